@@ -3,6 +3,23 @@ matlab = {}
 matlab['train_c'] = {}
 matlab['train_c']['LIBS'] = ['neuralnet', 'training']
 
+matlab['trainmany_c'] = {}
+matlab['trainmany_c']['LIBS'] = ['neuralnet', 'training']
+
+matlab['crossval_c'] = {}
+matlab['crossval_c']['LIBS'] = ['neuralnet', 'training']
+
+matlab['pcd_c'] = {}
+matlab['pcd_c']['LIBS'] = ['neuralnet', 'training']
+
 matlab['sim_c'] = {}
 matlab['sim_c']['LIBS'] = ['neuralnet']
 
+matlab['nsave_c'] = {}
+matlab['nsave_c']['LIBS'] = ['neuralnet']
+
+matlab['ncompile_c'] = {}
+matlab['ncompile_c']['LIBS'] = ['neuralnet']
+
+matlab['roc_c'] = {}
+matlab['roc_c']['LIBS'] = ['neuralnet']
@@ -0,0 +1,155 @@
+/**
+@file  activations.h
+@brief Transfer (activation) functions registry.
+
+  Each transfer function is applied to a whole layer at once, over a contiguous
+  buffer, so there is a single call per layer (instead of one call per node) and
+  the loops inside each function can be vectorized by the compiler.
+*/
+
+#ifndef ACTIVATIONS_H
+#define ACTIVATIONS_H
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+#include "fastnet/sys/defines.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /// Input value beyond which the tansig approximations (TRF_RATIONAL_ID and TRF_TABLE_ID) return +/-1.
+  const double TANSIG_CLAMP = 9.;
+
+  /// Points per unit of the TRF_TABLE_ID tansig table, which samples tanh over [0, TANSIG_CLAMP].
+  const unsigned TANSIG_TABLE_RES = 256;
+
+  /// Number of points of the tansig table (plus one extra point, so the interpolation never reads past the end).
+  const unsigned TANSIG_TABLE_SIZE = static_cast<unsigned>(TANSIG_CLAMP) * TANSIG_TABLE_RES + 2;
+
+  /// Coefficients of the TRF_RATIONAL_ID tansig, \f$ v P(v^2) / Q(v^2) \f$, highest degree first.
+  /**
+   Odd minimax rational approximation (degree 13 over degree 6) fitted over [-9, 9]. These are the
+   coefficients used by the Eigen library for its single precision tanh. They are shared by the
+   network and by the generated inference code (see codegen.h), which must give the same outputs.
+  */
+  const unsigned TANSIG_P_SIZE = 7;
+  const double TANSIG_P[TANSIG_P_SIZE] = {-2.76076847742355e-16, 2.00018790482477e-13, -8.60467152213735e-11,
+                                          5.12229709037114e-08, 1.48572235717979e-05, 6.37261928875436e-04,
+                                          4.89352455891786e-03};
+  const unsigned TANSIG_Q_SIZE = 4;
+  const double TANSIG_Q[TANSIG_Q_SIZE] = {1.19825839466702e-06, 1.18534705686654e-04, 2.26843463243900e-03,
+                                          4.89352518554385e-03};
+
+
+  /// Returns the TRF_RATIONAL_ID tansig of a value (the rational function of TANSIG_P and TANSIG_Q, by Horner's method).
+  template <class T>
+  inline T tansigRational(const T x)
+  {
+    const T v = min(max(x, static_cast<T>(-TANSIG_CLAMP)), static_cast<T>(TANSIG_CLAMP));
+    const T v2 = v*v;
+    T p = static_cast<T>(TANSIG_P[0]);
+    for (unsigned i=1; i<TANSIG_P_SIZE; i++) p = p*v2 + static_cast<T>(TANSIG_P[i]);
+    T q = static_cast<T>(TANSIG_Q[0]);
+    for (unsigned i=1; i<TANSIG_Q_SIZE; i++) q = q*v2 + static_cast<T>(TANSIG_Q[i]);
+    return (v*p) / q;
+  };
+
+
+  /// Returns the table of the TRF_TABLE_ID tansig (TANSIG_TABLE_SIZE values, built on the first call).
+  template <class T>
+  const T *getTansigTable();
+
+
+  /// Returns the TRF_TABLE_ID tansig of a value.
+  /**
+   The table holds only the positive half, since tanh is odd.
+   @param[in] table The table returned by getTansigTable.
+   @param[in] x The value.
+  */
+  template <class T>
+  inline T tansigTable(const T *table, const T x)
+  {
+    const T a = min(static_cast<T>(fabs(x)), static_cast<T>(TANSIG_CLAMP)) * TANSIG_TABLE_RES;
+    const unsigned i = static_cast<unsigned>(a);
+    const T frac = a - i;
+    const T y = table[i] + frac * (table[i+1] - table[i]);
+    return (x < 0) ? -y : y;
+  };
+
+
+  /**
+  @brief    A transfer function and its derivative, applied to a whole layer.
+  @param T The storage precision (float or double) of the network values.
+
+  The derivative is expressed as a function of the transfer function output (as
+  the training only keeps the layer outputs), and it is fused with the product by the
+  error sensibility (sigma), which is the only way the training uses it.
+  */
+  template <class T>
+  struct Activation
+  {
+    /// The transfer function ID (for instance, TGH_ID or LIN_ID).
+    string id;
+
+    /// Applies the transfer function to a layer.
+    /**
+     @param[in,out] x The values to be transformed (in place), usually the weighted sum of each node.
+     @param[in] n The number of values.
+    */
+    void (*apply)(T *x, const unsigned n);
+
+    /// Multiplies a vector by the transfer function derivative.
+    /**
+     @param[in] y The transfer function outputs (the layer outputs).
+     @param[in,out] d The values to be multiplied by the derivative (\f$ d[k] = d[k] f'(y[k]) \f$).
+     @param[in] n The number of values.
+    */
+    void (*deriv)(const T *y, T *d, const unsigned n);
+
+    /// The precision mode implemented (TRF_EXACT_ID, TRF_RATIONAL_ID or TRF_TABLE_ID).
+    /**
+     A transfer function may be registered several times with the same ID, once for each
+     precision mode. If left empty when registering, TRF_EXACT_ID is assumed.
+    */
+    string precision;
+  };
+
+
+  /// Returns a registered transfer function.
+  /**
+   The "tansig", "purelin", "logsig" and "poslin" (ReLU) transfer functions are always registered in
+   the exact precision mode. The "tansig" function also has approximated versions, which avoid calling
+   libm's tanh. Their maximum absolute error (with respect to tanh, for any input) are:
+    - TRF_EXACT_ID: libm's tanh (less than 1 ulp).
+    - TRF_RATIONAL_ID: 2.6e-8 with double, and 4e-7 with float (evaluated in single precision).
+      A degree 13/6 minimax rational function, clamped to +/-1 beyond |x| = 9.
+    - TRF_TABLE_ID: 1.5e-6 with either precision. Linear interpolation over a 256 points per unit
+      table, clamped beyond |x| = 9.
+
+   The derivative is the same (\f$ 1 - y^2 \f$) for every mode, calculated over the approximated outputs.
+   If the transfer function has no version for the requested precision, the exact version is returned.
+   Each storage precision (float or double) has its own registry, and only these two are instantiated.
+   @param[in] id The transfer function ID.
+   @param[in] precision The precision mode (TRF_EXACT_ID, TRF_RATIONAL_ID or TRF_TABLE_ID).
+   @return A pointer to the transfer function, or NULL if there is no transfer function with such ID.
+  */
+  template <class T>
+  const Activation<T> *getActivation(const string &id, const string &precision = TRF_EXACT_ID);
+
+
+  /// Registers a new transfer function.
+  /**
+   After registered, the transfer function can be used by any network, by means of its ID.
+   If a transfer function with the same ID and precision already exists, it is replaced. This function
+   is not thread safe, so all transfer functions must be registered before the networks are created.
+   @param[in] act The transfer function to register.
+  */
+  template <class T>
+  void registerActivation(const Activation<T> &act);
+}
+
+#endif
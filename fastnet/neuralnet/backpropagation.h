@@ -1,6 +1,6 @@
 /** 
 @file  backpropagation.h
-@brief The BackPropagation class declaration.
+@brief The BasicBackpropagation class template declaration.
 */
 
  
@@ -23,6 +23,7 @@ namespace FastNet
   @author    Rodrigo Coura Torres (torres@lps.ufrj.br)
   @version  1.0
   @date    14/11/2004
+  @param T The storage precision (float or double) of the weights, biases and layer outputs.
 
   This class implements the backpropagation training algorithm.
   it can perform either online and batch training, since the
@@ -33,15 +34,26 @@ namespace FastNet
   gradient will be used if multiple inputs were presented to the network. The class
   also automatically resets the accumulated values after an epoch, preparing itself
   for the next epoch, so the user just have to use the methods, without worring
-  about internal control.
+  about internal control. Whatever the storage precision is, the gradients are accumulated
+  in ACC_REAL, so the sum over many events does not lose the small contributions.
   */
-  class Backpropagation : public NeuralNetwork 
+  template <class T>
+  class BasicBackpropagation : public BasicNeuralNetwork<T>
   {
     protected:
+      using BasicNeuralNetwork<T>::arena;
+      using BasicNeuralNetwork<T>::weights;
+      using BasicNeuralNetwork<T>::bias;
+      using BasicNeuralNetwork<T>::layerOutputs;
+      using BasicNeuralNetwork<T>::nNodes;
+      using BasicNeuralNetwork<T>::usingBias;
+      using BasicNeuralNetwork<T>::trfFunc;
+      using BasicNeuralNetwork<T>::sparse;
+
       //Class attributes.
       
       /// The learning rate value to be used during the training process.
-      REAL learningRate;    
+      ACC_REAL learningRate;    
       
       /// The decreasing factor to be applied to the learning rate value, after each epoch.
       /**
@@ -50,7 +62,23 @@ namespace FastNet
         should be \f$0 < df \leq 1\f$, so that, if the decrease factor is 0.98, for instance, after each epoch,
         the learning rate will be decreased by 2% of its previously value.
       */
-      REAL decFactor;      
+      ACC_REAL decFactor;      
+
+      /// Holds the memory of the training tensors stored with the network precision.
+      /**
+       The saved weights and biases (savedW and savedB) are stored as parameter set SAVED_SET
+       and sigma as node set 0.
+      */
+      LayerArena<T> bpArena;
+
+      /// Holds the memory of the accumulated gradients (dw and db), as parameter set DELTA_SET.
+      LayerArena<ACC_REAL> gradArena;
+
+      /// Index, in gradArena, of the parameter set holding dw and db.
+      static const unsigned DELTA_SET = 0;
+
+      /// Index, in bpArena, of the parameter set holding savedW and savedB.
+      static const unsigned SAVED_SET = 0;
       
       /// Contains all the gradient of each node.
       /**
@@ -59,21 +87,21 @@ namespace FastNet
         the update weight values. This variable is dynamically allocated by the class
         and automatically released at the end.
       */
-      REAL **sigma;
+      T **sigma;
       
       /// Contains the delta weight values.
       /**
         Contains the update values for each weight. This variable is dynamically allocated by the class
         and automatically released at the end. 
       */
-      REAL ***dw;
+      ACC_REAL ***dw;
 
       /// Contains the delta biases values.
       /**
         Contains the update values for each bias. This variable is dynamically allocated by the class
         and automatically released at the end. 
       */
-      REAL **db;
+      ACC_REAL **db;
       
 
       /// The saving weights matrix.
@@ -83,7 +111,7 @@ namespace FastNet
         - y: the index of the node in layer x.
         - z: the index of the node in layer x-1.
       */
-      REAL ***savedW;
+      T ***savedW;
       
 
       /// Stores the entwork bias
@@ -92,7 +120,7 @@ namespace FastNet
         - x: the layer index (where 0 is the first hidden layer).
         - y: the index of the node in layer x.
       */
-      REAL **savedB;
+      T **savedB;
 
       /// Tells which nodes are frozen.
       /**
@@ -109,7 +137,70 @@ namespace FastNet
       */
       bool **frozenNode;
 
-      
+      /// The connections kept by each pruned layer (empty for the layers which are not pruned).
+      /**
+       The other connections of a pruned layer have zero weights, which are never trained: their
+       gradients are discarded by updateWeights, whichever kernels (dense or sparse) propagate the layer.
+       @see FastNet::BasicBackpropagation#setPruned
+      */
+      vector<SparseLayer> pruneMask;
+
+      /// The distance between two rows of the transposed block buffers (see TrainingWorkspace).
+      /**
+       A block of events plus a cache line, so the rows, written one value at a time
+       by the transposition, do not all map to the same cache sets.
+      */
+      static const unsigned TRANSPOSED_STRIDE = BasicNeuralNetwork<T>::BATCH_BLOCK + LayerArena<T>::ALIGNMENT / sizeof(T);
+
+
+      /// Holds the memory of the transposed weight matrices (see weightsT).
+      vector<T> transposedBuffer;
+
+      /// The row pointers of the transposed weight matrices.
+      vector<T*> transposedRows;
+
+      /// The transposed weight matrices, used by the batched error retropropagation.
+      /**
+       The dimensions (weightsT[x][z][y] = weights[x][y][z]) are as in weights, with the last two swapped,
+       and each row is padded as the weight rows. A row of weightsT holds, contiguously, the weights
+       from a node to every node of the next layer, so the sigma of a whole block of events is
+       calculated as a matrix product, by the same register blocked kernel as the propagation.
+       Only the layers given by usesTransposed have a valid copy.
+      */
+      vector<T**> weightsT;
+
+      /// Minimum number of nodes in a layer for the batched retropropagation through it to use the transposed weights.
+      /**
+       The sigma of each node is a dot product with as many values as the layer has nodes,
+       so, for narrower layers, accumulating the weight rows of every event is faster.
+      */
+      static const unsigned TRANSPOSED_MIN_NODES = 16;
+
+      /// Tells whether the batched retropropagation through a layer uses the transposed weights.
+      /**
+       @param[in] layer The layer whose weights are retropropagated through (where 0 is the first hidden layer).
+      */
+      bool usesTransposed(const unsigned layer) const {return (layer > 0) && (sparse[layer].empty()) && (nNodes[layer+1] >= TRANSPOSED_MIN_NODES);};
+
+      /// Copies the weights into the transposed weight matrices.
+      /**
+       It is called by every method changing the weights (updateWeights, readWeights and the
+       assignment), so the copy is refreshed once per weight update, and it is never written
+       while the training threads read it.
+      */
+      void transposeWeights();
+
+      /// Calculates the sigma of a hidden layer from the sigma of the next layer, for a single event.
+      /**
+       @param[in] layer The hidden layer (where 0 is the first hidden layer).
+       @param[in] sigmaNext The sigma of the nodes of layer+1.
+       @param[in] nodes The outputs of the nodes of the layer.
+       @param[out] sig Where to write the sigma of the nodes of the layer.
+      */
+      void retropropagateLayer(const unsigned layer, const T *sigmaNext, const T *nodes, T *sig) const;
+
+
+
       /// Retropropagates the error through the neural network.
       /**
        This method generatesthe error at the output of the network, comparing
@@ -119,7 +210,7 @@ namespace FastNet
        @param[in] output The output genarated by the neural network.
        @param[in] target The desired (target) output value.
       */
-      virtual void retropropagateError(const REAL *output, const REAL *target);
+      virtual void retropropagateError(const T *output, const T *target);
 
       //Dynamically allocates all the memory we need.
       /**
@@ -128,6 +219,146 @@ namespace FastNet
       */
       virtual void allocateSpace(const vector<unsigned> &nNodes);
 
+    public:
+      /// The buffers of a training thread.
+      /**
+       The const training methods (applySupervisedBatch and applySupervisedInput) do not change
+       the network: the intermediate values of the events and the accumulated gradients are kept
+       in a workspace. So the training threads share a single network (a single copy of the weights,
+       saved weights and training algorithm state), each one owning only its workspace, and the
+       gradients of the workspaces are added to the network (addToGradient) before the weights are
+       updated. A workspace can be used with any network with the same number of nodes in each layer.
+      */
+      class TrainingWorkspace
+      {
+        friend class BasicBackpropagation;
+
+        private:
+          /// Holds the memory of the accumulated gradients (dw and db), as parameter set DELTA_SET.
+          LayerArena<ACC_REAL> gradArena;
+
+          /// The accumulated weight gradients (as BasicBackpropagation::dw).
+          ACC_REAL ***dw;
+
+          /// The accumulated bias gradients (as BasicBackpropagation::db).
+          ACC_REAL **db;
+
+          /// Holds the memory of the block buffers below.
+          vector<T> buffer;
+
+          /// The outputs of each layer for a block of events (where 0 is the input layer).
+          /**
+           The events are stored one after the other, each one padded as the weight rows
+           (LayerArena::padded), as in the batched propagation.
+          */
+          vector<T*> nodes;
+
+          /// The sigma of each layer for a block of events (where 0 is the first hidden layer), as in nodes.
+          vector<T*> sigma;
+
+          /// The transposed inputs of the layer whose gradients are being accumulated.
+          /**
+           There is one row per input node, holding its value in every event of the block (the rows
+           are TRANSPOSED_STRIDE values apart). Together with sigmaT, the gradient of each weight becomes
+           a dot product over the events of the block.
+          */
+          T *nodesT;
+
+          /// The transposed sigma of the layer whose gradients are being accumulated (as nodesT).
+          T *sigmaT;
+
+          /// The trainable and the frozen nodes of the cached layer (see BasicBackpropagation::getCachedLayer).
+          vector<unsigned> trainRows;
+          vector<unsigned> frozenRows;
+
+          /// The outputs of some of the nodes of the cached layer, for a block of events (see propagateRowsBatch).
+          T *rowBuffer;
+
+          /// The buffers of the single event propagation.
+          typename BasicNeuralNetwork<T>::Workspace propagation;
+
+        public:
+          /// Creates the workspace for a given network, with zero gradients.
+          explicit TrainingWorkspace(const BasicBackpropagation &net);
+
+          /// Resets the accumulated gradients to zero.
+          void resetGradients()
+          {
+            memset(gradArena.getParams(DELTA_SET), 0, gradArena.paramSize()*sizeof(ACC_REAL));
+          };
+
+          /// Resets a slice of the accumulated gradients to zero.
+          /**
+           @param[in] begin The position of the first value, in the gradient vector (see getGradientSize).
+           @param[in] end The position after the last value.
+          */
+          void resetGradients(const size_t begin, const size_t end)
+          {
+            memset(gradArena.getParams(DELTA_SET) + begin, 0, (end - begin)*sizeof(ACC_REAL));
+          };
+      };
+
+    protected:
+      /// Returns the first node of a layer, from a given one, that is not frozen (or the number of nodes, if there is none).
+      unsigned nextTrainable(const unsigned layer, unsigned node) const
+      {
+        while ( (node < nNodes[layer+1]) && (frozenNode[layer][node]) ) node++;
+        return node;
+      };
+
+      /// Splits the nodes of a layer into the trainable and the frozen ones.
+      void splitFrozen(const unsigned layer, vector<unsigned> &train, vector<unsigned> &frozen) const;
+
+      /// Only the zero weights of the pruned layers are kept at zero by the training.
+      virtual bool hasFixedZeros(const unsigned layer) const {return isPruned(layer);};
+
+      /// Zeroes the values of a node row at the pruned connections of its layer (see setPruned).
+      /**
+       @param[in] layer The layer (where 0 is the first hidden layer).
+       @param[in] node The node.
+       @param[in,out] row The row of the node (its weights or their gradients).
+      */
+      template <class V>
+      void clearPruned(const unsigned layer, const unsigned node, V *row) const
+      {
+        const SparseLayer &mask = pruneMask[layer];
+        if (mask.empty()) return;
+        const unsigned *cols = mask.getCols(node);
+        const unsigned numCols = mask.getNumCols(node);
+        unsigned k = 0;
+        for (unsigned c=0; c<=numCols; c++)
+        {
+          const unsigned end = (c < numCols) ? cols[c] : nNodes[layer];
+          for (; k<end; k++) row[k] = 0;
+          k = end + 1;
+        }
+      };
+
+      /// Propagates a block of events through some of the nodes of a layer.
+      /**
+       The outputs are the same ones of propagateLayerBatch, for the given nodes.
+       @param[in] layer The layer (where 0 is the first hidden layer).
+       @param[in] rows The nodes to propagate.
+       @param[in] in The inputs of the layer, one event after the other.
+       @param[in] inStride The distance between two events in the inputs.
+       @param[in] nEvents The number of events.
+       @param[out] out Where to write the outputs of the given nodes (rows.size() values per event).
+       @param[in] outStride The distance between two events in the outputs.
+      */
+      void propagateRowsBatch(const unsigned layer, const vector<unsigned> &rows, const T *in, const unsigned inStride,
+                                const unsigned nEvents, T *out, const unsigned outStride) const;
+
+      /// Accumulates the gradients of a layer over the block of events in a workspace.
+      /**
+       The accumulation is done as a matrix product (sigma transposed times the layer inputs),
+       through the register blocked dot4x2 kernel, instead of one outer product per event.
+       The frozen nodes get no gradients.
+       @param[in] layer The layer (where 0 is the first hidden layer).
+       @param[in] nEvents The number of events in the block.
+       @param[in,out] ws The workspace holding the block, where the gradients are accumulated.
+      */
+      void accumulateBatch(const unsigned layer, const unsigned nEvents, TrainingWorkspace &ws) const;
+
     public:
       //Class virtual methods.
 
@@ -138,7 +369,26 @@ namespace FastNet
       applying sample parallelisum for the training, using multi-threads, for instance.
       @param[in] net The network from where to get the gradients from.
       */
-      virtual void addToGradient(const Backpropagation &net);
+      virtual void addToGradient(const BasicBackpropagation &net);
+
+      ///Adds the gradients accumulated in a workspace to the calling network.
+      /**
+      @param[in] ws The workspace (it is not reset).
+      */
+      void addToGradient(const TrainingWorkspace &ws);
+
+      ///Adds a slice of the gradients accumulated in a workspace to the calling network.
+      /**
+      The gradients (dw and db) are seen as a single vector, so several threads may reduce
+      the workspaces at the same time, each one over its own slice.
+      @param[in] ws The workspace (it is not reset).
+      @param[in] begin The position of the first value to add, in the gradient vector.
+      @param[in] end The position after the last value to add.
+      */
+      void addToGradient(const TrainingWorkspace &ws, const size_t begin, const size_t end);
+
+      /// Returns the number of values in the gradient vector (dw and db, including the padding).
+      size_t getGradientSize() const {return gradArena.paramSize();};
       
       /// Sets the freeze/unfreeze status of an specific node.
       /**
@@ -182,12 +432,70 @@ namespace FastNet
       bool isFrozen(unsigned layer) const;
 
 
+      /// Returns the first layer with a trainable node (the last layer, if every node is frozen).
+      /**
+       The layers before it have all their nodes frozen, so the training neither retropropagates
+       the error through them nor accumulates their gradients.
+       @return The layer (where 0 is the first hidden layer).
+      */
+      unsigned getCachedLayer() const;
+
+
+      /// Returns the number of values kept for each event by cacheFrozen (0, if there is nothing to cache).
+      unsigned getFrozenCacheSize() const;
+
+
+      /// Calculates the outputs of the frozen leading part of the network, for a set of events.
+      /**
+       For each event, the cache holds the inputs of the cached layer (see getCachedLayer), if it
+       is not the first one, followed by the outputs of its frozen nodes. Since the frozen weights
+       never change during a training, the cache is calculated once per data set, and then each epoch
+       only propagates the trainable nodes of the cached layer and the layers after it (see the cached
+       versions of applySupervisedBatch and applySupervisedInput), with exactly the same outputs.
+       The cache is valid while the frozen nodes and their weights are not changed.
+       @param[in] inputs The input events (one pointer per event).
+       @param[in] nEvents The number of events.
+       @param[out] cache Where to write the cache (getFrozenCacheSize() values per event, one event after the other).
+       @param[in,out] ws The workspace of the calling thread.
+      */
+      void cacheFrozen(const T * const *inputs, const unsigned nEvents, T *cache, TrainingWorkspace &ws) const;
+
+
       /// Defrost all nodes in the network.
       /**
        This method goes through the network and unfrost every node in each.
       */
       void defrostAll(){for (unsigned i=0; i<(nNodes.size()-1); i++) setFrozen(i, false);};
 
+      /// Sets the pruned/unpruned status of a layer.
+      /**
+       The connections of a pruned layer whose weights are zero (when it is pruned, or when the
+       weights are read again) are removed from the network: their weights stay at zero during
+       the training. The other weights of the layer are trained normally. This does not depend on the
+       kernels propagating the layer: only the pruned layers above SPARSE_THRESHOLD zero weights
+       are propagated by the sparse kernels, but the dense ones train exactly the same weights.
+       @param[in] layer The layer (where 0 is the first hidden layer).
+       @param[in] pruned If true, the zero weights of the layer are pruned, otherwise they are trained.
+      */
+      void setPruned(const unsigned layer, const bool pruned);
+
+      /// Tells if a layer is pruned (see setPruned).
+      /**
+       @param[in] layer The layer (where 0 is the first hidden layer).
+      */
+      bool isPruned(const unsigned layer) const {return !pruneMask[layer].empty();};
+
+      /// Initializes the weights and biases by the Nguyen-Widrow method.
+      /**
+       As Matlab's initnw (for inputs in [-1, 1]): each node gets random weights, normalized to the
+       magnitude 0.7*S^(1/R) (S is the number of nodes of the layer, and R the number of its inputs),
+       and the biases are spread over the same magnitude. The frozen nodes keep their weights and
+       biases, as in scrambleWeights.m, and the pruned connections stay at zero. The random numbers come from an engine seeded with the
+       given seed only, so the same seed always gives the same weights.
+       @param[in] seed The seed of the random engine.
+      */
+      void initWeights(const unsigned seed);
+
       /// Propagates and input event and calculates the MSE error obtained by comparing to a target output.
       /**
        This method should be used only in supervised
@@ -209,7 +517,32 @@ namespace FastNet
        this vector.
        @return The MSE error calculated.
       */
-      virtual REAL applySupervisedInput(const REAL *input, const REAL *target, const REAL* &output);
+      virtual ACC_REAL applySupervisedInput(const T *input, const T *target, const T* &output);
+
+      /// Propagates an input event and calculates the MSE error, without changing the network.
+      /**
+       Same as the method above, but the layer outputs are kept in a workspace, so several
+       threads may use the same network at the same time (for the validation, for instance).
+       @param[in] input The vector containing the input to be presented to the network.
+       @param[in] target The vector containing the desired output (target) of the network.
+       @param[out] output This pointer will point to the output generated by the network (inside the workspace).
+       @param[in,out] ws The workspace of the calling thread.
+       @return The MSE error calculated.
+      */
+      ACC_REAL applySupervisedInput(const T *input, const T *target, const T* &output, TrainingWorkspace &ws) const;
+
+      /// Propagates an input event from its cache and calculates the MSE error, without changing the network.
+      /**
+       Same as the method above, with the frozen leading part of the network taken from the cache of the event.
+       @param[in] input The vector containing the input to be presented to the network.
+       @param[in] cached The cache of the event (see cacheFrozen).
+       @param[in] target The vector containing the desired output (target) of the network.
+       @param[out] output This pointer will point to the output generated by the network (inside the workspace).
+       @param[in,out] ws The workspace of the calling thread.
+       @return The MSE error calculated.
+      */
+      ACC_REAL applySupervisedInput(const T *input, const T *cached, const T *target, const T* &output,
+                                      TrainingWorkspace &ws) const;
 
 
       /// Writes the weights in a memory buffer.
@@ -225,11 +558,8 @@ namespace FastNet
       */
       virtual void saveBestTrain()
       {
-        for (unsigned i=0; i<(nNodes.size()-1); i++)
-        {
-          memcpy(savedB[i], bias[i], nNodes[(i+1)]*sizeof(REAL));
-          for (unsigned j=0; j<nNodes[(i+1)]; j++) memcpy(savedW[i][j], weights[i][j], nNodes[i]*sizeof(REAL));
-        }
+        //Weights and biases are contiguous in the arena, so a single copy saves them all.
+        memcpy(bpArena.getParams(SAVED_SET), arena.getParams(0), arena.paramSize()*sizeof(T));
 
 #ifdef DEBUG
         DEBUG2("##### Saving Best Train Weights: #######")
@@ -258,7 +588,52 @@ namespace FastNet
        @param[in] output The output generated by the network after the feedforward process.
        @param[in] target The desired (target) output.
       */
-      virtual void calculateNewWeights(const REAL *output, const REAL *target);
+      virtual void calculateNewWeights(const T *output, const T *target);
+
+      /// Propagates a set of events and accumulates their gradients, as a batch.
+      /**
+       This method gives the same gradients as calling applySupervisedInput and calculateNewWeights
+       for every event (except for rounding), but the events are processed in blocks of BATCH_BLOCK
+       events. Each block is propagated layer by layer as in propagateBatch, the sigma of the whole
+       block is retropropagated, and the gradients are accumulated as one matrix product per layer,
+       so the weights and the gradients are read once per block, instead of once per event.
+       Within a block, the gradients are summed with the storage precision, and then added to the
+       ACC_REAL accumulators. The error is not retropropagated before the cached layer (see getCachedLayer),
+       and the frozen nodes get no gradients, so the cost grows with the trainable nodes only.
+       The network is not changed: the gradients are accumulated in the
+       workspace, so several threads may train the same network at the same time.
+       @param[in] inputs The input events (one pointer per event).
+       @param[in] targets The desired (target) outputs (one pointer per event).
+       @param[in] nEvents The number of events.
+       @param[in,out] ws The workspace of the calling thread.
+       @return The sum of the MSE errors of the events (as given by applySupervisedInput).
+      */
+      ACC_REAL applySupervisedBatch(const T * const *inputs, const T * const *targets, const unsigned nEvents,
+                                      TrainingWorkspace &ws) const {return applySupervisedBatch(inputs, NULL, targets, nEvents, ws);};
+
+      /// Propagates a set of events, from their caches, and accumulates their gradients, as a batch.
+      /**
+       Same as the method above, with the frozen leading part of the network taken from the cache of
+       each event, so only the trainable nodes are propagated (see cacheFrozen).
+       @param[in] inputs The input events (one pointer per event).
+       @param[in] cached The cache of each event (one pointer per event), or NULL to propagate the whole network.
+       @param[in] targets The desired (target) outputs (one pointer per event).
+       @param[in] nEvents The number of events.
+       @param[in,out] ws The workspace of the calling thread.
+       @return The sum of the MSE errors of the events.
+      */
+      ACC_REAL applySupervisedBatch(const T * const *inputs, const T * const *cached, const T * const *targets,
+                                      const unsigned nEvents, TrainingWorkspace &ws) const;
+
+      /// Propagates a set of events and accumulates their gradients in the network, as a batch.
+      /**
+       Same as the method above, using a temporary workspace whose gradients are then added to the network.
+       @param[in] inputs The input events (one pointer per event).
+       @param[in] targets The desired (target) outputs (one pointer per event).
+       @param[in] nEvents The number of events.
+       @return The sum of the MSE errors of the events.
+      */
+      virtual ACC_REAL applySupervisedBatch(const T * const *inputs, const T * const *targets, const unsigned nEvents);
 
       /// Updates the weight and biases matrices.
       /**
@@ -278,12 +653,12 @@ namespace FastNet
       @param[in] learningRate the algorithm learning rate
       @param[in] decFactor the algorithm decreasing factor.
       */
-      Backpropagation(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, 
-                                                      const std::vector<bool> &usingBias,  const REAL learningRate = 0.05,
-                                                      const REAL decFactor = 1);
+      BasicBackpropagation(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, 
+                                                      const std::vector<bool> &usingBias,  const ACC_REAL learningRate = 0.05,
+                                                      const ACC_REAL decFactor = 1);
 
       ///Copy constructor
-      Backpropagation(const Backpropagation &net);
+      BasicBackpropagation(const BasicBackpropagation &net);
 
 
       /// Returns a clone of the object.
@@ -292,13 +667,13 @@ namespace FastNet
       so it must be released with delete at the end of its use.
       @return A dynamically allocated clone of the calling object.
       */
-      virtual NeuralNetwork *clone(){return new Backpropagation(*this);} 
+      virtual BasicNeuralNetwork<T> *clone(){return new BasicBackpropagation(*this);} 
       
       /// Class destructor.
       /**
        Releases all the dynamically allocated memory used by the class.
       */
-      virtual ~Backpropagation();
+      virtual ~BasicBackpropagation();
       
       
       /// Gives the neural network information.
@@ -317,18 +692,31 @@ namespace FastNet
         the calling object. The space for weights and bias info must have been previously created.
         @param[in] net The network from where to copy the data from.
       */
-      virtual void operator=(const Backpropagation &net);
+      virtual void operator=(const BasicBackpropagation &net);
 
-      virtual void readWeights(const REAL ***w, const REAL **b)
+      virtual void readWeights(const T ***w, const T **b)
       {
-            NeuralNetwork::readWeights(w, b);
+            BasicNeuralNetwork<T>::readWeights(w, b);
+            //The zero weights just read are the pruned connections of the pruned layers.
+            for (unsigned i=0; i<(nNodes.size()-1); i++)
+            {
+              if (isPruned(i)) pruneMask[i] = SparseLayer(weights[i], nNodes[i], nNodes[i+1]);
+            }
+            transposeWeights();
             //The savedW and savedB matrices are initialized with the read weights and biases values.
             saveBestTrain();
       }
 
-      virtual const REAL***getSavedWeights() const {return (const REAL***) savedW;};
-      virtual const REAL**getSavedBias() const {return (const REAL**)  savedB;};
+      virtual const T***getSavedWeights() const {return (const T***) savedW;};
+      virtual const T**getSavedBias() const {return (const T**)  savedB;};
   };
+
+
+  /// Backpropagation training with the default precision (REAL).
+  typedef BasicBackpropagation<REAL> Backpropagation;
+
+  /// Backpropagation training in single precision.
+  typedef BasicBackpropagation<float> BackpropagationF;
 }
 
 #endif
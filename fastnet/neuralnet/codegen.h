@@ -0,0 +1,58 @@
+/**
+@file  codegen.h
+@brief Generator of dependency free C/C++ inference code for trained networks.
+
+  The generated source file holds the weights as constant arrays and a single, fully
+  unrolled, inference function. It can be compiled into any C (C99) or C++ program,
+  without linking the FastNet libraries (for instance, in the online trigger software).
+*/
+
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include <string>
+#include <ostream>
+
+#include "fastnet/sys/defines.h"
+#include "fastnet/neuralnet/neuralnetwork.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /// Writes the inference source code of a network.
+  /**
+   The generated function has the prototype
+   <tt>void funcName(const T *input, T *output)</tt>, where T is the storage precision of the network
+   (double or float). It calculates the weighted sum of each node as a single expression (the zero weights,
+   of pruned networks, are left out), followed by the node transfer function. The transfer functions are
+   generated as inline functions implementing the network precision mode (see FastNet::getActivation).
+   The weights are written with enough digits to be read back exactly, and they are declared as
+   <tt>static constexpr</tt> arrays in C++ (<tt>static const</tt> in C). Every generated name starts with
+   funcName, so several networks may be generated into the same program.
+
+   Since the weighted sums are calculated in another order, the outputs may differ from the ones
+   calculated by the network by rounding.
+   @param[out] out Where to write the source code.
+   @param[in] net The network.
+   @param[in] funcName The name of the inference function (a valid C identifier).
+   @throw const char* If the function name is not valid, or if the network uses a transfer
+   function that is not built in (a registered one).
+  */
+  template <class T>
+  void generateSource(ostream &out, const BasicNeuralNetwork<T> &net, const string &funcName);
+
+
+  /// Writes the inference source code of a network to a file.
+  /**
+   @param[in] fileName The name of the file to create (it is overwritten, if it exists).
+   @param[in] net The network.
+   @param[in] funcName The name of the inference function (a valid C identifier).
+   @throw const char* If the file can not be written, or as in the method above.
+  */
+  template <class T>
+  void generateSource(const string &fileName, const BasicNeuralNetwork<T> &net, const string &funcName);
+}
+
+#endif
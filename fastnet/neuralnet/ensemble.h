@@ -0,0 +1,148 @@
+/**
+@file  ensemble.h
+@brief BasicEnsemble class template declaration.
+
+  Propagates the same events through many networks (for instance, the networks
+  trained in a cross validation) in a single pass over the data.
+*/
+
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "fastnet/sys/defines.h"
+#include "fastnet/neuralnet/neuralnetwork.h"
+#include "fastnet/neuralnet/layerarena.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /**
+  @brief    A set of networks evaluated together, sharing each pass over the events.
+  @param T The storage precision (float or double) of the weights and layer outputs.
+
+  The networks must have the same number of inputs and outputs, but their hidden layers may
+  differ. The first layer weights of every member are packed, one member after the other, into a
+  single weight matrix, so each block of BATCH_BLOCK events is read from memory once and multiplied
+  by the first layers of all the members while it is in cache (the first layer, which reads the events,
+  is usually the largest one). The remaining layers of each member are then propagated over the
+  (small) first layer outputs of the block. The outputs are bit by bit equal to the ones obtained by
+  propagating the events through each member separately.
+  */
+  template <class T>
+  class BasicEnsemble
+  {
+    private:
+      /// Copies of the member networks (used for the layers after the first one).
+      vector<BasicNeuralNetwork<T>*> members;
+
+      /// The packed first layer weights and biases (a single layer of nFirst nodes).
+      LayerArena<T> firstLayer;
+
+      /// Position of the first layer nodes of each member in the packed layer.
+      vector<unsigned> firstOffset;
+
+      /// Total number of first layer nodes (of all the members).
+      unsigned nFirst;
+
+      /// Number of inputs and outputs of every member.
+      unsigned nIn, nOut;
+
+      /// Number of events propagated together.
+      static const unsigned BATCH_BLOCK = BasicNeuralNetwork<T>::BATCH_BLOCK;
+
+      //Ensembles can not be copied.
+      BasicEnsemble(const BasicEnsemble &);
+      void operator=(const BasicEnsemble &);
+
+    public:
+      /// Buffers for the intermediate values of a block of events.
+      /**
+       Each thread must use its own workspace.
+      */
+      class Workspace
+      {
+        friend class BasicEnsemble;
+
+        private:
+          /// The packed first layer outputs of a block.
+          vector<T> first;
+
+          /// Two buffers, used alternately by the other hidden layers of each member.
+          vector<T> buffer;
+
+          /// The outputs of a member for a block.
+          vector<T> output;
+
+          /// The size of each of the two buffers.
+          size_t bufferSize;
+
+        public:
+          /// Creates the workspace for a given ensemble.
+          explicit Workspace(const BasicEnsemble &ens)
+          {
+            unsigned maxStride = 0;
+            for (unsigned m=0; m<ens.members.size(); m++)
+            {
+              const BasicNeuralNetwork<T> &net = *ens.members[m];
+              for (unsigned i=2; i<(net.getNumLayers()-1); i++) maxStride = std::max(maxStride, LayerArena<T>::padded(net[i]));
+            }
+            first.resize(BATCH_BLOCK * LayerArena<T>::padded(ens.nFirst));
+            bufferSize = BATCH_BLOCK * maxStride;
+            buffer.resize(2*bufferSize);
+            output.resize(BATCH_BLOCK * ens.nOut);
+          };
+      };
+
+      /// Creates an ensemble from a set of networks.
+      /**
+       The networks are copied, so they may be released after the ensemble is created.
+       @param[in] nets The member networks.
+       @throw const char* If no network is given, or if the networks have different input or output sizes.
+      */
+      explicit BasicEnsemble(const vector<const BasicNeuralNetwork<T>*> &nets);
+
+      /// Releases the member networks.
+      ~BasicEnsemble();
+
+      /// Propagates a set of events through every member.
+      /**
+       @param[in] inputs The input events, one after the other (nEvents x getNumInputs() values).
+       @param[in] nEvents The number of events to propagate.
+       @param[out] outputs Where to write the outputs (nEvents x getNumOutputs() x size() values), where
+       the output o of member m for event e is outputs[(e*getNumOutputs() + o)*size() + m]. As a Matlab array,
+       this is a (size() x getNumOutputs() x nEvents) matrix.
+       @param[in,out] ws The workspace of the calling thread.
+      */
+      void propagateBatch(const T *inputs, const size_t nEvents, T *outputs, Workspace &ws) const;
+
+      /// Propagates a set of events through every member, using a local workspace.
+      void propagateBatch(const T *inputs, const size_t nEvents, T *outputs) const;
+
+      /// Gets the number of member networks.
+      unsigned size() const {return members.size();};
+
+      /// Gets the number of inputs of the members.
+      unsigned getNumInputs() const {return nIn;};
+
+      /// Gets the number of outputs of the members.
+      unsigned getNumOutputs() const {return nOut;};
+
+      /// Gets a member network.
+      const BasicNeuralNetwork<T> &operator[](const unsigned m) const {return *members[m];};
+  };
+
+
+  /// Ensemble of networks stored with the default precision (REAL).
+  typedef BasicEnsemble<REAL> Ensemble;
+
+  /// Ensemble of networks stored in single precision.
+  typedef BasicEnsemble<float> EnsembleF;
+}
+
+#endif
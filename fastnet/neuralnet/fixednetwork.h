@@ -0,0 +1,360 @@
+/**
+@file  fixednetwork.h
+@brief FixedNetwork class template declaration.
+
+  Inference only networks whose topology and transfer functions are known at
+  compile time. They are meant for the small networks used in online triggering,
+  where the per event latency matters more than flexibility.
+*/
+
+#ifndef FIXEDNETWORK_H
+#define FIXEDNETWORK_H
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+#include "fastnet/sys/defines.h"
+#include "fastnet/neuralnet/activations.h"
+#include "fastnet/neuralnet/neuralnetwork.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /// Hyperbolic tangent transfer function, for fixed topology networks.
+  struct TansigTrf
+  {
+    /// The transfer function ID, as used by NeuralNetwork.
+    static const string &id() {return TGH_ID;};
+
+    /// The transfer function precision mode, as used by NeuralNetwork (see getActivation).
+    static const string &precision() {return TRF_EXACT_ID;};
+
+    /// Returns \f$ \tanh(val) \f$.
+    static REAL apply(const REAL val) {return tanh(val);};
+  };
+
+
+  /// Hyperbolic tangent transfer function, in the rational precision mode (see getActivation).
+  struct TansigRationalTrf
+  {
+    /// The transfer function ID, as used by NeuralNetwork.
+    static const string &id() {return TGH_ID;};
+
+    /// The transfer function precision mode, as used by NeuralNetwork.
+    static const string &precision() {return TRF_RATIONAL_ID;};
+
+    /// Returns the rational approximation of \f$ \tanh(val) \f$.
+    static REAL apply(const REAL val) {return tansigRational(val);};
+  };
+
+
+  /// Hyperbolic tangent transfer function, in the table precision mode (see getActivation).
+  struct TansigTableTrf
+  {
+    /// The transfer function ID, as used by NeuralNetwork.
+    static const string &id() {return TGH_ID;};
+
+    /// The transfer function precision mode, as used by NeuralNetwork.
+    static const string &precision() {return TRF_TABLE_ID;};
+
+    /// Returns the interpolation of \f$ \tanh(val) \f$ over the tansig table.
+    static REAL apply(const REAL val)
+    {
+      static const REAL *table = getTansigTable<REAL>();
+      return tansigTable(table, val);
+    };
+  };
+
+
+  /// Linear transfer function, for fixed topology networks.
+  struct PurelinTrf
+  {
+    /// The transfer function ID, as used by NeuralNetwork.
+    static const string &id() {return LIN_ID;};
+
+    /// The transfer function precision mode, as used by NeuralNetwork.
+    static const string &precision() {return TRF_EXACT_ID;};
+
+    /// Returns val.
+    static REAL apply(const REAL val) {return val;};
+  };
+
+
+  /// Logistic sigmoid transfer function, for fixed topology networks.
+  struct LogsigTrf
+  {
+    /// The transfer function ID, as used by NeuralNetwork.
+    static const string &id() {return LOGSIG_ID;};
+
+    /// The transfer function precision mode, as used by NeuralNetwork.
+    static const string &precision() {return TRF_EXACT_ID;};
+
+    /// Returns \f$ 1 / (1 + e^{-val}) \f$.
+    static REAL apply(const REAL val) {return 1 / (1 + exp(-val));};
+  };
+
+
+  /// Positive linear (ReLU) transfer function, for fixed topology networks.
+  struct PoslinTrf
+  {
+    /// The transfer function ID, as used by NeuralNetwork.
+    static const string &id() {return POSLIN_ID;};
+
+    /// The transfer function precision mode, as used by NeuralNetwork.
+    static const string &precision() {return TRF_EXACT_ID;};
+
+    /// Returns \f$ \max(val, 0) \f$.
+    static REAL apply(const REAL val) {return (val > 0) ? val : 0;};
+  };
+
+
+  /// Tells whether a fixed network transfer function is the one a NeuralNetwork applies to a layer.
+  /**
+   Both the ID and the precision mode must match. The precision is the one of the transfer function the
+   network actually uses (see getActivation), so, for instance, a linear layer always matches PurelinTrf.
+   @param[in] net The network.
+   @param[in] layer The layer index (where 0 is the first hidden layer).
+  */
+  template <class Trf>
+  bool trfMatches(const NeuralNetwork &net, const unsigned layer)
+  {
+    if (net.getTrfFunc(layer) != Trf::id()) return false;
+    const Activation<REAL> *act = getActivation<REAL>(Trf::id(), net.getTrfPrecision());
+    return (act) && (act->precision == Trf::precision());
+  };
+
+
+  /// List of the transfer functions of each layer of a FixedNetwork.
+  /**
+   There must be one transfer function per layer, excluding the input layer. For instance,
+   TrfFuncs<TansigTrf, PurelinTrf> for a network with a hyperbolic tangent hidden layer and a linear output.
+  */
+  template <class... Trf> struct TrfFuncs {};
+
+
+  /**
+  @brief    A single fully connected layer with compile time sizes.
+
+  The weights are stored transposed (w[prevNode][node]), so the propagation
+  loop goes through the inputs once, updating all nodes of the layer at the same time.
+  This gives NOut independent sums (which the compiler maps to SIMD registers), instead
+  of a single long dependency chain per node. Each sum still starts from the bias and follows
+  the inputs order, as in NeuralNetwork::propagateInput.
+  */
+  template <unsigned NIn, unsigned NOut, class Trf>
+  class FixedLayer
+  {
+    private:
+      /// The transposed weights (w[prevNode*NOut + node]).
+      alignas(64) REAL w[NIn*NOut];
+
+      /// The biases.
+      alignas(64) REAL b[NOut];
+
+    public:
+      /// Copies the weights and biases of a layer from a NeuralNetwork.
+      /**
+       @param[in] net The network to copy the values from.
+       @param[in] layer The layer index (where 0 is the first hidden layer).
+      */
+      void read(const NeuralNetwork &net, const unsigned layer)
+      {
+        for (unsigned j=0; j<NOut; j++)
+        {
+          b[j] = net.getBias(layer, j);
+          for (unsigned k=0; k<NIn; k++) w[k*NOut + j] = net.getWeight(layer, j, k);
+        }
+      };
+
+      /// Propagates an input vector through the layer.
+      /**
+       @param[in] in The layer input (NIn values).
+       @param[out] out The layer output (NOut values).
+      */
+      void propagate(const REAL *in, REAL *out) const
+      {
+        REAL acc[NOut];
+        for (unsigned j=0; j<NOut; j++) acc[j] = b[j];
+        for (unsigned k=0; k<NIn; k++)
+        {
+          const REAL x = in[k];
+          const REAL *wk = w + k*NOut;
+          for (unsigned j=0; j<NOut; j++) acc[j] += x * wk[j];
+        }
+        for (unsigned j=0; j<NOut; j++) out[j] = Trf::apply(acc[j]);
+      };
+  };
+
+
+  /// Chain of fixed layers (one layer plus the remaining chain).
+  template <class Trfs, unsigned... N> class FixedLayerChain;
+
+  /// Chain of fixed layers, general case (two or more layers).
+  template <class Trf, class... TrfTail, unsigned N0, unsigned N1, unsigned N2, unsigned... NTail>
+  class FixedLayerChain<TrfFuncs<Trf, TrfTail...>, N0, N1, N2, NTail...>
+  {
+    private:
+      /// The first layer of the chain.
+      FixedLayer<N0, N1, Trf> layer;
+
+      /// The remaining layers.
+      FixedLayerChain<TrfFuncs<TrfTail...>, N1, N2, NTail...> next;
+
+    public:
+      /// Copies the weights of this chain from a NeuralNetwork, starting at a given layer.
+      void read(const NeuralNetwork &net, const unsigned first)
+      {
+        layer.read(net, first);
+        next.read(net, first+1);
+      };
+
+      /// Checks if the transfer functions of this chain match the ones of a NeuralNetwork.
+      static bool matches(const NeuralNetwork &net, const unsigned first)
+      {
+        return trfMatches<Trf>(net, first) && FixedLayerChain<TrfFuncs<TrfTail...>, N1, N2, NTail...>::matches(net, first+1);
+      };
+
+      /// Propagates an input vector through the chain (the intermediate outputs live in the stack).
+      void propagate(const REAL *in, REAL *out) const
+      {
+        REAL aux[N1];
+        layer.propagate(in, aux);
+        next.propagate(aux, out);
+      };
+  };
+
+  /// Chain of fixed layers, last layer.
+  template <class Trf, unsigned N0, unsigned N1>
+  class FixedLayerChain<TrfFuncs<Trf>, N0, N1>
+  {
+    private:
+      /// The output layer.
+      FixedLayer<N0, N1, Trf> layer;
+
+    public:
+      /// Copies the weights of this layer from a NeuralNetwork.
+      void read(const NeuralNetwork &net, const unsigned first) {layer.read(net, first);};
+
+      /// Checks if the transfer function of this layer matches the one of a NeuralNetwork.
+      static bool matches(const NeuralNetwork &net, const unsigned first) {return trfMatches<Trf>(net, first);};
+
+      /// Propagates an input vector through the output layer.
+      void propagate(const REAL *in, REAL *out) const {layer.propagate(in, out);};
+  };
+
+
+  /// Helper to get the first and last values of a list of layer sizes.
+  template <unsigned... N> struct FixedTopology;
+
+  template <unsigned N0, unsigned... NTail>
+  struct FixedTopology<N0, NTail...>
+  {
+    static const unsigned numLayers = 1 + sizeof...(NTail);
+    static const unsigned numInputs = N0;
+    static const unsigned numOutputs = FixedTopology<NTail...>::numOutputs;
+  };
+
+  template <unsigned N0>
+  struct FixedTopology<N0>
+  {
+    static const unsigned numLayers = 1;
+    static const unsigned numInputs = N0;
+    static const unsigned numOutputs = N0;
+  };
+
+
+  /**
+  @brief    Neural network with topology and transfer functions fixed at compile time.
+
+  The layer sizes (including the input layer) and the transfer function of each layer are template
+  parameters, so every loop has a constant trip count (and is unrolled and vectorized by the compiler),
+  the weights are stored inline in the object and the transfer functions are called directly,
+  instead of through the function pointers NeuralNetwork fetches from the activation registry
+  (see getActivation). For instance, a 100-10-1 network with
+  hyperbolic tangent in both layers is declared as:
+  @code
+    FixedNetwork<TrfFuncs<TansigTrf, TansigTrf>, 100, 10, 1> fixedNet(net);
+  @endcode
+  The tansig layers of a network using an approximated tansig (see NeuralNetwork::setTrfPrecision)
+  must be declared with TansigRationalTrf or TansigTableTrf, so both networks give the same outputs.
+  This class only performs inference. The network must be trained with a NeuralNetwork
+  derived class, and then converted by the constructor below.
+  */
+  template <class Trfs, unsigned... N>
+  class FixedNetwork
+  {
+    private:
+      /// The network layers.
+      FixedLayerChain<Trfs, N...> layers;
+
+      /// The output of the last call to propagateInput.
+      REAL output[FixedTopology<N...>::numOutputs];
+
+    public:
+      /// Number of layers, including the input layer.
+      static const unsigned NUM_LAYERS = FixedTopology<N...>::numLayers;
+
+      /// Number of network inputs.
+      static const unsigned NUM_INPUTS = FixedTopology<N...>::numInputs;
+
+      /// Number of network outputs.
+      static const unsigned NUM_OUTPUTS = FixedTopology<N...>::numOutputs;
+
+      /// Builds a fixed network from a trained network.
+      /**
+       The weights and biases are copied from the network, which must have exactly
+       the same topology and transfer functions (including their precision modes) as the ones given as
+       template parameters.
+       @param[in] net The network to copy the values from.
+       @throw const char* If the network topology or transfer functions do not match.
+      */
+      explicit FixedNetwork(const NeuralNetwork &net)
+      {
+        const unsigned nNodes[] = {N...};
+        if (net.getNumLayers() != NUM_LAYERS) throw "The network number of layers does not match the fixed network!";
+        for (unsigned i=0; i<NUM_LAYERS; i++)
+        {
+          if (net[i] != nNodes[i]) throw "The network layer sizes do not match the fixed network!";
+        }
+        if (!FixedLayerChain<Trfs, N...>::matches(net, 0)) throw "The network transfer functions (or their precision) do not match the fixed network!";
+
+        layers.read(net, 0);
+      };
+
+      /// Propagates the input through the network.
+      /**
+       This method does not change the network, so it can be called simultaneously from multiple threads.
+       @param[in] input The network's input vector (NUM_INPUTS values).
+       @param[out] out Where to write the network output (NUM_OUTPUTS values).
+      */
+      void propagate(const REAL *input, REAL *out) const {layers.propagate(input, out);};
+
+      /// Propagates the input through the network.
+      /**
+       Same interface as NeuralNetwork::propagateInput.
+       @param[in] input The network's input vector (NUM_INPUTS values).
+       @return A pointer to the network's output, valid until the next call.
+      */
+      const REAL *propagateInput(const REAL *input)
+      {
+        layers.propagate(input, output);
+        return output;
+      };
+
+      /// Propagates a set of events through the network.
+      /**
+       @param[in] inputs The input events, one after the other (nEvents x NUM_INPUTS values).
+       @param[in] nEvents The number of events to propagate.
+       @param[out] outputs Where to write the network outputs, one after the other (nEvents x NUM_OUTPUTS values).
+      */
+      void propagateBatch(const REAL *inputs, const size_t nEvents, REAL *outputs) const
+      {
+        for (size_t e=0; e<nEvents; e++) layers.propagate(inputs + e*NUM_INPUTS, outputs + e*NUM_OUTPUTS);
+      };
+  };
+}
+
+#endif
@@ -0,0 +1,212 @@
+/**
+@file  kernels.h
+@brief Numerical kernels used by the network propagation and training loops.
+
+  The kernels are implemented for several instruction sets (scalar, SSE2, AVX2 and AVX-512)
+  and for both storage precisions (float and double). The best implementation supported by
+  the running processor is selected once, the first time getKernels() is called, so the same
+  binary runs with the fastest available code on every machine.
+*/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdint.h>
+
+#include "fastnet/sys/defines.h"
+
+
+namespace FastNet
+{
+  /**
+  @brief    Table of numerical kernels for a given instruction set.
+  @param T The storage precision (float or double) of the network values.
+
+  Every kernel works on contiguous vectors, and none of them requires aligned
+  data. For the same kernel table, dot() and dot4x2() are guaranteed to produce
+  exactly the same values for the same pair of vectors, so single event and
+  batched propagation give identical outputs. The gradients and the RProp learning
+  rates are always kept in ACC_REAL, whatever the storage precision is.
+  */
+  template <class T>
+  struct Kernels
+  {
+    /// The name of the instruction set ("scalar", "sse2", "avx2" or "avx512").
+    const char *name;
+
+    /// Dot product of two vectors.
+    /**
+     @param[in] x The first vector.
+     @param[in] y The second vector.
+     @param[in] n The size of the vectors.
+     @return \f$ \sum\limits_{k=0}^{n-1} x[k] y[k] \f$.
+    */
+    T (*dot)(const T *x, const T *y, const unsigned n);
+
+    /// Dot products between 4 input vectors and 2 weight vectors.
+    /**
+     This is the register blocked kernel used by the batched propagation. Each
+     loaded value is used in 2 (inputs) or 4 (weights) dot products.
+     @param[in] x The first input vector. The others follow at x + e*xStride.
+     @param[in] xStride The distance between two consecutive input vectors.
+     @param[in] w The first weight vector. The second one is at w + wStride.
+     @param[in] wStride The distance between the two weight vectors.
+     @param[in] n The size of the vectors.
+     @param[out] res The 8 dot products, where res[2*e + j] is the dot product between input e and weight j.
+    */
+    void (*dot4x2)(const T *x, const unsigned xStride, const T *w, const unsigned wStride, const unsigned n, T *res);
+
+    /// Accumulates a scaled vector into another one (\f$ y = y + a x \f$).
+    /**
+     Used for the error retropropagation.
+     @param[in] a The scale factor.
+     @param[in] x The vector to be scaled.
+     @param[in,out] y The vector where a*x will be accumulated into.
+     @param[in] n The size of the vectors.
+    */
+    void (*axpy)(const T a, const T *x, T *y, const unsigned n);
+
+    /// Accumulates a scaled vector into an accumulator vector (\f$ y = y + a x \f$).
+    /**
+     Used for the gradients accumulation (outer product between sigma and the layer inputs).
+     @param[in] a The scale factor.
+     @param[in] x The vector to be scaled.
+     @param[in,out] y The accumulator vector.
+     @param[in] n The size of the vectors.
+    */
+    void (*accumulate)(const ACC_REAL a, const T *x, ACC_REAL *y, const unsigned n);
+
+    /// Adds a scaled accumulator vector to a vector (\f$ y = y + a x \f$).
+    /**
+     Used for the gradient descent weights update.
+     @param[in] a The scale factor.
+     @param[in] x The accumulator vector to be scaled.
+     @param[in,out] y The vector to be updated.
+     @param[in] n The size of the vectors.
+    */
+    void (*update)(const ACC_REAL a, const ACC_REAL *x, T *y, const unsigned n);
+
+    /// Applies the RProp update rule to a vector of weights.
+    /**
+     For each weight, the learning rate (delta) is increased by incEta (up to deltaMax) if the gradient kept its
+     sign, or decreased by decEta (down to deltaMin) if the sign has changed. The weight is then moved
+     by delta in the direction of the gradient, the gradient is saved in prevD and reset to zero.
+     @param[in,out] w The weights.
+     @param[in,out] d The accumulated gradients (zero at the end).
+     @param[in,out] prevD The gradients of the previous epoch.
+     @param[in,out] delta The learning rate of each weight.
+     @param[in] n The size of the vectors.
+    */
+    void (*rprop)(T *w, ACC_REAL *d, ACC_REAL *prevD, ACC_REAL *delta, const unsigned n,
+                    const ACC_REAL incEta, const ACC_REAL decEta, const ACC_REAL deltaMin, const ACC_REAL deltaMax);
+
+    /// Dot product over the nonzero weights of a sparse weight row (see SparseLayer).
+    /**
+     The weights are read from the dense row, only at the given columns.
+     @param[in] x The input vector.
+     @param[in] w The (dense) weight row.
+     @param[in] cols The columns of the nonzero weights.
+     @param[in] nnz The number of nonzero weights.
+     @return \f$ \sum\limits_{k=0}^{nnz-1} x[cols[k]] w[cols[k]] \f$.
+    */
+    T (*sparseDot)(const T *x, const T *w, const unsigned *cols, const unsigned nnz);
+
+    /// Sparse dot products between 4 input vectors and a sparse weight row.
+    /**
+     Used by the batched propagation: each column index and weight is loaded once for the 4 inputs.
+     The results are exactly the same as the ones from sparseDot.
+     @param[in] x The first input vector. The others follow at x + e*xStride.
+     @param[in] xStride The distance between two consecutive input vectors.
+     @param[in] w The (dense) weight row.
+     @param[in] cols The columns of the nonzero weights.
+     @param[in] nnz The number of nonzero weights.
+     @param[out] res The 4 dot products.
+    */
+    void (*sparseDot4)(const T *x, const unsigned xStride, const T *w, const unsigned *cols, const unsigned nnz, T *res);
+
+    /// Accumulates a scaled sparse weight row into a vector (y[c] = y[c] + a w[c], for every column c in cols).
+    /**
+     Used for the error retropropagation through sparse layers.
+    */
+    void (*sparseAxpy)(const T a, const T *w, const unsigned *cols, const unsigned nnz, T *y);
+
+    /// Accumulates a scaled vector into an accumulator vector, only at the given columns (y[c] = y[c] + a x[c]).
+    /**
+     Used for the gradients accumulation of sparse layers, whose zero weights are pruned
+     connections (their gradients would be discarded anyway, see BasicBackpropagation::setPruned).
+    */
+    void (*sparseAccumulate)(const ACC_REAL a, const T *x, const unsigned *cols, const unsigned nnz, ACC_REAL *y);
+  };
+
+
+  /// Table of integer kernels, used by the quantized networks.
+  struct QuantKernels
+  {
+    /// The name of the instruction set ("scalar", "sse2", "avx2" or "avx512").
+    const char *name;
+
+    /// Dot product of two int8 vectors, accumulated in 32 bits.
+    int32_t (*dot8)(const int8_t *x, const int8_t *y, const unsigned n);
+
+    /// Dot product of two int16 vectors, accumulated in 64 bits.
+    /**
+     The values must be within +/-32767 (-32768 is never produced by the quantization).
+    */
+    int64_t (*dot16)(const int16_t *x, const int16_t *y, const unsigned n);
+
+    /// Quantizes a vector to int8 (\f$ q = round(x \cdot invScale) \f$, saturated at +/-127).
+    /**
+     The values are rounded to the nearest integer (ties to even), as the SIMD conversions do, and NaN is quantized to 0.
+     @param[in] x The vector to be quantized.
+     @param[in] invScale The inverse of the quantization scale.
+     @param[out] q The quantized vector.
+     @param[in] n The size of the vectors.
+    */
+    void (*quantize8)(const double *x, const double invScale, int8_t *q, const unsigned n);
+
+    /// Quantizes a vector to int16 (\f$ q = round(x \cdot invScale) \f$, saturated at +/-32767).
+    void (*quantize16)(const double *x, const double invScale, int16_t *q, const unsigned n);
+  };
+
+
+  /// The portable kernels (no SIMD instructions).
+  extern const Kernels<double> SCALAR_KERNELS;
+  extern const Kernels<float> SCALAR_KERNELS_F;
+  extern const QuantKernels SCALAR_QUANT_KERNELS;
+
+#if defined(__x86_64__) || defined(__i386__)
+  /// The kernels using SSE2 instructions.
+  extern const Kernels<double> SSE2_KERNELS;
+  extern const Kernels<float> SSE2_KERNELS_F;
+  extern const QuantKernels SSE2_QUANT_KERNELS;
+
+  /// The kernels using AVX2 and FMA instructions.
+  extern const Kernels<double> AVX2_KERNELS;
+  extern const Kernels<float> AVX2_KERNELS_F;
+  extern const QuantKernels AVX2_QUANT_KERNELS;
+
+  /// The kernels using AVX-512 (foundation) instructions.
+  extern const Kernels<double> AVX512_KERNELS;
+  extern const Kernels<float> AVX512_KERNELS_F;
+  extern const QuantKernels AVX512_QUANT_KERNELS;
+#endif
+
+
+  /// Returns the kernels to be used for a given storage precision.
+  /**
+   The kernels are selected in the first call, according to the instruction sets supported
+   by the processor. The selection can be forced by setting the FASTNET_KERNELS environment
+   variable to "scalar", "sse2", "avx2" or "avx512" (useful for benchmarking and validation).
+   Only the float and double specializations exist.
+   @return The selected kernels table.
+  */
+  template <class T> const Kernels<T> &getKernels();
+
+  template <> const Kernels<double> &getKernels<double>();
+  template <> const Kernels<float> &getKernels<float>();
+
+  /// Returns the integer kernels (selected as in getKernels()).
+  const QuantKernels &getQuantKernels();
+}
+
+#endif
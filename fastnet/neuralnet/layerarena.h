@@ -0,0 +1,152 @@
+/**
+@file  layerarena.h
+@brief LayerArena class declaration.
+*/
+
+#ifndef LAYERARENA_H
+#define LAYERARENA_H
+
+#include <cstddef>
+#include <vector>
+
+#include "fastnet/sys/defines.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /**
+  @brief    Contiguous, cache line aligned storage for the per layer network tensors.
+  @param T The type of the stored values (float or double).
+
+  Instead of allocating one memory block per neuron, every tensor whose shape
+  follows the network topology lives in a single aligned memory block owned by this class.
+  Two kinds of tensors are handled:
+   - parameter sets: a weight matrix and a bias vector for every layer (weights, dw, savedW, etc.).
+   - node sets: one value per node for every layer (bias shaped, like layerOutputs or sigma).
+
+  Within a parameter set, the weight blocks of every layer are stored first (row major, one row per node),
+  followed by the bias vectors of every layer, so that a whole parameter set is a single contiguous
+  vector of T. Every row is padded with zeros up to a multiple of the cache line size, so every row
+  starts at an aligned address. The classic T*** / T** pointer tables are still provided, but
+  they are just views pointing into the arena.
+  */
+  template <class T>
+  class LayerArena
+  {
+    private:
+      /// The memory block holding every tensor.
+      T *block;
+
+      /// The first parameter set (inside the block, or an external memory block).
+      T *params;
+
+      /// Total number of values in the block.
+      size_t blockSize;
+
+      /// Number of values (including padding) of a single parameter set.
+      size_t pSize;
+
+      /// Number of values (including padding) of a single node set.
+      size_t nSize;
+
+      /// Number of parameter sets stored.
+      unsigned numParamSets;
+
+      /// Number of node sets stored.
+      unsigned numNodeSets;
+
+      /// Number of layers (excluding the input layer).
+      unsigned numLayers;
+
+      /// The padded row size (in values) of the weight matrix of each layer.
+      vector<unsigned> strides;
+
+      /// Pointer tables for the weight matrices ([set][layer] -> row pointers).
+      vector<T**> wLayerPtrs;
+
+      /// Row pointers referenced by wLayerPtrs.
+      vector<T*> wRowPtrs;
+
+      /// Pointer tables for the bias vectors of each parameter set ([set][layer]).
+      vector<T*> bPtrs;
+
+      /// Pointer tables for the node sets ([set][layer]).
+      vector<T*> nodePtrs;
+
+      /// Releases the memory block and clears the pointer tables.
+      void release();
+
+      //Copying arenas is only allowed through the copy method.
+      LayerArena(const LayerArena &);
+      void operator=(const LayerArena &);
+
+    public:
+      /// Alignment (in bytes) of the memory block and of every row inside it.
+      static const size_t ALIGNMENT = 64;
+
+      /// Returns the padded size of a row with n elements.
+      /**
+       @param[in] n The number of valid elements in the row.
+       @return The smallest multiple of (ALIGNMENT / sizeof(T)) that is equal or greater than n.
+      */
+      static unsigned padded(const unsigned n)
+      {
+        const unsigned step = ALIGNMENT / sizeof(T);
+        return ((n + step - 1) / step) * step;
+      };
+
+      /// Creates an empty arena.
+      LayerArena();
+
+      /// Releases the memory block.
+      ~LayerArena();
+
+      /// Allocates the arena for a given topology.
+      /**
+       Any previously allocated memory is released. The whole block is zero initialized,
+       so the padding elements are guaranteed to be zero.
+       @param[in] nNodes The number of nodes in each layer (including the input layer).
+       @param[in] numParamSets The number of parameter sets (weights and biases) to allocate.
+       @param[in] numNodeSets The number of node sets (one value per node) to allocate.
+       @param[in] extParams If not NULL, the parameter sets are not allocated, and the views point
+       into this (ALIGNMENT aligned) external memory instead, which must already hold the parameter
+       sets in the arena layout (for instance, a memory mapped model file). The external memory
+       is not released by the arena, and it must outlive it.
+       @throw bad_alloc If the memory could not be allocated.
+      */
+      void allocate(const vector<unsigned> &nNodes, const unsigned numParamSets, const unsigned numNodeSets,
+                      T *extParams = NULL);
+
+      /// Makes a bulk copy of all tensors of another arena with the exact same layout.
+      void copy(const LayerArena &arena);
+
+      /// Returns the weight matrix view (w[layer][node][prevNode]) of a parameter set.
+      T ***getWeights(const unsigned set) const {return const_cast<T***>(&wLayerPtrs[set*numLayers]);};
+
+      /// Returns the bias vector view (b[layer][node]) of a parameter set.
+      T **getBias(const unsigned set) const {return const_cast<T**>(&bPtrs[set*numLayers]);};
+
+      /// Returns the node vector view (v[layer][node]) of a node set.
+      T **getNodes(const unsigned set) const {return const_cast<T**>(&nodePtrs[set*numLayers]);};
+
+      /// Returns a pointer to the first value of a parameter set.
+      /**
+       The parameter set is a contiguous vector of paramSize() values, so it can be
+       processed (copied, accumulated, etc.) as a single flat vector.
+      */
+      T *getParams(const unsigned set) const {return params + set*pSize;};
+
+      /// Returns the number of values (including padding) of a parameter set.
+      size_t paramSize() const {return pSize;};
+
+      /// Returns the padded row size of the weight matrix in a given layer.
+      /**
+       @param[in] layer The layer index (where 0 is the first hidden layer).
+      */
+      unsigned getStride(const unsigned layer) const {return strides[layer];};
+  };
+}
+
+#endif
@@ -0,0 +1,187 @@
+/**
+@file  modelfile.h
+@brief Binary model file writer and (memory mapped) reader declarations.
+
+  A model file holds everything needed to rebuild a trained network (topology, transfer
+  functions, bias usage, frozen nodes and weights). The weights and biases are stored
+  in the LayerArena parameter set layout, at an aligned offset, so a mapped file is used by
+  the network directly, without parsing or copying the values.
+*/
+
+#ifndef MODELFILE_H
+#define MODELFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "fastnet/sys/defines.h"
+#include "fastnet/neuralnet/neuralnetwork.h"
+#include "fastnet/neuralnet/backpropagation.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /// The fixed size header at the beginning of every model file.
+  /**
+   The file layout is:
+    - This header (64 bytes).
+    - The metadata (metaSize bytes): the number of nodes of each layer (uint32_t each), the bias
+      usage of each layer (uint8_t each), the frozen status of each node (uint8_t each), the transfer
+      functions precision mode and the transfer function of each layer (null terminated strings).
+    - Zero padding up to paramOffset (a multiple of LayerArena::ALIGNMENT).
+    - The weights and biases (paramSize bytes), as a LayerArena parameter set of valueSize bytes values.
+  */
+  struct ModelFileHeader
+  {
+    /// Identifies the file type (MODEL_FILE_MAGIC).
+    char magic[8];
+
+    /// The file format version (MODEL_FILE_VERSION).
+    uint32_t version;
+
+    /// Written as MODEL_FILE_BYTE_ORDER, to detect files written with another byte order.
+    uint32_t byteOrder;
+
+    /// The size (4 or 8 bytes) of the stored weights (the network storage precision).
+    uint32_t valueSize;
+
+    /// The number of layers (including the input layer).
+    uint32_t numLayers;
+
+    /// The size, in bytes, of the metadata (which starts right after the header).
+    uint64_t metaSize;
+
+    /// The position, in bytes from the beginning of the file, of the weights and biases.
+    uint64_t paramOffset;
+
+    /// The size, in bytes, of the weights and biases.
+    uint64_t paramSize;
+
+    /// FNV-1a checksum of everything after the header.
+    uint64_t checksum;
+
+    /// Reserved for future versions (zero).
+    uint64_t reserved;
+  };
+
+  /// The model files magic string.
+  const char MODEL_FILE_MAGIC[8] = {'F', 'A', 'S', 'T', 'N', 'E', 'T', 'M'};
+
+  /// The current model file format version.
+  const uint32_t MODEL_FILE_VERSION = 1;
+
+  /// Byte order mark of the model files.
+  const uint32_t MODEL_FILE_BYTE_ORDER = 0x01020304;
+
+
+  /// Writes a network to a model file.
+  /**
+   @param[in] fileName The name of the file to create (it is overwritten, if it exists).
+   @param[in] net The network to be written.
+   @param[in] frozen The frozen status of each node (frozen[layer][node], where 0 is the first hidden layer).
+   If empty, no node is frozen.
+   @throw const char* If the file can not be written.
+  */
+  template <class T>
+  void writeModel(const string &fileName, const BasicNeuralNetwork<T> &net, const vector< vector<bool> > &frozen = vector< vector<bool> >());
+
+  /// Writes a training network, with its frozen nodes, to a model file.
+  template <class T>
+  void writeModel(const string &fileName, const BasicBackpropagation<T> &net);
+
+
+  /**
+  @brief    A model file mapped in memory.
+
+  The file is mapped (privately) in the constructor, and its header and metadata are validated.
+  The networks created by getNetwork() use the mapped weights directly, so loading a model costs
+  about the same whatever the network size is (the pages are only read when first used). Changes made
+  to the weights of these networks are private (copy on write), and never reach the file.
+  The ModelFile object must outlive the networks created from it.
+  */
+  class ModelFile
+  {
+    private:
+      /// The mapped memory.
+      void *mem;
+
+      /// The size of the mapped memory (the file size).
+      size_t memSize;
+
+      /// The file header (at the beginning of the mapped memory).
+      const ModelFileHeader *header;
+
+      /// Number of nodes in each layer (including the input layer).
+      vector<unsigned> nNodes;
+
+      /// The bias usage of each layer.
+      vector<bool> usingBias;
+
+      /// The frozen status of each node (frozen[layer][node]).
+      vector< vector<bool> > frozen;
+
+      /// The transfer function of each layer.
+      vector<string> trfFunc;
+
+      /// The transfer functions precision mode.
+      string trfPrecision;
+
+      /// Reads the metadata, checking it against the file size.
+      void readMetadata();
+
+      //Model files can not be copied.
+      ModelFile(const ModelFile &);
+      void operator=(const ModelFile &);
+
+    public:
+      /// Maps a model file in memory.
+      /**
+       @param[in] fileName The model file name.
+       @param[in] verify If true, the checksum is verified (it reads the whole file).
+       @throw const char* If the file can not be opened or it is not a valid model file.
+      */
+      explicit ModelFile(const string &fileName, const bool verify = true);
+
+      /// Unmaps the file.
+      ~ModelFile();
+
+      /// Creates a network using the mapped weights.
+      /**
+       If the stored precision is not T, the weights are converted (and so copied) to T.
+       @return A dynamically allocated network, to be released with delete (before this object).
+       @throw const char* If a transfer function of the model is not registered.
+      */
+      template <class T>
+      BasicNeuralNetwork<T> *getNetwork() const;
+
+      /// Gets the number of layers (including the input layer).
+      unsigned getNumLayers() const {return nNodes.size();};
+
+      /// Gets the number of nodes in a specific layer.
+      unsigned operator[](unsigned layer) const {return nNodes[layer];};
+
+      /// Gets the number of nodes of every layer.
+      const vector<unsigned> &getNumNodes() const {return nNodes;};
+
+      /// Gets the transfer function of every layer (where 0 is the first hidden layer).
+      const vector<string> &getTrfFuncs() const {return trfFunc;};
+
+      /// Gets the bias usage of every layer (where 0 is the first hidden layer).
+      const vector<bool> &getUsingBias() const {return usingBias;};
+
+      /// Gets the transfer functions precision mode.
+      const string &getTrfPrecision() const {return trfPrecision;};
+
+      /// Tells whether a node is frozen.
+      bool isFrozen(const unsigned layer, const unsigned node) const {return frozen[layer][node];};
+
+      /// Gets the size (4 or 8 bytes) of the stored weights.
+      unsigned getValueSize() const {return header->valueSize;};
+  };
+}
+
+#endif
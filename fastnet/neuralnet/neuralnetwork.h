@@ -1,6 +1,6 @@
 /** 
 @file  neuralnetwork.h
-@brief NeuralNetwork class declaration.
+@brief BasicNeuralNetwork class template declaration.
 */
 
 #ifndef NEURALNETWORK_H
@@ -10,9 +10,14 @@
 #include <cstring>
 #include <vector>
 #include <iostream>
+#include <new>
+#include <algorithm>
 
 #include "fastnet/sys/defines.h"
 #include "fastnet/sys/Reporter.h"
+#include "fastnet/neuralnet/layerarena.h"
+#include "fastnet/neuralnet/activations.h"
+#include "fastnet/neuralnet/sparselayer.h"
 
 using namespace std;
 
@@ -29,12 +34,14 @@ using namespace std;
 */
 namespace FastNet
 {
+  template <class T> class BasicEnsemble;
 
   /** 
   @brief    Base class for neural network applications.
   @author    Rodrigo Coura Torres (torres@lps.ufrj.br)
   @version  1.0
   @date    14/11/2004
+  @param T The storage precision (float or double) of the weights, biases and layer outputs.
 
   This class was developed to help the development of neural network applications.
   Some frequently used methods (like feedforwarding an input, for instance) were already
@@ -44,21 +51,22 @@ namespace FastNet
   already implemented by this superclass are virtual, so, if an application specific
   method must be developed, these implemented method can be easily overrided.
   */
-  class NeuralNetwork
+  template <class T>
+  class BasicNeuralNetwork
   {
+    //The ensembles propagate the events through the layers of their member networks.
+    friend class BasicEnsemble<T>;
+
     protected:
-      
-      ///Typedef for pointer to member functions.
+      //Class attributes.
+
+      /// Holds the memory of the weights, biases and layer outputs.
       /**
-       In order to improve speed, the transfer functions are called 
-       by means of function pointers. This typedef makes easy to refer to
-       this kind of pointer. In order to work correctly, this typedef MUST be
-       declared inside the class which member functions it will refer to.
+       The weights and biases are stored as parameter set 0 and the layer outputs
+       as node set 0. The weights, bias and layerOutputs pointers are just views
+       over this arena.
       */
-      typedef  REAL (NeuralNetwork::*TRF_FUNC_PTR)(REAL val, bool deriv) const; 
-
-
-      //Class attributes.
+      LayerArena<T> arena;
 
       /// The weights matrix.
       /**
@@ -67,7 +75,7 @@ namespace FastNet
         - y: the index of the node in layer x.
         - z: the index of the node in layer x-1.
       */
-      REAL ***weights;
+      T ***weights;
       
 
       /// Stores the network bias
@@ -76,7 +84,7 @@ namespace FastNet
         - x: the layer index (where 0 is the first hidden layer).
         - y: the index of the node in layer x.
       */
-      REAL **bias;
+      T **bias;
 
       /// Stores the output generated by each layer.
       /**
@@ -85,7 +93,7 @@ namespace FastNet
         - x: the layer index (where 0 is the output of the input layer).
         - y: the output generated by the node y in layer x.
       */
-      REAL **layerOutputs;
+      T **layerOutputs;
       
 
       /// Store the number of nodes in each layer (including the input layer).
@@ -113,77 +121,187 @@ namespace FastNet
       /**
        This vector holds, for each layer (where 0 is the first hidden layer)
        a pointer to the transfer function that will be used in that layer.
-       Doing so, there is no overhead during network execution, because
-       the pointers are already set up before the execution.
+       The transfer functions are taken from the registry (see getActivation) and
+       are applied to the whole layer at once, after all its weighted sums are calculated.
       */
-      vector<TRF_FUNC_PTR> trfFunc;
+      vector<const Activation<T>*> trfFunc;
 
-      //Inline standart methods.
-
-      /// Hyperbolic tangent transfer function.
-      /*
-       This method calculates the hyperbolic tangent of a given number, or the
-       derivative of a tangent hiperbolic for that value.
-       @param[in] val The value which the hyperbolic tangent (or its derivative) must be calculated.
-       @param[in] deriv If true, the function will calculate the dervative, otherwise, the hyperbolic tangent value of "val".
-       @return The hyperbolic value of "val" (\f$ \tanh(val) \f$), if "deriv" = false, or its derivative \f$1 - val^2\f$ otherwise.
-      */
-      REAL hyperbolicTangent(REAL val, bool deriv) const {return (deriv) ? (1 - (val*val)) : tanh(val);};
 
-      
-      /// Linear transfer function.
-      /*
-       This method implements a linear transfer function, or the
-       derivative of the linear function for that value.
-       @param[in] val The value which the linear function must be calculated.
-       @param[in] deriv If true, the function will calculate the dervative, otherwise, the linear value of "val".
-       @return "val" ("deriv" = false) or 1 ("deriv" = true).
+      /// The transfer functions precision mode (TRF_EXACT_ID, TRF_RATIONAL_ID or TRF_TABLE_ID).
+      /**
+       The precision mode is part of the network, and it is copied with it, so the
+       training and the later use of a network are done with the same transfer functions.
+       @see FastNet::getActivation
       */
-      REAL linear(REAL val, bool deriv) const {return (deriv) ? 1 : val;};
+      string trfPrecision;
 
 
-      /// Releases the memory used by a bias matrix.
+      /// The nonzero pattern of the weights of each layer (empty for the dense layers).
       /**
-       This method releases the memory dynamically allocated
-       for a bias matrix (or any other matrix that has the exactly same size),
-       by using the size information of the bias matrix.
-       If successfull, the pointer will be assigned to NULL.
-       @param b A pointer to a bias matrix.
+       The layers with more than SPARSE_THRESHOLD zero weights (pruned networks, for
+       instance) are propagated and trained by the sparse kernels, which skip the zero weights.
+       @see FastNet::BasicNeuralNetwork#updateSparsity
       */
-      void releaseMatrix(REAL **b);
-      
-      
-      /// Releases the memory used by a weight matrix.
+      vector<SparseLayer> sparse;
+
+
+      /// Tells whether the zero weights of a layer stay at zero until the weights are read again.
       /**
-       This method releases the memory dynamically allocated
-       for a weight matrix (or any other matrix that has the exactly same size), 
-       by using the size information of the weight matrix.
-       If successfull, the pointer will be assigned to NULL.
-       @param w A pointer to a weight matrix.
+       Only such layers may use the sparse kernels, since their nonzero pattern is computed once
+       (by updateSparsity). The weights of a network which is not trained only change when they are
+       read, so this class returns true for every layer. The training classes only keep at zero
+       the weights of the pruned layers (see BasicBackpropagation::setPruned).
+       @param[in] layer The layer (where 0 is the first hidden layer).
       */
-      void releaseMatrix(REAL ***w);
+      virtual bool hasFixedZeros(const unsigned /*layer*/) const {return true;};
 
 
       //Dynamically allocates all the memory we need.
       /**
       This function will take the nNodes vector ans will allocate all the memory that must be
       dynamically allocated. Caution: you <b>MUST</b> set, prior to call this function, the
-      nNodes vector.
+      nNodes vector. The weights, biases and layer outputs are placed in a single aligned arena.
       */
       virtual void allocateSpace(const vector<unsigned> &nNodes);
+
+
+      /// Allocates the arena and creates the weights, bias and layerOutputs views.
+      /**
+       @param[in] nNodes The number of nodes in each layer.
+       @param[in] extParams If not NULL, the weights and biases are not allocated, but taken
+       from this external memory (see LayerArena::allocate).
+      */
+      void allocateArena(const vector<unsigned> &nNodes, T *extParams);
+
+
+      /// Propagates a block of events through a single layer.
+      /**
+       This method computes, for every event in the block, the output of every node
+       in a layer, and then applies the layer's transfer function to each event. The events are
+       processed in tiles of 4 events by 2 nodes (Kernels::dot4x2), so each weight and input value loaded from
+       memory is reused several times from registers.
+       @param[in] layer The layer to propagate (where 0 is the first hidden layer).
+       @param[in] in The input of the layer, one event after the other.
+       @param[in] inStride The distance, in values, between two consecutive events in "in".
+       @param[in] nEvents The number of events in the block.
+       @param[out] out Where to write the layer output, one event after the other.
+       @param[in] outStride The distance, in values, between two consecutive events in "out".
+      */
+      void propagateLayerBatch(const unsigned layer, const T *in, const unsigned inStride, 
+                                const unsigned nEvents, T *out, const unsigned outStride) const;
+
+
+      /// Propagates a block of events through a layer given by its weights and biases.
+      /**
+       This is the computation behind the method above, for any weight matrix (for instance, the
+       packed first layers of an ensemble of networks, or the transposed weights used by the
+       batched retropropagation).
+       @param[in] w The weight rows (one per node).
+       @param[in] wStride The distance, in values, between two consecutive weight rows (for dot4x2).
+       @param[in] b The biases (one per node). If NULL, no bias is added.
+       @param[in] trf The transfer function applied to the output of each event (if NULL, none is applied).
+       @param[in] nIn The number of inputs of the layer.
+       @param[in] nOut The number of nodes of the layer.
+       The other parameters are as in the method above.
+      */
+      static void propagateLayerBatch(const T * const *w, const unsigned wStride, const T *b, const Activation<T> *trf,
+                                        const unsigned nIn, const unsigned nOut, const T *in, const unsigned inStride,
+                                        const unsigned nEvents, T *out, const unsigned outStride);
       
       
     public:
+      /// Number of events propagated together by propagateBatch.
+      /**
+       The events are propagated in blocks of this size, so the activations
+       of a block stay in cache while they are used as the input of the next layer.
+       It is also the block size of the batched training (see BasicBackpropagation::applySupervisedBatch).
+      */
+      static const unsigned BATCH_BLOCK = 64;
+
+
+      /// Buffers for the intermediate layer outputs of the const propagation methods.
+      /**
+       The network itself is not changed by the const propagation methods, so a single
+       network (one set of weights) can be shared by several threads, as long as each
+       thread uses its own workspace. A workspace can be reused for any number of
+       propagations, through any network with the same number of nodes in each layer.
+      */
+      class Workspace
+      {
+        friend class BasicNeuralNetwork;
+
+        private:
+          /// Two buffers, used alternately by the hidden layers of a block of events.
+          vector<T> buffer;
+
+          /// The output of the last propagated event.
+          vector<T> output;
+
+          /// The size of each of the two buffers.
+          size_t bufferSize;
+
+        public:
+          /// Creates the workspace for a given network.
+          explicit Workspace(const BasicNeuralNetwork &net)
+          {
+            const unsigned size = net.getNumLayers() - 1;
+            unsigned maxStride = 0;
+            for (unsigned i=1; i<size; i++) maxStride = std::max(maxStride, LayerArena<T>::padded(net[i]));
+            bufferSize = BATCH_BLOCK * maxStride;
+            buffer.resize(2*bufferSize);
+            output.resize(net[size]);
+          };
+      };
+
       //Virtual methods.      
       
       /// Propagates the input through the network.
       /**
        This method propagates the input data through the network.
-       The output of each layer is stored in matrix "layerOutputs".
+       The output of each layer is stored in matrix "layerOutputs", which is
+       also used by the training methods. For inference, prefer the const version below.
        @param input  The network's input vector.
        @return A pointer to the network's output (layerOutputs[nNodes.size()-1]).
       */
-      virtual const REAL* propagateInput(const REAL *input);
+      virtual const T* propagateInput(const T *input);
+
+
+      /// Propagates the input through the network, without changing it.
+      /**
+       The output is exactly the same as the one from propagateInput(input), but the
+       layer outputs are kept in the workspace, so several threads can propagate events
+       through the same network at the same time.
+       @param[in] input The network's input vector.
+       @param[in,out] ws The workspace of the calling thread.
+       @return A pointer to the network's output (inside the workspace, valid until its next use).
+      */
+      const T* propagateInput(const T *input, Workspace &ws) const;
+
+
+      /// Propagates a set of events through the network.
+      /**
+       This method treats the events as a matrix, propagating them in blocks of BATCH_BLOCK
+       events, layer by layer, as matrix products followed by the transfer function. The results
+       are exactly the same as calling propagateInput for every event. Since the intermediate
+       outputs are stored in a local workspace, this method does not change the network
+       and can be called simultaneously from multiple threads.
+       @param[in] inputs The input events, one after the other (nEvents x nNodes[0] values, as in a Matlab matrix with one event per column).
+       @param[in] nEvents The number of events to propagate.
+       @param[out] outputs Where to write the network outputs, one after the other (nEvents x nNodes[nLayers-1] values).
+      */
+      virtual void propagateBatch(const T *inputs, const size_t nEvents, T *outputs) const;
+
+
+      /// Propagates a set of events through the network, using a caller owned workspace.
+      /**
+       Same as the method above, but without allocating the intermediate buffers in every
+       call. Each thread must use its own workspace.
+       @param[in] inputs The input events, one after the other.
+       @param[in] nEvents The number of events to propagate.
+       @param[out] outputs Where to write the network outputs, one after the other.
+       @param[in,out] ws The workspace of the calling thread.
+      */
+      void propagateBatch(const T *inputs, const size_t nEvents, T *outputs, Workspace &ws) const;
 
       //Pure virtual methods.
 
@@ -194,7 +312,7 @@ namespace FastNet
       so it must be released with delete at the end of its use.
       @return A dynamically allocated clone of the calling object.
       */
-      virtual NeuralNetwork *clone(){return new NeuralNetwork(*this);}
+      virtual BasicNeuralNetwork *clone(){return new BasicNeuralNetwork(*this);}
 
       //Default methods.
 
@@ -204,7 +322,7 @@ namespace FastNet
       of another network.
       @param[in] net The network that we will copy the parameters from.
       */
-      NeuralNetwork(const NeuralNetwork &net);
+      BasicNeuralNetwork(const BasicNeuralNetwork &net);
 
       /// Constructor taking the parameters from scratch.
       /**
@@ -212,14 +330,30 @@ namespace FastNet
       @param[in] nNodes Specifies the size of each layer (including the input layer).
       @param[in] trfFunc Specifies the transfer function of each hidden layer and the output layer.
       @param[in] usingBias Specifies the usage of bias for each hidden layer and the output layer. 
+      @param[in] extParams If not NULL, the network uses the weights and biases stored in this memory
+      (in the LayerArena parameter set layout, aligned to LayerArena::ALIGNMENT) instead of allocating
+      its own, with no copy. This is how the memory mapped model files are loaded (see ModelFile). The
+      memory is not released by the network, and it must outlive it.
       */      
-      NeuralNetwork(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias);
+      BasicNeuralNetwork(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias,
+                          T *extParams = NULL);
+
+      /// Constructor converting a network from another storage precision.
+      /**
+      This constructor creates a copy of a network stored with another precision (for instance,
+      a float network for inference from a network trained in double). The values are rounded
+      to the new precision.
+      @param[in] net The network that we will copy the parameters from.
+      @throw const char* If a transfer function of the network is not registered for this precision.
+      */
+      template <class U>
+      explicit BasicNeuralNetwork(const BasicNeuralNetwork<U> &net);
             
       /// Class destructor.
       /**
        Releases all the dynamically allocated memory used by this class.
       */
-      virtual ~NeuralNetwork();
+      virtual ~BasicNeuralNetwork();
       
       /// Gives the neural network information.
       /**
@@ -237,7 +371,7 @@ namespace FastNet
         the calling object. The space for weights and bias info must have been previously created.
         @param[in] net The network from where to copy the data from.
       */
-      virtual void operator=(const NeuralNetwork &net);
+      virtual void operator=(const BasicNeuralNetwork &net);
 
       /// Returns an specific weight value.
       /**
@@ -247,7 +381,7 @@ namespace FastNet
        @param[in] prevNode The index of the node in layer "layer-1".
        @return The weight value at the specific location (w[layer][node][prevNode])
       */
-      REAL getWeight(unsigned layer, unsigned node, unsigned prevNode) const {return weights[layer][node][prevNode];};
+      T getWeight(unsigned layer, unsigned node, unsigned prevNode) const {return weights[layer][node][prevNode];};
       
       
       /// Returns an specific bias value.
@@ -257,7 +391,7 @@ namespace FastNet
        @param[in] node The index of the node in layer "layer".
        @return The bias value at the specific location (b[layer][node])
       */
-      REAL getBias(unsigned layer, unsigned node) const {return bias[layer][node];};
+      T getBias(unsigned layer, unsigned node) const {return bias[layer][node];};
       
       
       /// Gets the number of layers (including the input layer) of the network.
@@ -299,10 +433,94 @@ namespace FastNet
        @return True if bias is being used, false otherwise.
       */
       bool isUsingBias(const unsigned layer) const {return usingBias[layer];};
+
+
+      /// Gets the transfer function used by an specific layer.
+      /**
+       @param[in] layer The layer we want to know the transfer function (where 0 is the first hidden layer).
+       @return The transfer function ID (TGH_ID, LIN_ID, etc).
+      */
+      const string &getTrfFunc(const unsigned layer) const {return trfFunc[layer]->id;};
+
+
+      /// Sets the transfer functions precision mode.
+      /**
+       Selects, for every layer, the version of the layer's transfer function
+       implementing the given precision mode. The maximum error of each mode is
+       documented in FastNet::getActivation.
+       @param[in] precision The precision mode (TRF_EXACT_ID, TRF_RATIONAL_ID or TRF_TABLE_ID).
+       @throw const char* If the precision mode is not valid.
+      */
+      void setTrfPrecision(const string &precision);
+
+
+      /// Gets the transfer functions precision mode.
+      /**
+       @return The precision mode (TRF_EXACT_ID, TRF_RATIONAL_ID or TRF_TABLE_ID).
+      */
+      const string &getTrfPrecision() const {return trfPrecision;};
+
+
+      /// Selects, for each layer, the dense or the sparse kernels.
+      /**
+       The layers whose fraction of zero weights is above SPARSE_THRESHOLD (and whose zero weights
+       are fixed, see hasFixedZeros) get their nonzero pattern computed, and from then on they are
+       propagated (and trained) by the sparse kernels. This is only a speed choice: the sparse kernels
+       train exactly the weights the dense ones would. It is done automatically when the weights are read
+       (readWeights and the constructors taking the weights), but it must be called again if the weights
+       are changed by other means. The sparse outputs may differ from the dense ones by rounding, since
+       the sums are done in another order.
+      */
+      void updateSparsity();
+
+
+      /// Tells whether a layer is propagated by the sparse kernels (where 0 is the first hidden layer).
+      bool isSparse(const unsigned layer) const {return !sparse[layer].empty();};
       
       
-      virtual void readWeights(const REAL ***w, const REAL **b);
+      virtual void readWeights(const T ***w, const T **b);
   };
+
+
+  template <class T>
+  template <class U>
+  BasicNeuralNetwork<T>::BasicNeuralNetwork(const BasicNeuralNetwork<U> &net)
+  {
+    DEBUG1("Converting a NeuralNetwork to another storage precision.");
+    trfPrecision = net.getTrfPrecision();
+    for (unsigned i=0; i<net.getNumLayers(); i++)
+    {
+      nNodes.push_back(net[i]);
+      if (i > 0)
+      {
+        usingBias.push_back(net.isUsingBias(i-1));
+        const Activation<T> *act = getActivation<T>(net.getTrfFunc(i-1), trfPrecision);
+        if (!act) throw "Transfer function not specified!";
+        trfFunc.push_back(act);
+      }
+    }
+
+    try {allocateSpace(nNodes);}
+    catch (bad_alloc xa) {throw;}
+    layerOutputs[0] = NULL;
+
+    for (unsigned i=0; i<(nNodes.size()-1); i++)
+    {
+      for (unsigned j=0; j<nNodes[i+1]; j++)
+      {
+        for (unsigned k=0; k<nNodes[i]; k++) weights[i][j][k] = static_cast<T>(net.getWeight(i, j, k));
+        bias[i][j] = static_cast<T>(net.getBias(i, j));
+      }
+    }
+    updateSparsity();
+  }
+
+
+  /// Neural network stored with the default precision (REAL).
+  typedef BasicNeuralNetwork<REAL> NeuralNetwork;
+
+  /// Neural network stored in single precision.
+  typedef BasicNeuralNetwork<float> NeuralNetworkF;
 }
 
 #endif
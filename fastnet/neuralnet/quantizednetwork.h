@@ -0,0 +1,234 @@
+/**
+@file  quantizednetwork.h
+@brief BasicQuantizedNetwork class template declaration.
+
+  Fixed point (int8 or int16) inference networks, built from a trained network.
+  They reproduce the way the networks run in the online trigger hardware, and
+  are several times smaller than the floating point networks.
+*/
+
+#ifndef QUANTIZEDNETWORK_H
+#define QUANTIZEDNETWORK_H
+
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+
+#include "fastnet/sys/defines.h"
+#include "fastnet/neuralnet/neuralnetwork.h"
+#include "fastnet/neuralnet/activations.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /// Properties of the integer types a network can be quantized to.
+  template <class Q> struct QuantTraits;
+
+  /// 8 bits quantization.
+  template <> struct QuantTraits<int8_t>
+  {
+    /// The accumulator type of the weighted sums (it holds, at least, 2^17 products without overflow).
+    typedef int32_t Acc;
+
+    /// The largest quantized magnitude (the quantization is symmetric).
+    static const int QMAX = 127;
+
+    /// Number of transfer function table points per unit of the weighted sum.
+    static const unsigned TABLE_RES = 64;
+  };
+
+  /// 16 bits quantization.
+  template <> struct QuantTraits<int16_t>
+  {
+    /// The accumulator type of the weighted sums (a 32 bits accumulator would hold only 2 products).
+    typedef int64_t Acc;
+
+    /// The largest quantized magnitude (the quantization is symmetric).
+    static const int QMAX = 32767;
+
+    /// Number of transfer function table points per unit of the weighted sum.
+    static const unsigned TABLE_RES = 1024;
+  };
+
+
+  /// Comparison between a quantized network and the floating point network it was built from.
+  struct QuantizationReport
+  {
+    /// Maximum absolute difference between the outputs of both networks.
+    REAL maxDeviation;
+
+    /// Mean absolute difference between the outputs of both networks.
+    REAL meanDeviation;
+
+    /// Maximum SP product obtained by the floating point network.
+    REAL spFloat;
+
+    /// Maximum SP product obtained by the quantized network.
+    REAL spQuantized;
+
+    /// SP loss due to the quantization (spFloat - spQuantized).
+    REAL spLoss;
+  };
+
+
+  /**
+  @brief    Neural network quantized to fixed point, for inference only.
+  @param Q The integer type of the weights and layer values (int8_t or int16_t).
+
+  Every value is represented as an integer times a scale factor, and the scales
+  are calibrated per layer (symmetric quantization):
+    - The weights scale is the largest weight magnitude of the layer over QMAX.
+    - The network input scale is the largest input magnitude found in a calibration
+      sample of events, over QMAX.
+    - The output scale of each layer is the largest output magnitude the floating point network
+      produces for the calibration sample, over QMAX. It is also the input scale of the next layer.
+
+  The biases are stored in the accumulator scale (input scale times the weights scale), so the weighted
+  sum of each node is computed with integer operations only. The hyperbolic tangent and the logistic
+  sigmoid transfer functions are then evaluated by a lookup table, indexed by the weighted sum (nearest
+  point, TABLE_RES points per unit over +/-TABLE_RANGE). Since their outputs are bounded by 1, the output
+  scale of these layers is fixed to 1/QMAX, so a single table per function is shared by every layer and
+  every network. The other transfer functions are applied to the dequantized sum, which is then quantized
+  again. Values beyond the calibrated ranges saturate. The network outputs are dequantized back to REAL.
+  */
+  template <class Q>
+  class BasicQuantizedNetwork
+  {
+    private:
+      /// The accumulator type.
+      typedef typename QuantTraits<Q>::Acc Acc;
+
+      /// A quantized layer.
+      struct Layer
+      {
+        /// Number of inputs and outputs of the layer.
+        unsigned nIn, nOut;
+
+        /// Distance between two consecutive weight rows (padded to the cache line size).
+        unsigned stride;
+
+        /// The quantized weights, one row per node.
+        vector<Q> weights;
+
+        /// The quantized biases (in the accumulator scale).
+        vector<Acc> bias;
+
+        /// The input, weights and output scales.
+        REAL inScale, wScale, outScale;
+
+        /// The transfer function (used when there is no table).
+        const Activation<REAL> *trf;
+
+        /// The transfer function table (NULL if the transfer function is not tabulated).
+        const Q *table;
+
+        /// Converts a weighted sum (accumulator) into an index of the table.
+        REAL tableMult;
+      };
+
+      /// The network layers.
+      vector<Layer> layers;
+
+      /// Number of nodes in each layer (including the input layer).
+      vector<unsigned> nNodes;
+
+      /// Returns the shared table of a transfer function (NULL if it is not tabulated).
+      static const Q *getTable(const string &id);
+
+      /// Propagates a single event, using caller owned buffers for the intermediate layers.
+      void propagate(const REAL *input, REAL *output, Q *bufA, Q *bufB) const;
+
+    public:
+      /// Range (+/-) of the weighted sums covered by the transfer function tables.
+      static const unsigned TABLE_RANGE = 8;
+
+      /// Buffers for the intermediate layer values (see NeuralNetwork::Workspace).
+      class Workspace
+      {
+        friend class BasicQuantizedNetwork;
+
+        private:
+          /// Two buffers, used alternately by the layers.
+          vector<Q> bufA, bufB;
+
+        public:
+          /// Creates the workspace for a given network.
+          explicit Workspace(const BasicQuantizedNetwork &net)
+          {
+            const unsigned maxNodes = *std::max_element(net.nNodes.begin(), net.nNodes.end());
+            bufA.resize(maxNodes);
+            bufB.resize(maxNodes);
+          };
+      };
+
+      /// Builds and calibrates a quantized network from a trained network.
+      /**
+       @param[in] net The trained network.
+       @param[in] calibInputs The calibration events, one after the other (nEvents x net[0] values).
+       They should be a representative sample of the events the network will process.
+       @param[in] nEvents The number of calibration events.
+       @throw const char* If no calibration events are given.
+      */
+      BasicQuantizedNetwork(const NeuralNetwork &net, const REAL *calibInputs, const size_t nEvents);
+
+      /// Propagates a set of events through the network.
+      /**
+       Since the intermediate values are stored in a local workspace, this method
+       can be called simultaneously from multiple threads.
+       @param[in] inputs The input events, one after the other (nEvents x nNodes[0] values).
+       @param[in] nEvents The number of events to propagate.
+       @param[out] outputs Where to write the network outputs, one after the other (nEvents x nNodes[nLayers-1] values).
+      */
+      void propagateBatch(const REAL *inputs, const size_t nEvents, REAL *outputs) const;
+
+      /// Propagates a set of events through the network, using a caller owned workspace.
+      /**
+       Each thread must use its own workspace.
+       @param[in] inputs The input events, one after the other.
+       @param[in] nEvents The number of events to propagate.
+       @param[out] outputs Where to write the network outputs, one after the other.
+       @param[in,out] ws The workspace of the calling thread.
+      */
+      void propagateBatch(const REAL *inputs, const size_t nEvents, REAL *outputs, Workspace &ws) const;
+
+      /// Compares this network to the floating point network it was built from.
+      /**
+       Both networks propagate a signal and a noise set of events. The output deviation is measured
+       over every output, and the SP product over the first output, where the signal is expected
+       to be above the noise.
+       @param[in] net The floating point network.
+       @param[in] signal The signal events, one after the other.
+       @param[in] nSignal The number of signal events.
+       @param[in] noise The noise events, one after the other.
+       @param[in] nNoise The number of noise events.
+       @return The comparison results.
+      */
+      QuantizationReport compare(const NeuralNetwork &net, const REAL *signal, const size_t nSignal,
+                                  const REAL *noise, const size_t nNoise) const;
+
+      /// Gets the number of layers (including the input layer) of the network.
+      unsigned getNumLayers() const {return nNodes.size();};
+
+      /// Gets the number of nodes in a specific layer.
+      unsigned operator[](unsigned layer) const {return nNodes[layer];};
+
+      /// Returns the memory used by the weights and biases, in bytes (the shared tables are not included).
+      size_t modelSize() const;
+
+      /// Prints the scales of each layer and the model size.
+      void showInfo() const;
+  };
+
+
+  /// Network quantized to 8 bits.
+  typedef BasicQuantizedNetwork<int8_t> QuantizedNetwork8;
+
+  /// Network quantized to 16 bits.
+  typedef BasicQuantizedNetwork<int16_t> QuantizedNetwork16;
+}
+
+#endif
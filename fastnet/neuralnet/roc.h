@@ -0,0 +1,96 @@
+/**
+@file  roc.h
+@brief Exact ROC analysis of two class discriminators.
+
+  The outputs of each class are sorted once, and every operating point is then found
+  by a single linear sweep over both sorted sets, instead of rescanning the outputs for
+  every decision threshold.
+*/
+
+#ifndef ROC_H
+#define ROC_H
+
+#include <vector>
+#include <cstddef>
+
+#include "fastnet/sys/defines.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /// The ROC of a discriminator, where the signal is expected above the decision threshold.
+  /**
+   The operating points are ordered by increasing threshold. An output equal to the
+   threshold is taken as signal, and the outputs that can not be compared (NaN) are never
+   taken as signal (they still count in the efficiency denominators).
+  */
+  struct RocCurve
+  {
+    /// The decision thresholds.
+    vector<REAL> cut;
+
+    /// The signal detection efficiency at each threshold (fraction of the signal outputs at or above it).
+    vector<REAL> det;
+
+    /// The false alarm probability at each threshold (fraction of the noise outputs at or above it).
+    vector<REAL> fa;
+
+    /// The (weighted) SP product at each threshold.
+    /**
+     As in PatternRecognition: sqrt(((se + ne) / 2) * sqrt(se * ne)), where se is the
+     detection efficiency times the signal weight and ne is the fraction of the noise outputs
+     below the threshold times the noise weight (1 - fa, if no output is NaN).
+    */
+    vector<REAL> sp;
+
+    /// The position of the threshold with the maximum SP product (the lowest one, if tied).
+    size_t best;
+
+    /// The area under the exact ROC (the probability of a signal output being above a noise one, counting ties as half).
+    REAL auc;
+  };
+
+
+  /// Calculates the exact ROC of a discriminator.
+  /**
+   Every distinct output value is a threshold, followed by an infinite one (no event
+   taken as signal), so the curve holds every operating point of the discriminator.
+   Both output sets are sorted (in parallel, with OpenMP, for large sets), so the
+   cost is O(N log N) for the sort plus O(N) for the sweep.
+   @param[in] signal The outputs for the signal events.
+   @param[in] nSignal The number of signal events.
+   @param[in] noise The outputs for the noise events.
+   @param[in] nNoise The number of noise events.
+   @param[in] signalWeight The weight of the detection efficiency in the SP product.
+   @param[in] noiseWeight The weight of the noise rejection (1 - fa) in the SP product.
+   @return The ROC.
+   @throw const char* If there are no signal or no noise events.
+  */
+  template <class T>
+  RocCurve calculateRoc(const T *signal, const size_t nSignal, const T *noise, const size_t nNoise,
+                          const REAL signalWeight = 1., const REAL noiseWeight = 1.);
+
+
+  /// Calculates the ROC of a discriminator at given thresholds.
+  /**
+   Same as the method above, but the operating points are calculated only at the given
+   thresholds (in the given order), each one by a binary search over the sorted outputs.
+   The AUC is still the exact one.
+   @param[in] signal The outputs for the signal events.
+   @param[in] nSignal The number of signal events.
+   @param[in] noise The outputs for the noise events.
+   @param[in] nNoise The number of noise events.
+   @param[in] cuts The decision thresholds.
+   @param[in] signalWeight The weight of the detection efficiency in the SP product.
+   @param[in] noiseWeight The weight of the noise rejection (1 - fa) in the SP product.
+   @return The ROC.
+   @throw const char* If there are no signal or no noise events.
+  */
+  template <class T>
+  RocCurve calculateRoc(const T *signal, const size_t nSignal, const T *noise, const size_t nNoise,
+                          const vector<REAL> &cuts, const REAL signalWeight = 1., const REAL noiseWeight = 1.);
+}
+
+#endif
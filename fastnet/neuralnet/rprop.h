@@ -1,6 +1,6 @@
 /** 
 @file  rprop.h
-@brief The Resilient BackPropagation (RProp) class declaration.
+@brief The Resilient BackPropagation (BasicRProp) class template declaration.
 */
  
 #ifndef RPROP_H
@@ -21,6 +21,7 @@ namespace FastNet
   @author    Rodrigo Coura Torres (torres@lps.ufrj.br)
   @version  1.0
   @date    14/11/2004
+  @param T The storage precision (float or double) of the weights, biases and layer outputs.
 
   This class implements the resilient backpropagation training algorithm.
   This algorithm is based only in the direction of the derivative. The 
@@ -34,11 +35,23 @@ namespace FastNet
   gradient will be used if multiple inputs were presented to the network. The class
   also automatically resets the accumulated values after an epoch, preparing itself
   for the next epoch, so the user just have to use the methods, without worring
-  about internal control.
+  about internal control. The learning rates and the previous gradients are kept in
+  ACC_REAL, as the accumulated gradients.
   */
-  class RProp : public Backpropagation
+  template <class T>
+  class BasicRProp : public BasicBackpropagation<T>
   {
     protected:
+      using BasicNeuralNetwork<T>::weights;
+      using BasicNeuralNetwork<T>::bias;
+      using BasicNeuralNetwork<T>::nNodes;
+      using BasicNeuralNetwork<T>::usingBias;
+      using BasicBackpropagation<T>::dw;
+      using BasicBackpropagation<T>::db;
+      using BasicBackpropagation<T>::frozenNode;
+      using BasicBackpropagation<T>::clearPruned;
+      using BasicBackpropagation<T>::transposeWeights;
+
       //Class attributes.
 
       /// The maximum allowed learning rate value.
@@ -46,14 +59,14 @@ namespace FastNet
        Since the upate value can be increased or decreased, this value
        specifies the maximum accepted value for the update factor.
       */
-      REAL deltaMax;
+      ACC_REAL deltaMax;
 
       /// The minimum allowed learning rate value.
       /**
        Since the upate value can be increased or decreased, this value
        specifies the minimum accepted value for the update factor.
       */
-      REAL deltaMin;
+      ACC_REAL deltaMin;
 
       /// Specifies the increase factor for the learning rate.
       /**
@@ -61,7 +74,7 @@ namespace FastNet
        how much the learning rate will be increased (the learning rate value
        is multiplyed by this attribute value).
       */
-      REAL incEta;
+      ACC_REAL incEta;
       
       /// Specifies the decrease factor for the learning rate.
       /**
@@ -69,7 +82,7 @@ namespace FastNet
        how much the learning rate will be decreased (the learning rate value
        is multiplyed by this attribute value).
       */
-      REAL decEta;
+      ACC_REAL decEta;
 
       /// The initial learning rate value.
       /**
@@ -77,7 +90,20 @@ namespace FastNet
        of the training, the current learning rate will be changed according
        to the Resilient Backpropagation algorithm.
       */
-      REAL initEta;
+      ACC_REAL initEta;
+
+      /// Holds the memory of the RProp tensors.
+      /**
+       The previous deltas (prev_dw and prev_db) are stored as parameter set PREV_SET
+       and the learning rates (delta_w and delta_b) as parameter set ETA_SET.
+      */
+      LayerArena<ACC_REAL> rpArena;
+
+      /// Index, in rpArena, of the parameter set holding prev_dw and prev_db.
+      static const unsigned PREV_SET = 0;
+
+      /// Index, in rpArena, of the parameter set holding delta_w and delta_b.
+      static const unsigned ETA_SET = 1;
 
       /// Stores the delta weights values of the previous training epoch.
       /**
@@ -85,7 +111,7 @@ namespace FastNet
        in order to determine if the learning rate must be increased or decreased,
        this pointer holds a copy of the delta weights values calculated in the last epoch.
       */
-      REAL ***prev_dw;
+      ACC_REAL ***prev_dw;
 
       /// Stores the delta biases values of the previous training epoch.
       /**
@@ -93,7 +119,7 @@ namespace FastNet
        in order to determine if the learning rate must be increased or decreased,
        this pointer holds a copy of the delta biases values calculated in the last epoch.
       */
-      REAL **prev_db;
+      ACC_REAL **prev_db;
       
       
       /// The learning rate value for each weight.
@@ -102,7 +128,7 @@ namespace FastNet
        an specific learning rate value for each weight. So, this pointer
        contains the learning rate values that will be used in each weight.
       */
-      REAL ***delta_w;
+      ACC_REAL ***delta_w;
       
       /// The learning rate value for each bias.
       /**
@@ -110,7 +136,7 @@ namespace FastNet
        an specific learning rate value for each bias. So, this pointer
        contains the learning rate values that will be used in each bias.
       */
-      REAL **delta_b;
+      ACC_REAL **delta_b;
 
       //Inline methods.
       
@@ -121,7 +147,7 @@ namespace FastNet
        @param[in] v2 The second number.
        @return v1 if v1 < v2, v2 otherwise.
       */
-      REAL min(REAL v1, REAL v2) const {return ((v1 < v2) ? v1 : v2);}
+      ACC_REAL min(ACC_REAL v1, ACC_REAL v2) const {return ((v1 < v2) ? v1 : v2);}
     
       
       /// Gets the largest of two numbers.
@@ -131,7 +157,7 @@ namespace FastNet
        @param[in] v2 The second number.
        @return v1 if v1 > v2, v2 otherwise.
       */
-      REAL max(REAL v1, REAL v2) const {return ((v1 > v2) ? v1 : v2);}
+      ACC_REAL max(ACC_REAL v1, ACC_REAL v2) const {return ((v1 > v2) ? v1 : v2);}
       
       
       /// Gets the sign of a number.
@@ -140,7 +166,7 @@ namespace FastNet
        @param[in] val The number which the sign we want to know.
        @return 1 if val > 0, -1 if val <0, 0 if val = 0.
       */
-      REAL sign(REAL val) const {if (val > 0) return 1; else if (val < 0) return -1; else return 0;}
+      ACC_REAL sign(ACC_REAL val) const {if (val > 0) return 1; else if (val < 0) return -1; else return 0;}
 
       //Standart methods.
 
@@ -158,7 +184,7 @@ namespace FastNet
        @param prev_d The previous delta weight (or bias) value.
        @param w The weight (or bias) value.
       */
-      void updateW(REAL &delta, REAL &d, REAL &prev_d, REAL &w);
+      void updateW(ACC_REAL &delta, ACC_REAL &d, ACC_REAL &prev_d, T &w);
 
       //Dynamically allocates all the memory we need.
       /**
@@ -188,7 +214,7 @@ namespace FastNet
         of another network.
         @param[in] net The network that we will copy the parameters from.
       */
-      RProp(const RProp &net);
+      BasicRProp(const BasicRProp &net);
 
       /// Constructor taking the parameters from scratch.
       /**
@@ -201,9 +227,9 @@ namespace FastNet
       @param[in] incEta eta increasing factor.
       @param[in] decEta eta decreasing factor.
       */
-      RProp(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias, 
-                      const REAL deltaMin = 1E-6, const REAL deltaMax = 50.0, const REAL initEta = 0.1,
-                      const REAL incEta = 1.10, const REAL decEta = 0.5);  
+      BasicRProp(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias, 
+                      const ACC_REAL deltaMin = 1E-6, const ACC_REAL deltaMax = 50.0, const ACC_REAL initEta = 0.1,
+                      const ACC_REAL incEta = 1.10, const ACC_REAL decEta = 0.5);  
 
       /// Returns a clone of the object.
       /**
@@ -211,14 +237,14 @@ namespace FastNet
       so it must be released with delete at the end of its use.
       @return A dynamically allocated clone of the calling object.
       */
-      virtual NeuralNetwork *clone(){return new RProp(*this);}
+      virtual BasicNeuralNetwork<T> *clone(){return new BasicRProp(*this);}
 
       /// Class destructor.
       /**
        Releases all the dynamically allocated memory used by the class,
        so the user does not need to worry about dynamically allocated memory..
       */
-      virtual ~RProp();
+      virtual ~BasicRProp();
       
       
       /// Gives the neural network information.
@@ -237,8 +263,15 @@ namespace FastNet
         the calling object. The space for weights and bias info must have been previously created.
         @param[in] net The network from where to copy the data from.
       */
-      virtual void operator=(const RProp &net);
+      virtual void operator=(const BasicRProp &net);
   };
+
+
+  /// Resilient backpropagation training with the default precision (REAL).
+  typedef BasicRProp<REAL> RProp;
+
+  /// Resilient backpropagation training in single precision.
+  typedef BasicRProp<float> RPropF;
 }
 
 #endif
@@ -0,0 +1,93 @@
+/**
+@file  sparselayer.h
+@brief SparseLayer class declaration.
+*/
+
+#ifndef SPARSELAYER_H
+#define SPARSELAYER_H
+
+#include <vector>
+
+#include "fastnet/sys/defines.h"
+
+using namespace std;
+
+
+namespace FastNet
+{
+  /// Fraction of zero weights above which a double precision layer is propagated by the sparse kernels.
+  /**
+   Below it, the SIMD dense kernels (up to 8 products per instruction) are faster than
+   gathering the nonzero weights one by one. Since the single precision dense kernels
+   do twice as many products per instruction, the float layers use (1 + SPARSE_THRESHOLD) / 2.
+  */
+  const REAL SPARSE_THRESHOLD = 0.8;
+
+
+  /**
+  @brief    The nonzero pattern of a weight matrix, in the compressed sparse row (CSR) format.
+
+  Only the positions of the nonzero weights are stored: the weights themselves are
+  still read from the dense weight rows (at the stored columns), so the pattern stays valid
+  while the nonzero weights are changed by the training. The pattern is only built for layers
+  whose zero weights never change (see BasicNeuralNetwork::hasFixedZeros), so the sparse kernels
+  accumulating gradients only at the stored columns train the same weights as the dense ones.
+  The same class holds the connections kept by a pruned layer (see BasicBackpropagation::setPruned).
+  */
+  class SparseLayer
+  {
+    private:
+      /// Position, in cols, of the first column of each row (plus the total at the end).
+      vector<unsigned> rowStart;
+
+      /// The columns of the nonzero weights of every row, one row after the other.
+      vector<unsigned> cols;
+
+    public:
+      /// Creates an empty pattern (used for the dense layers).
+      SparseLayer(){};
+
+      /// Creates the pattern of a weight matrix.
+      /**
+       @param[in] w The weight rows.
+       @param[in] nIn The number of columns (inputs of the layer).
+       @param[in] nOut The number of rows (nodes of the layer).
+      */
+      template <class T>
+      SparseLayer(const T * const *w, const unsigned nIn, const unsigned nOut)
+      {
+        rowStart.push_back(0);
+        for (unsigned j=0; j<nOut; j++)
+        {
+          for (unsigned k=0; k<nIn; k++) if (w[j][k] != 0) cols.push_back(k);
+          rowStart.push_back(cols.size());
+        }
+      };
+
+      /// Returns the fraction of zero weights of a weight matrix.
+      template <class T>
+      static REAL sparsity(const T * const *w, const unsigned nIn, const unsigned nOut)
+      {
+        unsigned zeros = 0;
+        for (unsigned j=0; j<nOut; j++)
+        {
+          for (unsigned k=0; k<nIn; k++) if (w[j][k] == 0) zeros++;
+        }
+        return (nIn*nOut != 0) ? static_cast<REAL>(zeros) / (nIn*nOut) : 0.;
+      };
+
+      /// Tells whether the pattern is empty (the layer is dense).
+      bool empty() const {return rowStart.empty();};
+
+      /// Returns the columns of the nonzero weights of a row.
+      const unsigned *getCols(const unsigned row) const {return cols.data() + rowStart[row];};
+
+      /// Returns the number of nonzero weights of a row.
+      unsigned getNumCols(const unsigned row) const {return rowStart[row+1] - rowStart[row];};
+
+      /// Returns the total number of nonzero weights.
+      unsigned getNumNonZero() const {return (rowStart.empty()) ? 0 : rowStart.back();};
+  };
+}
+
+#endif
@@ -59,14 +59,14 @@ of REAL_TYPE as well.
 typedef double REAL;
 
 
-/// Macro to call pointers to member functions.
+/// Floating point type used to accumulate sums.
 /**
-Use this macro to call pointer to member functions. In order to improve speed
-the transfer functions are stored in pointer to functions, and this macro makes
-easy to call these pointers.
-@param[in] ptrToTrfFunc pointer pointing to the member function you want to call.
+The network classes are templates on their storage precision (float or double, see
+FastNet::BasicNeuralNetwork), and REAL is the precision used by default. Sums over many values, like the
+gradients accumulated over the training events and the training errors, always use this type,
+so storing the network in single precision does not spoil the training.
 */
-#define CALL_TRF_FUNC(ptrToTrfFunc)  ((this)->*(ptrToTrfFunc))
+typedef double ACC_REAL;
 
 
 /// String ID for the hyperbolic tangent transfer function.
@@ -87,6 +87,45 @@ function, this reference is done by this value.
 const std::string LIN_ID = "purelin";
 
 
+/// String ID for the logistic sigmoid transfer function.
+/**
+This is the only ID for the logistic sigmoid transfer function for files, so, every time
+that a file wants to make a reference that it will use this
+function, this reference is done by this value.
+*/
+const std::string LOGSIG_ID = "logsig";
+
+
+/// String ID for the positive linear (ReLU) transfer function.
+/**
+This is the only ID for the positive linear (ReLU) transfer function for files, so, every time
+that a file wants to make a reference that it will use this
+function, this reference is done by this value.
+*/
+const std::string POSLIN_ID = "poslin";
+
+
+/// String ID for the exact transfer functions precision mode.
+/**
+In this mode, the transfer functions are calculated using the standard math library.
+*/
+const std::string TRF_EXACT_ID = "exact";
+
+
+/// String ID for the rational approximation transfer functions precision mode.
+/**
+In this mode, the hyperbolic tangent is calculated by a rational function approximation.
+*/
+const std::string TRF_RATIONAL_ID = "rational";
+
+
+/// String ID for the table based transfer functions precision mode.
+/**
+In this mode, the hyperbolic tangent is calculated by interpolating a table of precalculated values.
+*/
+const std::string TRF_TABLE_ID = "table";
+
+
 /// String ID for the Gradient Descendent Backpropagation neural training.
 /**
 This is the only ID for the Gradient Descendent Backpropagation neural training for files, so, every time
@@ -0,0 +1,230 @@
+#ifndef CROSSVALID_H
+#define CROSSVALID_H
+
+#include <vector>
+
+#include "fastnet/neuralnet/roc.h"
+#include "fastnet/training/MultiStart.h"
+#include "fastnet/training/DataManager.h"
+
+
+/// The events of a cross validation deal.
+/**
+ Each set holds, for each pattern, the indices (from 0) of its events in the event store of
+ the pattern, so a deal is only a view of the store: no event is copied.
+*/
+struct Deal
+{
+  std::vector< std::vector<unsigned> > trn;
+  std::vector< std::vector<unsigned> > val;
+  std::vector< std::vector<unsigned> > tst;
+};
+
+
+/// Generates the deals of a cross validation.
+/**
+ The deals are generated on demand, so only the ones being trained are held in memory, however
+ many deals there are. getDeal may be called by several threads at the same time.
+*/
+class Dealer
+{
+public:
+  virtual ~Dealer() {};
+
+  /// Returns the number of deals.
+  virtual unsigned numDeals() const = 0;
+
+  /// Fills a deal.
+  /**
+  @param[in] d The index of the deal.
+  @param[out] deal The deal.
+  */
+  virtual void getDeal(const unsigned d, Deal &deal) const = 0;
+};
+
+
+/// The sorted blocks deals (as RandomBlocks.m).
+/**
+ The events of each pattern are split in nTrn + nVal + nTst blocks, where the block b holds
+ the events b, b + numBlocks, b + 2*numBlocks, and so on. At each deal, the blocks of each
+ pattern are randomly ordered, and the first nTrn blocks are the training set, the next nVal,
+ the validation set, and the last nTst, the testing set (which is the validation set, if nTst is 0).
+*/
+class RandomBlocksDealer : public Dealer
+{
+protected:
+  std::vector<unsigned> numEvents;
+  unsigned nTrn;
+  unsigned nVal;
+  unsigned nTst;
+  unsigned nDeals;
+
+  /// The order of the blocks of each pattern, for each deal.
+  std::vector<unsigned> order;
+
+  /// Appends the events of a range of blocks, in the deal order, to a set.
+  void addBlocks(const unsigned d, const unsigned pat, const unsigned first, const unsigned last, std::vector<unsigned> &set) const;
+
+public:
+  /**
+  @param[in] numEvents The number of events of each pattern.
+  @param[in] nTrn The number of training blocks.
+  @param[in] nVal The number of validation blocks.
+  @param[in] nTst The number of testing blocks.
+  @param[in] nDeals The number of deals.
+  @param[in] seed The seed of the block orders.
+  @throw const char* If there are no training or validation blocks.
+  */
+  RandomBlocksDealer(const std::vector<unsigned> &numEvents, const unsigned nTrn, const unsigned nVal,
+                      const unsigned nTst, const unsigned nDeals, const unsigned seed);
+
+  virtual unsigned numDeals() const {return nDeals;};
+
+  virtual void getDeal(const unsigned d, Deal &deal) const;
+};
+
+
+/// The leave one out deals (as LeaveOneOut.m).
+/**
+ The events of every pattern are taken one after the other (the ones of the first pattern, then the ones of
+ the second, and so on). At the deal d, the event first + d is the testing set, and all the other events are
+ both the training and the validation set.
+*/
+class LeaveOneOutDealer : public Dealer
+{
+protected:
+  std::vector<unsigned> numEvents;
+  unsigned first;
+  unsigned nDeals;
+
+public:
+  /**
+  @param[in] numEvents The number of events of each pattern.
+  @param[in] first The event left out at the first deal.
+  @param[in] nDeals The number of deals (up to the number of events after first).
+  */
+  LeaveOneOutDealer(const std::vector<unsigned> &numEvents, const unsigned first, const unsigned nDeals);
+
+  virtual unsigned numDeals() const {return nDeals;};
+
+  virtual void getDeal(const unsigned d, Deal &deal) const;
+};
+
+
+/// A given list of deals.
+class ListDealer : public Dealer
+{
+protected:
+  std::vector<Deal> deals;
+
+public:
+  ListDealer(const std::vector<Deal> &deals) : deals(deals) {};
+
+  virtual unsigned numDeals() const {return deals.size();};
+
+  virtual void getDeal(const unsigned d, Deal &deal) const {deal = deals[d];};
+};
+
+
+/// The result of a cross validation deal.
+template <class T>
+struct BasicDealResult
+{
+  /// The best network of the deal (owned by the cross validation).
+  FastNet::BasicBackpropagation<T> *net;
+
+  /// The index of the best network among the trainings of the deal.
+  unsigned bestTrain;
+
+  /// The training evolution of the best network.
+  TrainData trnEvolution;
+
+  /// The outputs of the best network for the testing events of each pattern.
+  std::vector< std::vector<REAL> > tstOutputs;
+
+  /// The ROC of the best network over the testing events (empty, if a pattern has no testing events).
+  FastNet::RocCurve roc;
+
+  /// The maximum SP product of the ROC (0, if it is empty).
+  REAL sp;
+};
+
+
+/// Cross validation of a two patterns discriminator.
+/**
+ It replaces the deal loop of crossVal.m. The events of each pattern are kept in a single store (the
+ given managers), and each deal is trained through managers that point to its events (see the
+ BasicDataManager fold constructor), so the memory does not grow with the number of deals. At each deal,
+ the network is trained several times (see BasicMultiStartTraining), and the best training is the one of
+ the highest testing SP (as crossVal.m), or of the best validation, if a pattern has no testing events
+ (leave one out). The deals are distributed over the threads (a whole deal per thread), and their seeds
+ come from a single base seed, so the results do not depend on the number of threads.
+*/
+template <class T>
+class BasicCrossValidation
+{
+protected:
+  FastNet::BasicBackpropagation<T> *protoNet;
+  std::vector<BasicDataManager<T>*> *dataList;
+  bool useSP;
+  unsigned batchSize;
+  REAL signalWeight;
+  REAL noiseWeight;
+  REAL spResolution;
+
+  std::vector< BasicDealResult<T> > results;
+
+  /// Releases the networks of the last cross validation.
+  void release();
+
+  /// Trains a deal, filling its result.
+  void trainDeal(const Deal &deal, const unsigned nTrains, const unsigned seed, const unsigned nEpochs,
+                  const unsigned failLimit, const std::vector<REAL> &cuts, BasicDealResult<T> &res);
+
+public:
+  /**
+  @param[in] net The network to train (its topology, training parameters and frozen nodes). It is not changed.
+  @param[in] data The events of each pattern (the first one is the signal).
+  The other parameters are the ones of BasicPatternRecognition.
+  @throw const char* If there are not two patterns.
+  */
+  BasicCrossValidation(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *data,
+                        const bool usingSP, const unsigned bSize, const REAL signalWeight = 1.0,
+                        const REAL noiseWeight = 1.0, const REAL spResolution = 0.01);
+
+  virtual ~BasicCrossValidation();
+
+
+  /// Trains every deal.
+  /**
+  The results of a previous cross validation are released.
+  @param[in] dealer The deals.
+  @param[in] nTrains The number of trainings of each deal.
+  @param[in] seed The base seed, from which the seeds of each deal are drawn.
+  @param[in] nEpochs The maximum number of epochs of each training.
+  @param[in] failLimit The maximum number of epochs without improvement (see BasicTraining::trainEpochs).
+  @param[in] cuts The thresholds of the testing ROCs (empty, for the exact ROCs).
+  @throw const char* If any of the deals fails.
+  */
+  void run(const Dealer &dealer, const unsigned nTrains, const unsigned seed, const unsigned nEpochs,
+            const unsigned failLimit, const std::vector<REAL> &cuts);
+
+
+  /// Returns the result of each deal of the last cross validation.
+  const std::vector< BasicDealResult<T> >& getResults() const {return results;};
+
+
+  /// Returns the ROC of the testing outputs of every deal together.
+  /**
+  It is the ROC of the leave one out deals, whose testing sets hold a single event.
+  @param[in] cuts The thresholds (empty, for the exact ROC).
+  @return The ROC.
+  @throw const char* If no deal has testing events of both patterns.
+  */
+  FastNet::RocCurve getPooledRoc(const std::vector<REAL> &cuts) const;
+};
+
+typedef BasicDealResult<REAL> DealResult;
+typedef BasicCrossValidation<REAL> CrossValidation;
+
+#endif
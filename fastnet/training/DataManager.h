@@ -2,29 +2,116 @@
 #define DATAMANAGER_H_H
 
 #include <vector>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
 
-class DataManager
+/// Random access to a set of events, stored with the precision T (float or double).
+/**
+ The events are sampled without replacement, following random permutations of the
+ event set: when a permutation is exhausted, the next one is used. The indices of a whole
+ training epoch are drawn at once (drawEpoch), before the training threads start, so each
+ thread reads the indices of its blocks of events from a fixed position, without locking.
+ The next permutation is shuffled ahead of time (prepareNext), by a thread of the training
+ team, while the other threads train. The shuffles use the manager own random engine (seeded
+ from rand() at initialization), instead of the global, not thread safe, random_shuffle state.
+*/
+template <class T>
+class BasicDataManager
 {
 protected:
   unsigned evSize;
-  std::vector<REAL *> data;
+  std::vector<T *> data;
+
+  /// The current permutation of the event indices.
   std::vector<unsigned> idx;
-  std::vector<unsigned>::const_iterator nextEvent;
+
+  /// The next permutation (valid only when nextReady is true).
+  std::vector<unsigned> nextIdx;
+
+  /// Tells whether nextIdx has already been shuffled.
+  bool nextReady;
+
+  /// The position, in idx, of the next event to sample.
+  size_t nextEvent;
+
+  /// The indices of the events of the current epoch (see drawEpoch).
+  std::vector<unsigned> epochIdx;
+
+  /// The random engine of the shuffles.
+  std::mt19937 engine;
   
   void init(const unsigned numEvents)
+  {
+    init(numEvents, static_cast<unsigned>(rand()));
+  }
+
+  /// Initializes the sampling of the events, with a given seed for the shuffles.
+  void init(const unsigned numEvents, const unsigned seed)
   {
     DEBUG1("Initializing ramdom selector for " << numEvents << " events.")
+    idx.clear();
     for (unsigned i=0; i<numEvents; i++) idx.push_back(i);
-    random_shuffle(idx.begin(), idx.end());
-    nextEvent = idx.begin();
+    engine.seed(static_cast<std::mt19937::result_type>(seed));
+    std::shuffle(idx.begin(), idx.end(), engine);
+    nextIdx = idx;
+    nextReady = false;
+    nextEvent = 0;
+  }
+
+  /// Moves to the next permutation (shuffling it first, if it was not prepared).
+  void nextPermutation()
+  {
+    prepareNext();
+    idx.swap(nextIdx);
+    nextReady = false;
+    nextEvent = 0;
   }
 
 public:
-  DataManager()
+  BasicDataManager()
   {
     evSize = 0;
+    nextReady = false;
+    nextEvent = 0;
   }
   
+  /// Creates a manager of the same events as another one, with its own sampling.
+  /**
+   The events are not copied (the new manager points to the same ones, which must outlive it),
+   only the sampling state, which is started anew from the given seed. So several trainings may
+   sample the same events at the same time, each one through its own manager.
+   @param[in] src The manager of the events.
+   @param[in] seed The seed of the shuffles.
+  */
+  BasicDataManager(const BasicDataManager &src, const unsigned seed)
+  {
+    evSize = src.evSize;
+    data = src.data;
+    init(data.size(), seed);
+  }
+
+  /// Creates a manager of some of the events of another one (a fold of a cross validation, for instance).
+  /**
+   As the constructor above, the events are not copied: the new manager points to the selected
+   events of the other one, in the given order.
+   @param[in] src The manager of the events.
+   @param[in] events The indices, in src, of the events to select.
+   @param[in] seed The seed of the shuffles.
+   @throw const char* If an index is not valid.
+  */
+  BasicDataManager(const BasicDataManager &src, const std::vector<unsigned> &events, const unsigned seed)
+  {
+    evSize = src.evSize;
+    data.reserve(events.size());
+    for (unsigned i=0; i<events.size(); i++)
+    {
+      if (events[i] >= src.data.size()) throw "Invalid event index!";
+      data.push_back(src.data[events[i]]);
+    }
+    init(data.size(), seed);
+  }
+
   unsigned numEvents() const
   {
     return data.size();
@@ -37,18 +124,51 @@ public:
   
   unsigned getNextEventIndex()
   {
-    if (nextEvent == idx.end())
+    if (nextEvent == idx.size()) nextPermutation();
+    return idx[nextEvent++];
+  }
+
+  /// Draws the indices of the events of a training epoch.
+  /**
+   The indices are the same ones returned by nEvents calls to getNextEventIndex. They stay
+   valid until the next call, so the training threads may read them concurrently.
+   @param[in] nEvents The number of events to draw.
+   @return The event indices.
+  */
+  const unsigned* drawEpoch(const unsigned nEvents)
+  {
+    if ( (nEvents) && (idx.empty()) ) throw "There are no events to sample!";
+    epochIdx.resize(nEvents);
+    unsigned e = 0;
+    while (e < nEvents)
     {
-      random_shuffle(idx.begin(), idx.end());
-      nextEvent = idx.begin();
+      if (nextEvent == idx.size()) nextPermutation();
+      const unsigned n = std::min(static_cast<size_t>(nEvents - e), idx.size() - nextEvent);
+      std::copy(idx.begin() + nextEvent, idx.begin() + nextEvent + n, epochIdx.begin() + e);
+      nextEvent += n;
+      e += n;
     }
-    return *nextEvent++;
+    return epochIdx.data();
+  }
+
+  /// Shuffles the next permutation, if it was not already shuffled.
+  /**
+   It may run concurrently with the reading of the indices returned by drawEpoch, but not
+   with the other sampling methods.
+  */
+  void prepareNext()
+  {
+    if (nextReady) return;
+    std::shuffle(nextIdx.begin(), nextIdx.end(), engine);
+    nextReady = true;
   }
   
-  const REAL* operator[](const unsigned idx) const
+  const T* operator[](const unsigned idx) const
   {
     return data[idx];
   };  
 };
 
+typedef BasicDataManager<REAL> DataManager;
+
 #endif
@@ -0,0 +1,108 @@
+#ifndef MULTISTART_H
+#define MULTISTART_H
+
+#include <vector>
+
+#include "fastnet/training/PatternRec.h"
+#include "fastnet/training/DataManager.h"
+
+
+/// The result of one of the trainings of a multi start training.
+template <class T>
+struct BasicTrainRun
+{
+  /// The trained network, holding the weights of its best validation (owned by the multi start training).
+  FastNet::BasicBackpropagation<T> *net;
+
+  /// The seed of the initial weights of the network (see BasicBackpropagation::initWeights).
+  unsigned seed;
+
+  /// The training evolution.
+  TrainData trnEvolution;
+
+  /// The validation MSE of the best network.
+  REAL mseVal;
+
+  /// The validation SP of the best network (0, if the SP criterium is not used).
+  REAL spVal;
+};
+
+
+/// Trains several copies of a pattern recognition network at the same time, from different initial weights.
+/**
+ It replaces the training loops of trainMany.m and crossVal.m: each run is a copy of the
+ network, initialized by the Nguyen-Widrow method from its own seed, and trained with its own
+ early stopping state, as train_c does for a single network. The runs are distributed over the
+ threads (a whole run per thread, so the runs do not synchronize with each other), and all of
+ them read the same events: each run samples the training events through its own manager
+ (see the BasicDataManager view constructor), and the validation events are only read.
+ The seeds come from a single base seed, so the results do not depend on the number of threads.
+*/
+template <class T>
+class BasicMultiStartTraining
+{
+protected:
+  FastNet::BasicBackpropagation<T> *protoNet;
+  std::vector<BasicDataManager<T>*> *inTrnList;
+  std::vector<BasicDataManager<T>*> *inValList;
+  bool useSP;
+  unsigned batchSize;
+  REAL signalWeight;
+  REAL noiseWeight;
+  REAL spResolution;
+
+  std::vector< BasicTrainRun<T> > runs;
+  unsigned bestRun;
+
+  /// Releases the networks of the last training.
+  void release();
+
+  /// Initializes the network of a run, before its training (by the Nguyen-Widrow method).
+  /**
+  It is called for every run, in the run order, before the training threads start.
+  @param[in,out] net The network of the run (a copy of the network given to the constructor).
+  @param[in] seed The seed of the run.
+  */
+  virtual void initNetwork(FastNet::BasicBackpropagation<T> *net, const unsigned seed) {net->initWeights(seed);};
+
+public:
+
+  /**
+  @param[in] net The network to train (its topology, training parameters and frozen nodes). It is not changed.
+  @param[in] inTrn The training events of each pattern.
+  @param[in] inVal The validation events of each pattern.
+  The other parameters are the ones of BasicPatternRecognition.
+  */
+  BasicMultiStartTraining(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *inTrn,
+                            std::vector<BasicDataManager<T>*> *inVal, const bool usingSP, const unsigned bSize,
+                            const REAL signalWeight = 1.0, const REAL noiseWeight = 1.0, const REAL spResolution = 0.01);
+
+  virtual ~BasicMultiStartTraining();
+
+
+  /// Trains the runs.
+  /**
+  The networks of a previous training are released.
+  @param[in] numRuns The number of runs (of networks trained).
+  @param[in] seed The base seed, from which the seeds of the initial weights and of the sampling of each run are drawn.
+  @param[in] nEpochs The maximum number of epochs of each run.
+  @param[in] failLimit The maximum number of epochs without improvement (see BasicTraining::trainEpochs).
+  @return The index of the best run: the one of the highest validation SP, if the SP criterium is used,
+  or of the lowest validation MSE, otherwise (the first one, if tied).
+  @throw const char* If there are no runs, or if any of the runs fails.
+  */
+  unsigned train(const unsigned numRuns, const unsigned seed, const unsigned nEpochs, const unsigned failLimit);
+
+
+  /// Returns the runs of the last training.
+  const std::vector< BasicTrainRun<T> >& getRuns() const {return runs;};
+
+
+  /// Returns the index of the best run of the last training.
+  unsigned getBestRun() const {return bestRun;};
+};
+
+typedef BasicTrainRun<REAL> TrainRun;
+typedef BasicMultiStartTraining<REAL> MultiStartTraining;
+
+#endif
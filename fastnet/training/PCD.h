@@ -0,0 +1,186 @@
+#ifndef PCD_H
+#define PCD_H
+
+#include <vector>
+
+#include "fastnet/training/MultiStart.h"
+#include "fastnet/training/DataManager.h"
+
+
+/// A copy of the events of another manager, from which directions of the event space may be removed.
+/**
+ It holds the residual events of the Caloba style PCD extraction (see forceOrthogonalization in npcd.m).
+ Unlike the views of BasicDataManager, the events are copied (once), since they are changed.
+*/
+template <class T>
+class BasicResidualDataManager : public BasicDataManager<T>
+{
+protected:
+  using BasicDataManager<T>::evSize;
+  using BasicDataManager<T>::data;
+
+  /// The copy of the events, one after the other.
+  std::vector<T> store;
+
+public:
+  /**
+  @param[in] src The manager of the events to copy.
+  @param[in] seed The seed of the shuffles.
+  */
+  BasicResidualDataManager(const BasicDataManager<T> &src, const unsigned seed)
+  {
+    evSize = src.eventSize();
+    store.resize(static_cast<size_t>(src.numEvents()) * evSize);
+    data.resize(src.numEvents());
+    for (unsigned i=0; i<src.numEvents(); i++)
+    {
+      data[i] = &store[static_cast<size_t>(i) * evSize];
+      for (unsigned k=0; k<evSize; k++) data[i][k] = src[i][k];
+    }
+    this->init(data.size(), seed);
+  }
+
+  /// Removes, from every event, its projection over a direction.
+  /**
+  @param[in] dir The direction, with unit norm (eventSize() values).
+  */
+  void removeDirection(const std::vector<REAL> &dir)
+  {
+    for (unsigned i=0; i<data.size(); i++)
+    {
+      T *ev = data[i];
+      REAL proj = 0.;
+      for (unsigned k=0; k<evSize; k++) proj += dir[k] * ev[k];
+      for (unsigned k=0; k<evSize; k++) ev[k] -= static_cast<T>(proj * dir[k]);
+    }
+  }
+};
+
+
+/// The result of the extraction of a PCD.
+template <class T>
+struct BasicPCDRound
+{
+  /// The best network of the round, whose first hidden layer holds the PCDs extracted so far (owned by the extraction).
+  FastNet::BasicBackpropagation<T> *net;
+
+  /// The extracted PCD (with unit norm, at the Caloba style).
+  std::vector<REAL> pcd;
+
+  /// The training evolution of the best network.
+  TrainData trnEvolution;
+
+  /// The SP of the best network over the testing events.
+  REAL sp;
+};
+
+
+/// Extracts the Principal Components of Discrimination (PCD) of a pattern recognition network.
+/**
+ It replaces the extraction loop of npcd.m. The PCDs are the nodes of the first hidden layer of the
+ given network, which is never resized: at the round k, the nodes before k (the PCDs already
+ extracted) are frozen (see BasicBackpropagation::setFrozen), the node k is trained, and the nodes
+ after k are frozen with null weights, bias and outgoing weights, so they output 0 and change nothing.
+ Each round starts from the best network of the previous one (the warm start): only the weights of
+ the new node, and its outgoing weights, are initialized (by the Nguyen-Widrow method). The round
+ trains the network several times at the same time (see BasicMultiStartTraining), and its PCD is the
+ one of the highest testing SP: the maximum SP of the ROC, for two patterns, or the SP of the
+ confusion matrix, otherwise.
+
+ As npcd.m, a network with more than one hidden layer is extracted at the Caloba style: its first
+ layer must be linear and without bias, the initial weights of each new node are orthogonalized
+ against the PCDs already extracted, and each PCD, normalized, is removed from the events before the
+ next round (the events are copied for that, see BasicResidualDataManager). Otherwise (the Seixas
+ style), the events are only read.
+*/
+template <class T>
+class BasicPCDExtraction
+{
+protected:
+  /// The multi start training of a round, which initializes only the node of the round.
+  class RoundTraining : public BasicMultiStartTraining<T>
+  {
+  protected:
+    unsigned node;
+    bool orthogonalize;
+
+    virtual void initNetwork(FastNet::BasicBackpropagation<T> *net, const unsigned seed);
+
+  public:
+    RoundTraining(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *inTrn,
+                  std::vector<BasicDataManager<T>*> *inVal, const bool usingSP, const unsigned bSize,
+                  const REAL signalWeight, const REAL noiseWeight, const REAL spResolution,
+                  const unsigned node, const bool orthogonalize)
+                  : BasicMultiStartTraining<T>(net, inTrn, inVal, usingSP, bSize, signalWeight, noiseWeight, spResolution),
+                    node(node), orthogonalize(orthogonalize) {};
+  };
+
+  FastNet::BasicBackpropagation<T> *protoNet;
+  std::vector<BasicDataManager<T>*> *inTrnList;
+  std::vector<BasicDataManager<T>*> *inValList;
+  std::vector<BasicDataManager<T>*> *inTstList;
+  bool useSP;
+  unsigned batchSize;
+  REAL signalWeight;
+  REAL noiseWeight;
+  REAL spResolution;
+  bool calobaStyle;
+
+  std::vector< BasicPCDRound<T> > rounds;
+
+  /// Releases the networks of the last extraction.
+  void release();
+
+  /// Returns the testing SP of a network.
+  REAL testSP(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *tst) const;
+
+public:
+  /// The number of consecutive rounds below the minimum SP gain that stops the extraction (as npcd.m).
+  static const unsigned MAX_FAIL = 3;
+
+  /**
+  @param[in] net The network (its topology and training parameters). The number of nodes of its first
+  hidden layer is the maximum number of PCDs. It is not changed.
+  @param[in] inTrn The training events of each pattern.
+  @param[in] inVal The validation events of each pattern.
+  @param[in] inTst The testing events of each pattern.
+  The other parameters are the ones of BasicPatternRecognition.
+  @throw const char* If the first hidden layer does not fit the extraction style.
+  */
+  BasicPCDExtraction(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *inTrn,
+                      std::vector<BasicDataManager<T>*> *inVal, std::vector<BasicDataManager<T>*> *inTst,
+                      const bool usingSP, const unsigned bSize, const REAL signalWeight = 1.0,
+                      const REAL noiseWeight = 1.0, const REAL spResolution = 0.01);
+
+  virtual ~BasicPCDExtraction();
+
+
+  /// Extracts the PCDs.
+  /**
+  The results of a previous extraction are released.
+  @param[in] numIterations The number of trainings of each PCD.
+  @param[in] minDiff The minimum gain (in percent) of the testing SP of a PCD over the previous one. After
+  MAX_FAIL consecutive PCDs below it, the extraction stops.
+  @param[in] nPCD If not 0, the number of PCDs to extract (overriding minDiff).
+  @param[in] seed The base seed, from which the seeds of every round are drawn.
+  @param[in] nEpochs The maximum number of epochs of each training.
+  @param[in] failLimit The maximum number of epochs without improvement (see BasicTraining::trainEpochs).
+  @return The number of PCDs extracted.
+  @throw const char* If nPCD is above the number of nodes of the first hidden layer, or if any training fails.
+  */
+  unsigned extract(const unsigned numIterations, const REAL minDiff, const unsigned nPCD, const unsigned seed,
+                    const unsigned nEpochs, const unsigned failLimit);
+
+
+  /// Returns the rounds of the last extraction (one per PCD).
+  const std::vector< BasicPCDRound<T> >& getRounds() const {return rounds;};
+
+
+  /// Tells whether the extraction is at the Caloba style.
+  bool isCalobaStyle() const {return calobaStyle;};
+};
+
+typedef BasicPCDRound<REAL> PCDRound;
+typedef BasicPCDExtraction<REAL> PCDExtraction;
+
+#endif
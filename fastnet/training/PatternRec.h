@@ -7,38 +7,144 @@
 #include "fastnet/training/DataManager.h"
 
 
-class PatternRecognition : public Training
+/// Pattern recognition training, for networks stored with the precision T (float or double).
+template <class T>
+class BasicPatternRecognition : public BasicTraining<T>
 {
 protected:
-  std::vector<DataManager*> *inTrnList;
-  std::vector<DataManager*> *inValList;
-  std::vector<const REAL*> targList;
-  std::vector<REAL*> epochValOutputs;
+  using BasicTraining<T>::trnEvolution;
+  using BasicTraining<T>::mainNet;
+  using BasicTraining<T>::wsVec;
+  using BasicTraining<T>::nThreads;
+  using BasicTraining<T>::batchSize;
+  using BasicTraining<T>::chunkSize;
+  using BasicTraining<T>::updateGradients;
+  using BasicTraining<T>::updateWeights;
+
+  std::vector<BasicDataManager<T>*> *inTrnList;
+  std::vector<BasicDataManager<T>*> *inValList;
+  std::vector<const T*> targList;
   bool useSP;
   REAL bestGoalSP;
   REAL signalWeight;
   REAL noiseWeight;
 
+  /// The distance between the SP cuts.
+  REAL spResolution;
 
-  void getNetworkErrors(const std::vector<DataManager*> *inList, std::vector<REAL*> &epochOutputs, REAL &mseRet, REAL &spRet);
+  /// The thresholds where the SP product is calculated, from the noise target to the signal target.
+  std::vector<REAL> spCuts;
+
+  /// The histogram of the first output of each pattern, in the last validation (see spBin).
+  /**
+   It is used only by the two patterns discriminators.
+  */
+  std::vector< std::vector<unsigned> > epochValHist;
+
+  /// The confusion matrix of the last validation (see getConfusionMatrix).
+  std::vector<unsigned> epochValConf;
+
+  /// The number of values of the cache of each event (0, if nothing is cached).
+  unsigned cacheSize;
+
+  /// Tells whether the caches were already calculated.
+  bool cacheReady;
+
+  /// The cache of the frozen leading part of the network, for the training and validation events of each pattern.
+  /**
+   See BasicBackpropagation::cacheFrozen. They are calculated by the first training epoch (see buildCaches),
+   since the frozen nodes and their weights do not change while the network is trained: the frozen
+   nodes of the network must not be changed after it (the events are cached once per training object).
+  */
+  std::vector< std::vector<T> > trnCache;
+  std::vector< std::vector<T> > valCache;
+
+  /// Calculates the caches of the training and validation events, if the network has frozen leading nodes.
+  void buildCaches();
+
+  /// Calculates the cache of the events of each pattern.
+  void buildCache(const std::vector<BasicDataManager<T>*> *inList, std::vector< std::vector<T> > &cache);
+
+
+  void getNetworkErrors(const std::vector<BasicDataManager<T>*> *inList, const std::vector< std::vector<T> > *cache,
+                          std::vector< std::vector<unsigned> > &epochHist, std::vector<unsigned> &epochConf,
+                          REAL &mseRet, REAL &spRet);
+
+  /// Returns the pattern an output is classified as.
+  /**
+   As in genConfMatrix.m: the two patterns discriminators (a single output node) classify
+   the non negative outputs as the first pattern, and the others classify an output as the
+   pattern of its highest node (the first one, if tied, and ignoring the NaN nodes).
+  */
+  unsigned classify(const T *output) const
+  {
+    const unsigned numPatterns = targList.size();
+    if (numPatterns == 2) return (output[0] >= 0) ? 0 : 1;
+    unsigned best = 0;
+    for (unsigned k=1; k<numPatterns; k++)
+    {
+      if ( (output[k] > output[best]) || ((output[best] != output[best]) && (output[k] == output[k])) ) best = k;
+    }
+    return best;
+  }
+
+  /// Returns the histogram bin of an output: the number of SP cuts below or at it.
+  /**
+   So an output passes the cut k (is taken as signal) if its bin is above k. The outputs
+   that can not be compared (NaN) must not be binned, since they are neither above nor below any cut.
+  */
+  unsigned spBin(const REAL out) const
+  {
+    const unsigned numCuts = spCuts.size();
+    if (!(out >= spCuts[0])) return 0;
+    //An estimate from the resolution, corrected against the cuts themselves.
+    const REAL pos = (out - spCuts[0]) / spResolution + 1;
+    unsigned bin = (pos < numCuts) ? static_cast<unsigned>(pos) : numCuts;
+    while ( (bin > 1) && (out < spCuts[bin-1]) ) bin--;
+    while ( (bin < numCuts) && (out >= spCuts[bin]) ) bin++;
+    return bin;
+  }
 
 
 public:
 
-  PatternRecognition(FastNet::Backpropagation *net, std::vector<DataManager*> *inTrn, std::vector<DataManager*> *inVal, 
+  BasicPatternRecognition(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *inTrn, std::vector<BasicDataManager<T>*> *inVal, 
                       const bool usingSP, const unsigned bSize,
-                      const REAL signalWeigh = 1.0, const REAL noiseWeight = 1.0);
+                      const REAL signalWeigh = 1.0, const REAL noiseWeight = 1.0, const REAL spResolution = 0.01);
 
-  virtual ~PatternRecognition();
+  virtual ~BasicPatternRecognition();
 
   /// Calculates the SP product.
   /**
   Calculates the SP product. This method will run through the dynamic range of the outputs,
   calculating the SP product in each lambda value. Returning, at the end, the maximum SP
-  product obtained.
+  product obtained. The outputs are not scanned again for every cut: the efficiencies at all
+  the cuts are the cumulative sums of the output histograms, filled during the validation.
+  @param[in] inList The events of each pattern.
+  @param[in] epochHist The histogram of the outputs of each pattern (see spBin).
   @return The maximum SP value obtained.
   */
-  virtual REAL sp(const std::vector<DataManager*> *inList, const std::vector<REAL*> &epochOutputs);
+  virtual REAL sp(const std::vector<BasicDataManager<T>*> *inList, const std::vector< std::vector<unsigned> > &epochHist);
+
+
+  /// Calculates the SP product of a multi class discriminator.
+  /**
+  The SP product is calculated from the efficiency of each pattern (the fraction of its events
+  classified as itself), as calcSP.m: the square root of the geometric mean times the arithmetic
+  mean of the efficiencies. It is the SP criterium of the discriminators with more than two patterns.
+  @param[in] epochConf The confusion matrix (see getConfusionMatrix).
+  @return The SP value.
+  */
+  virtual REAL multiClassSP(const std::vector<unsigned> &epochConf);
+
+
+  /// Returns the confusion matrix of the last validation.
+  /**
+  The matrix has a row per pattern, where the element (i,j) is the number of validation events of the
+  pattern i classified as the pattern j (see classify), stored row after row. It is filled during the
+  validation pass, for any number of patterns.
+  */
+  const std::vector<unsigned>& getConfusionMatrix() const {return epochValConf;};
 
 
   /// Applies the validating set of each pattern for the network's validation.
@@ -54,7 +160,7 @@ public:
   virtual void valNetwork(REAL &mseVal, REAL &spVal)
   {
     DEBUG2("Starting validation process for an epoch.");
-    getNetworkErrors(inValList, epochValOutputs, mseVal, spVal);
+    getNetworkErrors(inValList, (cacheSize) ? &valCache : NULL, epochValHist, epochValConf, mseVal, spVal);
   }
 
 
@@ -79,4 +185,6 @@ public:
   virtual void showTrainingStatus(const unsigned epoch, const REAL trnError, const REAL valError);  
 };
 
+typedef BasicPatternRecognition<REAL> PatternRecognition;
+
 #endif
@@ -5,18 +5,30 @@
 #include "fastnet/training/DataManager.h"
 
 
-class StandardTraining : public Training
+/// Input-target training, for networks stored with the precision T (float or double).
+template <class T>
+class BasicStandardTraining : public BasicTraining<T>
 {
 protected:
-  DataManager *inTrnData;
-  DataManager *outTrnData;
-  DataManager *inValData;
-  DataManager *outValData;
+  using BasicTraining<T>::trnEvolution;
+  using BasicTraining<T>::mainNet;
+  using BasicTraining<T>::wsVec;
+  using BasicTraining<T>::nThreads;
+  using BasicTraining<T>::batchSize;
+  using BasicTraining<T>::chunkSize;
+  using BasicTraining<T>::updateGradients;
+  using BasicTraining<T>::updateWeights;
+
+  BasicDataManager<T> *inTrnData;
+  BasicDataManager<T> *outTrnData;
+  BasicDataManager<T> *inValData;
+  BasicDataManager<T> *outValData;
 
 public:
-  StandardTraining(FastNet::Backpropagation *net, DataManager *inTrn, DataManager *outTrn, DataManager *inVal, DataManager *outVal, const unsigned bSize);
+  BasicStandardTraining(FastNet::BasicBackpropagation<T> *net, BasicDataManager<T> *inTrn, BasicDataManager<T> *outTrn, 
+                          BasicDataManager<T> *inVal, BasicDataManager<T> *outVal, const unsigned bSize);
 
-  virtual ~StandardTraining(){};
+  virtual ~BasicStandardTraining(){};
   
   virtual void tstNetwork(REAL &mseTst, REAL &spTst){mseTst = spTst = 0.;};
 
@@ -45,4 +57,6 @@ public:
   virtual void showInfo(const unsigned nEpochs) const;
 };
 
+typedef BasicStandardTraining<REAL> StandardTraining;
+
 #endif
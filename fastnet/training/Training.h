@@ -15,6 +15,11 @@
 #include "fastnet/sys/Reporter.h"
 #include "fastnet/sys/defines.h"
 
+#ifdef NO_OMP
+inline int omp_get_num_threads() {return 1;}
+inline int omp_get_thread_num() {return 0;}
+#endif
+
 
 enum ValResult {WORSE = -1, EQUAL = 0, BETTER = 1};
 
@@ -37,37 +42,66 @@ struct TrainData
 };
 
 
-class Training
+/// Base class of the training strategies, for networks stored with the precision T (float or double).
+template <class T>
+class BasicTraining
 {
 protected:
+  typedef typename FastNet::BasicBackpropagation<T>::TrainingWorkspace Workspace;
+
   TrainData trnEvolution;
   REAL bestGoal;
-  FastNet::Backpropagation *mainNet;
-  FastNet::Backpropagation **netVec;
+  FastNet::BasicBackpropagation<T> *mainNet;
+  std::vector<Workspace*> wsVec;
   unsigned nThreads;
   unsigned batchSize;
   int chunkSize;
 
+  /// Minimum number of gradient values for the reduction to be split among the threads.
+  static const size_t PARALLEL_REDUCTION_MIN = 8192;
+
+  /// Adds the gradients accumulated by every thread to the network, and resets them.
+  /**
+   The reduction is partitioned: each thread reduces a slice of the gradient vector over
+   all the workspaces, so every thread does 1/nThreads of the work, instead of the master
+   thread doing all of it. The slices are made of whole cache lines, so no two threads write
+   to the same line. Each value is still summed in the workspace order, so the gradients
+   do not depend on how the slices are distributed.
+  */
   void updateGradients()
   {
-    for (unsigned i=1; i<nThreads; i++) mainNet->addToGradient(*netVec[i]);
+    const size_t size = mainNet->getGradientSize();
+    const size_t line = FastNet::LayerArena<ACC_REAL>::ALIGNMENT / sizeof(ACC_REAL);
+    const size_t slice = (((size + nThreads - 1) / nThreads + line - 1) / line) * line;
+    const int numSlices = static_cast<int>((size + slice - 1) / slice);
+    const unsigned numWs = nThreads;
+    FastNet::BasicBackpropagation<T> *net = mainNet;
+    Workspace * const *ws = &wsVec[0];
+    int s;
+
+    #pragma omp parallel for schedule(static) shared(net,ws) private(s) if (size >= PARALLEL_REDUCTION_MIN)
+    for (s=0; s<numSlices; s++)
+    {
+      const size_t begin = s*slice;
+      const size_t end = std::min(size, begin + slice);
+      for (unsigned i=0; i<numWs; i++)
+      {
+        net->addToGradient(*ws[i], begin, end);
+        ws[i]->resetGradients(begin, end);
+      }
+    }
   }
 
+  /// Updates the network weights. The threads read them from the network itself, so nothing is copied.
   virtual void updateWeights()
   {
     mainNet->updateWeights(batchSize);
-    for (unsigned i=1; i<nThreads; i++) (*netVec[i]) = (*mainNet);
   };
 
 
-#ifdef NO_OMP
-int omp_get_num_threads() {return 1;}
-int omp_get_thread_num() {return 0;}
-#endif
-
 public:
 
-  Training(FastNet::Backpropagation *n, const unsigned bSize)
+  BasicTraining(FastNet::BasicBackpropagation<T> *n, const unsigned bSize)
   {
     bestGoal = 10000000000.;
     batchSize = bSize;
@@ -82,16 +116,23 @@ public:
     nThreads = static_cast<unsigned>(nt);
     chunkSize = static_cast<int>(std::ceil(static_cast<float>(batchSize) / static_cast<float>(nThreads)));
     
-    netVec = new FastNet::Backpropagation* [nThreads];
-    mainNet = netVec[0] = n;
-    for (unsigned i=1; i<nThreads; i++) netVec[i] = new FastNet::Backpropagation(*n);
+    //The threads share the network, each one with its own workspace.
+    mainNet = n;
+    try
+    {
+      for (unsigned i=0; i<nThreads; i++) wsVec.push_back(new Workspace(*n));
+    }
+    catch (bad_alloc xa)
+    {
+      for (unsigned i=0; i<wsVec.size(); i++) delete wsVec[i];
+      throw;
+    }
   };
 
 
-  virtual ~Training()
+  virtual ~BasicTraining()
   {
-    for (unsigned i=1; i<nThreads; i++) delete netVec[i];
-    delete netVec;
+    for (unsigned i=0; i<wsVec.size(); i++) delete wsVec[i];
   };
 
 
@@ -149,7 +190,82 @@ public:
   virtual void valNetwork(REAL &mseVal, REAL &spVal) = 0;
   
   virtual REAL trainNetwork() = 0;  
+
+
+  /// Trains the network, epoch after epoch, until the early stopping criteria are met.
+  /**
+   Each epoch trains and validates the network, and the weights of the best validation are saved
+   in the network (see saveBestTrain). The training stops after nEpochs epochs, or when both the MSE
+   and the SP validations failed to improve for failLimit epochs (failLimit/2 for the MSE, if the SP
+   is used). The evolution of every epoch is saved (see getTrainInfo).
+   @param[in] nEpochs The maximum number of epochs.
+   @param[in] failLimit The maximum number of epochs without improvement.
+   @param[in] useSP If true, the best network is the one of the highest validation SP, instead of the lowest MSE.
+   @param[in] show The period, in epochs, of the training status reports (0 for none).
+  */
+  void trainEpochs(const unsigned nEpochs, const unsigned failLimit, const bool useSP, const unsigned show)
+  {
+    unsigned num_fails_mse = 0;
+    unsigned num_fails_sp = 0;
+    unsigned dispCounter = 0;
+    REAL mse_val, sp_val;
+    mse_val = sp_val = 0.;
+    ValResult is_best_mse, is_best_sp;
+    bool stop_mse, stop_sp;
+
+    //Calculating the max_fail limits for each case (MSE and SP, if the case).
+    const unsigned fail_limit_mse = (useSP) ? (failLimit / 2) : failLimit;
+    const unsigned fail_limit_sp = (useSP) ? failLimit : 0;
+    ValResult &is_best = (useSP) ? is_best_sp :  is_best_mse;
+    REAL &val_data = (useSP) ? sp_val : mse_val;
+
+    for (unsigned epoch=0; epoch<nEpochs; epoch++)
+    {
+      //Training the network and calculating the new weights.
+      const REAL mse_trn = trainNetwork();
+
+      //Validating the new network.
+      valNetwork(mse_val, sp_val);
+
+      // Saving the best weight result.
+      isBestNetwork(mse_val, sp_val, is_best_mse, is_best_sp);
+      
+      if (is_best_mse == BETTER) num_fails_mse = 0;
+      else if (is_best_mse == WORSE) num_fails_mse++;
+
+      if (is_best_sp == BETTER) num_fails_sp = 0;
+      else if (is_best_sp == WORSE) num_fails_sp++;
+      
+      if (is_best == BETTER) mainNet->saveBestTrain();
+
+      //Showing partial results at every "show" epochs (if show != 0).
+      if (show)
+      {
+        if (!dispCounter)
+        {
+          showTrainingStatus(epoch, mse_trn, val_data);
+        }
+        dispCounter = (dispCounter + 1) % show;
+      }
+
+      //Knowing whether the criterias are telling us to stop.
+      stop_mse = num_fails_mse >= fail_limit_mse;
+      stop_sp = num_fails_sp >= fail_limit_sp;
+
+      //Saving the training evolution info.
+      saveTrainInfo(epoch, mse_trn, mse_val, sp_val, is_best_mse, 
+                      is_best_sp, num_fails_mse, num_fails_sp, stop_mse, stop_sp);
+
+      if ( (stop_mse) && (stop_sp) )
+      {
+        if (show) REPORT("Maximum number of failures reached. Finishing training...");
+        break;
+      }
+    }
+  };
 };
 
+typedef BasicTraining<REAL> Training;
+
 #endif
 
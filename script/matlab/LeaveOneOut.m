@@ -62,5 +62,15 @@ classdef LeaveOneOut < handle
       %Moving to the next event.
       self.evIdx = self.evIdx + 1;
     end
+
+
+    function ret = native_dealer(self, nDeal)
+    %function ret = native_dealer(self, nDeal)
+    %Returns the description of the next nDeal deals of this algorithm for
+    %crossval_c, which deals them itself, as event indices, without copying
+    %the events. The events are taken in the same order as deal_sets.
+      ret = struct('type', 'LeaveOneOut', 'first', self.evIdx - 1, 'nDeal', nDeal);
+      self.evIdx = self.evIdx + nDeal;
+    end
   end  
 end
\ No newline at end of file
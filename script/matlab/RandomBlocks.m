@@ -80,6 +80,17 @@ classdef RandomBlocks
         end
       end
     end
+
+
+    function ret = native_dealer(self, nDeal)
+    %function ret = native_dealer(self, nDeal)
+    %Returns the description of nDeal deals of this algorithm for crossval_c,
+    %which deals the blocks itself, as event indices, without copying the
+    %events. The blocks are the same ones, but their order at each deal is
+    %drawn by crossval_c.
+      ret = struct('type', 'RandomBlocks', 'nTrn', self.nTrn, 'nVal', self.nVal, ...
+                   'nTst', self.nTst, 'nDeal', nDeal);
+    end
   end
 
   methods
@@ -39,11 +39,16 @@ function ret = crossVal(data, net, pp, dealAlgo, saveData, nDeal, nTrains)
 % - pp : Pre-processing structure returned by pp_func.
 % - data: the events distribution used by each deal.
 %
+%If there is no pre-processing and dealAlgo has a native_dealer method
+%(RandomBlocks and LeaveOneOut), the deals are trained in parallel by
+%crossval_c, as views of data (no set is copied), and ret.data is not saved.
+%
 %WARNING: THIS FUNCTION ONLY WORKS FOR THE 2 CLASSES CASE!!!
 %
 
 if nargin < 2, net = []; end
-if (nargin < 3) || (isempty(pp)),
+usePP = (nargin >= 3) && (~isempty(pp));
+if ~usePP,
   pp.func = @do_nothing;
   pp.par = [];
 end
@@ -74,6 +79,21 @@ if isempty(net),
     [trn val tst ret.pp{d}] = calculate_pre_processing(trn, val, tst, pp);
     [ret.net{d} ret.sp(d) ret.det(d,:) ret.fa(d,:)] = get_sp_by_fisher(trn, tst, nROC);
   end  
+elseif (~usePP) && (length(data) == 2) && (size(data{1},1) > 1) && ismethod(dealAlgo, 'native_dealer'),
+  %Without pre-processing, the deals are views of data, trained in parallel
+  %by crossval_c, so no set is copied.
+  cutVec = -1 : (2/nROC) : 1;
+  cutVec = cutVec(1:nROC);
+  seed = floor(rand() * 2^31);
+  [ret.net, ret.evo, ret.sp, det, fa] = crossval_c(net, net.trainParam, data, dealAlgo.native_dealer(nDeal), nTrains, seed, cutVec);
+  ret.det = cell2mat(det');
+  ret.fa = cell2mat(fa');
+  if ~net.trainParam.useSP,
+    ret.evo = cellfun(@(x) rmfield(x, {'sp_val', 'is_best_sp', 'num_fails_sp', 'stop_sp'}), ret.evo, 'UniformOutput', false);
+  end
+  if saveData,
+    warning('The deals made by crossval_c are not saved.');
+  end
 else
   ret.evo = cell(1,nDeal);
   [net_par.hidNodes, net_par.trfFunc, net_par.trnParam] = getNetworkInfo(net);
@@ -95,23 +115,28 @@ end
 
 
 
-function [onet oevo osp odet ofa] = get_best_train(net_par, trn, val, tst, nTrains, nROC)
-%Trains the network net multiple times, and returns the best SP obtained.
-%The number of trains to perform is get from the length of the cell vector
-%net.
+function [onet oevo osp odet ofa] = get_best_train(net_par, trn, val, tst, nTrains, nROC, seed)
+%Trains the network net multiple times (all at once, by trainmany_c, with
+%the initial weights drawn from seed), and returns the best SP obtained.
+%If no seed is given, a random one is drawn, as in the native cross validation.
+
+  if nargin < 7, seed = floor(rand() * 2^31); end
 
-  netVec = cell(1, nTrains);
-  evo = cell(1, nTrains);
   sp = zeros(1, nTrains);
   det = zeros(nTrains, nROC);
   fa = zeros(nTrains, nROC);
   
+  net = newff2(trn, [-1 1], net_par.hidNodes, net_par.trfFunc);
+  net.trainParam = net_par.trnParam;
+  [netVec evo] = trainmany_c(net, net.trainParam, trn, val, nTrains, seed);
+  if ~net.trainParam.useSP,
+    evo = cellfun(@(x) rmfield(x, {'sp_val', 'is_best_sp', 'num_fails_sp', 'stop_sp'}), evo, 'UniformOutput', false);
+  end
+  
+  %All the trained networks are evaluated in a single pass over the testing set.
+  out = nsim(netVec, tst);
   for i=1:nTrains,
-    net = newff2(trn, [-1 1], net_par.hidNodes, net_par.trfFunc);
-    net.trainParam = net_par.trnParam;
-    [netVec{i} evo{i}]  = ntrain(net, trn, val);
-    out = nsim(netVec{i}, tst);
-    [spVec, cutVec, det(i,:), fa(i,:)] = genROC(out{1}, out{2}, nROC);
+    [spVec, cutVec, det(i,:), fa(i,:)] = genROC(reshape(out{1}(i,1,:), 1, []), reshape(out{2}(i,1,:), 1, []), nROC);
     sp(i) = max(spVec);
   end
   
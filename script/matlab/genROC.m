@@ -30,14 +30,10 @@ end
 %Stablishing where to calculate the efficiencies (thresholds).
 cutVec = -1 : (2/numPts) : 1;
 cutVec = cutVec(1:numPts);
-detVec = zeros(1,length(cutVec));
-faVec = zeros(1,length(cutVec));
 
-for i=1:length(cutVec),
-    [detVec(i), faVec(i)] = getEff(out_signal, out_noise, cutVec(i));
-end
-
-spVec = calcSP([detVec; (1-faVec)]);
+%The outputs are sorted once, and the efficiencies at every threshold are
+%found by binary search (see nroc), instead of rescanning them per threshold.
+[spVec, cutVec, detVec, faVec] = roc_c(double(out_signal), double(out_noise), cutVec);
 [sp, cutIdx] = max(spVec);
 
 if nargout == 0,
@@ -0,0 +1,27 @@
+function ncompile(net, fileName, funcName, type)
+%function ncompile(net, fileName, funcName, type)
+%Writes a trained neural network as a dependency free C/C++ source file, holding the weights
+%as constant arrays and a single, fully unrolled, inference function with the prototype
+%	void funcName(const type *input, type *output);
+%The file can be compiled into any C (C99) or C++ program, without the FastNet libraries.
+%Parameters are:
+%	net             -> The neural network structure created by "newff2", or the name of a
+%                      model file written by "nsave".
+%	fileName        -> The name of the source file to be created (it is overwritten, if it exists).
+%	funcName        -> The name of the inference function (a valid C identifier). Every other
+%                      generated name starts with it.
+%	type            -> (optional) The precision of the generated code: 'double' (default) or 'float'.
+%
+%The zero (pruned) weights are left out of the generated code. The outputs may differ from
+%the ones calculated by "nsim" by rounding.
+%
+
+if nargin < 4,
+  type = 'double';
+end
+
+if ~ischar(fileName) || ~ischar(funcName),
+  error('The file and function names must be strings!');
+end
+
+ncompile_c(net, fileName, funcName, type);
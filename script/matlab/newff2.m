@@ -30,10 +30,16 @@ function net = newff2(inTrn, outData, hNodes, trfFunc, netTrain)
     net.trainParam.decFactor = 1;
   end
 
-  %Adding the usingBias and frozen nodes.
+  %Transfer functions precision mode ('exact', 'rational' or 'table').
+  %It is kept with the network, so the training and the simulation use the same functions.
+  net.userdata.trfPrecision = 'exact';
+
+  %Adding the usingBias, frozen nodes and pruned flags. The zero weights of a
+  %pruned layer are removed connections, which the training keeps at zero.
   for i=1:net.numLayers,
     net.layers{i}.userdata.usingBias = true;
     net.layers{i}.userdata.frozenNodes = [];
+    net.layers{i}.userdata.pruned = false;
   end
 
   %Specifying the SP goal.
@@ -43,6 +49,9 @@ function net = newff2(inTrn, outData, hNodes, trfFunc, netTrain)
   net.trainParam.sp_signal_weight = 1;
   net.trainParam.sp_noise_weight = 1;
 
+  %Distance between the output thresholds where the SP is calculated.
+  net.trainParam.sp_resolution = 0.01;
+
   %Specifying the batch size.
   net.trainParam.batchSize = 10;
 
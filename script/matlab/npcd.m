@@ -1,5 +1,5 @@
-function [pcd, outNet, trnEvo, efficVec] = npcd(net, inTrn, inVal, inTst, numIterations, minDiff, nPCD)
-%function [pcd, outNet, trnEvo, efficVec] = npcd(net, inTrn, inVal, inTst, numIterations, minDiff, nPCD)
+function [pcd, outNet, trnEvo, efficVec] = npcd(net, inTrn, inVal, inTst, numIterations, minDiff, nPCD, seed)
+%function [pcd, outNet, trnEvo, efficVec] = npcd(net, inTrn, inVal, inTst, numIterations, minDiff, nPCD, seed)
 %Extracts the Principal Components of Discrimination (PCD).
 %Input parameters are:
 % net - The template neural netork to use. The number of PCDs to be
@@ -15,6 +15,8 @@ function [pcd, outNet, trnEvo, efficVec] = npcd(net, inTrn, inVal, inTst, numIte
 % minDiff - The minimum difference (in percentual value) in the SP for continuing extracting PCDs.
 % nPCD - If not zero, it must be the numer of OCD to be extracted. This parameter, if > 0, overrides
 %        minDiff.
+% seed - The base seed of the initial weights and of the sampling of every training
+%        (default 0), so the same seed gives the same PCDs.
 %
 %The function returns:
 % pcd - A matrix with the extracted PCDs.
@@ -25,14 +27,19 @@ function [pcd, outNet, trnEvo, efficVec] = npcd(net, inTrn, inVal, inTst, numIte
 % efficVec - a struct vector containing the mean and std of the SP efficiency obtained
 % for each PCD extraction, considering the number of iterations performed.
 %
+%The extraction is done by pcd_c, in a single call: each PCD starts from the
+%best network of the previous one (only the new node, and its outgoing
+%weights, are initialized), and the iterations of each PCD are trained in
+%parallel.
 %
 
 if (nargin < 5), numIterations = 5; end
 if (nargin < 6), minDiff = 0.01; end
 if (nargin < 7), nPCD = 0; end
+if (nargin < 8), seed = 0; end
 
 
-if (nargin > 7) || (nargin < 4),
+if (nargin > 8) || (nargin < 4),
   error('Invalid number of input arguments. See help.');
 end
 
@@ -47,153 +54,48 @@ end
 %orthogonalization. Also, in this case, there must be no bias in the first
 %hidded layer, and the activation function must be linear.
 if length(trfFunc) > 2,
-  multiLayer = true;
   usingBias(1) = false;
   trfFunc{1} = 'purelin';
-  disp('Extracting via Caloba Style');
-else
-  disp('Extracting via Seixas Style');
-  multiLayer = false;
 end
 
-
-%Initializing the output vectors.
-pcd = [];
-bias = [];
-outNet = cell(1,maxNumPCD);
-trnEvo = cell(1,maxNumPCD);
-maxEfic = zeros(1,maxNumPCD);
-
-%Will count how many PCDs were actually extracted.
-pcdExtracted = 1;
-
-%It is considered a failure if the PCD max SP is less than minDiff the
-%previous one. Then , if 'maxFail' failures occur, in a sequence, the PCD
-%extraction is aborted. But mxCount is reset to zero if, after a failure,
-%the next extraction is successfull.
-maxFail = 3;
-mfCount = 0;
-prevMaxSP = 0;
-spDiff = 0;
-
-%Extracting one PCD per iteration.
-for i=1:maxNumPCD,
-  pcdExtracted = i;
-  fprintf('Extracting PCD number %d (SP diff = %f)\n', pcdExtracted, spDiff);
-  
-  
-  trnNet = stdPCD(pcd, bias, trnAlgo, numNodes, trfFunc, usingBias, trnParam);
-
-  if (multiLayer && i>1),
-    [inTrn, inVal, inTst] = forceOrthogonalization(pcd(end,:), inTrn, inVal, inTst);
-  end
-  
-  %Doing the training.
-  [outNet{i}, trnEvo{i}, maxEfic(i)] = doTrain(trnNet, inTrn, inVal, inTst, numIterations, (multiLayer && i>1));
-  maxSP = 100*maxEfic(i);
-  
-  pcd2Save = outNet{i}.IW{1}(end,:);
-  if multiLayer, %Unit norm if Caloba Style.
-    pcd2Save = pcd2Save ./ norm(pcd2Save);
+%The network holds a node per PCD in its first hidden layer. The nodes not
+%extracted yet are kept with null weights by pcd_c.
+trnNet = stdPCD(maxNumPCD, trnAlgo, numNodes, trfFunc, usingBias, trnParam);
+[pcd, nets, trnEvo, efficVec] = pcd_c(trnNet, trnParam, inTrn, inVal, inTst, numIterations, minDiff, nPCD, seed);
+
+%Returning, for each PCD, the network with the PCDs extracted so far.
+outNet = cell(1, length(nets));
+for i=1:length(nets),
+  outNet{i} = trimPCD(nets{i}, i, trnAlgo, numNodes, trfFunc, usingBias, trnParam);
+  if ~trnParam.useSP,
+    trnEvo{i} = rmfield(trnEvo{i}, {'sp_val', 'is_best_sp', 'num_fails_sp', 'stop_sp'});
   end
-  pcd = [pcd; pcd2Save];
-  bias = outNet{i}.b{1};
-
-  %If the SP increment is not above the minimum threshold, we initiate the
-  %stopping countdown.
-  spDiff = 100 * (maxSP-prevMaxSP) / maxSP;
-  if (spDiff < minDiff)
-    mfCount = mfCount + 1;
-  else
-    mfCount = 0; %Stopping the countdown for the moment.
-  end
-  
-  if (nPCD == 0) && (mfCount == maxFail),
-    break; %We end the PCD extraction
-  end
-  
-  % We move on to the next PCD.
-  prevMaxSP = maxSP;
 end
 
-%Returning the PCDs actually extracted.
-pcd = pcd(1:pcdExtracted,:);
-outNet = outNet(1:pcdExtracted);
-trnEvo = trnEvo(1:pcdExtracted);
-efficVec = maxEfic(1:pcdExtracted);
-
 
 
-function net = stdPCD(pcd, bias, trnAlgo, numNodes, trfFunc, usingBias, trnParam)
-  nPCD = size(pcd,1);
-  numNodes.hidNodes(1) = nPCD + 1; %Increasing the number of nodes in the first hidden layers.
+function net = stdPCD(nPCD, trnAlgo, numNodes, trfFunc, usingBias, trnParam)
+  numNodes.hidNodes(1) = nPCD; %The number of nodes in the first hidden layer.
   net = newff2(numNodes.inRange, numNodes.outRange, numNodes.hidNodes, trfFunc, trnAlgo);
   net.trainParam = trnParam;
   
   for i=1:length(net.layers),
     net.layers{i}.userdata.usingBias = usingBias(i);
   end
-  
-  %Getting the PCDs extracted so far, and freezing them.
-  if (nPCD>=1),
-    net.IW{1}(1:nPCD,:) = pcd;
-    net.b{1}(1:nPCD) = bias;
-    net.layers{1}.userdata.frozenNodes = (1:nPCD);
-  end
 
 
-  
-function [trn, val, tst] = forceOrthogonalization(lastPCD, trn, val, tst)
-  %If we  have already extracted a PCD, we remove
-  % the information of the last PCD from the init values of the
-  % new PCD to be extracted, and also from the input data.
-  
-  disp('Extracting the residual information for the next component.')
-    
-  %Removing the info related to the last PCD extracted.
-  Nc = length(trn);
-  for i=1:Nc,
-    trn{i} = trn{i} - ( lastPCD' * (lastPCD * trn{i}) );
-    val{i} = val{i} - ( lastPCD' * (lastPCD * val{i}) );
-    tst{i} = tst{i} - ( lastPCD' * (lastPCD * tst{i}) );
+function net = trimPCD(fullNet, nPCD, trnAlgo, numNodes, trfFunc, usingBias, trnParam)
+  %Keeping only the nodes of the PCDs extracted so far (the previous ones frozen).
+  net = stdPCD(nPCD, trnAlgo, numNodes, trfFunc, usingBias, trnParam);
+  net.IW{1} = fullNet.IW{1}(1:nPCD,:);
+  net.b{1} = fullNet.b{1}(1:nPCD);
+  net.LW{2,1} = fullNet.LW{2,1}(:,1:nPCD);
+  net.b{2} = fullNet.b{2};
+  for i=3:net.numLayers,
+    net.LW{i,(i-1)} = fullNet.LW{i,(i-1)};
+    net.b{i} = fullNet.b{i};
   end
-
-  
-  function iw = ortWeights(iw)
-    disp('Pointing the initial weights of the new PCD to the right direction.');
-    sw = iw(end,:);
-    for i=1:(size(iw,1)-1)
-      pw = iw(i,:);
-      iw(end,:) = iw(end,:) - ( (pw*sw') / (pw*pw') )*pw;
-    end
-
-  
-function [bNet, bEvo, maxSP] = doTrain(net, inTrn, inVal, inTst, numTrains, ortWeight)
-  netVec = cell(1,numTrains);
-  trnVec = cell(1,numTrains);
-  spVec = zeros(1, numTrains);
-  nClasses = length(inTrn);
-
-  for i=1:numTrains,
-    net = scrambleWeights(net);
-    
-    if ortWeight,
-      net.IW{1} = ortWeights(net.IW{1});
-    end
-    
-    [netVec{i}, trnVec{i}] = ntrain(net, inTrn, inVal);
-    out = nsim(netVec{i}, inTst);
-  
-    if nClasses > 2,
-      spVec(i) = calcSP(diag(genConfMatrix(out)));
-    else
-      spVec(i) = max(genROC(out{1}, out{2}));
-    end
-  end
-
-  [maxSP, idx] = max(spVec);
-  bNet = netVec{idx};
-  bEvo = trnVec{idx};
+  net.layers{1}.userdata.frozenNodes = (1:(nPCD-1));
 
 
 function [trnAlgo, maxNumPCD, numNodes, trfFunc, usingBias, trnParam] = getNetworkInfo(net)
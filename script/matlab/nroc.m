@@ -0,0 +1,25 @@
+function [spVec, cutVec, detVec, faVec, auc, bestIdx] = nroc(out_signal, out_noise, cutVec, signalWeight, noiseWeight)
+%function [spVec, cutVec, detVec, faVec, auc, bestIdx] = nroc(out_signal, out_noise, cutVec, signalWeight, noiseWeight)
+%Calculates the ROC of a two class discriminator, where the signal is expected above the
+%decision threshold (an output equal to the threshold is taken as signal).
+%Parameters are:
+%	out_signal      -> The outputs generated by the discriminator for the signal events.
+%	out_noise       -> The outputs generated by the discriminator for the noise events.
+%	cutVec          -> (optional) The thresholds where the ROC is calculated. If ommited or [],
+%                      the exact ROC is calculated: every distinct output value is a threshold,
+%                      in increasing order, followed by Inf (no event taken as signal).
+%	signalWeight    -> (optional) The weight of the detection efficiency in the SP product (default 1).
+%	noiseWeight     -> (optional) The weight of the noise rejection in the SP product (default 1).
+%
+%The function returns the SP product, the threshold, the detection efficiency and the false
+%alarm probability of each operating point, the area under the ROC (auc) and the index of the
+%point with the maximum SP product (bestIdx). The weighted SP product is the same one used by
+%the SP stopping criteria of the training (see sp_signal_weight and sp_noise_weight in newff2).
+%The outputs are sorted once, so the exact ROC of millions of events takes a single pass.
+%
+
+if nargin < 3, cutVec = []; end
+if nargin < 4, signalWeight = 1; end
+if nargin < 5, noiseWeight = 1; end
+
+[spVec, cutVec, detVec, faVec, auc, bestIdx] = roc_c(double(out_signal), double(out_noise), double(cutVec), signalWeight, noiseWeight);
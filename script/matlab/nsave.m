@@ -0,0 +1,18 @@
+function nsave(net, fileName)
+%function nsave(net, fileName)
+%Writes a neural network to a binary model file. The file holds the network topology,
+%transfer functions, bias usage, frozen nodes and weights, and it is mapped in memory
+%(without parsing or copying the weights) when loaded, so even hundreds of networks
+%(such as the ones obtained in a cross validation) are loaded in a few milliseconds.
+%Parameters are:
+%	net             -> The neural network structure created by "newff2" (trained or not).
+%	fileName        -> The name of the model file to be created (it is overwritten, if it exists).
+%
+%The model file name may be passed to "nsim" in place of the network structure.
+%
+
+if ~ischar(fileName),
+  error('The model file name must be a string!');
+end
+
+nsave_c(net, net.trainParam, fileName);
@@ -1,16 +1,49 @@
-function out = nsim(net, in_data)
-%function out = nsim(net, in_data)
+function out = nsim(net, in_data, mode, calib_data)
+%function out = nsim(net, in_data, mode, calib_data)
 %Propagates a input data set through a neural network, returning the output generated for
 % each input, just like sim. input_data can be a standard matrix, or a cell
 % vector. If it is a cell vector, the feedforward is applyed for each cell,
 %and the output will be, also, a cell vector.
 %Parameters are:
-%	net             -> The neural network structure created by "newff2".
+%	net             -> The neural network structure created by "newff2", or the name of a
+%                      model file written by "nsave". It may also be a cell vector of networks
+%                      with the same number of inputs and outputs (an ensemble), which are all
+%                      evaluated in a single pass over the data (only in the 'float' mode).
 %	in_data         -> The input data.
+%	mode            -> (optional) The network precision: 'float' (default), 'int8' or 'int16'.
+%                      In the integer modes, the network is quantized before the propagation,
+%                      reproducing the fixed point networks of the online trigger.
+%	calib_data      -> (optional) The events used to calibrate the quantization scales. If not
+%                      given, in_data is used (if in_data is a cell vector, all of its cells).
 %The function returns:
-%	out -> The output generated by the network for each input.
+%	out -> The output generated by the network for each input. For an ensemble of N networks,
+%         a (N x outputs x events) matrix, where out(i,:,j) is the output of network i for event j.
 %
 
+if nargin < 3,
+  mode = 'float';
+end
+
+if ~any(strcmp(mode, {'float', 'int8', 'int16'})),
+  error('Invalid network precision! Use float, int8 or int16.');
+end
+
+%The calibration events are only needed (and only built) by the integer modes.
+quantize = strcmp(mode, 'int8') || strcmp(mode, 'int16');
+if quantize,
+  if nargin < 4,
+    if iscell(in_data),
+      calib_data = [in_data{:}];
+    else
+      calib_data = in_data;
+    end
+  end
+
+  if ~isa(calib_data, 'double'),
+    error(sprintf('Calibration dataset is not of type "double"!'));
+  end
+end
+
 if iscell(in_data),
   nClasses = length(in_data);
   out = cell(1, nClasses);
@@ -19,12 +52,20 @@ if iscell(in_data),
       error(sprintf('Cell number %d does not containg a double precision matrix! Data must be of type "double"!', i));
     end
     if ~isempty(in_data{i}),
+      if quantize,
+        out{i} = sim_c(net, in_data{i}, mode, calib_data);
+      else
         out{i} = sim_c(net, in_data{i});
+      end
     end
   end
 else
   if ~isa(in_data, 'double'),
     error(sprintf('Input dataset is not of type "double"!'));
   end  
-  out = sim_c(net, in_data);
+  if quantize,
+    out = sim_c(net, in_data, mode, calib_data);
+  else
+    out = sim_c(net, in_data);
+  end
 end
@@ -1,5 +1,5 @@
-function [oNet, I] = trainMany(net, inTrn, inVal, inTst, numTrains)
-%function [oNet, I] = trainMany(net, inTrn, inVal, inTst, numTrains)
+function [oNet, I] = trainMany(net, inTrn, inVal, inTst, numTrains, seed)
+%function [oNet, I] = trainMany(net, inTrn, inVal, inTst, numTrains, seed)
 %Returns the maximum SP value obtained for each training, as well as the
 %trained network for each iteration. The function receives a non trained 
 %(but configured) neural network net, the training 
@@ -9,16 +9,37 @@ function [oNet, I] = trainMany(net, inTrn, inVal, inTst, numTrains)
 %vector containning the max sp obtained for the network, the trained network structure,
 %the epochs evolution, and the training and validation errors obtained for each epoch.
 %"I" is the index within the oNet cell vector where the best train was achieved.
+%All the trainings are done at once, in parallel, by trainmany_c. The initial
+%weights (Nguyen-Widrow, keeping the frozen nodes) are drawn from the seed,
+%so the same seed gives the same trainings. If no seed is given, a random one
+%is drawn, so successive calls give different trainings.
 %
 
+if nargin < 6, seed = floor(rand() * 2^31); end
+
 oNet = cell(1,numTrains);
 spVec = zeros(1, numTrains);
 nClasses = length(inTrn);
 
+[nets, evos] = trainmany_c(net, net.trainParam, inTrn, inVal, numTrains, seed);
 for i=1:numTrains,
-  net = scrambleWeights(net);
-  [aux.net, aux.trnEvo] = ntrain(net, inTrn, inVal);
-  out = nsim(aux.net, inTst);
+  oNet{i}.net = nets{i};
+  oNet{i}.trnEvo = evos{i};
+  if ~net.trainParam.useSP,
+    oNet{i}.trnEvo = rmfield(oNet{i}.trnEvo, {'sp_val', 'is_best_sp', 'num_fails_sp', 'stop_sp'});
+  end
+end
+
+%All the trained networks are evaluated in a single pass over the testing set.
+nets = cellfun(@(x) x.net, oNet, 'UniformOutput', false);
+outs = nsim(nets, inTst);
+
+for i=1:numTrains,
+  aux = oNet{i};
+  out = cell(1, nClasses);
+  for c=1:nClasses,
+    out{c} = reshape(outs{c}(i,:,:), size(outs{c},2), []);
+  end
   
   if nClasses > 2,
     aux.sp = calcSP(diag(genConfMatrix(out)));
@@ -0,0 +1,181 @@
+/**
+@file  crossval_c.cxx
+@brief The Matlab's crossVal function definition file.
+
+ This file implements the function that is called by matlab when the matlab's crossVal
+ function is called with a network and a deal algorithm that can be dealt natively (see the
+ native_dealer method of RandomBlocks and LeaveOneOut). Every deal is a view of the events of
+ each class (see CrossValid.h), and the deals are trained in parallel. For each deal, it returns
+ the best network, its training evolution, the maximum testing SP, the testing ROC and the
+ testing outputs.
+*/
+
+#include <vector>
+#include <mex.h>
+
+#include "fastnet/sys/Reporter.h"
+#include "fastnet/neuralnet/backpropagation.h"
+#include "fastnet/neuralnet/rprop.h"
+#include "fastnet/training/CrossValid.h"
+#include "matlabbp.hxx"
+#include "matlabrp.hxx"
+#include "mxdatamanager.hxx"
+#include "mxtraininfo.hxx"
+
+using namespace std;
+using namespace FastNet;
+
+/// Number of input arguments.
+const unsigned NUM_ARGS = 7;
+
+/// Index, in the arguments list, of the neural network structure.
+const unsigned NET_STR_IDX = 0;
+
+/// Index, in the arguments list, of the neural network train parameters structure.
+const unsigned NET_TRN_STR_IDX = 1;
+
+/// Index, in the arguments list, of the events (a cell per class).
+const unsigned DATA_IDX = 2;
+
+/// Index, in the arguments list, of the deal algorithm structure.
+const unsigned DEALER_IDX = 3;
+
+/// Index, in the arguments list, of the number of trainings per deal.
+const unsigned NUM_TRAINS_IDX = 4;
+
+/// Index, in the arguments list, of the base seed.
+const unsigned SEED_IDX = 5;
+
+/// Index, in the arguments list, of the ROC thresholds (empty for the exact ROCs).
+const unsigned CUTS_IDX = 6;
+
+/// Indexes, in the return vector, of the networks, training evolutions, SP, detection, false alarm and testing outputs of each deal.
+const unsigned OUT_NET_IDX = 0;
+const unsigned OUT_TRN_EVO = 1;
+const unsigned OUT_SP_IDX = 2;
+const unsigned OUT_DET_IDX = 3;
+const unsigned OUT_FA_IDX = 4;
+const unsigned OUT_TST_IDX = 5;
+
+
+/// Creates a Matlab row vector from a vector.
+mxArray *createRow(const vector<REAL> &vec)
+{
+  mxArray *ret = mxCreateNumericMatrix(1, vec.size(), REAL_TYPE, mxREAL);
+  REAL *data = static_cast<REAL*>(mxGetData(ret));
+  for (size_t i=0; i<vec.size(); i++) data[i] = vec[i];
+  return ret;
+}
+
+
+/// Reads a field of the deal algorithm structure.
+unsigned getDealerField(const mxArray *dealer, const char *name)
+{
+  const mxArray *field = mxGetField(dealer, 0, name);
+  if (!field) throw "Incomplete deal algorithm structure!";
+  return static_cast<unsigned>(mxGetScalar(field));
+}
+
+
+/// Matlab 's main function.
+void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
+{
+  MatlabBP *matHandler = nullptr;
+  Backpropagation *net = nullptr;
+  Dealer *dealer = nullptr;
+  CrossValidation *cv = nullptr;
+  std::vector<DataManager*> data;
+  const char *errorMsg = nullptr;
+
+  try
+  {
+    if (nargin != NUM_ARGS) throw "Incorrect number of arguments! See help for information!";
+    if (!mxIsCell(args[DATA_IDX])) throw "The events must be given as a cell vector per class!";
+
+    const mxArray *netStr = args[NET_STR_IDX];
+    const mxArray *trnParam =  args[NET_TRN_STR_IDX];
+    const unsigned numTrains = static_cast<unsigned>(mxGetScalar(args[NUM_TRAINS_IDX]));
+    const unsigned seed = static_cast<unsigned>(mxGetScalar(args[SEED_IDX]));
+    const unsigned nEpochs = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "epochs")));
+    const unsigned show = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "show")));
+    const unsigned fail_limit = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "max_fail")));
+    const unsigned batchSize = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "batchSize")));
+    const bool useSP = static_cast<bool>(mxGetScalar(mxGetField(trnParam, 0, "useSP")));
+    const REAL signalWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_signal_weight")));
+    const REAL noiseWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_noise_weight")));
+    const mxArray *spRes = mxGetField(trnParam, 0, "sp_resolution");
+    const REAL spResolution = (spRes) ? static_cast<REAL>(mxGetScalar(spRes)) : 0.01;
+    const REAL *c = static_cast<const REAL*>(mxGetData(args[CUTS_IDX]));
+    const vector<REAL> cuts(c, c + mxGetNumberOfElements(args[CUTS_IDX]));
+
+    //Selecting the training type by reading the training agorithm.
+    const string trnType = mxArrayToString(mxGetField(netStr, 0, "trainFcn"));
+    if (trnType == TRAINRP_ID) matHandler = new MatlabRP(netStr, trnParam);
+    else if (trnType == TRAINGD_ID) matHandler = new MatlabBP(netStr, trnParam);
+    else throw "Invalid training algorithm option!";
+    net = matHandler->getNetwork();
+
+    //The events of each class are a single store, shared by every deal.
+    vector<unsigned> numEvents;
+    for (auto i=0; i<mxGetN(args[DATA_IDX]); i++)
+    {
+      data.push_back(new MxDataManager(mxGetCell(args[DATA_IDX], i)));
+      numEvents.push_back(data.back()->numEvents());
+    }
+
+    //Creating the deals.
+    const mxArray *dealStr = args[DEALER_IDX];
+    const string dealType = mxArrayToString(mxGetField(dealStr, 0, "type"));
+    if (dealType == "RandomBlocks")
+    {
+      dealer = new RandomBlocksDealer(numEvents, getDealerField(dealStr, "nTrn"), getDealerField(dealStr, "nVal"),
+                                        getDealerField(dealStr, "nTst"), getDealerField(dealStr, "nDeal"), seed);
+    }
+    else if (dealType == "LeaveOneOut")
+    {
+      dealer = new LeaveOneOutDealer(numEvents, getDealerField(dealStr, "first"), getDealerField(dealStr, "nDeal"));
+    }
+    else throw "Invalid deal algorithm!";
+
+    if (show) REPORT("Starting the cross validation of " << dealer->numDeals() << " deals...");
+    cv = new CrossValidation(net, &data, useSP, batchSize, signalWeight, noiseWeight, spResolution);
+    cv->run(*dealer, numTrains, seed, nEpochs, fail_limit, cuts);
+
+    //Returning the results of each deal.
+    const vector<DealResult> &res = cv->getResults();
+    const unsigned nDeals = res.size();
+    ret[OUT_NET_IDX] = mxCreateCellMatrix(1, nDeals);
+    if (nargout > OUT_TRN_EVO) ret[OUT_TRN_EVO] = mxCreateCellMatrix(1, nDeals);
+    if (nargout > OUT_SP_IDX) ret[OUT_SP_IDX] = mxCreateDoubleMatrix(1, nDeals, mxREAL);
+    if (nargout > OUT_DET_IDX) ret[OUT_DET_IDX] = mxCreateCellMatrix(1, nDeals);
+    if (nargout > OUT_FA_IDX) ret[OUT_FA_IDX] = mxCreateCellMatrix(1, nDeals);
+    if (nargout > OUT_TST_IDX) ret[OUT_TST_IDX] = mxCreateCellMatrix(1, nDeals);
+    for (unsigned d=0; d<nDeals; d++)
+    {
+      mxArray *outNet = mxDuplicateArray(netStr);
+      matHandler->flushBestTrainWeights(outNet, res[d].net);
+      mxSetCell(ret[OUT_NET_IDX], d, outNet);
+      if (nargout > OUT_TRN_EVO) mxSetCell(ret[OUT_TRN_EVO], d, flushTrainInfo(res[d].trnEvolution));
+      if (nargout > OUT_SP_IDX) mxGetPr(ret[OUT_SP_IDX])[d] = res[d].sp;
+      if (nargout > OUT_DET_IDX) mxSetCell(ret[OUT_DET_IDX], d, createRow(res[d].roc.det));
+      if (nargout > OUT_FA_IDX) mxSetCell(ret[OUT_FA_IDX], d, createRow(res[d].roc.fa));
+      if (nargout > OUT_TST_IDX)
+      {
+        mxArray *outs = mxCreateCellMatrix(1, res[d].tstOutputs.size());
+        for (unsigned p=0; p<res[d].tstOutputs.size(); p++) mxSetCell(outs, p, createRow(res[d].tstOutputs[p]));
+        mxSetCell(ret[OUT_TST_IDX], d, outs);
+      }
+    }
+    if (show) REPORT("Cross validation finished!");
+  }
+  catch (bad_alloc xa) {errorMsg = "Error on allocating memory!";}
+  catch (const char *msg) {errorMsg = msg;}
+
+  //Deleting the allocated memory (before reporting any error, since it does not return).
+  if (cv != nullptr) delete cv;
+  if (dealer != nullptr) delete dealer;
+  if (net != nullptr) delete net;
+  if (matHandler != nullptr) delete matHandler;
+  for (const auto &x : data) delete x;
+  if (errorMsg) FATAL(errorMsg);
+}
@@ -29,6 +29,7 @@ class MatlabBP : public MatlabNN
         REAL learningRate;
         REAL decFactor;
         list<Node> frozen;
+        list<unsigned> pruned;
     
     public:
         MatlabBP(const mxArray *netStr, const mxArray *trnParam) : MatlabNN(netStr)
@@ -56,14 +57,20 @@ class MatlabBP : public MatlabNN
                     if (node < numNodes[(i+1)]) frozen.push_back({.layer = i, .node = node});
                     else throw "Node to be frozen is invalid!";
                 }
+
+                //The zero weights of the pruned layers are not trained (optional, false by default).
+                const mxArray *matPruned = mxGetField(userData, 0, "pruned");
+                if ( (matPruned) && (mxGetScalar(matPruned)) ) pruned.push_back(i);
             }
         }
 
         virtual Backpropagation *getNetwork()
         {
             Backpropagation *ret = new Backpropagation(numNodes, trfFunc, usingBias, learningRate, decFactor);
+            ret->setTrfPrecision(trfPrecision);
             ret->readWeights( (const REAL***) weights, (const REAL**) bias);
             for (list<Node>::const_iterator itr = frozen.begin(); itr != frozen.end(); itr++) ret->setFrozen(itr->layer, itr->node, true);
+            for (list<unsigned>::const_iterator itr = pruned.begin(); itr != pruned.end(); itr++) ret->setPruned(*itr, true);
             return ret;
         }
 
@@ -35,6 +35,7 @@ class MatlabNN
         vector<unsigned> numNodes;
         vector<string> trfFunc;
         vector<bool> usingBias;
+        string trfPrecision;
         REAL ***weights;
         REAL **bias;
 
@@ -133,6 +134,14 @@ class MatlabNN
                 usingBias.push_back(static_cast<bool>(mxGetScalar(mxGetField(userData, 0, "usingBias"))));
             } 
 
+            //Getting the transfer functions precision mode (networks created by older versions do not have it).
+            trfPrecision = TRF_EXACT_ID;
+            const mxArray *netUserData = mxGetField(net, 0, "userdata");
+            if ( (netUserData) && (mxIsStruct(netUserData)) && (mxGetField(netUserData, 0, "trfPrecision")) )
+            {
+                trfPrecision = mxArrayToString(mxGetField(netUserData, 0, "trfPrecision"));
+            }
+
             //Taking the weights and values info.
             allocate_space();
             readWeights(net);
@@ -141,6 +150,7 @@ class MatlabNN
         virtual NeuralNetwork *getNetwork()
         {
             NeuralNetwork *ret = new NeuralNetwork(numNodes, trfFunc, usingBias);
+            ret->setTrfPrecision(trfPrecision);
             ret->readWeights( (const REAL***) weights, (const REAL**) bias);
             return ret;
         }
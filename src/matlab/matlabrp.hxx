@@ -26,8 +26,10 @@ class MatlabRP : public MatlabBP
         virtual Backpropagation *getNetwork()
         {
             RProp *ret = new RProp(numNodes, trfFunc, usingBias, deltaMin, deltaMax, initEta, incEta, decEta);
+            ret->setTrfPrecision(trfPrecision);
             ret->readWeights( (const REAL***) weights, (const REAL**) bias);
             for (list<Node>::const_iterator itr = frozen.begin(); itr != frozen.end(); itr++) ret->setFrozen(itr->layer, itr->node, true);
+            for (list<unsigned>::const_iterator itr = pruned.begin(); itr != pruned.end(); itr++) ret->setPruned(*itr, true);
             return ret;
         }
 };
\ No newline at end of file
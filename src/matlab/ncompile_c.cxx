@@ -0,0 +1,77 @@
+/** 
+@file  ncompile_c.cxx
+@brief The Matlab's ncompile function definition file.
+
+ This file implements the function that is called by matlab when the matlab's ncompile function
+ is called. It writes a dependency free C/C++ source file holding the weights of the passed
+ neural network (a Matlab structure or a model file name) and a single, fully unrolled,
+ inference function (see codegen.h).
+*/
+
+#include <string>
+#include <mex.h>
+
+#include "fastnet/neuralnet/codegen.h"
+#include "fastnet/neuralnet/modelfile.h"
+#include "matlabnn.hxx"
+
+using namespace std;
+using namespace FastNet;
+
+/// Minimum number of input arguments.
+const unsigned MIN_ARGS = 3;
+
+/// Maximum number of input arguments.
+const unsigned MAX_ARGS = 4;
+
+/// Index, in the arguments list, of the neural network structure (or model file name).
+const unsigned NET_STR_IDX = 0;
+
+/// Index, in the arguments list, of the source file name.
+const unsigned FILE_NAME_IDX = 1;
+
+/// Index, in the arguments list, of the inference function name.
+const unsigned FUNC_NAME_IDX = 2;
+
+/// Index, in the arguments list, of the generated code precision ("double" or "float").
+const unsigned TYPE_IDX = 3;
+
+
+/// Matlab 's main function.
+void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
+{
+  ModelFile *modelFile = nullptr;
+  NeuralNetwork *net = nullptr;
+  const char *errorMsg = nullptr;
+
+  try
+  {
+    if ( (nargin < MIN_ARGS) || (nargin > MAX_ARGS) ) throw "Incorrect number of arguments! See help for information!";
+    if ( (!mxIsChar(args[FILE_NAME_IDX])) || (!mxIsChar(args[FUNC_NAME_IDX])) ) throw "The file and function names must be strings!";
+    const string type = (nargin > TYPE_IDX) ? mxArrayToString(args[TYPE_IDX]) : "double";
+    if ( (type != "double") && (type != "float") ) throw "Invalid generated code precision! Use double or float.";
+
+    if (mxIsChar(args[NET_STR_IDX]))
+    {
+      modelFile = new ModelFile(mxArrayToString(args[NET_STR_IDX]));
+      net = modelFile->getNetwork<REAL>();
+    }
+    else
+    {
+      MatlabNN mat_net(args[NET_STR_IDX]);
+      net = mat_net.getNetwork();
+    }
+
+    const string fileName = mxArrayToString(args[FILE_NAME_IDX]);
+    const string funcName = mxArrayToString(args[FUNC_NAME_IDX]);
+    if (type == "float") generateSource(fileName, NeuralNetworkF(*net), funcName);
+    else generateSource(fileName, *net, funcName);
+  }
+  catch (bad_alloc xa) {errorMsg = "Error on allocating memory!";}
+  catch (const char *msg) {errorMsg = msg;}
+
+  //Deleting the network before its model file (and before reporting any error, since it does not return).
+  if (net != nullptr) delete net;
+  if (modelFile != nullptr) delete modelFile;
+  if (errorMsg) FATAL(errorMsg);
+}
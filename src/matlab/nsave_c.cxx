@@ -0,0 +1,58 @@
+/** 
+@file  nsave_c.cxx
+@brief The Matlab's nsave function definition file.
+
+ This file implements the function that is called by matlab when the matlab's nsave function
+ is called. It writes the passed neural network (topology, transfer functions, bias usage,
+ frozen nodes and weights) to a binary model file, which can later be mapped in memory
+ by the ModelFile class (or passed to nsim in place of the network structure).
+*/
+
+#include <list>
+#include <string>
+#include <mex.h>
+
+#include "fastnet/neuralnet/modelfile.h"
+#include "matlabbp.hxx"
+
+using namespace std;
+using namespace FastNet;
+
+/// Number of input arguments.
+const unsigned NUM_ARGS = 3;
+
+/// Index, in the arguments list, of the neural network structure.
+const unsigned NET_STR_IDX = 0;
+
+/// Index, in the arguments list, of the neural network train parameters structure.
+const unsigned NET_TRN_STR_IDX = 1;
+
+/// Index, in the arguments list, of the model file name.
+const unsigned FILE_NAME_IDX = 2;
+
+
+/// Matlab 's main function.
+void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
+{
+  MatlabBP *matHandler = nullptr;
+  Backpropagation *net = nullptr;
+  const char *errorMsg = nullptr;
+
+  try
+  {
+    if (nargin != NUM_ARGS) throw "Incorrect number of arguments! See help for information!";
+    if (!mxIsChar(args[FILE_NAME_IDX])) throw "The model file name must be a string!";
+
+    //The training handler also reads the frozen nodes.
+    matHandler = new MatlabBP(args[NET_STR_IDX], args[NET_TRN_STR_IDX]);
+    net = matHandler->getNetwork();
+    writeModel(mxArrayToString(args[FILE_NAME_IDX]), *net);
+  }
+  catch (bad_alloc xa) {errorMsg = "Error on allocating memory!";}
+  catch (const char *msg) {errorMsg = msg;}
+
+  //Deleting the allocated memory (before reporting any error, since it does not return).
+  if (net != nullptr) delete net;
+  if (matHandler != nullptr) delete matHandler;
+  if (errorMsg) FATAL(errorMsg);
+}
@@ -0,0 +1,145 @@
+/**
+@file  pcd_c.cxx
+@brief The Matlab's npcd function definition file.
+
+ This file implements the function that is called by matlab when the matlab's npcd
+ function is called. It extracts the Principal Components of Discrimination of a pattern
+ recognition network (see PCD.h): each PCD is a node of the first hidden layer, trained several
+ times at the same time from the network of the previous PCD. For each PCD, it returns the
+ PCD, the best network (whose first hidden layer holds every node, the ones not extracted yet
+ with null weights), its training evolution and its testing SP.
+*/
+
+#include <vector>
+#include <mex.h>
+
+#include "fastnet/sys/Reporter.h"
+#include "fastnet/neuralnet/backpropagation.h"
+#include "fastnet/neuralnet/rprop.h"
+#include "fastnet/training/PCD.h"
+#include "matlabbp.hxx"
+#include "matlabrp.hxx"
+#include "mxdatamanager.hxx"
+#include "mxtraininfo.hxx"
+
+using namespace std;
+using namespace FastNet;
+
+/// Number of input arguments.
+const unsigned NUM_ARGS = 9;
+
+/// Index, in the arguments list, of the neural network structure.
+const unsigned NET_STR_IDX = 0;
+
+/// Index, in the arguments list, of the neural network train parameters structure.
+const unsigned NET_TRN_STR_IDX = 1;
+
+/// Indexes, in the arguments list, of the input training, validating and testing events (a cell per pattern).
+const unsigned IN_TRN_IDX = 2;
+const unsigned IN_VAL_IDX = 3;
+const unsigned IN_TST_IDX = 4;
+
+/// Index, in the arguments list, of the number of trainings of each PCD.
+const unsigned NUM_ITER_IDX = 5;
+
+/// Index, in the arguments list, of the minimum SP gain (in percent) of a PCD.
+const unsigned MIN_DIFF_IDX = 6;
+
+/// Index, in the arguments list, of the number of PCDs to extract (0, to stop by the SP gain).
+const unsigned NUM_PCD_IDX = 7;
+
+/// Index, in the arguments list, of the base seed.
+const unsigned SEED_IDX = 8;
+
+/// Indexes, in the return vector, of the PCDs, networks, training evolutions and testing SP of each PCD.
+const unsigned OUT_PCD_IDX = 0;
+const unsigned OUT_NET_IDX = 1;
+const unsigned OUT_TRN_EVO = 2;
+const unsigned OUT_SP_IDX = 3;
+
+
+/// Matlab 's main function.
+void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
+{
+  MatlabBP *matHandler = nullptr;
+  Backpropagation *net = nullptr;
+  PCDExtraction *pcd = nullptr;
+  std::vector<DataManager*> patInTrn, patInVal, patInTst;
+  const char *errorMsg = nullptr;
+
+  try
+  {
+    if (nargin != NUM_ARGS) throw "Incorrect number of arguments! See help for information!";
+    if ( (!mxIsCell(args[IN_TRN_IDX])) || (!mxIsCell(args[IN_VAL_IDX])) || (!mxIsCell(args[IN_TST_IDX])) )
+    {
+      throw "The events must be given as a cell vector per pattern!";
+    }
+
+    const mxArray *netStr = args[NET_STR_IDX];
+    const mxArray *trnParam =  args[NET_TRN_STR_IDX];
+    const unsigned numIterations = static_cast<unsigned>(mxGetScalar(args[NUM_ITER_IDX]));
+    const REAL minDiff = static_cast<REAL>(mxGetScalar(args[MIN_DIFF_IDX]));
+    const unsigned nPCD = static_cast<unsigned>(mxGetScalar(args[NUM_PCD_IDX]));
+    const unsigned seed = static_cast<unsigned>(mxGetScalar(args[SEED_IDX]));
+    const unsigned nEpochs = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "epochs")));
+    const unsigned show = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "show")));
+    const unsigned fail_limit = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "max_fail")));
+    const unsigned batchSize = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "batchSize")));
+    const bool useSP = static_cast<bool>(mxGetScalar(mxGetField(trnParam, 0, "useSP")));
+    const REAL signalWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_signal_weight")));
+    const REAL noiseWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_noise_weight")));
+    const mxArray *spRes = mxGetField(trnParam, 0, "sp_resolution");
+    const REAL spResolution = (spRes) ? static_cast<REAL>(mxGetScalar(spRes)) : 0.01;
+
+    //Selecting the training type by reading the training agorithm.
+    const string trnType = mxArrayToString(mxGetField(netStr, 0, "trainFcn"));
+    if (trnType == TRAINRP_ID) matHandler = new MatlabRP(netStr, trnParam);
+    else if (trnType == TRAINGD_ID) matHandler = new MatlabBP(netStr, trnParam);
+    else throw "Invalid training algorithm option!";
+    net = matHandler->getNetwork();
+
+    for (auto i=0; i<mxGetN(args[IN_TRN_IDX]); i++)
+    {
+      patInTrn.push_back(new MxDataManager(mxGetCell(args[IN_TRN_IDX], i)));
+      patInVal.push_back(new MxDataManager(mxGetCell(args[IN_VAL_IDX], i)));
+      patInTst.push_back(new MxDataManager(mxGetCell(args[IN_TST_IDX], i)));
+    }
+
+    pcd = new PCDExtraction(net, &patInTrn, &patInVal, &patInTst, useSP, batchSize, signalWeight, noiseWeight, spResolution);
+    if (show) REPORT("Extracting via " << ((pcd->isCalobaStyle()) ? "Caloba" : "Seixas") << " Style");
+    const unsigned numPCD = pcd->extract(numIterations, minDiff, nPCD, seed, nEpochs, fail_limit);
+
+    //Returning the PCDs (one per row), and the network, training evolution and SP of each one.
+    const vector<PCDRound> &rounds = pcd->getRounds();
+    const unsigned inputSize = (*net)[0];
+    ret[OUT_PCD_IDX] = mxCreateDoubleMatrix(numPCD, inputSize, mxREAL);
+    double *pcdMat = mxGetPr(ret[OUT_PCD_IDX]);
+    if (nargout > OUT_NET_IDX) ret[OUT_NET_IDX] = mxCreateCellMatrix(1, numPCD);
+    if (nargout > OUT_TRN_EVO) ret[OUT_TRN_EVO] = mxCreateCellMatrix(1, numPCD);
+    if (nargout > OUT_SP_IDX) ret[OUT_SP_IDX] = mxCreateDoubleMatrix(1, numPCD, mxREAL);
+    for (unsigned i=0; i<numPCD; i++)
+    {
+      for (unsigned k=0; k<inputSize; k++) pcdMat[k*numPCD + i] = rounds[i].pcd[k];
+      if (nargout > OUT_NET_IDX)
+      {
+        mxArray *outNet = mxDuplicateArray(netStr);
+        matHandler->flushBestTrainWeights(outNet, rounds[i].net);
+        mxSetCell(ret[OUT_NET_IDX], i, outNet);
+      }
+      if (nargout > OUT_TRN_EVO) mxSetCell(ret[OUT_TRN_EVO], i, flushTrainInfo(rounds[i].trnEvolution));
+      if (nargout > OUT_SP_IDX) mxGetPr(ret[OUT_SP_IDX])[i] = rounds[i].sp;
+      if (show) REPORT("PCD " << (i+1) << " extracted (SP = " << rounds[i].sp << ")");
+    }
+  }
+  catch (bad_alloc xa) {errorMsg = "Error on allocating memory!";}
+  catch (const char *msg) {errorMsg = msg;}
+
+  //Deleting the allocated memory (before reporting any error, since it does not return).
+  if (pcd != nullptr) delete pcd;
+  if (net != nullptr) delete net;
+  if (matHandler != nullptr) delete matHandler;
+  for (const auto &x : patInTrn) delete x;
+  for (const auto &x : patInVal) delete x;
+  for (const auto &x : patInTst) delete x;
+  if (errorMsg) FATAL(errorMsg);
+}
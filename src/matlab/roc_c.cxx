@@ -0,0 +1,97 @@
+/**
+@file  roc_c.cxx
+@brief The Matlab's nroc function definition file.
+
+ This file implements the function that is called by matlab when the matlab's nroc function
+ (or genROC) is called. It calculates the ROC of a two class discriminator from its outputs
+ for the signal and noise events, either the exact one (every distinct output is a threshold)
+ or at given thresholds, along with the SP product of each operating point, the best one and
+ the area under the ROC (see roc.h).
+*/
+
+#include <vector>
+#include <mex.h>
+
+#include "fastnet/neuralnet/roc.h"
+#include "fastnet/sys/Reporter.h"
+#include "mxhandler.hxx"
+
+using namespace std;
+using namespace FastNet;
+
+/// Minimum number of input arguments.
+const unsigned MIN_ARGS = 2;
+
+/// Maximum number of input arguments.
+const unsigned MAX_ARGS = 5;
+
+/// Index, in the arguments list, of the signal outputs.
+const unsigned SIGNAL_IDX = 0;
+
+/// Index, in the arguments list, of the noise outputs.
+const unsigned NOISE_IDX = 1;
+
+/// Index, in the arguments list, of the thresholds (empty for the exact ROC).
+const unsigned CUTS_IDX = 2;
+
+/// Index, in the arguments list, of the signal weight of the SP product.
+const unsigned SIGNAL_WEIGHT_IDX = 3;
+
+/// Index, in the arguments list, of the noise weight of the SP product.
+const unsigned NOISE_WEIGHT_IDX = 4;
+
+/// Indexes, in the return vector, of the SP products, thresholds, detection efficiencies, false alarms, AUC and best point.
+const unsigned SP_OUT_IDX = 0;
+const unsigned CUT_OUT_IDX = 1;
+const unsigned DET_OUT_IDX = 2;
+const unsigned FA_OUT_IDX = 3;
+const unsigned AUC_OUT_IDX = 4;
+const unsigned BEST_OUT_IDX = 5;
+
+
+/// Creates a Matlab row vector from a vector.
+mxArray *createRow(const vector<REAL> &vec)
+{
+  mxArray *ret = mxCreateNumericMatrix(1, vec.size(), REAL_TYPE, mxREAL);
+  REAL *data = static_cast<REAL*>(mxGetData(ret));
+  for (size_t i=0; i<vec.size(); i++) data[i] = vec[i];
+  return ret;
+}
+
+
+/// Matlab 's main function.
+void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
+{
+  try
+  {
+    if ( (nargin < MIN_ARGS) || (nargin > MAX_ARGS) ) throw "Incorrect number of arguments! See help for information!";
+    for (int i=0; i<nargin; i++)
+    {
+      if ( (mxGetClassID(args[i]) != REAL_TYPE) || (mxIsComplex(args[i])) ) throw "The arguments must be real double values!";
+    }
+
+    const REAL *signal = static_cast<const REAL*>(mxGetData(args[SIGNAL_IDX]));
+    const REAL *noise = static_cast<const REAL*>(mxGetData(args[NOISE_IDX]));
+    const size_t nSignal = mxGetNumberOfElements(args[SIGNAL_IDX]);
+    const size_t nNoise = mxGetNumberOfElements(args[NOISE_IDX]);
+    const REAL signalWeight = (nargin > SIGNAL_WEIGHT_IDX) ? mxGetScalar(args[SIGNAL_WEIGHT_IDX]) : 1.;
+    const REAL noiseWeight = (nargin > NOISE_WEIGHT_IDX) ? mxGetScalar(args[NOISE_WEIGHT_IDX]) : 1.;
+
+    RocCurve roc;
+    if ( (nargin > CUTS_IDX) && (!mxIsEmpty(args[CUTS_IDX])) )
+    {
+      const REAL *c = static_cast<const REAL*>(mxGetData(args[CUTS_IDX]));
+      const vector<REAL> cuts(c, c + mxGetNumberOfElements(args[CUTS_IDX]));
+      roc = calculateRoc(signal, nSignal, noise, nNoise, cuts, signalWeight, noiseWeight);
+    }
+    else roc = calculateRoc(signal, nSignal, noise, nNoise, signalWeight, noiseWeight);
+
+    ret[SP_OUT_IDX] = createRow(roc.sp);
+    if (nargout > CUT_OUT_IDX) ret[CUT_OUT_IDX] = createRow(roc.cut);
+    if (nargout > DET_OUT_IDX) ret[DET_OUT_IDX] = createRow(roc.det);
+    if (nargout > FA_OUT_IDX) ret[FA_OUT_IDX] = createRow(roc.fa);
+    if (nargout > AUC_OUT_IDX) ret[AUC_OUT_IDX] = mxCreateDoubleScalar(roc.auc);
+    if (nargout > BEST_OUT_IDX) ret[BEST_OUT_IDX] = mxCreateDoubleScalar(static_cast<double>(roc.best + 1));
+  }
+  catch (const char *msg) FATAL(msg);
+}
@@ -5,44 +5,122 @@
  This file implements the function that is called by matlab when the matlab's nsim function
  is called. This function reads the matlab arguments (specified in "args"), and porpagates
  the input data set through the passed neural  network, returning the outputs obtained.
+ The network may also be given as the name of a model file (see modelfile.h), which is mapped
+ in memory instead of being read from a Matlab structure.
+ If a cell vector of networks is passed, the events are propagated through all of them in a
+ single pass (see ensemble.h), and a (networks x outputs x events) matrix is returned.
+ Optionally, the network is quantized ("int8" or "int16") before the propagation, using a
+ calibration data set (the input data set, if none is given).
 */
 
 #include <mex.h>
 #include <vector>
+#include <string>
 
 #ifndef NO_OMP
 #include <omp.h>
 #endif
 
 #include "matlabnn.hxx"
+#include "fastnet/neuralnet/quantizednetwork.h"
+#include "fastnet/neuralnet/modelfile.h"
+#include "fastnet/neuralnet/ensemble.h"
 
 using namespace std;
 using namespace FastNet;
 
-/// Number of input arguments.
-const unsigned NUM_ARGS = 2;
+/// Minimum number of input arguments.
+const unsigned MIN_ARGS = 2;
 
-/// Index, in the arguments list, of the neural network structure.
+/// Maximum number of input arguments.
+const unsigned MAX_ARGS = 4;
+
+/// Index, in the arguments list, of the neural network structure (or model file name, or a cell vector of them).
 const unsigned NET_STR_IDX = 0;
 
 /// Index, in the arguments list, of the input testing events.
 const unsigned IN_DATA_IDX = 1;
 
+/// Index, in the arguments list, of the network precision ("float", "int8" or "int16").
+const unsigned MODE_IDX = 2;
+
+/// Index, in the arguments list, of the quantization calibration events.
+const unsigned CALIB_IDX = 3;
+
 /// Index, in the return vector, of the network structure after training.
 const unsigned NET_OUT_IDX = 0;
 
 
+/// Propagates all the events, each thread propagating whole blocks of events at once.
+/**
+ The network is shared (read only) by all the threads, and each thread
+ keeps its intermediate values in its own workspace.
+*/
+template <class Network>
+void propagateEvents(const Network &net, const REAL *inputEvents, const unsigned numEvents, 
+                      const unsigned inputSize, const unsigned outputSize, REAL *outputEvents)
+{
+  int i;
+  const unsigned chunk = 1000;
+  const int numBlocks = static_cast<int>((numEvents + chunk - 1) / chunk);
+  #pragma omp parallel shared(inputEvents,outputEvents,net) private(i)
+  {
+    typename Network::Workspace ws(net);
+
+    #pragma omp for schedule(dynamic)
+    for (i=0; i<numBlocks; i++)
+    {
+      const unsigned first = i*chunk;
+      const unsigned blockSize = ((first + chunk) < numEvents) ? chunk : (numEvents - first);
+      net.propagateBatch(&inputEvents[first*inputSize], blockSize, &outputEvents[first*outputSize], ws);
+    }
+  }
+}
+
+
+/// Creates a network from a Matlab network structure or from a model file name.
+/**
+ @param[in] mNet The network structure or the model file name.
+ @param[out] modelFiles Where the mapped model file (if any) is appended. It must be released after the network.
+ @return A dynamically allocated network.
+*/
+NeuralNetwork *readNetwork(const mxArray *mNet, vector<ModelFile*> &modelFiles)
+{
+  if (mxIsChar(mNet))
+  {
+    modelFiles.push_back(new ModelFile(mxArrayToString(mNet)));
+    return modelFiles.back()->getNetwork<REAL>();
+  }
+
+  MatlabNN mat_net(mNet);
+  return mat_net.getNetwork();
+}
+
+
 /// Matlab 's main function.
 void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
 {
+  vector<ModelFile*> modelFiles;
+  vector<const NeuralNetwork*> nets;
+  const char *errorMsg = nullptr;
+
   try
   {
     //Verifying if the number of input parameters is ok.
-    if (nargin != NUM_ARGS) throw "Incorrect number of arguments! See help for information!";
+    if ( (nargin < MIN_ARGS) || (nargin > MAX_ARGS) ) throw "Incorrect number of arguments! See help for information!";
+    const string mode = (nargin > MODE_IDX) ? mxArrayToString(args[MODE_IDX]) : "float";
+    if ( (mode != "float") && (mode != "int8") && (mode != "int16") ) throw "Invalid network precision! Use float, int8 or int16.";
 
-    // Creating the neural network to use.
-    MatlabNN mat_net(args[NET_STR_IDX]);
-    NeuralNetwork *net = mat_net.getNetwork();
+    // Creating the neural networks to use, either from model files or from Matlab structures.
+    const bool isEnsemble = mxIsCell(args[NET_STR_IDX]);
+    if (isEnsemble)
+    {
+      if (mode != "float") throw "Ensembles of networks can only be propagated in floating point!";
+      for (unsigned i=0; i<mxGetNumberOfElements(args[NET_STR_IDX]); i++) nets.push_back(readNetwork(mxGetCell(args[NET_STR_IDX], i), modelFiles));
+      if (nets.empty()) throw "The cell vector of networks is empty!";
+    }
+    else nets.push_back(readNetwork(args[NET_STR_IDX], modelFiles));
+    const NeuralNetwork *net = nets[0];
 
     //Checking if the input and output data sizes match the network's input layer.
     if (mxGetM(args[IN_DATA_IDX]) != (*net)[0])
@@ -52,23 +130,54 @@ void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
     const unsigned numEvents = mxGetN(args[IN_DATA_IDX]);
     const unsigned inputSize = mxGetM(args[IN_DATA_IDX]);
     const unsigned outputSize = (*net)[net->getNumLayers()-1];
-    const unsigned numBytes2Copy = outputSize * sizeof(REAL);
     REAL *inputEvents = static_cast<REAL*>(mxGetData(args[IN_DATA_IDX]));
-    mxArray *outData = mxCreateNumericMatrix(outputSize, numEvents, REAL_TYPE, mxREAL);
-    REAL *outputEvents = static_cast<REAL*>(mxGetData(outData));
+    mxArray *outData;
     
-    int i;
-    int chunk = 1000;
-    #pragma omp parallel shared(inputEvents,outputEvents,chunk) private(i) firstprivate(net)
+    if (isEnsemble)
+    {
+      //The ensemble checks that every network has the same input and output sizes.
+      const Ensemble ens(nets);
+      const mwSize dims[3] = {nets.size(), outputSize, numEvents};
+      outData = mxCreateNumericArray(3, dims, REAL_TYPE, mxREAL);
+      REAL *outputEvents = static_cast<REAL*>(mxGetData(outData));
+      propagateEvents(ens, inputEvents, numEvents, inputSize, outputSize*ens.size(), outputEvents);
+    }
+    else if (mode == "float")
+    {
+      outData = mxCreateNumericMatrix(outputSize, numEvents, REAL_TYPE, mxREAL);
+      REAL *outputEvents = static_cast<REAL*>(mxGetData(outData));
+      propagateEvents(*net, inputEvents, numEvents, inputSize, outputSize, outputEvents);
+    }
+    else
     {
-      #pragma omp for schedule(dynamic,chunk) nowait
-      for (i=0; i<numEvents; i++)
+      outData = mxCreateNumericMatrix(outputSize, numEvents, REAL_TYPE, mxREAL);
+      REAL *outputEvents = static_cast<REAL*>(mxGetData(outData));
+
+      //The calibration events default to the events being propagated.
+      const mxArray *calibData = (nargin > CALIB_IDX) ? args[CALIB_IDX] : args[IN_DATA_IDX];
+      if (mxGetM(calibData) != inputSize) throw "Calibration data do not match the network input layer size!";
+      const REAL *calibEvents = static_cast<const REAL*>(mxGetData(calibData));
+      const unsigned numCalib = mxGetN(calibData);
+
+      if (mode == "int8")
+      {
+        QuantizedNetwork8 qnet(*net, calibEvents, numCalib);
+        propagateEvents(qnet, inputEvents, numEvents, inputSize, outputSize, outputEvents);
+      }
+      else
       {
-        memcpy(&outputEvents[i*outputSize], net->propagateInput(&inputEvents[i*inputSize]), numBytes2Copy);
+        QuantizedNetwork16 qnet(*net, calibEvents, numCalib);
+        propagateEvents(qnet, inputEvents, numEvents, inputSize, outputSize, outputEvents);
       }
     }
 
     ret[NET_OUT_IDX] = outData;
   }
-  catch (const char *msg) FATAL(msg);
+  catch (bad_alloc xa) {errorMsg = "Error on allocating memory!";}
+  catch (const char *msg) {errorMsg = msg;}
+
+  //Deleting the networks before their model files (and before reporting any error, since it does not return).
+  for (unsigned i=0; i<nets.size(); i++) delete nets[i];
+  for (unsigned i=0; i<modelFiles.size(); i++) delete modelFiles[i];
+  if (errorMsg) FATAL(errorMsg);
 }
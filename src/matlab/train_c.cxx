@@ -24,6 +24,7 @@
 #include "matlabbp.hxx"
 #include "matlabrp.hxx"
 #include "mxdatamanager.hxx"
+#include "mxtraininfo.hxx"
 
 using namespace std;
 using namespace FastNet;
@@ -59,66 +60,6 @@ bool isEmpty(const mxArray *mat)
 }
 
 
-/// Flush trining evolution info to Matlab vectors.
-mxArray *flushTrainInfo(const TrainData &trnEvolution)
-{
-  const unsigned size = trnEvolution.size();  
-  mxArray *epoch = mxCreateNumericMatrix(1, size, mxUINT32_CLASS, mxREAL);
-  mxArray *mse_trn = mxCreateNumericMatrix(1, size, REAL_TYPE, mxREAL);
-  mxArray *mse_val = mxCreateNumericMatrix(1, size, REAL_TYPE, mxREAL);
-  mxArray *sp_val = mxCreateNumericMatrix(1, size, REAL_TYPE, mxREAL);
-  mxArray *is_best_mse = mxCreateNumericMatrix(1, size, mxINT32_CLASS, mxREAL);;
-  mxArray *is_best_sp = mxCreateNumericMatrix(1, size, mxINT32_CLASS, mxREAL);;
-  mxArray *num_fails_mse = mxCreateNumericMatrix(1, size, mxUINT32_CLASS, mxREAL);
-  mxArray *num_fails_sp = mxCreateNumericMatrix(1, size, mxUINT32_CLASS, mxREAL);
-  mxArray *stop_mse = mxCreateLogicalMatrix(1, size);
-  mxArray *stop_sp = mxCreateLogicalMatrix(1, size);
-
-  unsigned* epoch_ptr = static_cast<unsigned*>(mxGetData(epoch));
-  REAL* mse_trn_ptr = static_cast<REAL*>(mxGetData(mse_trn));
-  REAL* mse_val_ptr = static_cast<REAL*>(mxGetData(mse_val));
-  REAL* sp_val_ptr = static_cast<REAL*>(mxGetData(sp_val));
-  int* is_best_mse_ptr = static_cast<int*>(mxGetData(is_best_mse));
-  int* is_best_sp_ptr = static_cast<int*>(mxGetData(is_best_sp));
-  unsigned* num_fails_mse_ptr = static_cast<unsigned*>(mxGetData(num_fails_mse));
-  unsigned* num_fails_sp_ptr = static_cast<unsigned*>(mxGetData(num_fails_sp));
-  bool* stop_mse_ptr = static_cast<bool*>(mxGetData(stop_mse));
-  bool* stop_sp_ptr = static_cast<bool*>(mxGetData(stop_sp));
-  
-  for (auto i=0; i<size; i++)
-  {
-    *epoch_ptr++ = trnEvolution.epoch[i];
-    *mse_trn_ptr++ = trnEvolution.mse_trn[i];
-    *mse_val_ptr++ = trnEvolution.mse_val[i];
-    *sp_val_ptr++ = trnEvolution.sp_val[i];
-    *is_best_mse_ptr++ = static_cast<int>(trnEvolution.is_best_mse[i]);
-    *is_best_sp_ptr++ = static_cast<int>(trnEvolution.is_best_sp[i]);
-    *num_fails_mse_ptr++ = trnEvolution.num_fails_mse[i];
-    *num_fails_sp_ptr++ = trnEvolution.num_fails_sp[i];
-    *stop_mse_ptr++ = trnEvolution.stop_mse[i];
-    *stop_sp_ptr++ = trnEvolution.stop_sp[i];
-  }
-    
-  // Creating the Matlab structure to be returned.
-  const unsigned NNAMES = 10;
-  const char *NAMES[] = {"epoch", "mse_trn", "mse_val", "sp_val", 
-                          "is_best_mse", "is_best_sp", "num_fails_mse", "num_fails_sp", 
-                          "stop_mse", "stop_sp"};
-  mxArray *ret = mxCreateStructMatrix(1,1,NNAMES,NAMES);
-  mxSetField(ret, 0, "epoch", epoch);
-  mxSetField(ret, 0, "mse_trn", mse_trn);
-  mxSetField(ret, 0, "mse_val", mse_val);
-  mxSetField(ret, 0, "sp_val", sp_val);
-  mxSetField(ret, 0, "is_best_mse", is_best_mse);
-  mxSetField(ret, 0, "is_best_sp", is_best_sp);
-  mxSetField(ret, 0, "num_fails_mse", num_fails_mse);
-  mxSetField(ret, 0, "num_fails_sp", num_fails_sp);
-  mxSetField(ret, 0, "stop_mse", stop_mse);
-  mxSetField(ret, 0, "stop_sp", stop_sp);
-  return ret;
-};
-
-
 /// Matlab 's main function.
 void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
 {
@@ -147,6 +88,8 @@ void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
     const unsigned batchSize = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "batchSize")));
     const REAL signalWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_signal_weight")));
     const REAL noiseWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_noise_weight")));
+    const mxArray *spRes = mxGetField(trnParam, 0, "sp_resolution");
+    const REAL spResolution = (spRes) ? static_cast<REAL>(mxGetScalar(spRes)) : 0.01;
 
     //Selecting the training type by reading the training agorithm.    
     const string trnType = mxArrayToString(mxGetField(netStr, 0, "trainFcn"));
@@ -184,7 +127,7 @@ void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
         patInTrn.push_back(new MxDataManager(mxGetCell(args[IN_TRN_IDX], i)));
         patInVal.push_back(new MxDataManager(mxGetCell(args[IN_VAL_IDX], i)));
       }
-      train = new PatternRecognition(net, &patInTrn, &patInVal, useSP, batchSize, signalWeight, noiseWeight);
+      train = new PatternRecognition(net, &patInTrn, &patInVal, useSP, batchSize, signalWeight, noiseWeight, spResolution);
     }
 
 #ifdef DEBUG
@@ -196,63 +139,7 @@ void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
     if (show) REPORT("Network Training Status:");
         
     // Performing the training.
-    unsigned num_fails_mse = 0;
-    unsigned num_fails_sp = 0;
-    unsigned dispCounter = 0;
-    REAL mse_val, sp_val;
-    mse_val = sp_val = 0.;
-    ValResult is_best_mse, is_best_sp;
-    bool stop_mse, stop_sp;
-
-    //Calculating the max_fail limits for each case (MSE and SP, if the case).
-    const unsigned fail_limit_mse = (useSP) ? (fail_limit / 2) : fail_limit;
-    const unsigned fail_limit_sp = (useSP) ? fail_limit : 0;
-    ValResult &is_best = (useSP) ? is_best_sp :  is_best_mse;
-    REAL &val_data = (useSP) ? sp_val : mse_val;
-
-    for (unsigned epoch=0; epoch<nEpochs; epoch++)
-    {
-      //Training the network and calculating the new weights.
-      const REAL mse_trn = train->trainNetwork();
-
-      //Validating the new network.
-      train->valNetwork(mse_val, sp_val);
-
-      // Saving the best weight result.
-      train->isBestNetwork(mse_val, sp_val, is_best_mse, is_best_sp);
-      
-      if (is_best_mse == BETTER) num_fails_mse = 0;
-      else if (is_best_mse == WORSE) num_fails_mse++;
-
-      if (is_best_sp == BETTER) num_fails_sp = 0;
-      else if (is_best_sp == WORSE) num_fails_sp++;
-      
-      if (is_best == BETTER) net->saveBestTrain();
-
-      //Showing partial results at every "show" epochs (if show != 0).
-      if (show)
-      {
-        if (!dispCounter)
-        {
-          train->showTrainingStatus(epoch, mse_trn, val_data);
-        }
-        dispCounter = (dispCounter + 1) % show;
-      }
-
-      //Knowing whether the criterias are telling us to stop.
-      stop_mse = num_fails_mse >= fail_limit_mse;
-      stop_sp = num_fails_sp >= fail_limit_sp;
-
-      //Saving the training evolution info.
-      train->saveTrainInfo(epoch, mse_trn, mse_val, sp_val, is_best_mse, 
-                            is_best_sp, num_fails_mse, num_fails_sp, stop_mse, stop_sp);
-
-      if ( (stop_mse) && (stop_sp) )
-      {
-        if (show) REPORT("Maximum number of failures reached. Finishing training...");
-        break;
-      }
-    }
+    train->trainEpochs(nEpochs, fail_limit, useSP, show);
 
     // Generating a copy of the network structure passed as input.
     ret[OUT_NET_IDX] = mxDuplicateArray(netStr);
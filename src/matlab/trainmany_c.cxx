@@ -0,0 +1,130 @@
+/**
+@file  trainmany_c.cxx
+@brief The Matlab's trainMany function definition file.
+
+ This file implements the function that is called by matlab when the matlab's trainMany
+ function is called. It trains several copies of a pattern recognition network at the same
+ time (see MultiStart.h), each one from its own initial weights, and returns every trained
+ network, with its training evolution, and the index of the best one (by the validation SP,
+ if the SP criterium is used, or by the validation MSE, otherwise).
+*/
+
+#include <vector>
+#include <mex.h>
+
+#include "fastnet/sys/Reporter.h"
+#include "fastnet/neuralnet/backpropagation.h"
+#include "fastnet/neuralnet/rprop.h"
+#include "fastnet/training/MultiStart.h"
+#include "matlabbp.hxx"
+#include "matlabrp.hxx"
+#include "mxdatamanager.hxx"
+#include "mxtraininfo.hxx"
+
+using namespace std;
+using namespace FastNet;
+
+/// Minimum number of input arguments.
+const unsigned MIN_ARGS = 5;
+
+/// Maximum number of input arguments.
+const unsigned MAX_ARGS = 6;
+
+/// Index, in the arguments list, of the neural network structure.
+const unsigned NET_STR_IDX = 0;
+
+/// Index, in the arguments list, of the neural network train parameters structure.
+const unsigned NET_TRN_STR_IDX = 1;
+
+/// Index, in the arguments list, of the input training events (a cell per pattern).
+const unsigned IN_TRN_IDX = 2;
+
+/// Index, in the arguments list, of the input validating events (a cell per pattern).
+const unsigned IN_VAL_IDX = 3;
+
+/// Index, in the arguments list, of the number of trainings.
+const unsigned NUM_TRAINS_IDX = 4;
+
+/// Index, in the arguments list, of the base seed of the initial weights (0, if omitted).
+const unsigned SEED_IDX = 5;
+
+/// Index, in the return vector, of the cell vector of the trained networks.
+const unsigned OUT_NET_IDX = 0;
+
+/// Index, in the return vector, of the cell vector of the training evolutions.
+const unsigned OUT_TRN_EVO = 1;
+
+/// Index, in the return vector, of the index of the best training.
+const unsigned OUT_BEST_IDX = 2;
+
+
+/// Matlab 's main function.
+void mexFunction(int nargout, mxArray *ret[], int nargin, const mxArray *args[])
+{
+  MatlabBP *matHandler = nullptr;
+  Backpropagation *net = nullptr;
+  MultiStartTraining *train = nullptr;
+  std::vector<DataManager*> patInTrn, patInVal;
+  const char *errorMsg = nullptr;
+
+  try
+  {
+    if ( (nargin < MIN_ARGS) || (nargin > MAX_ARGS) ) throw "Incorrect number of arguments! See help for information!";
+    if ( (!mxIsCell(args[IN_TRN_IDX])) || (!mxIsCell(args[IN_VAL_IDX])) ) throw "The events must be given as a cell vector per pattern!";
+
+    const mxArray *netStr = args[NET_STR_IDX];
+    const mxArray *trnParam =  args[NET_TRN_STR_IDX];
+    const unsigned numTrains = static_cast<unsigned>(mxGetScalar(args[NUM_TRAINS_IDX]));
+    const unsigned seed = (nargin > SEED_IDX) ? static_cast<unsigned>(mxGetScalar(args[SEED_IDX])) : 0;
+    const unsigned nEpochs = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "epochs")));
+    const unsigned show = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "show")));
+    const unsigned fail_limit = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "max_fail")));
+    const unsigned batchSize = static_cast<unsigned>(mxGetScalar(mxGetField(trnParam, 0, "batchSize")));
+    const bool useSP = static_cast<bool>(mxGetScalar(mxGetField(trnParam, 0, "useSP")));
+    const REAL signalWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_signal_weight")));
+    const REAL noiseWeight = static_cast<REAL>(mxGetScalar(mxGetField(trnParam, 0, "sp_noise_weight")));
+    const mxArray *spRes = mxGetField(trnParam, 0, "sp_resolution");
+    const REAL spResolution = (spRes) ? static_cast<REAL>(mxGetScalar(spRes)) : 0.01;
+
+    //Selecting the training type by reading the training agorithm.
+    const string trnType = mxArrayToString(mxGetField(netStr, 0, "trainFcn"));
+    if (trnType == TRAINRP_ID) matHandler = new MatlabRP(netStr, trnParam);
+    else if (trnType == TRAINGD_ID) matHandler = new MatlabBP(netStr, trnParam);
+    else throw "Invalid training algorithm option!";
+    net = matHandler->getNetwork();
+
+    for (auto i=0; i<mxGetN(args[IN_TRN_IDX]); i++)
+    {
+      patInTrn.push_back(new MxDataManager(mxGetCell(args[IN_TRN_IDX], i)));
+      patInVal.push_back(new MxDataManager(mxGetCell(args[IN_VAL_IDX], i)));
+    }
+
+    if (show) REPORT("Starting " << numTrains << " trainings...");
+    train = new MultiStartTraining(net, &patInTrn, &patInVal, useSP, batchSize, signalWeight, noiseWeight, spResolution);
+    const unsigned best = train->train(numTrains, seed, nEpochs, fail_limit);
+
+    //Returning a copy of the network structure, with the trained weights, and the evolution of each training.
+    const vector<TrainRun> &runs = train->getRuns();
+    ret[OUT_NET_IDX] = mxCreateCellMatrix(1, numTrains);
+    if (nargout > OUT_TRN_EVO) ret[OUT_TRN_EVO] = mxCreateCellMatrix(1, numTrains);
+    for (unsigned i=0; i<numTrains; i++)
+    {
+      mxArray *outNet = mxDuplicateArray(netStr);
+      matHandler->flushBestTrainWeights(outNet, runs[i].net);
+      mxSetCell(ret[OUT_NET_IDX], i, outNet);
+      if (nargout > OUT_TRN_EVO) mxSetCell(ret[OUT_TRN_EVO], i, flushTrainInfo(runs[i].trnEvolution));
+    }
+    if (nargout > OUT_BEST_IDX) ret[OUT_BEST_IDX] = mxCreateDoubleScalar(static_cast<double>(best + 1));
+    if (show) REPORT("Training process finished! Best training: " << (best + 1));
+  }
+  catch (bad_alloc xa) {errorMsg = "Error on allocating memory!";}
+  catch (const char *msg) {errorMsg = msg;}
+
+  //Deleting the allocated memory (before reporting any error, since it does not return).
+  if (train != nullptr) delete train;
+  if (net != nullptr) delete net;
+  if (matHandler != nullptr) delete matHandler;
+  for (const auto &x : patInTrn) delete x;
+  for (const auto &x : patInVal) delete x;
+  if (errorMsg) FATAL(errorMsg);
+}
@@ -0,0 +1,164 @@
+/**
+@file  activations.cxx
+@brief Built in transfer functions and the transfer functions registry.
+*/
+
+#include <cmath>
+#include <list>
+#include <string>
+#include <algorithm>
+
+#include "fastnet/neuralnet/activations.h"
+
+using namespace std;
+
+namespace FastNet
+{
+  namespace
+  {
+    template <class T>
+    void tansigApply(T *x, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) x[k] = tanh(x[k]);
+    }
+
+
+    template <class T>
+    void tansigDeriv(const T *y, T *d, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) d[k] *= (1 - (y[k]*y[k]));
+    }
+
+
+    template <class T>
+    void tansigRationalApply(T *x, const unsigned n)
+    {
+      //There are no branches, so the loop is vectorized by the compiler.
+      for (unsigned k=0; k<n; k++) x[k] = tansigRational(x[k]);
+    }
+
+
+    /// Table with tanh sampled over [0, TANSIG_CLAMP], at TANSIG_TABLE_RES points per unit (see activations.h).
+    template <class T>
+    struct TansigTable
+    {
+      T val[TANSIG_TABLE_SIZE];
+      TansigTable() {for (unsigned i=0; i<TANSIG_TABLE_SIZE; i++) val[i] = static_cast<T>(tanh(static_cast<double>(i) / TANSIG_TABLE_RES));};
+    };
+
+
+    template <class T>
+    void tansigTableApply(T *x, const unsigned n)
+    {
+      const T *table = getTansigTable<T>();
+      for (unsigned k=0; k<n; k++) x[k] = tansigTable(table, x[k]);
+    }
+
+
+    template <class T>
+    void purelinApply(T *, const unsigned) {}
+
+
+    template <class T>
+    void purelinDeriv(const T *, T *, const unsigned) {}
+
+
+    template <class T>
+    void logsigApply(T *x, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) x[k] = 1 / (1 + exp(-x[k]));
+    }
+
+
+    template <class T>
+    void logsigDeriv(const T *y, T *d, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) d[k] *= (y[k] * (1 - y[k]));
+    }
+
+
+    template <class T>
+    void poslinApply(T *x, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) x[k] = (x[k] > 0) ? x[k] : 0;
+    }
+
+
+    template <class T>
+    void poslinDeriv(const T *y, T *d, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) d[k] = (y[k] > 0) ? d[k] : 0;
+    }
+
+
+    /// The registered transfer functions.
+    /**
+     A list is used, so the pointers returned by getActivation remain
+     valid when new transfer functions are registered.
+    */
+    template <class T>
+    list<Activation<T> > &registry()
+    {
+      static const Activation<T> builtIn[] = {
+        {TGH_ID, tansigApply<T>, tansigDeriv<T>, TRF_EXACT_ID},
+        {TGH_ID, tansigRationalApply<T>, tansigDeriv<T>, TRF_RATIONAL_ID},
+        {TGH_ID, tansigTableApply<T>, tansigDeriv<T>, TRF_TABLE_ID},
+        {LIN_ID, purelinApply<T>, purelinDeriv<T>, TRF_EXACT_ID},
+        {LOGSIG_ID, logsigApply<T>, logsigDeriv<T>, TRF_EXACT_ID},
+        {POSLIN_ID, poslinApply<T>, poslinDeriv<T>, TRF_EXACT_ID}
+      };
+      static list<Activation<T> > acts(builtIn, builtIn + (sizeof(builtIn) / sizeof(Activation<T>)));
+      return acts;
+    }
+  }
+
+
+  template <class T>
+  const T *getTansigTable()
+  {
+    static const TansigTable<T> table;
+    return table.val;
+  }
+
+
+  template <class T>
+  const Activation<T> *getActivation(const string &id, const string &precision)
+  {
+    list<Activation<T> > &acts = registry<T>();
+    const Activation<T> *exact = NULL;
+    for (typename list<Activation<T> >::const_iterator itr = acts.begin(); itr != acts.end(); ++itr)
+    {
+      if (itr->id != id) continue;
+      if (itr->precision == precision) return &(*itr);
+      if (itr->precision == TRF_EXACT_ID) exact = &(*itr);
+    }
+    return exact;
+  }
+
+
+  template <class T>
+  void registerActivation(const Activation<T> &act)
+  {
+    list<Activation<T> > &acts = registry<T>();
+    Activation<T> newAct = act;
+    if (newAct.precision.empty()) newAct.precision = TRF_EXACT_ID;
+
+    for (typename list<Activation<T> >::iterator itr = acts.begin(); itr != acts.end(); ++itr)
+    {
+      if ( (itr->id == newAct.id) && (itr->precision == newAct.precision) )
+      {
+        *itr = newAct;
+        return;
+      }
+    }
+    acts.push_back(newAct);
+  }
+
+
+  template const float *getTansigTable<float>();
+  template const double *getTansigTable<double>();
+  template const Activation<float> *getActivation<float>(const string &id, const string &precision);
+  template const Activation<double> *getActivation<double>(const string &id, const string &precision);
+  template void registerActivation<float>(const Activation<float> &act);
+  template void registerActivation<double>(const Activation<double> &act);
+}
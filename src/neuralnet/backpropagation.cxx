@@ -1,6 +1,6 @@
 /**
 @file  backpropagation.cpp
-@brief The BackPropagation class definition.
+@brief The BasicBackpropagation class template definition.
 */
 
 #include <vector>
@@ -8,13 +8,18 @@
 #include <cstdlib>
 #include <typeinfo>
 #include <sstream>
+#include <algorithm>
+#include <random>
+#include <cmath>
 
 #include "fastnet/neuralnet/backpropagation.h"
+#include "fastnet/neuralnet/kernels.h"
 #include "fastnet/sys/Reporter.h"
 
 namespace FastNet
 {
-  Backpropagation::Backpropagation(const Backpropagation &net) : NeuralNetwork(net)
+  template <class T>
+  BasicBackpropagation<T>::BasicBackpropagation(const BasicBackpropagation &net) : BasicNeuralNetwork<T>(net)
   { 
     try {allocateSpace(net.nNodes);}
     catch (bad_alloc xa) {throw;}
@@ -22,32 +27,31 @@ namespace FastNet
   }
 
 
-  void Backpropagation::operator=(const Backpropagation &net)
+  template <class T>
+  void BasicBackpropagation<T>::operator=(const BasicBackpropagation &net)
   { 
     DEBUG1("Attributing all values using assignment operator for Backpropagation class");
-    NeuralNetwork::operator=(net);
+    BasicNeuralNetwork<T>::operator=(net);
     
     learningRate = net.learningRate;
     decFactor = net.decFactor;
 
-    for (unsigned i=0; i<(nNodes.size() - 1); i++)
-    {
-      memcpy(savedB[i], net.savedB[i], nNodes[i+1]*sizeof(REAL));
-      memcpy(frozenNode[i], net.frozenNode[i], nNodes[i+1]*sizeof(bool));
-      memcpy(db[i], net.db[i], nNodes[i+1]*sizeof(REAL));
-      memcpy(sigma[i], net.sigma[i], nNodes[i+1]*sizeof(REAL));
-      for (unsigned j=0; j<nNodes[i+1]; j++)
-      {
-        memcpy(dw[i][j], net.dw[i][j], nNodes[i]*sizeof(REAL));
-        memcpy(savedW[i][j], net.savedW[i][j], nNodes[i]*sizeof(REAL));
-      }
-    }
+    //dw and db, and then savedW, savedB and sigma, are copied all at once.
+    gradArena.copy(net.gradArena);
+    bpArena.copy(net.bpArena);
+
+    unsigned numNodes = 0;
+    for (unsigned i=1; i<nNodes.size(); i++) numNodes += nNodes[i];
+    memcpy(frozenNode[0], net.frozenNode[0], numNodes*sizeof(bool));
+    pruneMask.assign(net.pruneMask.begin(), net.pruneMask.end());
+    transposeWeights();
   }
   
 
-  Backpropagation::Backpropagation(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, 
-                                                      const std::vector<bool> &usingBias,  const REAL learningRate ,
-                                                      const REAL decFactor)  : NeuralNetwork(nNodes, trfFunc, usingBias)
+  template <class T>
+  BasicBackpropagation<T>::BasicBackpropagation(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, 
+                                                      const std::vector<bool> &usingBias,  const ACC_REAL learningRate ,
+                                                      const ACC_REAL decFactor)  : BasicNeuralNetwork<T>(nNodes, trfFunc, usingBias)
     {
         DEBUG1("Initializing the Backpropagation class from scratch.");
 
@@ -57,47 +61,107 @@ namespace FastNet
         try {allocateSpace(nNodes);}
         catch (bad_alloc xa) {throw;}
 
-        for (unsigned i=0; i<(nNodes.size()-1); i++)
-        {
-            // For the frozen nodes, we first initialize them all as unfrozen.
-            setFrozen(i, false);
-      
-            //Initializing dw and db.
-            for (unsigned j=0; j<nNodes[i+1]; j++) 
-            {
-                this->db[i][j] = 0.;
-                this->sigma[i][j] = 0.;
-                for (unsigned k=0; k<nNodes[i]; k++) this->dw[i][j][k] = 0.;
-            }
-        }    
+        // For the frozen nodes, we first initialize them all as unfrozen.
+        // dw, db and sigma need no initialization, since the arena is zero initialized.
+        for (unsigned i=0; i<(nNodes.size()-1); i++) setFrozen(i, false);
+        transposeWeights();
     }
 
 
-  void Backpropagation::allocateSpace(const vector<unsigned> &nNodes)
+  template <class T>
+  BasicBackpropagation<T>::TrainingWorkspace::TrainingWorkspace(const BasicBackpropagation &net) : propagation(net)
+  {
+    const vector<unsigned> &nNodes = net.nNodes;
+    const unsigned size = nNodes.size() - 1;
+    try
+    {
+      gradArena.allocate(nNodes, 1, 0);
+      dw = gradArena.getWeights(DELTA_SET);
+      db = gradArena.getBias(DELTA_SET);
+
+      //A block of events for the outputs and the sigma of every layer, followed by the
+      //transposed copies of a single layer and the outputs of some nodes of a layer.
+      const unsigned block = BasicNeuralNetwork<T>::BATCH_BLOCK;
+      unsigned maxNodes = 0;
+      size_t bufSize = 0;
+      for (unsigned i=0; i<=size; i++)
+      {
+        maxNodes = std::max(maxNodes, nNodes[i]);
+        bufSize += ((i) ? 2 : 1) * block * LayerArena<T>::padded(nNodes[i]);
+      }
+      buffer.assign(bufSize + 2*maxNodes*TRANSPOSED_STRIDE + block*LayerArena<T>::padded(maxNodes), 0);
+      nodes.resize(size+1);
+      sigma.resize(size);
+      T *buf = &buffer[0];
+      for (unsigned i=0; i<=size; i++)
+      {
+        nodes[i] = buf;
+        buf += block * LayerArena<T>::padded(nNodes[i]);
+      }
+      for (unsigned i=0; i<size; i++)
+      {
+        sigma[i] = buf;
+        buf += block * LayerArena<T>::padded(nNodes[i+1]);
+      }
+      nodesT = buf;
+      sigmaT = buf + maxNodes*TRANSPOSED_STRIDE;
+      rowBuffer = sigmaT + maxNodes*TRANSPOSED_STRIDE;
+    }
+    catch (bad_alloc xa)
+    {
+      throw;
+    }
+  }
+
+
+  template <class T>
+  void BasicBackpropagation<T>::allocateSpace(const vector<unsigned> &nNodes)
   {
     DEBUG2("Allocating all the space that the Backpropagation class will need.");
     const unsigned size = nNodes.size() - 1;
     try
     {
+      gradArena.allocate(nNodes, 1, 0);
+      dw = gradArena.getWeights(DELTA_SET);
+      db = gradArena.getBias(DELTA_SET);
+      bpArena.allocate(nNodes, 1, 1);
+      savedW = bpArena.getWeights(SAVED_SET);
+      savedB = bpArena.getBias(SAVED_SET);
+      sigma = bpArena.getNodes(0);
+
+      //The frozen status of every node is also kept in a single block.
+      unsigned numNodes = 0;
+      for (unsigned i=0; i<size; i++) numNodes += nNodes[i+1];
       frozenNode = new bool* [size];
-      savedB = new REAL* [size];
-      savedW = new REAL** [size];
-      db = new REAL* [size];
-      sigma = new REAL* [size];
-      dw = new REAL** [size];
-      for (unsigned i=0; i<size; i++)
+      frozenNode[0] = new bool [numNodes];
+      for (unsigned i=1; i<size; i++) frozenNode[i] = frozenNode[i-1] + nNodes[i];
+
+      //Every layer starts unpruned.
+      pruneMask.assign(size, SparseLayer());
+
+      //The transposed weights (see usesTransposed).
+      //Since they depend on the sparsity, a copy is allocated for every layer but the first one.
+      size_t trSize = 0;
+      unsigned numRows = 0;
+      for (unsigned i=1; i<size; i++)
       {
-        savedW[i] = new REAL* [nNodes[i+1]];
-        savedB[i] = new REAL [nNodes[i+1]];
-        frozenNode[i] = new bool [nNodes[i+1]];
-        db[i] = new REAL [nNodes[i+1]];
-        sigma[i] = new REAL [nNodes[i+1]];
-        dw[i] = new REAL* [nNodes[i+1]];
-        for (unsigned j=0; j<nNodes[i+1]; j++)
+        trSize += nNodes[i] * LayerArena<T>::padded(nNodes[i+1]);
+        numRows += nNodes[i];
+      }
+      transposedBuffer.assign(trSize, 0);
+      transposedRows.resize(numRows);
+      weightsT.assign(size, NULL);
+      T *row = (trSize) ? &transposedBuffer[0] : NULL;
+      T **rowPtr = (numRows) ? &transposedRows[0] : NULL;
+      for (unsigned i=1; i<size; i++)
+      {
+        weightsT[i] = rowPtr;
+        for (unsigned j=0; j<nNodes[i]; j++)
         {
-          dw[i][j] = new REAL [nNodes[i]];
-          savedW[i][j] = new REAL [nNodes[i]];
+          rowPtr[j] = row;
+          row += LayerArena<T>::padded(nNodes[i+1]);
         }
+        rowPtr += nNodes[i];
       }
     }
     catch (bad_alloc xa)
@@ -106,89 +170,433 @@ namespace FastNet
     }
   }
 
-  Backpropagation::~Backpropagation()
+  template <class T>
+  BasicBackpropagation<T>::~BasicBackpropagation()
   {
     DEBUG2("Releasing all memory allocated by Backpropagation.");
-    releaseMatrix(db);
-    releaseMatrix(dw);
-    releaseMatrix(sigma);
-    releaseMatrix(savedB);
-    releaseMatrix(savedW);
+    //dw, db, savedW, savedB and sigma are released by the arenas.
 
     // Deallocating the frozenNode matrix.
     if (frozenNode)
     {
-      for (unsigned i=0; i<(nNodes.size()-1); i++) if (frozenNode[i]) delete [] frozenNode[i];
+      delete [] frozenNode[0];
       delete [] frozenNode;
     }
+  }
+
+  template <class T>
+  void BasicBackpropagation<T>::retropropagateLayer(const unsigned layer, const T *sigmaNext, const T *nodes, T *sig) const
+  {
+    const Kernels<T> &kernels = getKernels<T>();
+    const unsigned nNext = nNodes[layer+2];
+
+    //The weight rows are accessed contiguously, by accumulating
+    //each row scaled by the sigma of its node.
+    for (unsigned j=0; j<nNodes[layer+1]; j++) sig[j] = 0;
+
+    if (!sparse[layer+1].empty())
+    {
+      const SparseLayer &sp = sparse[layer+1];
+      for (unsigned k=0; k<nNext; k++) kernels.sparseAxpy(sigmaNext[k], weights[layer+1][k], sp.getCols(k), sp.getNumCols(k), sig);
+    }
+    else
+    {
+      for (unsigned k=0; k<nNext; k++) kernels.axpy(sigmaNext[k], weights[layer+1][k], sig, nNodes[layer+1]);
+    }
 
+    trfFunc[layer]->deriv(nodes, sig, nNodes[layer+1]);
   }
 
-  void Backpropagation::retropropagateError(const REAL *output, const REAL *target)
+
+  template <class T>
+  void BasicBackpropagation<T>::transposeWeights()
+  {
+    for (unsigned i=1; i<(nNodes.size()-1); i++)
+    {
+      if (!usesTransposed(i)) continue;
+      for (unsigned k=0; k<nNodes[i+1]; k++)
+      {
+        for (unsigned j=0; j<nNodes[i]; j++) weightsT[i][j][k] = weights[i][k][j];
+      }
+    }
+  }
+
+
+  template <class T>
+  void BasicBackpropagation<T>::retropropagateError(const T *output, const T *target)
   {
     const unsigned size = nNodes.size() - 1;
 
-    for (unsigned i=0; i<nNodes[size]; i++) sigma[size-1][i] = (target[i] - output[i]) * CALL_TRF_FUNC(trfFunc[size-1])(output[i], true);
+    for (unsigned i=0; i<nNodes[size]; i++) sigma[size-1][i] = (target[i] - output[i]);
+    trfFunc[size-1]->deriv(output, sigma[size-1], nNodes[size]);
 
     //Retropropagating the error.
-    for (int i=(size-2); i>=0; i--)
+    for (int i=(size-2); i>=0; i--) retropropagateLayer(i, sigma[i+1], layerOutputs[i+1], sigma[i]);
+  }
+  
+
+  template <class T>
+  void BasicBackpropagation<T>::calculateNewWeights(const T *output, const T *target)
+  {
+    const unsigned size = nNodes.size() - 1;
+
+    const Kernels<T> &kernels = getKernels<T>();
+
+    retropropagateError(output, target);
+
+    //Accumulating the deltas. In the sparse layers, only the nonzero weights get gradients,
+    //and the frozen nodes get none.
+    for (unsigned i=0; i<size; i++)
     {
-      for (unsigned j=0; j<nNodes[i+1]; j++)
+      const SparseLayer &sp = sparse[i];
+      for (unsigned j=0; j<nNodes[(i+1)]; j++)
+      {
+        if (frozenNode[i][j]) continue;
+        if (sp.empty()) kernels.accumulate(sigma[i][j], layerOutputs[i], dw[i][j], nNodes[i]);
+        else kernels.sparseAccumulate(sigma[i][j], layerOutputs[i], sp.getCols(j), sp.getNumCols(j), dw[i][j]);
+        db[i][j] += (sigma[i][j]);
+      }
+    }
+  }
+
+
+  template <class T>
+  ACC_REAL BasicBackpropagation<T>::applySupervisedBatch(const T * const *inputs, const T * const *targets, const unsigned nEvents)
+  {
+    TrainingWorkspace ws(*this);
+    const ACC_REAL error = applySupervisedBatch(inputs, targets, nEvents, ws);
+    addToGradient(ws);
+    return error;
+  }
+
+
+  template <class T>
+  ACC_REAL BasicBackpropagation<T>::applySupervisedBatch(const T * const *inputs, const T * const *cached, const T * const *targets,
+                                                            const unsigned nEvents, TrainingWorkspace &ws) const
+  {
+    const unsigned size = nNodes.size() - 1;
+    const unsigned nOut = nNodes[size];
+    const unsigned outStride = LayerArena<T>::padded(nOut);
+    const unsigned block = BasicNeuralNetwork<T>::BATCH_BLOCK;
+    const unsigned cachedLayer = getCachedLayer();
+    ACC_REAL error = 0;
+
+    //With the caches, the propagation starts at the cached layer, whose frozen nodes are read from the caches.
+    const unsigned firstLayer = (cached) ? cachedLayer : 0;
+    const unsigned prevSize = (firstLayer) ? nNodes[firstLayer] : 0;
+    if (cached) splitFrozen(firstLayer, ws.trainRows, ws.frozenRows);
+
+    for (unsigned first=0; first<nEvents; first+=block)
+    {
+      const unsigned blockSize = std::min(block, nEvents - first);
+
+      //Gathering the block events (or the inputs of the cached layer), and propagating them layer by layer.
+      const unsigned inStride = LayerArena<T>::padded(nNodes[firstLayer]);
+      for (unsigned e=0; e<blockSize; e++)
+      {
+        const T *in = (firstLayer) ? cached[first+e] : inputs[first+e];
+        memcpy(ws.nodes[firstLayer] + e*inStride, in, nNodes[firstLayer]*sizeof(T));
+      }
+      for (unsigned i=firstLayer; i<size; i++)
       {
-        sigma[i][j] = 0;
+        const unsigned stride = LayerArena<T>::padded(nNodes[i+1]);
+        if ( (!cached) || (i != firstLayer) )
+        {
+          this->propagateLayerBatch(i, ws.nodes[i], LayerArena<T>::padded(nNodes[i]), blockSize, ws.nodes[i+1], stride);
+          continue;
+        }
 
-        for (unsigned k=0; k<nNodes[i+2]; k++)
+        const vector<unsigned> &train = ws.trainRows;
+        const vector<unsigned> &frozen = ws.frozenRows;
+        if (!train.empty()) propagateRowsBatch(i, train, ws.nodes[i], inStride, blockSize, ws.rowBuffer, stride);
+        for (unsigned e=0; e<blockSize; e++)
         {
-          sigma[i][j] += sigma[i+1][k] * weights[(i+1)][k][j];
+          T *y = ws.nodes[i+1] + e*stride;
+          const T *t = ws.rowBuffer + e*stride;
+          const T *c = cached[first+e] + prevSize;
+          for (unsigned r=0; r<train.size(); r++) y[train[r]] = t[r];
+          for (unsigned r=0; r<frozen.size(); r++) y[frozen[r]] = c[r];
         }
+      }
 
-        sigma[i][j] *= CALL_TRF_FUNC(trfFunc[i])(layerOutputs[i+1][j], true);
+      //The output errors.
+      for (unsigned e=0; e<blockSize; e++)
+      {
+        const T *output = ws.nodes[size] + e*outStride;
+        const T *target = targets[first+e];
+        T *sig = ws.sigma[size-1] + e*outStride;
+        ACC_REAL evError = 0;
+        for (unsigned k=0; k<nOut; k++)
+        {
+          sig[k] = (target[k] - output[k]);
+          evError += SQR(target[k] - output[k]);
+        }
+        error += evError / nOut;
+        trfFunc[size-1]->deriv(output, sig, nOut);
+      }
+
+      //Retropropagating the error of every event of the block, down to the cached layer (the layers
+      //before it are frozen). Through the transposed weights, this is a matrix product, calculated
+      //as the propagation of sigma through a layer.
+      for (int i=(size-2); i>=static_cast<int>(cachedLayer); i--)
+      {
+        const unsigned stride = LayerArena<T>::padded(nNodes[i+1]);
+        const unsigned nextStride = LayerArena<T>::padded(nNodes[i+2]);
+        if (usesTransposed(i+1))
+        {
+          BasicNeuralNetwork<T>::propagateLayerBatch(weightsT[i+1], LayerArena<T>::padded(nNodes[i+2]), NULL, NULL, nNodes[i+2],
+                                                      nNodes[i+1], ws.sigma[i+1], nextStride, blockSize, ws.sigma[i], stride);
+          for (unsigned e=0; e<blockSize; e++) trfFunc[i]->deriv(ws.nodes[i+1] + e*stride, ws.sigma[i] + e*stride, nNodes[i+1]);
+        }
+        else
+        {
+          for (unsigned e=0; e<blockSize; e++)
+          {
+            retropropagateLayer(i, ws.sigma[i+1] + e*nextStride, ws.nodes[i+1] + e*stride, ws.sigma[i] + e*stride);
+          }
+        }
       }
+
+      for (unsigned i=cachedLayer; i<size; i++) accumulateBatch(i, blockSize, ws);
     }
+
+    return error;
   }
-  
 
-  void Backpropagation::calculateNewWeights(const REAL *output, const REAL *target)
+
+  template <class T>
+  void BasicBackpropagation<T>::splitFrozen(const unsigned layer, vector<unsigned> &train, vector<unsigned> &frozen) const
   {
-    const unsigned size = nNodes.size() - 1;
+    train.clear();
+    frozen.clear();
+    for (unsigned j=0; j<nNodes[layer+1]; j++)
+    {
+      if (frozenNode[layer][j]) frozen.push_back(j);
+      else train.push_back(j);
+    }
+  }
 
-    retropropagateError(output, target);
 
-    //Accumulating the deltas.
-    for (unsigned i=0; i<size; i++)
+  template <class T>
+  void BasicBackpropagation<T>::propagateRowsBatch(const unsigned layer, const vector<unsigned> &rows, const T *in,
+                                                   const unsigned inStride, const unsigned nEvents, T *out,
+                                                   const unsigned outStride) const
+  {
+    //The same kernels of propagateLayerBatch (dot4x2 gives the same values as dot, and sparseDot4 as sparseDot),
+    //so the outputs of the nodes are exactly the same ones.
+    const Kernels<T> &kernels = getKernels<T>();
+    const unsigned nIn = nNodes[layer];
+    const unsigned nRows = rows.size();
+    const T * const *w = weights[layer];
+    const T *b = bias[layer];
+    const SparseLayer &sp = sparse[layer];
+
+    unsigned e = 0;
+    for (; (e+4)<=nEvents; e+=4)
     {
-      for (unsigned j=0; j<nNodes[(i+1)]; j++)
+      const T *x = in + e*inStride;
+      T *y = out + e*outStride;
+      unsigned r = 0;
+      if (sp.empty())
       {
-        for (unsigned k=0; k<nNodes[i]; k++)
+        for (; (r+2)<=nRows; r+=2)
         {
-          dw[i][j][k] += (sigma[i][j] * layerOutputs[i][k]);
+          T acc[8];
+          kernels.dot4x2(x, inStride, w[rows[r]], w[rows[r+1]] - w[rows[r]], nIn, acc);
+          for (unsigned t=0; t<4; t++)
+          {
+            y[t*outStride + r] = b[rows[r]] + acc[2*t];
+            y[t*outStride + r+1] = b[rows[r+1]] + acc[2*t+1];
+          }
         }
+      }
+      for (; r<nRows; r++)
+      {
+        const unsigned j = rows[r];
+        T acc[4];
+        if (sp.empty()) for (unsigned t=0; t<4; t++) acc[t] = kernels.dot(x + t*inStride, w[j], nIn);
+        else kernels.sparseDot4(x, inStride, w[j], sp.getCols(j), sp.getNumCols(j), acc);
+        for (unsigned t=0; t<4; t++) y[t*outStride + r] = b[j] + acc[t];
+      }
+      for (unsigned t=0; t<4; t++) trfFunc[layer]->apply(y + t*outStride, nRows);
+    }
 
-        db[i][j] += (sigma[i][j]);
+    //Remaining events (block size not multiple of 4).
+    for (; e<nEvents; e++)
+    {
+      const T *x = in + e*inStride;
+      T *y = out + e*outStride;
+      for (unsigned r=0; r<nRows; r++)
+      {
+        const unsigned j = rows[r];
+        y[r] = b[j] + ((sp.empty()) ? kernels.dot(x, w[j], nIn) : kernels.sparseDot(x, w[j], sp.getCols(j), sp.getNumCols(j)));
       }
+      trfFunc[layer]->apply(y, nRows);
     }
   }
 
 
-  void Backpropagation::addToGradient(const Backpropagation &net)
+  template <class T>
+  unsigned BasicBackpropagation<T>::getCachedLayer() const
   {
-    //Accumulating the deltas.
-    for (unsigned i=0; i<(nNodes.size()-1); i++)
+    const unsigned size = nNodes.size() - 1;
+    unsigned layer = 0;
+    while ( (layer < (size-1)) && (isFrozen(layer)) ) layer++;
+    return layer;
+  }
+
+
+  template <class T>
+  unsigned BasicBackpropagation<T>::getFrozenCacheSize() const
+  {
+    const unsigned layer = getCachedLayer();
+    unsigned numFrozen = 0;
+    for (unsigned j=0; j<nNodes[layer+1]; j++) if (frozenNode[layer][j]) numFrozen++;
+    return ((layer) ? nNodes[layer] : 0) + numFrozen;
+  }
+
+
+  template <class T>
+  void BasicBackpropagation<T>::cacheFrozen(const T * const *inputs, const unsigned nEvents, T *cache, TrainingWorkspace &ws) const
+  {
+    const unsigned block = BasicNeuralNetwork<T>::BATCH_BLOCK;
+    const unsigned layer = getCachedLayer();
+    const unsigned cacheSize = getFrozenCacheSize();
+    const unsigned prevSize = (layer) ? nNodes[layer] : 0;
+    const unsigned inStride = LayerArena<T>::padded(nNodes[0]);
+    const unsigned prevStride = LayerArena<T>::padded(nNodes[layer]);
+    const unsigned stride = LayerArena<T>::padded(nNodes[layer+1]);
+    splitFrozen(layer, ws.trainRows, ws.frozenRows);
+    const vector<unsigned> &frozen = ws.frozenRows;
+
+    for (unsigned first=0; first<nEvents; first+=block)
     {
-      for (unsigned j=0; j<nNodes[(i+1)]; j++)
+      const unsigned blockSize = std::min(block, nEvents - first);
+      for (unsigned e=0; e<blockSize; e++) memcpy(ws.nodes[0] + e*inStride, inputs[first+e], nNodes[0]*sizeof(T));
+      for (unsigned i=0; i<layer; i++)
+      {
+        this->propagateLayerBatch(i, ws.nodes[i], LayerArena<T>::padded(nNodes[i]), blockSize,
+                                    ws.nodes[i+1], LayerArena<T>::padded(nNodes[i+1]));
+      }
+      if (!frozen.empty()) propagateRowsBatch(layer, frozen, ws.nodes[layer], prevStride, blockSize, ws.rowBuffer, stride);
+
+      for (unsigned e=0; e<blockSize; e++)
       {
-        for (unsigned k=0; k<nNodes[i]; k++)
+        T *c = cache + static_cast<size_t>(first+e)*cacheSize;
+        if (prevSize) memcpy(c, ws.nodes[layer] + e*prevStride, prevSize*sizeof(T));
+        if (!frozen.empty()) memcpy(c + prevSize, ws.rowBuffer + e*stride, frozen.size()*sizeof(T));
+      }
+    }
+  }
+
+
+  template <class T>
+  void BasicBackpropagation<T>::accumulateBatch(const unsigned layer, const unsigned nEvents, TrainingWorkspace &ws) const
+  {
+    const Kernels<T> &kernels = getKernels<T>();
+    const unsigned block = TRANSPOSED_STRIDE;
+    const unsigned nIn = nNodes[layer];
+    const unsigned nOut = nNodes[layer+1];
+    const unsigned inStride = LayerArena<T>::padded(nIn);
+    const unsigned outStride = LayerArena<T>::padded(nOut);
+    const T *in = ws.nodes[layer];
+    T *nodesT = ws.nodesT;
+    T *sigmaT = ws.sigmaT;
+    const T *sig = ws.sigma[layer];
+
+    //Transposing the inputs and sigma, so each node has its values in the block events contiguously.
+    for (unsigned e=0; e<nEvents; e++)
+    {
+      for (unsigned k=0; k<nIn; k++) nodesT[k*block + e] = in[e*inStride + k];
+      for (unsigned j=0; j<nOut; j++) sigmaT[j*block + e] = sig[e*outStride + j];
+    }
+
+    //The frozen nodes get no gradients (updateWeights would discard them).
+    for (unsigned j=nextTrainable(layer, 0); j<nOut; j=nextTrainable(layer, j+1))
+    {
+      const T *s = sigmaT + j*block;
+      for (unsigned e=0; e<nEvents; e++) ws.db[layer][j] += s[e];
+    }
+
+    //In the sparse layers, only the nonzero weights get gradients.
+    if (!sparse[layer].empty())
+    {
+      const SparseLayer &sp = sparse[layer];
+      for (unsigned j=nextTrainable(layer, 0); j<nOut; j=nextTrainable(layer, j+1))
+      {
+        const unsigned *cols = sp.getCols(j);
+        for (unsigned c=0; c<sp.getNumCols(j); c++)
+        {
+          ws.dw[layer][j][cols[c]] += kernels.dot(sigmaT + j*block, nodesT + cols[c]*block, nEvents);
+        }
+      }
+      return;
+    }
+
+    //dw += sigma' * inputs, in tiles of 2 trainable nodes by 4 inputs.
+    unsigned j = nextTrainable(layer, 0);
+    unsigned j1 = nextTrainable(layer, j+1);
+    for (; j1<nOut; j=nextTrainable(layer, j1+1), j1=nextTrainable(layer, j+1))
+    {
+      ACC_REAL *dw0 = ws.dw[layer][j];
+      ACC_REAL *dw1 = ws.dw[layer][j1];
+      unsigned k = 0;
+      for (; (k+4)<=nIn; k+=4)
+      {
+        T acc[8];
+        kernels.dot4x2(nodesT + k*block, block, sigmaT + j*block, (j1-j)*block, nEvents, acc);
+        for (unsigned t=0; t<4; t++)
         {
-          dw[i][j][k] += net.dw[i][j][k];
+          dw0[k+t] += acc[2*t];
+          dw1[k+t] += acc[2*t+1];
         }
-        db[i][j] += net.db[i][j];
       }
+      for (; k<nIn; k++)
+      {
+        dw0[k] += kernels.dot(nodesT + k*block, sigmaT + j*block, nEvents);
+        dw1[k] += kernels.dot(nodesT + k*block, sigmaT + j1*block, nEvents);
+      }
+    }
+
+    //Remaining node (odd number of trainable nodes).
+    if (j < nOut)
+    {
+      for (unsigned k=0; k<nIn; k++) ws.dw[layer][j][k] += kernels.dot(nodesT + k*block, sigmaT + j*block, nEvents);
     }
   }
 
-  void Backpropagation::updateWeights(const unsigned numEvents)
+
+  template <class T>
+  void BasicBackpropagation<T>::addToGradient(const BasicBackpropagation &net)
   {
-    const REAL val = 1. / static_cast<REAL>(numEvents);
+    //Accumulating the deltas. Since dw and db are contiguous in the arena,
+    //they are accumulated as a single flat vector.
+    ACC_REAL *d = gradArena.getParams(DELTA_SET);
+    const ACC_REAL *nd = net.gradArena.getParams(DELTA_SET);
+    getKernels<ACC_REAL>().axpy(1., nd, d, gradArena.paramSize());
+  }
+
+
+  template <class T>
+  void BasicBackpropagation<T>::addToGradient(const TrainingWorkspace &ws)
+  {
+    addToGradient(ws, 0, gradArena.paramSize());
+  }
+
+
+  template <class T>
+  void BasicBackpropagation<T>::addToGradient(const TrainingWorkspace &ws, const size_t begin, const size_t end)
+  {
+    //The workspace gradients have the same layout as the network ones.
+    ACC_REAL *d = gradArena.getParams(DELTA_SET) + begin;
+    getKernels<ACC_REAL>().axpy(1., ws.gradArena.getParams(DELTA_SET) + begin, d, end - begin);
+  }
+
+  template <class T>
+  void BasicBackpropagation<T>::updateWeights(const unsigned numEvents)
+  {
+    const ACC_REAL val = 1. / static_cast<ACC_REAL>(numEvents);
+    const Kernels<T> &kernels = getKernels<T>();
     
     for (unsigned i=0; i<(nNodes.size()-1); i++)
     {
@@ -205,15 +613,13 @@ namespace FastNet
         }
         else
         {
-          for (unsigned k=0; k<nNodes[i]; k++)
-          {
-            weights[i][j][k] += (learningRate * val * dw[i][j][k]);
-            dw[i][j][k] = 0;
-          }
+          clearPruned(i, j, dw[i][j]);
+          kernels.update(learningRate * val, dw[i][j], weights[i][j], nNodes[i]);
+          for (unsigned k=0; k<nNodes[i]; k++) dw[i][j][k] = 0;
 
           if (usingBias[i])
           {
-            bias[i][j] += (learningRate * val * db[i][j]);
+            bias[i][j] += static_cast<T>(learningRate * val * db[i][j]);
             db[i][j] = 0;
           }
           else
@@ -223,12 +629,14 @@ namespace FastNet
         }
       }
     }
+    transposeWeights();
   }
 
 
-  void Backpropagation::showInfo() const
+  template <class T>
+  void BasicBackpropagation<T>::showInfo() const
   {
-    NeuralNetwork::showInfo();
+    BasicNeuralNetwork<T>::showInfo();
     REPORT("TRAINING ALGORITHM INFORMATION:");
     REPORT("Training algorithm : Gradient Descent");
     REPORT("Learning rate      : " << learningRate);
@@ -253,7 +661,8 @@ namespace FastNet
   }
 
 
-  bool Backpropagation::isFrozen(unsigned layer) const
+  template <class T>
+  bool BasicBackpropagation<T>::isFrozen(unsigned layer) const
   {
     for (int i=0; i<nNodes[layer+1]; i++)
     {
@@ -264,13 +673,63 @@ namespace FastNet
   }
 
 
-  inline REAL Backpropagation::applySupervisedInput(const REAL *input, const REAL *target, const REAL* &output)
+  template <class T>
+  void BasicBackpropagation<T>::setPruned(const unsigned layer, const bool pruned)
+  {
+    DEBUG2("Setting layer " << layer << " as " << ((pruned) ? "pruned" : "unpruned"));
+    pruneMask[layer] = (pruned) ? SparseLayer(weights[layer], nNodes[layer], nNodes[layer+1]) : SparseLayer();
+    this->updateSparsity();
+    transposeWeights();
+  }
+
+
+  template <class T>
+  void BasicBackpropagation<T>::initWeights(const unsigned seed)
+  {
+    DEBUG1("Initializing the weights by the Nguyen-Widrow method (seed " << seed << ").");
+    std::mt19937 engine(seed);
+    std::uniform_real_distribution<double> uniform(-1., 1.);
+
+    for (unsigned i=0; i<(nNodes.size()-1); i++)
+    {
+      const unsigned numInputs = nNodes[i];
+      const unsigned numNodes = nNodes[i+1];
+      const double magnitude = 0.7 * pow(static_cast<double>(numNodes), 1. / numInputs);
+      for (unsigned j=0; j<numNodes; j++)
+      {
+        //The random numbers of the frozen nodes are drawn anyway, so freezing a node
+        //does not change the weights of the others.
+        vector<double> w(numInputs);
+        double norm = 0.;
+        for (unsigned k=0; k<numInputs; k++)
+        {
+          w[k] = uniform(engine);
+          norm += w[k]*w[k];
+        }
+        if (frozenNode[i][j]) continue;
+
+        norm = sqrt(norm);
+        for (unsigned k=0; k<numInputs; k++) weights[i][j][k] = static_cast<T>((norm > 0.) ? magnitude * w[k] / norm : 0.);
+        clearPruned(i, j, weights[i][j]);
+        const double spread = (numNodes > 1) ? (-1. + (2. * j) / (numNodes - 1)) : 1.;
+        bias[i][j] = (usingBias[i]) ? static_cast<T>(magnitude * spread * ((w[0] < 0.) ? -1. : 1.)) : 0;
+      }
+    }
+
+    this->updateSparsity();
+    transposeWeights();
+    saveBestTrain();
+  }
+
+
+  template <class T>
+  ACC_REAL BasicBackpropagation<T>::applySupervisedInput(const T *input, const T *target, const T* &output)
   {
     int size = (nNodes.size()-1);
-    REAL error = 0;
+    ACC_REAL error = 0;
 
     //Propagating the input.
-    output = propagateInput(input);
+    output = this->propagateInput(input);
       
     //Calculating the error.
     for (int i=0; i<nNodes[size]; i++) error += SQR(target[i] - output[i]);
@@ -279,4 +738,62 @@ namespace FastNet
     return (error / nNodes[size]);
   }
 
+
+  template <class T>
+  ACC_REAL BasicBackpropagation<T>::applySupervisedInput(const T *input, const T *target, const T* &output, TrainingWorkspace &ws) const
+  {
+    const unsigned size = nNodes.size() - 1;
+    ACC_REAL error = 0;
+
+    output = this->propagateInput(input, ws.propagation);
+    for (unsigned i=0; i<nNodes[size]; i++) error += SQR(target[i] - output[i]);
+    return (error / nNodes[size]);
+  }
+
+
+  template <class T>
+  ACC_REAL BasicBackpropagation<T>::applySupervisedInput(const T *input, const T *cached, const T *target, const T* &output,
+                                                            TrainingWorkspace &ws) const
+  {
+    const unsigned size = nNodes.size() - 1;
+    const unsigned layer = getCachedLayer();
+    const unsigned prevSize = (layer) ? nNodes[layer] : 0;
+    const Kernels<T> &kernels = getKernels<T>();
+    ACC_REAL error = 0;
+
+    //The trainable nodes of the cached layer are propagated, and the frozen ones come from the cache.
+    splitFrozen(layer, ws.trainRows, ws.frozenRows);
+    const vector<unsigned> &train = ws.trainRows;
+    const vector<unsigned> &frozen = ws.frozenRows;
+    const T *in = (layer) ? cached : input;
+    if (!train.empty()) propagateRowsBatch(layer, train, in, 0, 1, ws.rowBuffer, 0);
+    T *y = ws.nodes[layer+1];
+    for (unsigned r=0; r<train.size(); r++) y[train[r]] = ws.rowBuffer[r];
+    for (unsigned r=0; r<frozen.size(); r++) y[frozen[r]] = cached[prevSize + r];
+
+    //The next layers, as in propagateInput.
+    for (unsigned i=layer+1; i<size; i++)
+    {
+      const T *x = ws.nodes[i];
+      T *out = ws.nodes[i+1];
+      if (this->isSparse(i))
+      {
+        const SparseLayer &sp = sparse[i];
+        for (unsigned j=0; j<nNodes[i+1]; j++) out[j] = bias[i][j] + kernels.sparseDot(x, weights[i][j], sp.getCols(j), sp.getNumCols(j));
+      }
+      else
+      {
+        for (unsigned j=0; j<nNodes[i+1]; j++) out[j] = bias[i][j] + kernels.dot(x, weights[i][j], nNodes[i]);
+      }
+      trfFunc[i]->apply(out, nNodes[i+1]);
+    }
+
+    output = ws.nodes[size];
+    for (unsigned i=0; i<nNodes[size]; i++) error += SQR(target[i] - output[i]);
+    return (error / nNodes[size]);
+  }
+
+
+  template class BasicBackpropagation<float>;
+  template class BasicBackpropagation<double>;
 }
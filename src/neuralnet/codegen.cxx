@@ -0,0 +1,230 @@
+/**
+@file  codegen.cxx
+@brief Generator of dependency free C/C++ inference code implementation file.
+*/
+
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <set>
+#include <limits>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+
+#include "fastnet/neuralnet/activations.h"
+#include "fastnet/neuralnet/codegen.h"
+
+using namespace std;
+
+namespace FastNet
+{
+  namespace
+  {
+    /// The C names of the storage precisions, and the suffixes of their literals and math functions.
+    template <class T> struct CType;
+    template <> struct CType<double> {static const char *name() {return "double";}; static const char *suffix() {return "";};};
+    template <> struct CType<float> {static const char *name() {return "float";}; static const char *suffix() {return "f";};};
+
+
+    /// Tells whether a string is a valid C identifier.
+    bool isIdentifier(const string &name)
+    {
+      if ( (name.empty()) || (isdigit(name[0])) ) return false;
+      for (unsigned i=0; i<name.size(); i++)
+      {
+        if ( (!isalnum(name[i])) && (name[i] != '_') ) return false;
+      }
+      return true;
+    }
+
+
+    /// Formats a value as a C floating point literal, which is read back exactly.
+    template <class T>
+    string literal(const T val)
+    {
+      if (!std::isfinite(val)) throw "The network has a non finite weight!";
+      ostringstream str;
+      str << setprecision(numeric_limits<T>::max_digits10) << val;
+      string ret = str.str();
+      if (ret.find_first_of(".e") == string::npos) ret += ".0";
+      return ret + CType<T>::suffix();
+    }
+
+
+    /// Writes the inline function implementing a transfer function.
+    template <class T>
+    void writeTrf(ostream &out, const string &prefix, const string &id, const string &precision)
+    {
+      const string type = CType<T>::name();
+      const string sfx = CType<T>::suffix();
+      const string name = prefix + "_" + id;
+      const string clamp = literal(static_cast<T>(TANSIG_CLAMP));
+
+      if ( (id == TGH_ID) && (precision == TRF_TABLE_ID) )
+      {
+        //The same table as the network one (see activations.h).
+        const unsigned size = TANSIG_TABLE_SIZE;
+        out << "FASTNET_GENERATED_CONST " << type << " " << name << "_table[" << size << "] = {";
+        for (unsigned i=0; i<size; i++)
+        {
+          out << ((i % 8) ? " " : "\n  ") << literal(static_cast<T>(tanh(static_cast<double>(i) / TANSIG_TABLE_RES)));
+          if (i < (size-1)) out << ",";
+        }
+        out << "\n};\n\n";
+        out << "static inline " << type << " " << name << "(const " << type << " x)\n{\n";
+        out << "  const " << type << " m = fabs" << sfx << "(x);\n";
+        out << "  const " << type << " a = ((m < " << clamp << ") ? m : " << clamp << ") * " << TANSIG_TABLE_RES << ";\n";
+        out << "  const unsigned i = (unsigned) a;\n";
+        out << "  const " << type << " y = " << name << "_table[i] + (a - i) * (" << name << "_table[i+1] - " << name << "_table[i]);\n";
+        out << "  return (x < 0) ? -y : y;\n}\n\n";
+      }
+      else if ( (id == TGH_ID) && (precision == TRF_RATIONAL_ID) )
+      {
+        out << "static inline " << type << " " << name << "(const " << type << " x)\n{\n";
+        out << "  const " << type << " v = (x < -" << clamp << ") ? -" << clamp << " : ((x > " << clamp << ") ? " << clamp << " : x);\n";
+        out << "  const " << type << " v2 = v*v;\n";
+        out << "  " << type << " p = " << literal(static_cast<T>(TANSIG_P[0])) << ";\n";
+        for (unsigned i=1; i<TANSIG_P_SIZE; i++) out << "  p = p*v2 + " << literal(static_cast<T>(TANSIG_P[i])) << ";\n";
+        out << "  " << type << " q = " << literal(static_cast<T>(TANSIG_Q[0])) << ";\n";
+        for (unsigned i=1; i<TANSIG_Q_SIZE; i++) out << "  q = q*v2 + " << literal(static_cast<T>(TANSIG_Q[i])) << ";\n";
+        out << "  return (v*p) / q;\n}\n\n";
+      }
+      else if (id == TGH_ID)
+      {
+        out << "static inline " << type << " " << name << "(const " << type << " x) {return tanh" << sfx << "(x);}\n\n";
+      }
+      else if (id == LOGSIG_ID)
+      {
+        out << "static inline " << type << " " << name << "(const " << type << " x) {return 1 / (1 + exp" << sfx << "(-x));}\n\n";
+      }
+      else if (id == POSLIN_ID)
+      {
+        out << "static inline " << type << " " << name << "(const " << type << " x) {return (x > 0) ? x : 0;}\n\n";
+      }
+    }
+  }
+
+
+  template <class T>
+  void generateSource(ostream &out, const BasicNeuralNetwork<T> &net, const string &funcName)
+  {
+    DEBUG1("Generating the inference source code of the network as " << funcName);
+    if (!isIdentifier(funcName)) throw "The inference function name is not a valid C identifier!";
+
+    const unsigned size = net.getNumLayers() - 1;
+    const string type = CType<T>::name();
+    set<string> trfs;
+    for (unsigned i=0; i<size; i++)
+    {
+      const string &id = net.getTrfFunc(i);
+      if ( (id != TGH_ID) && (id != LIN_ID) && (id != LOGSIG_ID) && (id != POSLIN_ID) )
+      {
+        throw "Only the built in transfer functions can be generated as source code!";
+      }
+      if (id != LIN_ID) trfs.insert(id);
+    }
+
+    //Header.
+    ostringstream topology;
+    for (unsigned i=0; i<=size; i++) topology << ((i) ? "-" : "") << net[i];
+    out << "/*\n  Inference function of a " << topology.str() << " network (transfer functions:";
+    for (unsigned i=0; i<size; i++) out << " " << net.getTrfFunc(i);
+    out << ", " << net.getTrfPrecision() << " precision, " << type << " values).\n";
+    out << "  Generated by FastNet. Do not edit: regenerate it from the network.\n\n";
+    out << "  void " << funcName << "(const " << type << " *input, " << type << " *output);\n*/\n\n";
+    out << "#include <math.h>\n\n";
+    out << "#ifndef FASTNET_GENERATED_CONST\n";
+    out << "#ifdef __cplusplus\n#define FASTNET_GENERATED_CONST static constexpr\n";
+    out << "#else\n#define FASTNET_GENERATED_CONST static const\n#endif\n#endif\n\n";
+
+    //Weights and biases.
+    for (unsigned i=0; i<size; i++)
+    {
+      out << "FASTNET_GENERATED_CONST " << type << " " << funcName << "_w" << i << "[" << net[i+1] << "][" << net[i] << "] = {";
+      for (unsigned j=0; j<net[i+1]; j++)
+      {
+        out << "\n  {";
+        for (unsigned k=0; k<net[i]; k++) out << ((k) ? ", " : "") << literal(net.getWeight(i, j, k));
+        out << "}" << ((j < (net[i+1]-1)) ? "," : "");
+      }
+      out << "\n};\n\n";
+
+      if (net.isUsingBias(i))
+      {
+        out << "FASTNET_GENERATED_CONST " << type << " " << funcName << "_b" << i << "[" << net[i+1] << "] = {";
+        for (unsigned j=0; j<net[i+1]; j++) out << ((j) ? ", " : "") << literal(net.getBias(i, j));
+        out << "};\n\n";
+      }
+    }
+
+    //Transfer functions.
+    for (set<string>::const_iterator itr = trfs.begin(); itr != trfs.end(); ++itr)
+    {
+      writeTrf<T>(out, funcName, *itr, net.getTrfPrecision());
+    }
+
+    //The inference function: a weighted sum expression per node (without the zero weights),
+    //followed by the transfer function of each node.
+    out << "#ifdef __cplusplus\nextern \"C\"\n#endif\n";
+    out << "void " << funcName << "(const " << type << " *input, " << type << " *output)\n{\n";
+    for (unsigned i=1; i<size; i++) out << "  " << type << " h" << i << "[" << net[i] << "];\n";
+
+    for (unsigned i=0; i<size; i++)
+    {
+      const string in = (i) ? ("h" + to_string(i)) : string("input");
+      const string res = (i == (size-1)) ? string("output") : ("h" + to_string(i+1));
+      const string w = funcName + "_w" + to_string(i);
+      const string b = funcName + "_b" + to_string(i);
+      out << "\n";
+      for (unsigned j=0; j<net[i+1]; j++)
+      {
+        out << "  " << res << "[" << j << "] = ";
+        bool first = true;
+        if (net.isUsingBias(i))
+        {
+          out << b << "[" << j << "]";
+          first = false;
+        }
+        for (unsigned k=0; k<net[i]; k++)
+        {
+          if (net.getWeight(i, j, k) == 0) continue;
+          out << ((first) ? "" : " + ") << w << "[" << j << "][" << k << "]*" << in << "[" << k << "]";
+          first = false;
+        }
+        out << ((first) ? "0;\n" : ";\n");
+      }
+
+      if (net.getTrfFunc(i) != LIN_ID)
+      {
+        for (unsigned j=0; j<net[i+1]; j++)
+        {
+          out << "  " << res << "[" << j << "] = " << funcName << "_" << net.getTrfFunc(i) << "(" << res << "[" << j << "]);\n";
+        }
+      }
+    }
+    out << "}\n";
+  }
+
+
+  template <class T>
+  void generateSource(const string &fileName, const BasicNeuralNetwork<T> &net, const string &funcName)
+  {
+    //Generating it first, so no file is left behind if the network can not be generated.
+    ostringstream source;
+    generateSource(source, net, funcName);
+
+    ofstream file(fileName.c_str());
+    if (!file) throw "Impossible to create the source file!";
+    file << source.str();
+    file.close();
+    if (!file) throw "Error writing the source file!";
+  }
+
+
+  template void generateSource(ostream &out, const BasicNeuralNetwork<float> &net, const string &funcName);
+  template void generateSource(ostream &out, const BasicNeuralNetwork<double> &net, const string &funcName);
+  template void generateSource(const string &fileName, const BasicNeuralNetwork<float> &net, const string &funcName);
+  template void generateSource(const string &fileName, const BasicNeuralNetwork<double> &net, const string &funcName);
+}
@@ -0,0 +1,127 @@
+/**
+@file  ensemble.cxx
+@brief BasicEnsemble class template implementation file.
+*/
+
+#include <vector>
+#include <algorithm>
+
+#include "fastnet/neuralnet/ensemble.h"
+
+using namespace std;
+
+namespace FastNet
+{
+  template <class T>
+  BasicEnsemble<T>::BasicEnsemble(const vector<const BasicNeuralNetwork<T>*> &nets)
+  {
+    DEBUG1("Creating an ensemble of " << nets.size() << " networks.");
+    if (nets.empty()) throw "The ensemble must have at least one network!";
+    nIn = (*nets[0])[0];
+    nOut = (*nets[0])[nets[0]->getNumLayers()-1];
+
+    nFirst = 0;
+    for (unsigned m=0; m<nets.size(); m++)
+    {
+      const BasicNeuralNetwork<T> &net = *nets[m];
+      if ( (net[0] != nIn) || (net[net.getNumLayers()-1] != nOut) )
+      {
+        throw "The networks of an ensemble must have the same number of inputs and outputs!";
+      }
+      firstOffset.push_back(nFirst);
+      nFirst += net[1];
+    }
+
+    //Packing the first layer of every member into a single layer.
+    vector<unsigned> packed;
+    packed.push_back(nIn);
+    packed.push_back(nFirst);
+    try
+    {
+      firstLayer.allocate(packed, 1, 0);
+      for (unsigned m=0; m<nets.size(); m++) members.push_back(new BasicNeuralNetwork<T>(*nets[m]));
+    }
+    catch (bad_alloc xa)
+    {
+      for (unsigned m=0; m<members.size(); m++) delete members[m];
+      throw;
+    }
+
+    T **w = firstLayer.getWeights(0)[0];
+    T *b = firstLayer.getBias(0)[0];
+    for (unsigned m=0; m<members.size(); m++)
+    {
+      const BasicNeuralNetwork<T> &net = *members[m];
+      for (unsigned j=0; j<net[1]; j++)
+      {
+        memcpy(w[firstOffset[m] + j], net.weights[0][j], nIn*sizeof(T));
+        b[firstOffset[m] + j] = net.bias[0][j];
+      }
+    }
+  }
+
+
+  template <class T>
+  BasicEnsemble<T>::~BasicEnsemble()
+  {
+    for (unsigned m=0; m<members.size(); m++) delete members[m];
+  }
+
+
+  template <class T>
+  void BasicEnsemble<T>::propagateBatch(const T *inputs, const size_t nEvents, T *outputs) const
+  {
+    Workspace ws(*this);
+    propagateBatch(inputs, nEvents, outputs, ws);
+  }
+
+
+  template <class T>
+  void BasicEnsemble<T>::propagateBatch(const T *inputs, const size_t nEvents, T *outputs, Workspace &ws) const
+  {
+    const unsigned numMembers = members.size();
+    const unsigned firstStride = LayerArena<T>::padded(nFirst);
+    const T * const *w = firstLayer.getWeights(0)[0];
+    const T *b = firstLayer.getBias(0)[0];
+
+    for (size_t ev=0; ev<nEvents; ev+=BATCH_BLOCK)
+    {
+      const unsigned blockSize = static_cast<unsigned>(std::min(static_cast<size_t>(BATCH_BLOCK), nEvents - ev));
+
+      //The first layers of all the members, in a single pass over the block events.
+      BasicNeuralNetwork<T>::propagateLayerBatch(w, firstLayer.getStride(0), b, NULL, nIn, nFirst,
+                                                  inputs + ev*nIn, nIn, blockSize, &ws.first[0], firstStride);
+
+      for (unsigned m=0; m<numMembers; m++)
+      {
+        const BasicNeuralNetwork<T> &net = *members[m];
+        const unsigned size = net.getNumLayers() - 1;
+        T *in = &ws.first[firstOffset[m]];
+        for (unsigned e=0; e<blockSize; e++) net.trfFunc[0]->apply(in + e*firstStride, net[1]);
+
+        //The remaining layers of the member (the last one writes to the output block).
+        unsigned inStride = firstStride;
+        for (unsigned i=1; i<size; i++)
+        {
+          const bool isLast = (i == (size-1));
+          T *out = (isLast) ? &ws.output[0] : &ws.buffer[(i%2)*ws.bufferSize];
+          const unsigned outStride = (isLast) ? nOut : LayerArena<T>::padded(net[i+1]);
+          net.propagateLayerBatch(i, in, inStride, blockSize, out, outStride);
+          in = out;
+          inStride = outStride;
+        }
+
+        //Interleaving the member outputs.
+        T *o = outputs + ev*nOut*numMembers + m;
+        for (unsigned e=0; e<blockSize; e++)
+        {
+          for (unsigned k=0; k<nOut; k++, o+=numMembers) *o = in[e*inStride + k];
+        }
+      }
+    }
+  }
+
+
+  template class BasicEnsemble<float>;
+  template class BasicEnsemble<double>;
+}
@@ -0,0 +1,169 @@
+/**
+@file  kernels.cxx
+@brief Portable kernels and the runtime kernel selection.
+*/
+
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+#include "fastnet/neuralnet/kernels.h"
+#include "fastnet/sys/Reporter.h"
+
+#define KERNEL_TARGET
+#include "kernels_loops.hxx"
+
+using namespace std;
+
+namespace FastNet
+{
+  namespace
+  {
+    template <class T>
+    T scalarDot(const T *x, const T *y, const unsigned n)
+    {
+      T ret = 0;
+      for (unsigned k=0; k<n; k++) ret += x[k] * y[k];
+      return ret;
+    }
+
+
+    template <class T>
+    void scalarDot4x2(const T *x, const unsigned xStride, const T *w, const unsigned wStride, const unsigned n, T *res)
+    {
+      for (unsigned e=0; e<4; e++)
+      {
+        res[2*e] = scalarDot(x + e*xStride, w, n);
+        res[2*e+1] = scalarDot(x + e*xStride, w + wStride, n);
+      }
+    }
+
+
+    template <class T>
+    void scalarAxpy(const T a, const T *x, T *y, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) y[k] += a * x[k];
+    }
+
+
+    template <class Q, class Acc>
+    Acc scalarIntDot(const Q *x, const Q *y, const unsigned n)
+    {
+      //Each product fits in 32 bits, only the sum needs the accumulator type.
+      Acc ret = 0;
+      for (unsigned k=0; k<n; k++) ret += static_cast<int32_t>(x[k]) * static_cast<int32_t>(y[k]);
+      return ret;
+    }
+
+
+    template <class Q, int QMAX>
+    void scalarQuantize(const double *x, const double invScale, Q *q, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++)
+      {
+        const double scaled = x[k] * invScale;
+        const double val = std::min(std::max(scaled, static_cast<double>(-QMAX)), static_cast<double>(QMAX));
+        q[k] = (std::isnan(scaled)) ? 0 : static_cast<Q>(lrint(val));
+      }
+    }
+
+
+    void scalarRProp(double *w, double *d, double *prevD, double *delta, const unsigned n,
+                      const double incEta, const double decEta, const double deltaMin, const double deltaMax)
+    {
+      for (unsigned k=0; k<n; k++)
+      {
+        const double val = prevD[k] * d[k];
+        if (val > 0.)
+        {
+          const double inc = delta[k] * incEta;
+          delta[k] = (inc < deltaMax) ? inc : deltaMax;
+        }
+        else if (val < 0.)
+        {
+          const double dec = delta[k] * decEta;
+          delta[k] = (dec > deltaMin) ? dec : deltaMin;
+        }
+
+        if (d[k] > 0.) w[k] += delta[k];
+        else if (d[k] < 0.) w[k] -= delta[k];
+        prevD[k] = d[k];
+        d[k] = 0;
+      }
+    }
+
+
+    template <class K>
+    const K &selectKernels(const K &scalar, const K &sse2, const K &avx2, const K &avx512)
+    {
+      const char *forced = getenv("FASTNET_KERNELS");
+      if (forced)
+      {
+        const string name(forced);
+        if (name == scalar.name) return scalar;
+#if defined(__x86_64__) || defined(__i386__)
+        if (name == sse2.name) return sse2;
+        if (name == avx2.name) return avx2;
+        if (name == avx512.name) return avx512;
+#endif
+        WARN("Unknown FASTNET_KERNELS value (" << name << "). Selecting the kernels automatically.");
+      }
+
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f")) return avx512;
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return avx2;
+      if (__builtin_cpu_supports("sse2")) return sse2;
+#endif
+      return scalar;
+    }
+  }
+
+
+  const Kernels<double> SCALAR_KERNELS = {"scalar", scalarDot<double>, scalarDot4x2<double>, scalarAxpy<double>,
+                                          scalarAxpy<double>, scalarAxpy<double>, scalarRProp,
+                                          loopSparseDot<double>, loopSparseDot4<double>, loopSparseAxpy<double>, loopSparseAccumulate<double>};
+
+  const Kernels<float> SCALAR_KERNELS_F = {"scalar", scalarDot<float>, scalarDot4x2<float>, scalarAxpy<float>,
+                                            loopAccumulate<float>, loopUpdate<float>, loopRProp<float>,
+                                            loopSparseDot<float>, loopSparseDot4<float>, loopSparseAxpy<float>, loopSparseAccumulate<float>};
+
+  const QuantKernels SCALAR_QUANT_KERNELS = {"scalar", scalarIntDot<int8_t, int32_t>, scalarIntDot<int16_t, int64_t>,
+                                              scalarQuantize<int8_t, 127>, scalarQuantize<int16_t, 32767>};
+
+
+  template <>
+  const Kernels<double> &getKernels<double>()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    static const Kernels<double> &kernels = selectKernels(SCALAR_KERNELS, SSE2_KERNELS, AVX2_KERNELS, AVX512_KERNELS);
+#else
+    static const Kernels<double> &kernels = SCALAR_KERNELS;
+#endif
+    return kernels;
+  }
+
+
+  template <>
+  const Kernels<float> &getKernels<float>()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    static const Kernels<float> &kernels = selectKernels(SCALAR_KERNELS_F, SSE2_KERNELS_F, AVX2_KERNELS_F, AVX512_KERNELS_F);
+#else
+    static const Kernels<float> &kernels = SCALAR_KERNELS_F;
+#endif
+    return kernels;
+  }
+
+
+  const QuantKernels &getQuantKernels()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    static const QuantKernels &kernels = selectKernels(SCALAR_QUANT_KERNELS, SSE2_QUANT_KERNELS, AVX2_QUANT_KERNELS, AVX512_QUANT_KERNELS);
+#else
+    static const QuantKernels &kernels = SCALAR_QUANT_KERNELS;
+#endif
+    return kernels;
+  }
+}
@@ -0,0 +1,333 @@
+/**
+@file  kernels_avx2.cxx
+@brief Kernels implemented with AVX2 and FMA instructions.
+*/
+
+#include "fastnet/neuralnet/kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#define KERNEL_TARGET AVX2_TARGET
+#include "kernels_loops.hxx"
+
+namespace FastNet
+{
+  namespace
+  {
+    AVX2_TARGET inline double hsum(const __m256d v)
+    {
+      const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+      return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+
+
+    /// Mask selecting the first r (0 to 3) values of a vector.
+    AVX2_TARGET inline __m256i tailMask(const unsigned r)
+    {
+      return _mm256_setr_epi64x((r > 0) ? -1 : 0, (r > 1) ? -1 : 0, (r > 2) ? -1 : 0, 0);
+    }
+
+
+    AVX2_TARGET double avx2Dot(const double *x, const double *y, const unsigned n)
+    {
+      __m256d acc = _mm256_setzero_pd();
+      unsigned k = 0;
+      for (; (k+4)<=n; k+=4) acc = _mm256_fmadd_pd(_mm256_loadu_pd(x+k), _mm256_loadu_pd(y+k), acc);
+      if (k < n)
+      {
+        const __m256i mask = tailMask(n-k);
+        acc = _mm256_fmadd_pd(_mm256_maskload_pd(x+k, mask), _mm256_maskload_pd(y+k, mask), acc);
+      }
+      return hsum(acc);
+    }
+
+
+    AVX2_TARGET void avx2Dot4x2(const double *x, const unsigned xStride, const double *w, const unsigned wStride, const unsigned n, double *res)
+    {
+      const double *x0 = x;
+      const double *x1 = x0 + xStride;
+      const double *x2 = x1 + xStride;
+      const double *x3 = x2 + xStride;
+      const double *w0 = w;
+      const double *w1 = w + wStride;
+      __m256d a00 = _mm256_setzero_pd(), a01 = _mm256_setzero_pd();
+      __m256d a10 = _mm256_setzero_pd(), a11 = _mm256_setzero_pd();
+      __m256d a20 = _mm256_setzero_pd(), a21 = _mm256_setzero_pd();
+      __m256d a30 = _mm256_setzero_pd(), a31 = _mm256_setzero_pd();
+
+      unsigned k = 0;
+      for (; (k+4)<=n; k+=4)
+      {
+        const __m256d vw0 = _mm256_loadu_pd(w0+k);
+        const __m256d vw1 = _mm256_loadu_pd(w1+k);
+        __m256d vx = _mm256_loadu_pd(x0+k);
+        a00 = _mm256_fmadd_pd(vx, vw0, a00);
+        a01 = _mm256_fmadd_pd(vx, vw1, a01);
+        vx = _mm256_loadu_pd(x1+k);
+        a10 = _mm256_fmadd_pd(vx, vw0, a10);
+        a11 = _mm256_fmadd_pd(vx, vw1, a11);
+        vx = _mm256_loadu_pd(x2+k);
+        a20 = _mm256_fmadd_pd(vx, vw0, a20);
+        a21 = _mm256_fmadd_pd(vx, vw1, a21);
+        vx = _mm256_loadu_pd(x3+k);
+        a30 = _mm256_fmadd_pd(vx, vw0, a30);
+        a31 = _mm256_fmadd_pd(vx, vw1, a31);
+      }
+
+      //Same tail handling as in avx2Dot.
+      if (k < n)
+      {
+        const __m256i mask = tailMask(n-k);
+        const __m256d vw0 = _mm256_maskload_pd(w0+k, mask);
+        const __m256d vw1 = _mm256_maskload_pd(w1+k, mask);
+        __m256d vx = _mm256_maskload_pd(x0+k, mask);
+        a00 = _mm256_fmadd_pd(vx, vw0, a00);
+        a01 = _mm256_fmadd_pd(vx, vw1, a01);
+        vx = _mm256_maskload_pd(x1+k, mask);
+        a10 = _mm256_fmadd_pd(vx, vw0, a10);
+        a11 = _mm256_fmadd_pd(vx, vw1, a11);
+        vx = _mm256_maskload_pd(x2+k, mask);
+        a20 = _mm256_fmadd_pd(vx, vw0, a20);
+        a21 = _mm256_fmadd_pd(vx, vw1, a21);
+        vx = _mm256_maskload_pd(x3+k, mask);
+        a30 = _mm256_fmadd_pd(vx, vw0, a30);
+        a31 = _mm256_fmadd_pd(vx, vw1, a31);
+      }
+
+      res[0] = hsum(a00); res[1] = hsum(a01);
+      res[2] = hsum(a10); res[3] = hsum(a11);
+      res[4] = hsum(a20); res[5] = hsum(a21);
+      res[6] = hsum(a30); res[7] = hsum(a31);
+    }
+
+
+    AVX2_TARGET void avx2Axpy(const double a, const double *x, double *y, const unsigned n)
+    {
+      const __m256d va = _mm256_set1_pd(a);
+      unsigned k = 0;
+      for (; (k+4)<=n; k+=4) _mm256_storeu_pd(y+k, _mm256_fmadd_pd(va, _mm256_loadu_pd(x+k), _mm256_loadu_pd(y+k)));
+      if (k < n)
+      {
+        const __m256i mask = tailMask(n-k);
+        _mm256_maskstore_pd(y+k, mask, _mm256_fmadd_pd(va, _mm256_maskload_pd(x+k, mask), _mm256_maskload_pd(y+k, mask)));
+      }
+    }
+
+
+    AVX2_TARGET void avx2RProp(double *w, double *d, double *prevD, double *delta, const unsigned n,
+                                const double incEta, const double decEta, const double deltaMin, const double deltaMax)
+    {
+      const __m256d zero = _mm256_setzero_pd();
+      const __m256d one = _mm256_set1_pd(1.);
+      const __m256d vInc = _mm256_set1_pd(incEta);
+      const __m256d vDec = _mm256_set1_pd(decEta);
+      const __m256d vMin = _mm256_set1_pd(deltaMin);
+      const __m256d vMax = _mm256_set1_pd(deltaMax);
+
+      unsigned k = 0;
+      for (; (k+4)<=n; k+=4)
+      {
+        const __m256d vd = _mm256_loadu_pd(d+k);
+        const __m256d val = _mm256_mul_pd(_mm256_loadu_pd(prevD+k), vd);
+        __m256d vDelta = _mm256_loadu_pd(delta+k);
+        const __m256d up = _mm256_min_pd(_mm256_mul_pd(vDelta, vInc), vMax);
+        const __m256d down = _mm256_max_pd(_mm256_mul_pd(vDelta, vDec), vMin);
+        vDelta = _mm256_blendv_pd(vDelta, up, _mm256_cmp_pd(val, zero, _CMP_GT_OQ));
+        vDelta = _mm256_blendv_pd(vDelta, down, _mm256_cmp_pd(val, zero, _CMP_LT_OQ));
+        const __m256d sign = _mm256_sub_pd(_mm256_and_pd(_mm256_cmp_pd(vd, zero, _CMP_GT_OQ), one), 
+                                            _mm256_and_pd(_mm256_cmp_pd(vd, zero, _CMP_LT_OQ), one));
+        _mm256_storeu_pd(w+k, _mm256_add_pd(_mm256_loadu_pd(w+k), _mm256_mul_pd(sign, vDelta)));
+        _mm256_storeu_pd(delta+k, vDelta);
+        _mm256_storeu_pd(prevD+k, vd);
+        _mm256_storeu_pd(d+k, zero);
+      }
+      SCALAR_KERNELS.rprop(w+k, d+k, prevD+k, delta+k, n-k, incEta, decEta, deltaMin, deltaMax);
+    }
+
+
+    AVX2_TARGET inline float hsum(const __m256 v)
+    {
+      __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+      s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+      return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+
+
+    /// Mask selecting the first r (0 to 7) single precision values of a vector.
+    AVX2_TARGET inline __m256i tailMaskF(const unsigned r)
+    {
+      return _mm256_cmpgt_epi32(_mm256_set1_epi32(r), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+
+
+    AVX2_TARGET float avx2Dot(const float *x, const float *y, const unsigned n)
+    {
+      __m256 acc = _mm256_setzero_ps();
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8) acc = _mm256_fmadd_ps(_mm256_loadu_ps(x+k), _mm256_loadu_ps(y+k), acc);
+      if (k < n)
+      {
+        const __m256i mask = tailMaskF(n-k);
+        acc = _mm256_fmadd_ps(_mm256_maskload_ps(x+k, mask), _mm256_maskload_ps(y+k, mask), acc);
+      }
+      return hsum(acc);
+    }
+
+
+    AVX2_TARGET void avx2Dot4x2(const float *x, const unsigned xStride, const float *w, const unsigned wStride, const unsigned n, float *res)
+    {
+      const float *x0 = x;
+      const float *x1 = x0 + xStride;
+      const float *x2 = x1 + xStride;
+      const float *x3 = x2 + xStride;
+      const float *w0 = w;
+      const float *w1 = w + wStride;
+      __m256 a00 = _mm256_setzero_ps(), a01 = _mm256_setzero_ps();
+      __m256 a10 = _mm256_setzero_ps(), a11 = _mm256_setzero_ps();
+      __m256 a20 = _mm256_setzero_ps(), a21 = _mm256_setzero_ps();
+      __m256 a30 = _mm256_setzero_ps(), a31 = _mm256_setzero_ps();
+
+      for (unsigned k=0; k<n; k+=8)
+      {
+        //The last iteration loads only the remaining values (same tail handling as in avx2Dot).
+        const __m256i mask = ((k+8) <= n) ? _mm256_set1_epi32(-1) : tailMaskF(n-k);
+        const __m256 vw0 = _mm256_maskload_ps(w0+k, mask);
+        const __m256 vw1 = _mm256_maskload_ps(w1+k, mask);
+        __m256 vx = _mm256_maskload_ps(x0+k, mask);
+        a00 = _mm256_fmadd_ps(vx, vw0, a00);
+        a01 = _mm256_fmadd_ps(vx, vw1, a01);
+        vx = _mm256_maskload_ps(x1+k, mask);
+        a10 = _mm256_fmadd_ps(vx, vw0, a10);
+        a11 = _mm256_fmadd_ps(vx, vw1, a11);
+        vx = _mm256_maskload_ps(x2+k, mask);
+        a20 = _mm256_fmadd_ps(vx, vw0, a20);
+        a21 = _mm256_fmadd_ps(vx, vw1, a21);
+        vx = _mm256_maskload_ps(x3+k, mask);
+        a30 = _mm256_fmadd_ps(vx, vw0, a30);
+        a31 = _mm256_fmadd_ps(vx, vw1, a31);
+      }
+
+      res[0] = hsum(a00); res[1] = hsum(a01);
+      res[2] = hsum(a10); res[3] = hsum(a11);
+      res[4] = hsum(a20); res[5] = hsum(a21);
+      res[6] = hsum(a30); res[7] = hsum(a31);
+    }
+
+
+    AVX2_TARGET void avx2Axpy(const float a, const float *x, float *y, const unsigned n)
+    {
+      const __m256 va = _mm256_set1_ps(a);
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8) _mm256_storeu_ps(y+k, _mm256_fmadd_ps(va, _mm256_loadu_ps(x+k), _mm256_loadu_ps(y+k)));
+      if (k < n)
+      {
+        const __m256i mask = tailMaskF(n-k);
+        _mm256_maskstore_ps(y+k, mask, _mm256_fmadd_ps(va, _mm256_maskload_ps(x+k, mask), _mm256_maskload_ps(y+k, mask)));
+      }
+    }
+
+    AVX2_TARGET inline int32_t hsumEpi32(const __m256i v)
+    {
+      __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+      return _mm_cvtsi128_si32(_mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1)));
+    }
+
+
+    AVX2_TARGET inline int64_t hsumEpi64(const __m256i v)
+    {
+      int64_t aux[2];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(aux), _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+      return aux[0] + aux[1];
+    }
+
+
+    AVX2_TARGET int32_t avx2IntDot8(const int8_t *x, const int8_t *y, const unsigned n)
+    {
+      __m256i acc = _mm256_setzero_si256();
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16)
+      {
+        const __m256i vx = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x+k)));
+        const __m256i vy = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y+k)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(vx, vy));
+      }
+      int32_t ret = hsumEpi32(acc);
+      for (; k<n; k++) ret += static_cast<int32_t>(x[k]) * y[k];
+      return ret;
+    }
+
+
+    AVX2_TARGET int64_t avx2IntDot16(const int16_t *x, const int16_t *y, const unsigned n)
+    {
+      //The values are within +/-32767, so each pair of products added by madd fits in 32 bits.
+      __m256i acc = _mm256_setzero_si256();
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16)
+      {
+        const __m256i p = _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x+k)),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y+k)));
+        acc = _mm256_add_epi64(acc, _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(p)),
+                                                     _mm256_cvtepi32_epi64(_mm256_extracti128_si256(p, 1))));
+      }
+      int64_t ret = hsumEpi64(acc);
+      for (; k<n; k++) ret += static_cast<int32_t>(x[k]) * y[k];
+      return ret;
+    }
+
+
+    /// Saturates 4 values at +/-qmax, with NaN mapped to 0.
+    AVX2_TARGET inline __m256d saturate(const __m256d v, const __m256d qmax, const __m256d qmin)
+    {
+      return _mm256_and_pd(_mm256_max_pd(_mm256_min_pd(v, qmax), qmin), _mm256_cmp_pd(v, v, _CMP_ORD_Q));
+    }
+
+
+    /// Quantizes 8 values (saturated at +/-qmax, and NaN to 0) to 16 bits integers.
+    AVX2_TARGET inline __m128i quantizeBlock(const double *x, const __m256d scale, const __m256d qmax)
+    {
+      const __m256d qmin = _mm256_sub_pd(_mm256_setzero_pd(), qmax);
+      const __m128i lo = _mm256_cvtpd_epi32(saturate(_mm256_mul_pd(_mm256_loadu_pd(x), scale), qmax, qmin));
+      const __m128i hi = _mm256_cvtpd_epi32(saturate(_mm256_mul_pd(_mm256_loadu_pd(x+4), scale), qmax, qmin));
+      return _mm_packs_epi32(lo, hi);
+    }
+
+
+    AVX2_TARGET void avx2Quantize8(const double *x, const double invScale, int8_t *q, const unsigned n)
+    {
+      const __m256d scale = _mm256_set1_pd(invScale);
+      const __m256d qmax = _mm256_set1_pd(127.);
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8)
+      {
+        const __m128i v = quantizeBlock(x+k, scale, qmax);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(q+k), _mm_packs_epi16(v, v));
+      }
+      SCALAR_QUANT_KERNELS.quantize8(x+k, invScale, q+k, n-k);
+    }
+
+
+    AVX2_TARGET void avx2Quantize16(const double *x, const double invScale, int16_t *q, const unsigned n)
+    {
+      const __m256d scale = _mm256_set1_pd(invScale);
+      const __m256d qmax = _mm256_set1_pd(32767.);
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8) _mm_storeu_si128(reinterpret_cast<__m128i*>(q+k), quantizeBlock(x+k, scale, qmax));
+      SCALAR_QUANT_KERNELS.quantize16(x+k, invScale, q+k, n-k);
+    }
+  }
+
+  const Kernels<double> AVX2_KERNELS = {"avx2", avx2Dot, avx2Dot4x2, avx2Axpy, avx2Axpy, avx2Axpy, avx2RProp,
+                                        loopSparseDot<double>, loopSparseDot4<double>, loopSparseAxpy<double>, loopSparseAccumulate<double>};
+
+  const Kernels<float> AVX2_KERNELS_F = {"avx2", avx2Dot, avx2Dot4x2, avx2Axpy,
+                                          loopAccumulate<float>, loopUpdate<float>, loopRProp<float>,
+                                          loopSparseDot<float>, loopSparseDot4<float>, loopSparseAxpy<float>, loopSparseAccumulate<float>};
+
+  const QuantKernels AVX2_QUANT_KERNELS = {"avx2", avx2IntDot8, avx2IntDot16, avx2Quantize8, avx2Quantize16};
+}
+
+#endif
@@ -0,0 +1,299 @@
+/**
+@file  kernels_avx512.cxx
+@brief Kernels implemented with AVX-512 (foundation) instructions.
+*/
+
+#include "fastnet/neuralnet/kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define AVX512_TARGET __attribute__((target("avx512f")))
+#define KERNEL_TARGET AVX512_TARGET
+#include "kernels_loops.hxx"
+
+namespace FastNet
+{
+  namespace
+  {
+    /// Mask selecting the first r (0 to 7) values of a vector.
+    AVX512_TARGET inline __mmask8 tailMask(const unsigned r)
+    {
+      return static_cast<__mmask8>((1u << r) - 1);
+    }
+
+
+    AVX512_TARGET double avx512Dot(const double *x, const double *y, const unsigned n)
+    {
+      __m512d acc = _mm512_setzero_pd();
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8) acc = _mm512_fmadd_pd(_mm512_loadu_pd(x+k), _mm512_loadu_pd(y+k), acc);
+      if (k < n)
+      {
+        const __mmask8 mask = tailMask(n-k);
+        acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, x+k), _mm512_maskz_loadu_pd(mask, y+k), acc);
+      }
+      return _mm512_reduce_add_pd(acc);
+    }
+
+
+    AVX512_TARGET void avx512Dot4x2(const double *x, const unsigned xStride, const double *w, const unsigned wStride, const unsigned n, double *res)
+    {
+      const double *x0 = x;
+      const double *x1 = x0 + xStride;
+      const double *x2 = x1 + xStride;
+      const double *x3 = x2 + xStride;
+      const double *w0 = w;
+      const double *w1 = w + wStride;
+      __m512d a00 = _mm512_setzero_pd(), a01 = _mm512_setzero_pd();
+      __m512d a10 = _mm512_setzero_pd(), a11 = _mm512_setzero_pd();
+      __m512d a20 = _mm512_setzero_pd(), a21 = _mm512_setzero_pd();
+      __m512d a30 = _mm512_setzero_pd(), a31 = _mm512_setzero_pd();
+
+      for (unsigned k=0; k<n; k+=8)
+      {
+        //The last iteration loads only the remaining values (same tail handling as in avx512Dot).
+        const __mmask8 mask = ((k+8) <= n) ? 0xFF : tailMask(n-k);
+        const __m512d vw0 = _mm512_maskz_loadu_pd(mask, w0+k);
+        const __m512d vw1 = _mm512_maskz_loadu_pd(mask, w1+k);
+        __m512d vx = _mm512_maskz_loadu_pd(mask, x0+k);
+        a00 = _mm512_fmadd_pd(vx, vw0, a00);
+        a01 = _mm512_fmadd_pd(vx, vw1, a01);
+        vx = _mm512_maskz_loadu_pd(mask, x1+k);
+        a10 = _mm512_fmadd_pd(vx, vw0, a10);
+        a11 = _mm512_fmadd_pd(vx, vw1, a11);
+        vx = _mm512_maskz_loadu_pd(mask, x2+k);
+        a20 = _mm512_fmadd_pd(vx, vw0, a20);
+        a21 = _mm512_fmadd_pd(vx, vw1, a21);
+        vx = _mm512_maskz_loadu_pd(mask, x3+k);
+        a30 = _mm512_fmadd_pd(vx, vw0, a30);
+        a31 = _mm512_fmadd_pd(vx, vw1, a31);
+      }
+
+      res[0] = _mm512_reduce_add_pd(a00); res[1] = _mm512_reduce_add_pd(a01);
+      res[2] = _mm512_reduce_add_pd(a10); res[3] = _mm512_reduce_add_pd(a11);
+      res[4] = _mm512_reduce_add_pd(a20); res[5] = _mm512_reduce_add_pd(a21);
+      res[6] = _mm512_reduce_add_pd(a30); res[7] = _mm512_reduce_add_pd(a31);
+    }
+
+
+    AVX512_TARGET void avx512Axpy(const double a, const double *x, double *y, const unsigned n)
+    {
+      const __m512d va = _mm512_set1_pd(a);
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8) _mm512_storeu_pd(y+k, _mm512_fmadd_pd(va, _mm512_loadu_pd(x+k), _mm512_loadu_pd(y+k)));
+      if (k < n)
+      {
+        const __mmask8 mask = tailMask(n-k);
+        _mm512_mask_storeu_pd(y+k, mask, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(mask, x+k), _mm512_maskz_loadu_pd(mask, y+k)));
+      }
+    }
+
+
+    AVX512_TARGET void avx512RProp(double *w, double *d, double *prevD, double *delta, const unsigned n,
+                                    const double incEta, const double decEta, const double deltaMin, const double deltaMax)
+    {
+      const __m512d zero = _mm512_setzero_pd();
+      const __m512d vInc = _mm512_set1_pd(incEta);
+      const __m512d vDec = _mm512_set1_pd(decEta);
+      const __m512d vMin = _mm512_set1_pd(deltaMin);
+      const __m512d vMax = _mm512_set1_pd(deltaMax);
+
+      for (unsigned k=0; k<n; k+=8)
+      {
+        const __mmask8 mask = ((k+8) <= n) ? 0xFF : tailMask(n-k);
+        const __m512d vd = _mm512_maskz_loadu_pd(mask, d+k);
+        const __m512d val = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, prevD+k), vd);
+        __m512d vDelta = _mm512_maskz_loadu_pd(mask, delta+k);
+        const __m512d up = _mm512_min_pd(_mm512_mul_pd(vDelta, vInc), vMax);
+        const __m512d down = _mm512_max_pd(_mm512_mul_pd(vDelta, vDec), vMin);
+        vDelta = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(val, zero, _CMP_GT_OQ), vDelta, up);
+        vDelta = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(val, zero, _CMP_LT_OQ), vDelta, down);
+        
+        //Moving the weights by +delta (positive gradient) or -delta (negative gradient).
+        __m512d vw = _mm512_maskz_loadu_pd(mask, w+k);
+        vw = _mm512_mask_add_pd(vw, _mm512_cmp_pd_mask(vd, zero, _CMP_GT_OQ), vw, vDelta);
+        vw = _mm512_mask_sub_pd(vw, _mm512_cmp_pd_mask(vd, zero, _CMP_LT_OQ), vw, vDelta);
+        
+        _mm512_mask_storeu_pd(w+k, mask, vw);
+        _mm512_mask_storeu_pd(delta+k, mask, vDelta);
+        _mm512_mask_storeu_pd(prevD+k, mask, vd);
+        _mm512_mask_storeu_pd(d+k, mask, zero);
+      }
+    }
+
+
+    /// Mask selecting the first r (0 to 15) single precision values of a vector.
+    AVX512_TARGET inline __mmask16 tailMaskF(const unsigned r)
+    {
+      return static_cast<__mmask16>((1u << r) - 1);
+    }
+
+
+    AVX512_TARGET float avx512Dot(const float *x, const float *y, const unsigned n)
+    {
+      __m512 acc = _mm512_setzero_ps();
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16) acc = _mm512_fmadd_ps(_mm512_loadu_ps(x+k), _mm512_loadu_ps(y+k), acc);
+      if (k < n)
+      {
+        const __mmask16 mask = tailMaskF(n-k);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x+k), _mm512_maskz_loadu_ps(mask, y+k), acc);
+      }
+      return _mm512_reduce_add_ps(acc);
+    }
+
+
+    AVX512_TARGET void avx512Dot4x2(const float *x, const unsigned xStride, const float *w, const unsigned wStride, const unsigned n, float *res)
+    {
+      const float *x0 = x;
+      const float *x1 = x0 + xStride;
+      const float *x2 = x1 + xStride;
+      const float *x3 = x2 + xStride;
+      const float *w0 = w;
+      const float *w1 = w + wStride;
+      __m512 a00 = _mm512_setzero_ps(), a01 = _mm512_setzero_ps();
+      __m512 a10 = _mm512_setzero_ps(), a11 = _mm512_setzero_ps();
+      __m512 a20 = _mm512_setzero_ps(), a21 = _mm512_setzero_ps();
+      __m512 a30 = _mm512_setzero_ps(), a31 = _mm512_setzero_ps();
+
+      for (unsigned k=0; k<n; k+=16)
+      {
+        //The last iteration loads only the remaining values (same tail handling as in avx512Dot).
+        const __mmask16 mask = ((k+16) <= n) ? 0xFFFF : tailMaskF(n-k);
+        const __m512 vw0 = _mm512_maskz_loadu_ps(mask, w0+k);
+        const __m512 vw1 = _mm512_maskz_loadu_ps(mask, w1+k);
+        __m512 vx = _mm512_maskz_loadu_ps(mask, x0+k);
+        a00 = _mm512_fmadd_ps(vx, vw0, a00);
+        a01 = _mm512_fmadd_ps(vx, vw1, a01);
+        vx = _mm512_maskz_loadu_ps(mask, x1+k);
+        a10 = _mm512_fmadd_ps(vx, vw0, a10);
+        a11 = _mm512_fmadd_ps(vx, vw1, a11);
+        vx = _mm512_maskz_loadu_ps(mask, x2+k);
+        a20 = _mm512_fmadd_ps(vx, vw0, a20);
+        a21 = _mm512_fmadd_ps(vx, vw1, a21);
+        vx = _mm512_maskz_loadu_ps(mask, x3+k);
+        a30 = _mm512_fmadd_ps(vx, vw0, a30);
+        a31 = _mm512_fmadd_ps(vx, vw1, a31);
+      }
+
+      res[0] = _mm512_reduce_add_ps(a00); res[1] = _mm512_reduce_add_ps(a01);
+      res[2] = _mm512_reduce_add_ps(a10); res[3] = _mm512_reduce_add_ps(a11);
+      res[4] = _mm512_reduce_add_ps(a20); res[5] = _mm512_reduce_add_ps(a21);
+      res[6] = _mm512_reduce_add_ps(a30); res[7] = _mm512_reduce_add_ps(a31);
+    }
+
+
+    AVX512_TARGET void avx512Axpy(const float a, const float *x, float *y, const unsigned n)
+    {
+      const __m512 va = _mm512_set1_ps(a);
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16) _mm512_storeu_ps(y+k, _mm512_fmadd_ps(va, _mm512_loadu_ps(x+k), _mm512_loadu_ps(y+k)));
+      if (k < n)
+      {
+        const __mmask16 mask = tailMaskF(n-k);
+        _mm512_mask_storeu_ps(y+k, mask, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(mask, x+k), _mm512_maskz_loadu_ps(mask, y+k)));
+      }
+    }
+
+    //AVX-512 foundation has no 8 and 16 bits integer instructions, so the
+    //integer kernels use the 256 bits AVX2 instructions it includes.
+    AVX512_TARGET inline int32_t hsumEpi32(const __m256i v)
+    {
+      __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+      return _mm_cvtsi128_si32(_mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1)));
+    }
+
+
+    AVX512_TARGET inline int64_t hsumEpi64(const __m256i v)
+    {
+      int64_t aux[2];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(aux), _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+      return aux[0] + aux[1];
+    }
+
+
+    AVX512_TARGET int32_t avx512IntDot8(const int8_t *x, const int8_t *y, const unsigned n)
+    {
+      __m256i acc = _mm256_setzero_si256();
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16)
+      {
+        const __m256i vx = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x+k)));
+        const __m256i vy = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y+k)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(vx, vy));
+      }
+      int32_t ret = hsumEpi32(acc);
+      for (; k<n; k++) ret += static_cast<int32_t>(x[k]) * y[k];
+      return ret;
+    }
+
+
+    AVX512_TARGET int64_t avx512IntDot16(const int16_t *x, const int16_t *y, const unsigned n)
+    {
+      //The values are within +/-32767, so each pair of products added by madd fits in 32 bits.
+      __m256i acc = _mm256_setzero_si256();
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16)
+      {
+        const __m256i p = _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x+k)),
+                                             _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y+k)));
+        acc = _mm256_add_epi64(acc, _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(p)),
+                                                     _mm256_cvtepi32_epi64(_mm256_extracti128_si256(p, 1))));
+      }
+      int64_t ret = hsumEpi64(acc);
+      for (; k<n; k++) ret += static_cast<int32_t>(x[k]) * y[k];
+      return ret;
+    }
+
+
+    /// Saturates 8 values at +/-qmax, with NaN mapped to 0.
+    AVX512_TARGET inline __m512d saturate(const __m512d v, const __m512d qmax, const __m512d qmin)
+    {
+      return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(v, v, _CMP_ORD_Q), _mm512_max_pd(_mm512_min_pd(v, qmax), qmin));
+    }
+
+
+    /// Quantizes 16 values (saturated at +/-qmax, and NaN to 0) to 32 bits integers.
+    AVX512_TARGET inline __m512i quantizeBlock(const double *x, const __m512d scale, const __m512d qmax)
+    {
+      const __m512d qmin = _mm512_sub_pd(_mm512_setzero_pd(), qmax);
+      const __m256i lo = _mm512_cvtpd_epi32(saturate(_mm512_mul_pd(_mm512_loadu_pd(x), scale), qmax, qmin));
+      const __m256i hi = _mm512_cvtpd_epi32(saturate(_mm512_mul_pd(_mm512_loadu_pd(x+8), scale), qmax, qmin));
+      return _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+    }
+
+
+    AVX512_TARGET void avx512Quantize8(const double *x, const double invScale, int8_t *q, const unsigned n)
+    {
+      const __m512d scale = _mm512_set1_pd(invScale);
+      const __m512d qmax = _mm512_set1_pd(127.);
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16) _mm_storeu_si128(reinterpret_cast<__m128i*>(q+k), _mm512_cvtepi32_epi8(quantizeBlock(x+k, scale, qmax)));
+      SCALAR_QUANT_KERNELS.quantize8(x+k, invScale, q+k, n-k);
+    }
+
+
+    AVX512_TARGET void avx512Quantize16(const double *x, const double invScale, int16_t *q, const unsigned n)
+    {
+      const __m512d scale = _mm512_set1_pd(invScale);
+      const __m512d qmax = _mm512_set1_pd(32767.);
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16) _mm256_storeu_si256(reinterpret_cast<__m256i*>(q+k), _mm512_cvtepi32_epi16(quantizeBlock(x+k, scale, qmax)));
+      SCALAR_QUANT_KERNELS.quantize16(x+k, invScale, q+k, n-k);
+    }
+  }
+
+  const Kernels<double> AVX512_KERNELS = {"avx512", avx512Dot, avx512Dot4x2, avx512Axpy, avx512Axpy, avx512Axpy, avx512RProp,
+                                          loopSparseDot<double>, loopSparseDot4<double>, loopSparseAxpy<double>, loopSparseAccumulate<double>};
+
+  const Kernels<float> AVX512_KERNELS_F = {"avx512", avx512Dot, avx512Dot4x2, avx512Axpy,
+                                            loopAccumulate<float>, loopUpdate<float>, loopRProp<float>,
+                                            loopSparseDot<float>, loopSparseDot4<float>, loopSparseAxpy<float>, loopSparseAccumulate<float>};
+
+  const QuantKernels AVX512_QUANT_KERNELS = {"avx512", avx512IntDot8, avx512IntDot16, avx512Quantize8, avx512Quantize16};
+}
+
+#endif
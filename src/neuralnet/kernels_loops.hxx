@@ -0,0 +1,123 @@
+/**
+@file  kernels_loops.hxx
+@brief Mixed precision kernels written as plain loops.
+
+  These kernels mix the storage precision with the ACC_REAL accumulators, which has no
+  direct SIMD counterpart. They are written without branches, so the compiler vectorizes
+  them for the instruction set of the file including this one. The including file must
+  define KERNEL_TARGET (the target attribute of its instruction set) before including it.
+*/
+
+#ifndef KERNELS_LOOPS_HXX
+#define KERNELS_LOOPS_HXX
+
+#include "fastnet/neuralnet/kernels.h"
+
+namespace FastNet
+{
+  namespace
+  {
+    template <class T>
+    KERNEL_TARGET void loopAccumulate(const ACC_REAL a, const T *x, ACC_REAL *y, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) y[k] += a * x[k];
+    }
+
+
+    template <class T>
+    KERNEL_TARGET void loopUpdate(const ACC_REAL a, const ACC_REAL *x, T *y, const unsigned n)
+    {
+      for (unsigned k=0; k<n; k++) y[k] = static_cast<T>(y[k] + a * x[k]);
+    }
+
+
+    template <class T>
+    KERNEL_TARGET void loopRProp(T *w, ACC_REAL *d, ACC_REAL *prevD, ACC_REAL *delta, const unsigned n,
+                                  const ACC_REAL incEta, const ACC_REAL decEta, const ACC_REAL deltaMin, const ACC_REAL deltaMax)
+    {
+      for (unsigned k=0; k<n; k++)
+      {
+        const ACC_REAL grad = d[k];
+        const ACC_REAL val = prevD[k] * grad;
+        const ACC_REAL inc = delta[k] * incEta;
+        const ACC_REAL dec = delta[k] * decEta;
+        const ACC_REAL up = (inc < deltaMax) ? inc : deltaMax;
+        const ACC_REAL down = (dec > deltaMin) ? dec : deltaMin;
+        const ACC_REAL newDelta = (val > 0.) ? up : ((val < 0.) ? down : delta[k]);
+        const ACC_REAL step = (grad > 0.) ? newDelta : ((grad < 0.) ? -newDelta : 0.);
+        w[k] = static_cast<T>(w[k] + step);
+        delta[k] = newDelta;
+        prevD[k] = grad;
+        d[k] = 0;
+      }
+    }
+
+
+    template <class T>
+    KERNEL_TARGET T loopSparseDot(const T *x, const T *w, const unsigned *cols, const unsigned nnz)
+    {
+      //Independent partial sums, so the gathers of consecutive columns overlap.
+      T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      unsigned k = 0;
+      for (; (k+4)<=nnz; k+=4)
+      {
+        s0 += x[cols[k]] * w[cols[k]];
+        s1 += x[cols[k+1]] * w[cols[k+1]];
+        s2 += x[cols[k+2]] * w[cols[k+2]];
+        s3 += x[cols[k+3]] * w[cols[k+3]];
+      }
+      for (; k<nnz; k++) s0 += x[cols[k]] * w[cols[k]];
+      return (s0 + s1) + (s2 + s3);
+    }
+
+
+    template <class T>
+    KERNEL_TARGET void loopSparseDot4(const T *x, const unsigned xStride, const T *w, const unsigned *cols, const unsigned nnz, T *res)
+    {
+      //The partial sums of each event are the same as in loopSparseDot.
+      const T *x1 = x + xStride;
+      const T *x2 = x1 + xStride;
+      const T *x3 = x2 + xStride;
+      T s[4][4] = {{0}};
+      unsigned k = 0;
+      for (; (k+4)<=nnz; k+=4)
+      {
+        for (unsigned p=0; p<4; p++)
+        {
+          const unsigned c = cols[k+p];
+          const T wc = w[c];
+          s[0][p] += x[c] * wc;
+          s[1][p] += x1[c] * wc;
+          s[2][p] += x2[c] * wc;
+          s[3][p] += x3[c] * wc;
+        }
+      }
+      for (; k<nnz; k++)
+      {
+        const unsigned c = cols[k];
+        const T wc = w[c];
+        s[0][0] += x[c] * wc;
+        s[1][0] += x1[c] * wc;
+        s[2][0] += x2[c] * wc;
+        s[3][0] += x3[c] * wc;
+      }
+      for (unsigned e=0; e<4; e++) res[e] = (s[e][0] + s[e][1]) + (s[e][2] + s[e][3]);
+    }
+
+
+    template <class T>
+    KERNEL_TARGET void loopSparseAxpy(const T a, const T *w, const unsigned *cols, const unsigned nnz, T *y)
+    {
+      for (unsigned k=0; k<nnz; k++) y[cols[k]] += a * w[cols[k]];
+    }
+
+
+    template <class T>
+    KERNEL_TARGET void loopSparseAccumulate(const ACC_REAL a, const T *x, const unsigned *cols, const unsigned nnz, ACC_REAL *y)
+    {
+      for (unsigned k=0; k<nnz; k++) y[cols[k]] += a * x[cols[k]];
+    }
+  }
+}
+
+#endif
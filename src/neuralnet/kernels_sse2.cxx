@@ -0,0 +1,316 @@
+/**
+@file  kernels_sse2.cxx
+@brief Kernels implemented with SSE2 instructions.
+*/
+
+#include "fastnet/neuralnet/kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define KERNEL_TARGET SSE2_TARGET
+#include "kernels_loops.hxx"
+
+namespace FastNet
+{
+  namespace
+  {
+    SSE2_TARGET inline double hsum(const __m128d v)
+    {
+      return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+
+
+    SSE2_TARGET double sse2Dot(const double *x, const double *y, const unsigned n)
+    {
+      __m128d acc = _mm_setzero_pd();
+      unsigned k = 0;
+      for (; (k+2)<=n; k+=2) acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(x+k), _mm_loadu_pd(y+k)));
+      double ret = hsum(acc);
+      for (; k<n; k++) ret += x[k] * y[k];
+      return ret;
+    }
+
+
+    SSE2_TARGET void sse2Dot4x2(const double *x, const unsigned xStride, const double *w, const unsigned wStride, const unsigned n, double *res)
+    {
+      const double *x0 = x;
+      const double *x1 = x0 + xStride;
+      const double *x2 = x1 + xStride;
+      const double *x3 = x2 + xStride;
+      const double *w0 = w;
+      const double *w1 = w + wStride;
+      __m128d a00 = _mm_setzero_pd(), a01 = _mm_setzero_pd();
+      __m128d a10 = _mm_setzero_pd(), a11 = _mm_setzero_pd();
+      __m128d a20 = _mm_setzero_pd(), a21 = _mm_setzero_pd();
+      __m128d a30 = _mm_setzero_pd(), a31 = _mm_setzero_pd();
+
+      unsigned k = 0;
+      for (; (k+2)<=n; k+=2)
+      {
+        const __m128d vw0 = _mm_loadu_pd(w0+k);
+        const __m128d vw1 = _mm_loadu_pd(w1+k);
+        __m128d vx = _mm_loadu_pd(x0+k);
+        a00 = _mm_add_pd(a00, _mm_mul_pd(vx, vw0));
+        a01 = _mm_add_pd(a01, _mm_mul_pd(vx, vw1));
+        vx = _mm_loadu_pd(x1+k);
+        a10 = _mm_add_pd(a10, _mm_mul_pd(vx, vw0));
+        a11 = _mm_add_pd(a11, _mm_mul_pd(vx, vw1));
+        vx = _mm_loadu_pd(x2+k);
+        a20 = _mm_add_pd(a20, _mm_mul_pd(vx, vw0));
+        a21 = _mm_add_pd(a21, _mm_mul_pd(vx, vw1));
+        vx = _mm_loadu_pd(x3+k);
+        a30 = _mm_add_pd(a30, _mm_mul_pd(vx, vw0));
+        a31 = _mm_add_pd(a31, _mm_mul_pd(vx, vw1));
+      }
+
+      res[0] = hsum(a00); res[1] = hsum(a01);
+      res[2] = hsum(a10); res[3] = hsum(a11);
+      res[4] = hsum(a20); res[5] = hsum(a21);
+      res[6] = hsum(a30); res[7] = hsum(a31);
+
+      //Same tail handling as in sse2Dot.
+      for (; k<n; k++)
+      {
+        res[0] += x0[k] * w0[k]; res[1] += x0[k] * w1[k];
+        res[2] += x1[k] * w0[k]; res[3] += x1[k] * w1[k];
+        res[4] += x2[k] * w0[k]; res[5] += x2[k] * w1[k];
+        res[6] += x3[k] * w0[k]; res[7] += x3[k] * w1[k];
+      }
+    }
+
+
+    SSE2_TARGET void sse2Axpy(const double a, const double *x, double *y, const unsigned n)
+    {
+      const __m128d va = _mm_set1_pd(a);
+      unsigned k = 0;
+      for (; (k+2)<=n; k+=2) _mm_storeu_pd(y+k, _mm_add_pd(_mm_loadu_pd(y+k), _mm_mul_pd(va, _mm_loadu_pd(x+k))));
+      for (; k<n; k++) y[k] += a * x[k];
+    }
+
+
+    SSE2_TARGET inline __m128d select(const __m128d mask, const __m128d a, const __m128d b)
+    {
+      return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+    }
+
+
+    SSE2_TARGET void sse2RProp(double *w, double *d, double *prevD, double *delta, const unsigned n,
+                                const double incEta, const double decEta, const double deltaMin, const double deltaMax)
+    {
+      const __m128d zero = _mm_setzero_pd();
+      const __m128d one = _mm_set1_pd(1.);
+      const __m128d vInc = _mm_set1_pd(incEta);
+      const __m128d vDec = _mm_set1_pd(decEta);
+      const __m128d vMin = _mm_set1_pd(deltaMin);
+      const __m128d vMax = _mm_set1_pd(deltaMax);
+
+      unsigned k = 0;
+      for (; (k+2)<=n; k+=2)
+      {
+        const __m128d vd = _mm_loadu_pd(d+k);
+        const __m128d val = _mm_mul_pd(_mm_loadu_pd(prevD+k), vd);
+        __m128d vDelta = _mm_loadu_pd(delta+k);
+        const __m128d up = _mm_min_pd(_mm_mul_pd(vDelta, vInc), vMax);
+        const __m128d down = _mm_max_pd(_mm_mul_pd(vDelta, vDec), vMin);
+        vDelta = select(_mm_cmpgt_pd(val, zero), up, vDelta);
+        vDelta = select(_mm_cmplt_pd(val, zero), down, vDelta);
+        const __m128d sign = _mm_sub_pd(_mm_and_pd(_mm_cmpgt_pd(vd, zero), one), _mm_and_pd(_mm_cmplt_pd(vd, zero), one));
+        _mm_storeu_pd(w+k, _mm_add_pd(_mm_loadu_pd(w+k), _mm_mul_pd(sign, vDelta)));
+        _mm_storeu_pd(delta+k, vDelta);
+        _mm_storeu_pd(prevD+k, vd);
+        _mm_storeu_pd(d+k, zero);
+      }
+      SCALAR_KERNELS.rprop(w+k, d+k, prevD+k, delta+k, n-k, incEta, decEta, deltaMin, deltaMax);
+    }
+
+
+    SSE2_TARGET inline float hsum(const __m128 v)
+    {
+      const __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+      return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+
+
+    SSE2_TARGET float sse2Dot(const float *x, const float *y, const unsigned n)
+    {
+      __m128 acc = _mm_setzero_ps();
+      unsigned k = 0;
+      for (; (k+4)<=n; k+=4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x+k), _mm_loadu_ps(y+k)));
+      float ret = hsum(acc);
+      for (; k<n; k++) ret += x[k] * y[k];
+      return ret;
+    }
+
+
+    SSE2_TARGET void sse2Dot4x2(const float *x, const unsigned xStride, const float *w, const unsigned wStride, const unsigned n, float *res)
+    {
+      const float *x0 = x;
+      const float *x1 = x0 + xStride;
+      const float *x2 = x1 + xStride;
+      const float *x3 = x2 + xStride;
+      const float *w0 = w;
+      const float *w1 = w + wStride;
+      __m128 a00 = _mm_setzero_ps(), a01 = _mm_setzero_ps();
+      __m128 a10 = _mm_setzero_ps(), a11 = _mm_setzero_ps();
+      __m128 a20 = _mm_setzero_ps(), a21 = _mm_setzero_ps();
+      __m128 a30 = _mm_setzero_ps(), a31 = _mm_setzero_ps();
+
+      unsigned k = 0;
+      for (; (k+4)<=n; k+=4)
+      {
+        const __m128 vw0 = _mm_loadu_ps(w0+k);
+        const __m128 vw1 = _mm_loadu_ps(w1+k);
+        __m128 vx = _mm_loadu_ps(x0+k);
+        a00 = _mm_add_ps(a00, _mm_mul_ps(vx, vw0));
+        a01 = _mm_add_ps(a01, _mm_mul_ps(vx, vw1));
+        vx = _mm_loadu_ps(x1+k);
+        a10 = _mm_add_ps(a10, _mm_mul_ps(vx, vw0));
+        a11 = _mm_add_ps(a11, _mm_mul_ps(vx, vw1));
+        vx = _mm_loadu_ps(x2+k);
+        a20 = _mm_add_ps(a20, _mm_mul_ps(vx, vw0));
+        a21 = _mm_add_ps(a21, _mm_mul_ps(vx, vw1));
+        vx = _mm_loadu_ps(x3+k);
+        a30 = _mm_add_ps(a30, _mm_mul_ps(vx, vw0));
+        a31 = _mm_add_ps(a31, _mm_mul_ps(vx, vw1));
+      }
+
+      res[0] = hsum(a00); res[1] = hsum(a01);
+      res[2] = hsum(a10); res[3] = hsum(a11);
+      res[4] = hsum(a20); res[5] = hsum(a21);
+      res[6] = hsum(a30); res[7] = hsum(a31);
+
+      //Same tail handling as in sse2Dot.
+      for (; k<n; k++)
+      {
+        res[0] += x0[k] * w0[k]; res[1] += x0[k] * w1[k];
+        res[2] += x1[k] * w0[k]; res[3] += x1[k] * w1[k];
+        res[4] += x2[k] * w0[k]; res[5] += x2[k] * w1[k];
+        res[6] += x3[k] * w0[k]; res[7] += x3[k] * w1[k];
+      }
+    }
+
+
+    SSE2_TARGET void sse2Axpy(const float a, const float *x, float *y, const unsigned n)
+    {
+      const __m128 va = _mm_set1_ps(a);
+      unsigned k = 0;
+      for (; (k+4)<=n; k+=4) _mm_storeu_ps(y+k, _mm_add_ps(_mm_loadu_ps(y+k), _mm_mul_ps(va, _mm_loadu_ps(x+k))));
+      for (; k<n; k++) y[k] += a * x[k];
+    }
+
+    SSE2_TARGET inline int32_t hsumEpi32(const __m128i v)
+    {
+      const __m128i s = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4e));
+      return _mm_cvtsi128_si32(_mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1)));
+    }
+
+
+    SSE2_TARGET inline int64_t hsumEpi64(const __m128i v)
+    {
+      int64_t aux[2];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(aux), v);
+      return aux[0] + aux[1];
+    }
+
+
+    /// Sign extends the 8 low bytes of a vector to 16 bits.
+    SSE2_TARGET inline __m128i extendLo(const __m128i v)
+    {
+      return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+    }
+
+
+    /// Sign extends the 8 high bytes of a vector to 16 bits.
+    SSE2_TARGET inline __m128i extendHi(const __m128i v)
+    {
+      return _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+    }
+
+
+    SSE2_TARGET int32_t sse2IntDot8(const int8_t *x, const int8_t *y, const unsigned n)
+    {
+      __m128i acc = _mm_setzero_si128();
+      unsigned k = 0;
+      for (; (k+16)<=n; k+=16)
+      {
+        const __m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x+k));
+        const __m128i vy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y+k));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(extendLo(vx), extendLo(vy)));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(extendHi(vx), extendHi(vy)));
+      }
+      int32_t ret = hsumEpi32(acc);
+      for (; k<n; k++) ret += static_cast<int32_t>(x[k]) * y[k];
+      return ret;
+    }
+
+
+    SSE2_TARGET int64_t sse2IntDot16(const int16_t *x, const int16_t *y, const unsigned n)
+    {
+      //The values are within +/-32767, so each pair of products added by madd fits in 32 bits.
+      __m128i acc = _mm_setzero_si128();
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8)
+      {
+        const __m128i p = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x+k)),
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(y+k)));
+        const __m128i sign = _mm_srai_epi32(p, 31);
+        acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_unpacklo_epi32(p, sign), _mm_unpackhi_epi32(p, sign)));
+      }
+      int64_t ret = hsumEpi64(acc);
+      for (; k<n; k++) ret += static_cast<int32_t>(x[k]) * y[k];
+      return ret;
+    }
+
+
+    /// Quantizes 8 values (saturated at +/-qmax, and NaN to 0) to 16 bits integers.
+    SSE2_TARGET inline __m128i quantizeBlock(const double *x, const __m128d scale, const __m128d qmax)
+    {
+      const __m128d qmin = _mm_sub_pd(_mm_setzero_pd(), qmax);
+      __m128i q[4];
+      for (unsigned i=0; i<4; i++)
+      {
+        const __m128d v = _mm_mul_pd(_mm_loadu_pd(x+2*i), scale);
+        q[i] = _mm_cvtpd_epi32(_mm_and_pd(_mm_max_pd(_mm_min_pd(v, qmax), qmin), _mm_cmpord_pd(v, v)));
+      }
+      return _mm_packs_epi32(_mm_unpacklo_epi64(q[0], q[1]), _mm_unpacklo_epi64(q[2], q[3]));
+    }
+
+
+    SSE2_TARGET void sse2Quantize8(const double *x, const double invScale, int8_t *q, const unsigned n)
+    {
+      const __m128d scale = _mm_set1_pd(invScale);
+      const __m128d qmax = _mm_set1_pd(127.);
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8)
+      {
+        const __m128i v = quantizeBlock(x+k, scale, qmax);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(q+k), _mm_packs_epi16(v, v));
+      }
+      SCALAR_QUANT_KERNELS.quantize8(x+k, invScale, q+k, n-k);
+    }
+
+
+    SSE2_TARGET void sse2Quantize16(const double *x, const double invScale, int16_t *q, const unsigned n)
+    {
+      const __m128d scale = _mm_set1_pd(invScale);
+      const __m128d qmax = _mm_set1_pd(32767.);
+      unsigned k = 0;
+      for (; (k+8)<=n; k+=8) _mm_storeu_si128(reinterpret_cast<__m128i*>(q+k), quantizeBlock(x+k, scale, qmax));
+      SCALAR_QUANT_KERNELS.quantize16(x+k, invScale, q+k, n-k);
+    }
+  }
+
+  const Kernels<double> SSE2_KERNELS = {"sse2", sse2Dot, sse2Dot4x2, sse2Axpy, sse2Axpy, sse2Axpy, sse2RProp,
+                                        loopSparseDot<double>, loopSparseDot4<double>, loopSparseAxpy<double>, loopSparseAccumulate<double>};
+
+  const Kernels<float> SSE2_KERNELS_F = {"sse2", sse2Dot, sse2Dot4x2, sse2Axpy,
+                                          loopAccumulate<float>, loopUpdate<float>, loopRProp<float>,
+                                          loopSparseDot<float>, loopSparseDot4<float>, loopSparseAxpy<float>, loopSparseAccumulate<float>};
+
+  const QuantKernels SSE2_QUANT_KERNELS = {"sse2", sse2IntDot8, sse2IntDot16, sse2Quantize8, sse2Quantize16};
+}
+
+#endif
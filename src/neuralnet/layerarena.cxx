@@ -0,0 +1,123 @@
+/**
+@file  layerarena.cxx
+@brief LayerArena class implementation file.
+*/
+
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "fastnet/neuralnet/layerarena.h"
+#include "fastnet/sys/Reporter.h"
+
+using namespace std;
+
+namespace FastNet
+{
+  template <class T>
+  LayerArena<T>::LayerArena()
+  {
+    block = params = NULL;
+    blockSize = pSize = nSize = 0;
+    numParamSets = numNodeSets = numLayers = 0;
+  }
+
+
+  template <class T>
+  LayerArena<T>::~LayerArena()
+  {
+    release();
+  }
+
+
+  template <class T>
+  void LayerArena<T>::release()
+  {
+    if (block) free(block);
+    block = params = NULL;
+    blockSize = pSize = nSize = 0;
+    numParamSets = numNodeSets = numLayers = 0;
+    strides.clear();
+    wLayerPtrs.clear();
+    wRowPtrs.clear();
+    bPtrs.clear();
+    nodePtrs.clear();
+  }
+
+
+  template <class T>
+  void LayerArena<T>::allocate(const vector<unsigned> &nNodes, const unsigned numParamSets, const unsigned numNodeSets,
+                                T *extParams)
+  {
+    release();
+
+    numLayers = nNodes.size() - 1;
+    this->numParamSets = numParamSets;
+    this->numNodeSets = numNodeSets;
+
+    //Calculating the layout of a single parameter set and a single node set.
+    vector<size_t> wOffset(numLayers), bOffset(numLayers);
+    size_t wSize = 0, bSize = 0, numRows = 0;
+    for (unsigned i=0; i<numLayers; i++)
+    {
+      strides.push_back(padded(nNodes[i]));
+      wOffset[i] = wSize;
+      bOffset[i] = bSize;
+      wSize += nNodes[i+1] * strides[i];
+      bSize += padded(nNodes[i+1]);
+      numRows += nNodes[i+1];
+    }
+    pSize = wSize + bSize;
+    nSize = bSize;
+    const size_t ownParams = (extParams) ? 0 : numParamSets*pSize;
+    blockSize = ownParams + numNodeSets*nSize;
+    DEBUG2("Allocating a layer arena of " << blockSize << " values (" << numParamSets << " parameter sets, " << numNodeSets << " node sets).");
+
+    void *mem = NULL;
+    if (posix_memalign(&mem, ALIGNMENT, std::max(blockSize, static_cast<size_t>(1))*sizeof(T))) throw bad_alloc();
+    block = static_cast<T*>(mem);
+    memset(block, 0, blockSize*sizeof(T));
+    params = (extParams) ? extParams : block;
+
+    //Creating the pointer tables (views) over the block.
+    wLayerPtrs.resize(numParamSets*numLayers);
+    wRowPtrs.resize(numParamSets*numRows);
+    bPtrs.resize(numParamSets*numLayers);
+    nodePtrs.resize(numNodeSets*numLayers);
+
+    for (unsigned s=0; s<numParamSets; s++)
+    {
+      T *params = getParams(s);
+      T **rows = &wRowPtrs[s*numRows];
+      for (unsigned i=0; i<numLayers; i++)
+      {
+        wLayerPtrs[s*numLayers + i] = rows;
+        for (unsigned j=0; j<nNodes[i+1]; j++) *rows++ = params + wOffset[i] + j*strides[i];
+        bPtrs[s*numLayers + i] = params + wSize + bOffset[i];
+      }
+    }
+
+    T *nodes = block + ownParams;
+    for (unsigned s=0; s<numNodeSets; s++)
+    {
+      for (unsigned i=0; i<numLayers; i++) nodePtrs[s*numLayers + i] = nodes + s*nSize + bOffset[i];
+    }
+  }
+
+
+  template <class T>
+  void LayerArena<T>::copy(const LayerArena<T> &arena)
+  {
+    //The parameter sets of any of the arenas may be external.
+    memcpy(params, arena.params, numParamSets*pSize*sizeof(T));
+    T *nodes = block + ((params == block) ? numParamSets*pSize : 0);
+    const T *srcNodes = arena.block + ((arena.params == arena.block) ? arena.numParamSets*arena.pSize : 0);
+    memcpy(nodes, srcNodes, numNodeSets*nSize*sizeof(T));
+  }
+
+
+  template class LayerArena<float>;
+  template class LayerArena<double>;
+}
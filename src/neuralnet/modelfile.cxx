@@ -0,0 +1,284 @@
+/**
+@file  modelfile.cxx
+@brief Binary model file writer and (memory mapped) reader implementation file.
+*/
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fastnet/neuralnet/modelfile.h"
+#include "fastnet/neuralnet/layerarena.h"
+
+using namespace std;
+
+namespace FastNet
+{
+  namespace
+  {
+    /// FNV-1a (64 bits) checksum of a memory block.
+    uint64_t checksum(const unsigned char *data, const size_t size)
+    {
+      uint64_t hash = 0xcbf29ce484222325ULL;
+      for (size_t k=0; k<size; k++)
+      {
+        hash ^= data[k];
+        hash *= 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+
+    /// Appends the bytes of a value to a buffer.
+    template <class V>
+    void append(vector<unsigned char> &buf, const V &val)
+    {
+      const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&val);
+      buf.insert(buf.end(), bytes, bytes + sizeof(V));
+    }
+
+
+    /// Appends a null terminated string to a buffer.
+    void appendString(vector<unsigned char> &buf, const string &str)
+    {
+      buf.insert(buf.end(), str.begin(), str.end());
+      buf.push_back(0);
+    }
+
+
+    /// Returns the size, in bytes, of a LayerArena parameter set.
+    /**
+     The size is computed in size_t (the layer sizes may come from an untrusted file, so
+     the padded row sizes and their products could wrap around in unsigned arithmetic).
+     @param[in] nNodes The number of nodes in each layer (including the input layer).
+     @param[in] maxSize The maximum acceptable size, in bytes.
+     @return The parameter set size, or 0 if it is larger than maxSize.
+    */
+    template <class T>
+    size_t paramSetSize(const vector<unsigned> &nNodes, const size_t maxSize = SIZE_MAX)
+    {
+      const size_t step = LayerArena<T>::ALIGNMENT / sizeof(T);
+      const size_t maxValues = maxSize / sizeof(T);
+      size_t ret = 0;
+      for (unsigned i=0; i<(nNodes.size()-1); i++)
+      {
+        if (!nNodes[i+1]) return 0;
+        const size_t rowSize = ((static_cast<size_t>(nNodes[i]) + step - 1) / step) * step;
+        const size_t biasSize = ((static_cast<size_t>(nNodes[i+1]) + step - 1) / step) * step;
+        if (rowSize > (maxValues - ret) / nNodes[i+1]) return 0;
+        ret += nNodes[i+1] * rowSize;
+        if (biasSize > (maxValues - ret)) return 0;
+        ret += biasSize;
+      }
+      return ret * sizeof(T);
+    }
+  }
+
+
+  template <class T>
+  void writeModel(const string &fileName, const BasicNeuralNetwork<T> &net, const vector< vector<bool> > &frozen)
+  {
+    DEBUG1("Writing the network to the model file " << fileName);
+    const unsigned numLayers = net.getNumLayers();
+    vector<unsigned> nNodes;
+    for (unsigned i=0; i<numLayers; i++) nNodes.push_back(net[i]);
+
+    //Metadata.
+    vector<unsigned char> body;
+    for (unsigned i=0; i<numLayers; i++) append(body, static_cast<uint32_t>(nNodes[i]));
+    for (unsigned i=0; i<(numLayers-1); i++) append(body, static_cast<uint8_t>(net.isUsingBias(i)));
+    for (unsigned i=0; i<(numLayers-1); i++)
+    {
+      for (unsigned j=0; j<nNodes[i+1]; j++) append(body, static_cast<uint8_t>((!frozen.empty()) && (frozen[i][j])));
+    }
+    appendString(body, net.getTrfPrecision());
+    for (unsigned i=0; i<(numLayers-1); i++) appendString(body, net.getTrfFunc(i));
+    const size_t metaSize = body.size();
+
+    //The weights and biases, in the LayerArena parameter set layout (zero padded rows).
+    const size_t paramOffset = LayerArena<T>::padded((sizeof(ModelFileHeader) + metaSize) / sizeof(T) + 1) * sizeof(T);
+    body.resize(paramOffset - sizeof(ModelFileHeader), 0);
+    const size_t paramSize = paramSetSize<T>(nNodes);
+    if (!paramSize) throw "The network is too large to be written to a model file!";
+    vector<T> params(paramSize / sizeof(T), 0);
+    size_t pos = 0;
+    for (unsigned i=0; i<(numLayers-1); i++)
+    {
+      for (unsigned j=0; j<nNodes[i+1]; j++, pos += LayerArena<T>::padded(nNodes[i]))
+      {
+        for (unsigned k=0; k<nNodes[i]; k++) params[pos + k] = net.getWeight(i, j, k);
+      }
+    }
+    for (unsigned i=0; i<(numLayers-1); i++)
+    {
+      for (unsigned j=0; j<nNodes[i+1]; j++) params[pos + j] = net.getBias(i, j);
+      pos += LayerArena<T>::padded(nNodes[i+1]);
+    }
+    const unsigned char *paramBytes = reinterpret_cast<const unsigned char*>(&params[0]);
+    body.insert(body.end(), paramBytes, paramBytes + params.size()*sizeof(T));
+
+    ModelFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic));
+    header.version = MODEL_FILE_VERSION;
+    header.byteOrder = MODEL_FILE_BYTE_ORDER;
+    header.valueSize = sizeof(T);
+    header.numLayers = numLayers;
+    header.metaSize = metaSize;
+    header.paramOffset = paramOffset;
+    header.paramSize = params.size()*sizeof(T);
+    header.checksum = checksum(&body[0], body.size());
+
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file) throw "Impossible to create the model file!";
+    const bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) && (fwrite(&body[0], body.size(), 1, file) == 1);
+    if ( (fclose(file) != 0) || (!ok) ) throw "Error writing the model file!";
+  }
+
+
+  template <class T>
+  void writeModel(const string &fileName, const BasicBackpropagation<T> &net)
+  {
+    vector< vector<bool> > frozen(net.getNumLayers()-1);
+    for (unsigned i=0; i<frozen.size(); i++)
+    {
+      for (unsigned j=0; j<net[i+1]; j++) frozen[i].push_back(net.isFrozen(i, j));
+    }
+    writeModel(fileName, static_cast<const BasicNeuralNetwork<T>&>(net), frozen);
+  }
+
+
+  ModelFile::ModelFile(const string &fileName, const bool verify)
+  {
+    DEBUG1("Mapping the model file " << fileName);
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) throw "Impossible to open the model file!";
+    struct stat info;
+    if ( (fstat(fd, &info) != 0) || (static_cast<size_t>(info.st_size) < sizeof(ModelFileHeader)) )
+    {
+      close(fd);
+      throw "Invalid model file!";
+    }
+
+    //Privately mapped: changes to the weights are kept in memory only.
+    memSize = info.st_size;
+    mem = mmap(NULL, memSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) throw "Impossible to map the model file!";
+    header = static_cast<const ModelFileHeader*>(mem);
+
+    try
+    {
+      if (memcmp(header->magic, MODEL_FILE_MAGIC, sizeof(header->magic))) throw "Invalid model file!";
+      if (header->byteOrder != MODEL_FILE_BYTE_ORDER) throw "The model file was written with another byte order!";
+      if (header->version != MODEL_FILE_VERSION) throw "Unsupported model file version!";
+      if ( (header->valueSize != sizeof(float)) && (header->valueSize != sizeof(double)) ) throw "Invalid model file!";
+      if ( (header->numLayers < 2) || (header->paramOffset % LayerArena<double>::ALIGNMENT)
+          || (header->metaSize > memSize) || (header->paramOffset < (sizeof(ModelFileHeader) + header->metaSize))
+          || (header->paramOffset > memSize) || (header->paramSize != (memSize - header->paramOffset)) )
+      {
+        throw "Invalid model file!";
+      }
+
+      const unsigned char *body = static_cast<const unsigned char*>(mem) + sizeof(ModelFileHeader);
+      if ( (verify) && (checksum(body, memSize - sizeof(ModelFileHeader)) != header->checksum) )
+      {
+        throw "Model file checksum mismatch (the file is corrupted)!";
+      }
+
+      readMetadata();
+      //The layer sizes are untrusted: the parameter set they describe must fit in the mapped file.
+      const size_t maxSize = memSize - header->paramOffset;
+      const size_t expected = (header->valueSize == sizeof(float)) ? paramSetSize<float>(nNodes, maxSize) : paramSetSize<double>(nNodes, maxSize);
+      if ( (!expected) || (header->paramSize != expected) ) throw "Invalid model file!";
+    }
+    catch (const char *)
+    {
+      munmap(mem, memSize);
+      throw;
+    }
+  }
+
+
+  ModelFile::~ModelFile()
+  {
+    munmap(mem, memSize);
+  }
+
+
+  void ModelFile::readMetadata()
+  {
+    const unsigned char *pos = static_cast<const unsigned char*>(mem) + sizeof(ModelFileHeader);
+    const unsigned char *end = pos + header->metaSize;
+    const unsigned numLayers = header->numLayers;
+
+    if (static_cast<size_t>(end - pos) < numLayers*sizeof(uint32_t) + (numLayers-1)) throw "Invalid model file!";
+    for (unsigned i=0; i<numLayers; i++, pos += sizeof(uint32_t))
+    {
+      uint32_t val;
+      memcpy(&val, pos, sizeof(val));
+      if (!val) throw "Invalid model file!";
+      nNodes.push_back(val);
+    }
+    for (unsigned i=0; i<(numLayers-1); i++) usingBias.push_back(*pos++ != 0);
+
+    frozen.resize(numLayers-1);
+    for (unsigned i=0; i<(numLayers-1); i++)
+    {
+      if (static_cast<size_t>(end - pos) < nNodes[i+1]) throw "Invalid model file!";
+      for (unsigned j=0; j<nNodes[i+1]; j++) frozen[i].push_back(*pos++ != 0);
+    }
+
+    //The strings must be terminated inside the metadata.
+    for (unsigned i=0; i<numLayers; i++)
+    {
+      const unsigned char *term = static_cast<const unsigned char*>(memchr(pos, 0, end - pos));
+      if (!term) throw "Invalid model file!";
+      const string str(reinterpret_cast<const char*>(pos));
+      if (i) trfFunc.push_back(str);
+      else trfPrecision = str;
+      pos = term + 1;
+    }
+  }
+
+
+  template <class T>
+  BasicNeuralNetwork<T> *ModelFile::getNetwork() const
+  {
+    char *params = static_cast<char*>(mem) + header->paramOffset;
+
+    //Same precision: the network uses the mapped weights.
+    if (header->valueSize == sizeof(T))
+    {
+      BasicNeuralNetwork<T> *ret = new BasicNeuralNetwork<T>(nNodes, trfFunc, usingBias, reinterpret_cast<T*>(params));
+      ret->setTrfPrecision(trfPrecision);
+      return ret;
+    }
+
+    //Other precision: the weights are converted from a temporary view of the mapped weights.
+    if (header->valueSize == sizeof(double))
+    {
+      BasicNeuralNetwork<double> view(nNodes, trfFunc, usingBias, reinterpret_cast<double*>(params));
+      view.setTrfPrecision(trfPrecision);
+      return new BasicNeuralNetwork<T>(view);
+    }
+    BasicNeuralNetwork<float> view(nNodes, trfFunc, usingBias, reinterpret_cast<float*>(params));
+    view.setTrfPrecision(trfPrecision);
+    return new BasicNeuralNetwork<T>(view);
+  }
+
+
+  template void writeModel(const string &fileName, const BasicNeuralNetwork<float> &net, const vector< vector<bool> > &frozen);
+  template void writeModel(const string &fileName, const BasicNeuralNetwork<double> &net, const vector< vector<bool> > &frozen);
+  template void writeModel(const string &fileName, const BasicBackpropagation<float> &net);
+  template void writeModel(const string &fileName, const BasicBackpropagation<double> &net);
+  template BasicNeuralNetwork<float> *ModelFile::getNetwork<float>() const;
+  template BasicNeuralNetwork<double> *ModelFile::getNetwork<double>() const;
+}
@@ -1,6 +1,6 @@
 /**
 @file  neuralnetwork.cpp
-@brief NeuralNetwork class implementation file.
+@brief BasicNeuralNetwork class template implementation file.
 */
 
 #include <iostream>
@@ -9,14 +9,17 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 #include "fastnet/neuralnet/neuralnetwork.h"
+#include "fastnet/neuralnet/kernels.h"
 
 using namespace std;
 
 namespace FastNet
 {
-  NeuralNetwork::NeuralNetwork(const NeuralNetwork &net)
+  template <class T>
+  BasicNeuralNetwork<T>::BasicNeuralNetwork(const BasicNeuralNetwork &net)
   {
     //Allocating the memory for the values.
     try {allocateSpace(net.nNodes);}
@@ -25,7 +28,8 @@ namespace FastNet
   }
 
 
-  void NeuralNetwork::operator=(const NeuralNetwork &net)
+  template <class T>
+  void BasicNeuralNetwork<T>::operator=(const BasicNeuralNetwork &net)
   {
     nNodes.clear();
     usingBias.clear();
@@ -33,20 +37,22 @@ namespace FastNet
     nNodes.assign(net.nNodes.begin(), net.nNodes.end());
     usingBias.assign(net.usingBias.begin(), net.usingBias.end());
     trfFunc.assign(net.trfFunc.begin(), net.trfFunc.end());
+    trfPrecision = net.trfPrecision;
+    sparse.assign(net.sparse.begin(), net.sparse.end());
       
     layerOutputs[0] = net.layerOutputs[0]; // This will be a pointer to the input event.
-    for (unsigned i=0; i<(nNodes.size()-1); i++)
-    {
-      memcpy(bias[i], net.bias[i], nNodes[i+1]*sizeof(REAL));
-      memcpy(layerOutputs[i+1], net.layerOutputs[i+1], nNodes[i+1]*sizeof(REAL));
-      for (unsigned j=0; j<nNodes[i+1]; j++) memcpy(weights[i][j], net.weights[i][j], nNodes[i]*sizeof(REAL));
-    } 
+    
+    //Weights, biases and layer outputs are copied all at once.
+    arena.copy(net.arena);
   }
 
   
-  NeuralNetwork::NeuralNetwork(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias)
+  template <class T>
+  BasicNeuralNetwork<T>::BasicNeuralNetwork(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias,
+                                              T *extParams)
   {
         DEBUG1("Initializing the NeuralNetwork class from scratch.");
+        trfPrecision = TRF_EXACT_ID;
 
         //Getting the number of nodes and transfer function in each layer:
         int layer = 0;
@@ -62,53 +68,52 @@ namespace FastNet
                 DEBUG2("Layer " << (layer) << " is using bias? " << this->usingBias[layer-1]);
       
                 //Getting the transfer function
-                const string transFunction = trfFunc[layer-1];
-                if (transFunction == TGH_ID)
-                {
-                    this->trfFunc.push_back(&NeuralNetwork::hyperbolicTangent);
-                    DEBUG2("Transfer function in layer " << (layer) << ": tanh");
-                }
-                else if (transFunction == LIN_ID)
-                {
-                    this->trfFunc.push_back(&NeuralNetwork::linear);
-                    DEBUG2("Transfer function in layer " << (layer) << ": purelin");
-                }
-                else throw "Transfer function not specified!";
+                const Activation<T> *act = getActivation<T>(trfFunc[layer-1]);
+                if (!act) throw "Transfer function not specified!";
+                this->trfFunc.push_back(act);
+                DEBUG2("Transfer function in layer " << (layer) << ": " << act->id);
             }
             
             layer++;
         }
     
         //Allocating the memory for the other values.
-        try {allocateSpace(nNodes);}
+        try {allocateArena(nNodes, extParams);}
         catch (bad_alloc xa) {throw;}
     
         // This will be a pointer to the input event.
         layerOutputs[0] = NULL;    
+
+        //External weights are already set.
+        if (extParams) updateSparsity();
   }
 
 
 
-  void NeuralNetwork::allocateSpace(const vector<unsigned> &nNodes)
+  template <class T>
+  void BasicNeuralNetwork<T>::allocateSpace(const vector<unsigned> &nNodes)
+  {
+    try {allocateArena(nNodes, NULL);}
+    catch (bad_alloc xa) {throw;}
+  }
+
+
+  template <class T>
+  void BasicNeuralNetwork<T>::allocateArena(const vector<unsigned> &nNodes, T *extParams)
   {
     DEBUG2("Allocating all the space that the NeuralNetwork class will need.");
     try
     {
-      layerOutputs = new REAL* [nNodes.size()];
+      arena.allocate(nNodes, 1, 1, extParams);
+      weights = arena.getWeights(0);
+      bias = arena.getBias(0);
+
+      layerOutputs = new T* [nNodes.size()];
       layerOutputs[0] = NULL; // This will be a pointer to the input event.
-    
-      const unsigned size = nNodes.size()-1;
-      
-      bias = new REAL* [size];
-      weights = new REAL** [size];
+      for (unsigned i=0; i<(nNodes.size()-1); i++) layerOutputs[i+1] = arena.getNodes(0)[i];
 
-      for (unsigned i=0; i<size; i++)
-      {
-        bias[i] = new REAL [nNodes[i+1]];
-        layerOutputs[i+1] = new REAL [nNodes[i+1]];
-        weights[i] = new REAL* [nNodes[i+1]];
-        for (unsigned j=0; j<nNodes[i+1]; j++) weights[i][j] = new REAL [nNodes[i]];
-      }
+      //Every layer starts dense.
+      sparse.assign(nNodes.size()-1, SparseLayer());
     }
     catch (bad_alloc xa)
     {
@@ -117,32 +122,23 @@ namespace FastNet
   }
   
 
-  NeuralNetwork::~NeuralNetwork()
+  template <class T>
+  BasicNeuralNetwork<T>::~BasicNeuralNetwork()
   {
     DEBUG2("Releasing all memory allocated by NeuralNetwork.");
-    const unsigned size = nNodes.size() - 1;
-
-    // Deallocating the bias and weight matrices.
-    releaseMatrix(bias);
-    releaseMatrix(weights);
-    
-    // Deallocating the hidden outputs matrix.
-    if (layerOutputs)
-    {
-      for (unsigned i=1; i<size; i++)
-      {
-        if (layerOutputs[i]) delete [] layerOutputs[i];
-      }
 
-      delete [] layerOutputs;
-    }
+    // The weights, bias and outputs values are released by the arena.
+    // Only the outputs pointer table must be released.
+    if (layerOutputs) delete [] layerOutputs;
   }
   
   
-  void NeuralNetwork::showInfo() const
+  template <class T>
+  void BasicNeuralNetwork<T>::showInfo() const
   {
     REPORT("NEURAL NETWORK CONFIGURATION INFO");
     REPORT("Number of Layers (including the input): " << nNodes.size());
+    REPORT("Transfer functions precision: " << trfPrecision);
     
     for (unsigned i=0; i<nNodes.size(); i++)
     {
@@ -152,84 +148,253 @@ namespace FastNet
       if (i)
       {
         std::ostringstream aux;
-        aux << "Transfer function : ";
-        if (trfFunc[(i-1)] == (&NeuralNetwork::hyperbolicTangent)) aux << "tanh";
-        else if (trfFunc[(i-1)] == (&NeuralNetwork::linear)) aux << "purelin";
-        else aux << "UNKNOWN!";
+        aux << "Transfer function : " << trfFunc[(i-1)]->id;
 
         aux << "\nUsing bias        : ";
         if (usingBias[(i-1)]) aux << "true";
         else  aux << "false";
+
+        aux << "\nSparse kernels    : ";
+        if (isSparse(i-1)) aux << "true (" << sparse[i-1].getNumNonZero() << " nonzero weights)";
+        else aux << "false";
         REPORT(aux.str());
       }      
     }
   }
 
 
-  const REAL* NeuralNetwork::propagateInput(const REAL *input)
+  template <class T>
+  void BasicNeuralNetwork<T>::setTrfPrecision(const string &precision)
+  {
+    if ( (precision != TRF_EXACT_ID) && (precision != TRF_RATIONAL_ID) && (precision != TRF_TABLE_ID) )
+    {
+      throw "Invalid transfer function precision mode!";
+    }
+
+    DEBUG2("Setting the transfer functions precision mode to " << precision);
+    trfPrecision = precision;
+    for (unsigned i=0; i<trfFunc.size(); i++) trfFunc[i] = getActivation<T>(trfFunc[i]->id, precision);
+  }
+
+
+  template <class T>
+  void BasicNeuralNetwork<T>::updateSparsity()
+  {
+    const REAL threshold = (sizeof(T) == sizeof(float)) ? (1. + SPARSE_THRESHOLD) / 2. : SPARSE_THRESHOLD;
+    for (unsigned i=0; i<(nNodes.size()-1); i++)
+    {
+      const REAL val = SparseLayer::sparsity(weights[i], nNodes[i], nNodes[i+1]);
+      sparse[i] = ( (val > threshold) && (hasFixedZeros(i)) ) ? SparseLayer(weights[i], nNodes[i], nNodes[i+1]) : SparseLayer();
+      DEBUG2("Layer " << i << " sparsity: " << val << ((isSparse(i)) ? " (sparse kernels)" : " (dense kernels)"));
+    }
+  }
+
+
+  template <class T>
+  const T* BasicNeuralNetwork<T>::propagateInput(const T *input)
   {
     const unsigned size = (nNodes.size() - 1);
+    const Kernels<T> &kernels = getKernels<T>();
 
     //Placing the input. though we are removing the const' ness no changes are perfomed.
-    layerOutputs[0] = const_cast<REAL*>(input);
+    layerOutputs[0] = const_cast<T*>(input);
 
     //Propagating the input through the network.
     for (unsigned i=0; i<size; i++)
     {
-      for (unsigned j=0; j<nNodes[i+1]; j++)
+      if (isSparse(i))
       {
-        layerOutputs[i+1][j] = bias[i][j];
-        
-        for (unsigned k=0; k<nNodes[i]; k++)
+        const SparseLayer &sp = sparse[i];
+        for (unsigned j=0; j<nNodes[i+1]; j++)
         {
-          layerOutputs[i+1][j] += layerOutputs[i][k] * weights[i][j][k];
+          layerOutputs[i+1][j] = bias[i][j] + kernels.sparseDot(layerOutputs[i], weights[i][j], sp.getCols(j), sp.getNumCols(j));
+        }
+      }
+      else
+      {
+        for (unsigned j=0; j<nNodes[i+1]; j++)
+        {
+          layerOutputs[i+1][j] = bias[i][j] + kernels.dot(layerOutputs[i], weights[i][j], nNodes[i]);
         }
-
-        layerOutputs[i+1][j] = CALL_TRF_FUNC(trfFunc[i])(layerOutputs[i+1][j], false);
       }
+      trfFunc[i]->apply(layerOutputs[i+1], nNodes[i+1]);
     }
     
     //Returning the network's output.
     return layerOutputs[size];
   }
-  
 
-  void NeuralNetwork::releaseMatrix(REAL **b)
+
+  template <class T>
+  const T* BasicNeuralNetwork<T>::propagateInput(const T *input, Workspace &ws) const
+  {
+    const unsigned size = (nNodes.size() - 1);
+    const Kernels<T> &kernels = getKernels<T>();
+
+    //The hidden layers outputs are kept in the two workspace buffers, used alternately.
+    const T *in = input;
+    for (unsigned i=0; i<size; i++)
+    {
+      T *out = (i == (size-1)) ? &ws.output[0] : &ws.buffer[(i%2)*ws.bufferSize];
+      if (isSparse(i))
+      {
+        const SparseLayer &sp = sparse[i];
+        for (unsigned j=0; j<nNodes[i+1]; j++) out[j] = bias[i][j] + kernels.sparseDot(in, weights[i][j], sp.getCols(j), sp.getNumCols(j));
+      }
+      else
+      {
+        for (unsigned j=0; j<nNodes[i+1]; j++) out[j] = bias[i][j] + kernels.dot(in, weights[i][j], nNodes[i]);
+      }
+      trfFunc[i]->apply(out, nNodes[i+1]);
+      in = out;
+    }
+
+    return &ws.output[0];
+  }
+
+
+  template <class T>
+  void BasicNeuralNetwork<T>::propagateBatch(const T *inputs, const size_t nEvents, T *outputs) const
+  {
+    Workspace ws(*this);
+    propagateBatch(inputs, nEvents, outputs, ws);
+  }
+
+
+  template <class T>
+  void BasicNeuralNetwork<T>::propagateBatch(const T *inputs, const size_t nEvents, T *outputs, Workspace &ws) const
   {
-    if (b)
+    const unsigned size = (nNodes.size() - 1);
+    const unsigned inputSize = nNodes[0];
+    const unsigned outputSize = nNodes[size];
+
+    //The hidden layers outputs of a block are kept in the two workspace buffers, used alternately.
+    for (size_t ev=0; ev<nEvents; ev+=BATCH_BLOCK)
     {
-      for (int i=0; i<(nNodes.size()-1); i++)
+      const unsigned blockSize = static_cast<unsigned>(std::min(static_cast<size_t>(BATCH_BLOCK), nEvents - ev));
+      const T *in = inputs + ev*inputSize;
+      unsigned inStride = inputSize;
+
+      for (unsigned i=0; i<size; i++)
       {
-        if (b[i]) delete [] b[i];
+        //The last layer writes directly to the output matrix.
+        const bool isLast = (i == (size-1));
+        T *out = (isLast) ? outputs + ev*outputSize : &ws.buffer[(i%2)*ws.bufferSize];
+        const unsigned outStride = (isLast) ? outputSize : LayerArena<T>::padded(nNodes[i+1]);
+
+        propagateLayerBatch(i, in, inStride, blockSize, out, outStride);
+        in = out;
+        inStride = outStride;
       }
-      delete [] b;
-      b = NULL;
     }
   }
 
 
-  void NeuralNetwork::releaseMatrix(REAL ***w)
+  template <class T>
+  void BasicNeuralNetwork<T>::propagateLayerBatch(const unsigned layer, const T *in, const unsigned inStride, 
+                                                 const unsigned nEvents, T *out, const unsigned outStride) const
   {
-    if (w)
+    if (!isSparse(layer))
+    {
+      propagateLayerBatch(weights[layer], arena.getStride(layer), bias[layer], trfFunc[layer],
+                            nNodes[layer], nNodes[layer+1], in, inStride, nEvents, out, outStride);
+      return;
+    }
+
+    //Sparse layers: the events are processed in groups of 4 (Kernels::sparseDot4), so each weight
+    //and column index is loaded once per group. Since the inputs are not read sequentially, the
+    //next group is explicitly prefetched.
+    const SparseLayer &sp = sparse[layer];
+    const Kernels<T> &kernels = getKernels<T>();
+    const unsigned nIn = nNodes[layer];
+    const unsigned nOut = nNodes[layer+1];
+    const unsigned lineSize = LayerArena<T>::ALIGNMENT / sizeof(T);
+    const T * const *w = weights[layer];
+    const T *b = bias[layer];
+    const Activation<T> *trf = trfFunc[layer];
+
+    unsigned e = 0;
+    for (; (e+4)<=nEvents; e+=4)
     {
-      for (int i=0; i<(nNodes.size()-1); i++)
+      const T *x = in + e*inStride;
+      T *y = out + e*outStride;
+      for (unsigned t=4; (t<8) && ((e+t)<nEvents); t++)
+      {
+        for (unsigned k=0; k<nIn; k+=lineSize) __builtin_prefetch(x + t*inStride + k);
+      }
+
+      for (unsigned j=0; j<nOut; j++)
       {
-        if (w[i])
+        T acc[4];
+        kernels.sparseDot4(x, inStride, w[j], sp.getCols(j), sp.getNumCols(j), acc);
+        for (unsigned t=0; t<4; t++) y[t*outStride + j] = b[j] + acc[t];
+      }
+      for (unsigned t=0; t<4; t++) trf->apply(y + t*outStride, nOut);
+    }
+
+    //Remaining events (block size not multiple of 4).
+    for (; e<nEvents; e++)
+    {
+      const T *x = in + e*inStride;
+      T *y = out + e*outStride;
+      for (unsigned j=0; j<nOut; j++) y[j] = b[j] + kernels.sparseDot(x, w[j], sp.getCols(j), sp.getNumCols(j));
+      trf->apply(y, nOut);
+    }
+  }
+
+
+  template <class T>
+  void BasicNeuralNetwork<T>::propagateLayerBatch(const T * const *w, const unsigned wStride, const T *b, const Activation<T> *trf,
+                                                 const unsigned nIn, const unsigned nOut, const T *in, const unsigned inStride,
+                                                 const unsigned nEvents, T *out, const unsigned outStride)
+  {
+    const Kernels<T> &kernels = getKernels<T>();
+
+    //The dot products are computed by the same kernels used by propagateInput,
+    //so the results are bit by bit equal to the ones from propagateInput.
+    unsigned e = 0;
+    for (; (e+4)<=nEvents; e+=4)
+    {
+      const T *x = in + e*inStride;
+      T *y = out + e*outStride;
+
+      unsigned j = 0;
+      for (; (j+2)<=nOut; j+=2)
+      {
+        T acc[8];
+        kernels.dot4x2(x, inStride, w[j], wStride, nIn, acc);
+        const T b0 = (b) ? b[j] : 0;
+        const T b1 = (b) ? b[j+1] : 0;
+        for (unsigned t=0; t<4; t++)
         {
-          for (int j=0; j<nNodes[i+1]; j++)
-          {
-            if (w[i][j]) delete [] w[i][j];
-          }
-          delete [] w[i];
+          y[t*outStride + j] = b0 + acc[2*t];
+          y[t*outStride + j+1] = b1 + acc[2*t+1];
         }
       }
-      delete [] w;
-      w = NULL;
+
+      //Remaining node (odd layer size).
+      for (; j<nOut; j++)
+      {
+        const T b0 = (b) ? b[j] : 0;
+        for (unsigned t=0; t<4; t++) y[t*outStride + j] = b0 + kernels.dot(x + t*inStride, w[j], nIn);
+      }
+
+      if (trf) for (unsigned t=0; t<4; t++) trf->apply(y + t*outStride, nOut);
     }
-  }
 
+    //Remaining events (block size not multiple of 4).
+    for (; e<nEvents; e++)
+    {
+      const T *x = in + e*inStride;
+      T *y = out + e*outStride;
+      for (unsigned j=0; j<nOut; j++) y[j] = ((b) ? b[j] : 0) + kernels.dot(x, w[j], nIn);
+      if (trf) trf->apply(y, nOut);
+    }
+  }
+  
 
-  void NeuralNetwork::setUsingBias(const unsigned layer, const bool val)
+  template <class T>
+  void BasicNeuralNetwork<T>::setUsingBias(const unsigned layer, const bool val)
   {
     usingBias[layer] = val;
     
@@ -244,7 +409,8 @@ namespace FastNet
     }
   }
   
-  void NeuralNetwork::readWeights(const REAL ***w, const REAL **b)
+  template <class T>
+  void BasicNeuralNetwork<T>::readWeights(const T ***w, const T **b)
   {
     DEBUG1("Reading passed wight and bias.");
     for (unsigned i=0; i<(nNodes.size()-1); i++)
@@ -260,5 +426,10 @@ namespace FastNet
         DEBUG3("Bias[" << i << "][" << j << "] = " << bias[i][j]);
       }
     }
+    updateSparsity();
   }
+
+
+  template class BasicNeuralNetwork<float>;
+  template class BasicNeuralNetwork<double>;
 }
@@ -0,0 +1,344 @@
+/**
+@file  quantizednetwork.cxx
+@brief BasicQuantizedNetwork class template implementation file.
+*/
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+
+#include "fastnet/neuralnet/quantizednetwork.h"
+#include "fastnet/neuralnet/kernels.h"
+#include "fastnet/neuralnet/roc.h"
+
+using namespace std;
+
+namespace FastNet
+{
+  namespace
+  {
+    /// Quantizes a value (already divided by its scale), saturating at +/-QMAX.
+    /**
+     Rounds as the quantization kernels (to the nearest integer, ties to even), and maps NaN to 0, as they do.
+    */
+    template <class Q>
+    inline Q quantize(const REAL val)
+    {
+      const REAL QMAX = QuantTraits<Q>::QMAX;
+      if (std::isnan(val)) return 0;
+      return static_cast<Q>(lrint(std::min(std::max(val, -QMAX), QMAX)));
+    }
+
+
+    /// Integer dot products, selecting the kernel by the quantized type.
+    inline int32_t intDot(const QuantKernels &kernels, const int8_t *x, const int8_t *w, const unsigned n)
+    {
+      return kernels.dot8(x, w, n);
+    }
+
+    inline int64_t intDot(const QuantKernels &kernels, const int16_t *x, const int16_t *w, const unsigned n)
+    {
+      return kernels.dot16(x, w, n);
+    }
+
+
+    /// Vector quantization, selecting the kernel by the quantized type.
+    inline void quantizeVec(const QuantKernels &kernels, const REAL *x, const REAL invScale, int8_t *q, const unsigned n)
+    {
+      kernels.quantize8(x, invScale, q, n);
+    }
+
+    inline void quantizeVec(const QuantKernels &kernels, const REAL *x, const REAL invScale, int16_t *q, const unsigned n)
+    {
+      kernels.quantize16(x, invScale, q, n);
+    }
+
+
+    /// Returns the scale mapping a maximum magnitude to QMAX.
+    inline REAL getScale(const REAL maxAbs, const int QMAX)
+    {
+      return (maxAbs > 0) ? (maxAbs / QMAX) : 1.;
+    }
+
+
+    /// Calculates the maximum SP product between a signal and a noise output distribution.
+    /**
+     Every output value is tried as the decision threshold (the signal is expected above it).
+    */
+    REAL maxSP(const vector<REAL> &signal, const vector<REAL> &noise)
+    {
+      if (signal.empty() || noise.empty()) return 0.;
+      const RocCurve roc = calculateRoc(signal.data(), signal.size(), noise.data(), noise.size());
+      return roc.sp[roc.best];
+    }
+  }
+
+
+  template <class Q>
+  const Q *BasicQuantizedNetwork<Q>::getTable(const string &id)
+  {
+    //The tables are built in the first call (thread safe initialization).
+    struct Table
+    {
+      vector<Q> values;
+      Table(const string &id)
+      {
+        const unsigned TABLE_RES = QuantTraits<Q>::TABLE_RES;
+        const Activation<REAL> *trf = getActivation<REAL>(id);
+        values.resize(2*TABLE_RANGE*TABLE_RES + 1);
+        for (unsigned t=0; t<values.size(); t++)
+        {
+          REAL val = (static_cast<REAL>(t) - TABLE_RANGE*TABLE_RES) / TABLE_RES;
+          trf->apply(&val, 1);
+          values[t] = quantize<Q>(val * QuantTraits<Q>::QMAX);
+        }
+      }
+    };
+    static const Table tghTable(TGH_ID);
+    static const Table logsigTable(LOGSIG_ID);
+
+    if (id == TGH_ID) return &tghTable.values[0];
+    if (id == LOGSIG_ID) return &logsigTable.values[0];
+    return NULL;
+  }
+
+
+  template <class Q>
+  BasicQuantizedNetwork<Q>::BasicQuantizedNetwork(const NeuralNetwork &net, const REAL *calibInputs, const size_t nEvents)
+  {
+    DEBUG1("Quantizing a NeuralNetwork to " << (8*sizeof(Q)) << " bits.");
+    if (!nEvents) throw "No calibration events were given!";
+
+    const int QMAX = QuantTraits<Q>::QMAX;
+    const unsigned TABLE_RES = QuantTraits<Q>::TABLE_RES;
+    const unsigned size = net.getNumLayers() - 1;
+    for (unsigned i=0; i<=size; i++) nNodes.push_back(net[i]);
+    layers.resize(size);
+
+    //Floating point copy of the weights, for the calibration.
+    vector< vector<REAL> > w(size), b(size);
+    unsigned maxNodes = 0;
+    for (unsigned i=0; i<size; i++)
+    {
+      Layer &layer = layers[i];
+      layer.nIn = nNodes[i];
+      layer.nOut = nNodes[i+1];
+      layer.trf = getActivation<REAL>(net.getTrfFunc(i));
+      maxNodes = std::max(maxNodes, layer.nOut);
+
+      REAL wMax = 0.;
+      w[i].resize(layer.nOut * layer.nIn);
+      b[i].resize(layer.nOut);
+      for (unsigned j=0; j<layer.nOut; j++)
+      {
+        b[i][j] = net.getBias(i, j);
+        for (unsigned k=0; k<layer.nIn; k++)
+        {
+          w[i][j*layer.nIn + k] = net.getWeight(i, j, k);
+          wMax = std::max(wMax, fabs(w[i][j*layer.nIn + k]));
+        }
+      }
+      layer.wScale = getScale(wMax, QMAX);
+    }
+
+    //Calibration: the largest magnitude of the input and of each layer output.
+    const Kernels<REAL> &kernels = getKernels<REAL>();
+    vector<REAL> maxAbs(size+1, 0.);
+    vector<REAL> bufA(std::max(maxNodes, nNodes[0])), bufB(bufA.size());
+    for (size_t e=0; e<nEvents; e++)
+    {
+      const REAL *in = calibInputs + e*nNodes[0];
+      for (unsigned k=0; k<nNodes[0]; k++) maxAbs[0] = std::max(maxAbs[0], fabs(in[k]));
+
+      REAL *out = &bufA[0];
+      for (unsigned i=0; i<size; i++)
+      {
+        const Layer &layer = layers[i];
+        for (unsigned j=0; j<layer.nOut; j++) out[j] = b[i][j] + kernels.dot(in, &w[i][j*layer.nIn], layer.nIn);
+        layer.trf->apply(out, layer.nOut);
+        for (unsigned j=0; j<layer.nOut; j++) maxAbs[i+1] = std::max(maxAbs[i+1], fabs(out[j]));
+        in = out;
+        out = (out == &bufA[0]) ? &bufB[0] : &bufA[0];
+      }
+    }
+
+    //Quantizing the weights and biases. The tabulated layers have a fixed output scale.
+    for (unsigned i=0; i<size; i++)
+    {
+      Layer &layer = layers[i];
+      layer.table = getTable(layer.trf->id);
+      if (layer.table) maxAbs[i+1] = 1.;
+      layer.inScale = getScale(maxAbs[i], QMAX);
+      layer.outScale = getScale(maxAbs[i+1], QMAX);
+      layer.stride = LayerArena<Q>::padded(layer.nIn);
+      layer.weights.assign(layer.nOut * layer.stride, 0);
+      layer.bias.resize(layer.nOut);
+
+      const REAL accScale = layer.inScale * layer.wScale;
+      for (unsigned j=0; j<layer.nOut; j++)
+      {
+        for (unsigned k=0; k<layer.nIn; k++) layer.weights[j*layer.stride + k] = quantize<Q>(w[i][j*layer.nIn + k] / layer.wScale);
+        layer.bias[j] = static_cast<Acc>(llround(b[i][j] / accScale));
+      }
+
+      layer.tableMult = accScale * TABLE_RES;
+    }
+  }
+
+
+  template <class Q>
+  void BasicQuantizedNetwork<Q>::propagate(const REAL *input, REAL *output, Q *bufA, Q *bufB) const
+  {
+    const unsigned size = layers.size();
+    const REAL tableCenter = TABLE_RANGE * QuantTraits<Q>::TABLE_RES;
+    const REAL invScale = 1. / layers[0].inScale;
+    const QuantKernels &kernels = getQuantKernels();
+
+    quantizeVec(kernels, input, invScale, bufA, nNodes[0]);
+
+    const Q *in = bufA;
+    Q *out = bufB;
+    for (unsigned i=0; i<size; i++)
+    {
+      //The layer parameters are copied to local variables, as the stores into the
+      //int8 buffers could alias them (and they would be read again for every node).
+      const Layer &layer = layers[i];
+      const bool isLast = (i == (size-1));
+      const unsigned nIn = layer.nIn;
+      const unsigned nOut = layer.nOut;
+      const unsigned stride = layer.stride;
+      const Q *w = &layer.weights[0];
+      const Acc *b = &layer.bias[0];
+      const Q *table = layer.table;
+      const REAL tableMult = layer.tableMult;
+      const REAL accScale = layer.inScale * layer.wScale;
+      const REAL outScale = layer.outScale;
+
+      for (unsigned j=0; j<nOut; j++)
+      {
+        const Acc acc = b[j] + intDot(kernels, in, w + j*stride, nIn);
+
+        Q q;
+        if (table)
+        {
+          //Nearest table point (the position is not negative, so the truncation rounds it).
+          const REAL pos = std::min(std::max(acc * tableMult + tableCenter, static_cast<REAL>(0.)), 2*tableCenter);
+          q = table[static_cast<unsigned>(pos + 0.5)];
+        }
+        else
+        {
+          REAL val = acc * accScale;
+          layer.trf->apply(&val, 1);
+          q = quantize<Q>(val / outScale);
+        }
+
+        if (isLast) output[j] = q * outScale;
+        else out[j] = q;
+      }
+
+      in = out;
+      out = (out == bufB) ? bufA : bufB;
+    }
+  }
+
+
+  template <class Q>
+  void BasicQuantizedNetwork<Q>::propagateBatch(const REAL *inputs, const size_t nEvents, REAL *outputs) const
+  {
+    Workspace ws(*this);
+    propagateBatch(inputs, nEvents, outputs, ws);
+  }
+
+
+  template <class Q>
+  void BasicQuantizedNetwork<Q>::propagateBatch(const REAL *inputs, const size_t nEvents, REAL *outputs, Workspace &ws) const
+  {
+    const unsigned inputSize = nNodes[0];
+    const unsigned outputSize = nNodes[nNodes.size()-1];
+    for (size_t e=0; e<nEvents; e++) propagate(inputs + e*inputSize, outputs + e*outputSize, &ws.bufA[0], &ws.bufB[0]);
+  }
+
+
+  template <class Q>
+  QuantizationReport BasicQuantizedNetwork<Q>::compare(const NeuralNetwork &net, const REAL *signal, const size_t nSignal,
+                                                        const REAL *noise, const size_t nNoise) const
+  {
+    const unsigned outputSize = nNodes[nNodes.size()-1];
+    const REAL *inputs[2] = {signal, noise};
+    const size_t nEvents[2] = {nSignal, nNoise};
+    vector<REAL> floatOut[2], quantOut[2], floatFirst[2], quantFirst[2];
+
+    QuantizationReport report;
+    report.maxDeviation = report.meanDeviation = 0.;
+    size_t numValues = 0;
+
+    for (unsigned c=0; c<2; c++)
+    {
+      floatOut[c].resize(nEvents[c] * outputSize);
+      quantOut[c].resize(nEvents[c] * outputSize);
+      if (!nEvents[c]) continue;
+      net.propagateBatch(inputs[c], nEvents[c], &floatOut[c][0]);
+      propagateBatch(inputs[c], nEvents[c], &quantOut[c][0]);
+
+      for (size_t k=0; k<floatOut[c].size(); k++)
+      {
+        const REAL dev = fabs(floatOut[c][k] - quantOut[c][k]);
+        report.maxDeviation = std::max(report.maxDeviation, dev);
+        report.meanDeviation += dev;
+      }
+      numValues += floatOut[c].size();
+
+      for (size_t e=0; e<nEvents[c]; e++)
+      {
+        floatFirst[c].push_back(floatOut[c][e*outputSize]);
+        quantFirst[c].push_back(quantOut[c][e*outputSize]);
+      }
+    }
+
+    if (numValues) report.meanDeviation /= numValues;
+    report.spFloat = maxSP(floatFirst[0], floatFirst[1]);
+    report.spQuantized = maxSP(quantFirst[0], quantFirst[1]);
+    report.spLoss = report.spFloat - report.spQuantized;
+    return report;
+  }
+
+
+  template <class Q>
+  size_t BasicQuantizedNetwork<Q>::modelSize() const
+  {
+    size_t ret = 0;
+    for (unsigned i=0; i<layers.size(); i++)
+    {
+      ret += layers[i].nOut * layers[i].nIn * sizeof(Q);
+      ret += layers[i].bias.size() * sizeof(Acc);
+    }
+    return ret;
+  }
+
+
+  template <class Q>
+  void BasicQuantizedNetwork<Q>::showInfo() const
+  {
+    REPORT("QUANTIZED NEURAL NETWORK INFO");
+    REPORT("Number of bits          : " << (8*sizeof(Q)));
+    REPORT("Number of Layers (including the input): " << nNodes.size());
+    REPORT("Model size (bytes)      : " << modelSize());
+
+    for (unsigned i=0; i<layers.size(); i++)
+    {
+      std::ostringstream aux;
+      aux << "\nLayer " << (i+1) << " Configuration:";
+      aux << "\nNumber of Nodes   : " << layers[i].nOut;
+      aux << "\nTransfer function : " << layers[i].trf->id << ((layers[i].table) ? " (table)" : "");
+      aux << "\nInput scale       : " << layers[i].inScale;
+      aux << "\nWeights scale     : " << layers[i].wScale;
+      aux << "\nOutput scale      : " << layers[i].outScale;
+      REPORT(aux.str());
+    }
+  }
+
+
+  template class BasicQuantizedNetwork<int8_t>;
+  template class BasicQuantizedNetwork<int16_t>;
+}
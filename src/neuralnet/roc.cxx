@@ -0,0 +1,250 @@
+/**
+@file  roc.cxx
+@brief Exact ROC analysis implementation file.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#ifndef NO_OMP
+#include <omp.h>
+#endif
+
+#include "fastnet/neuralnet/roc.h"
+#include "fastnet/sys/Reporter.h"
+
+using namespace std;
+
+namespace FastNet
+{
+  namespace
+  {
+    /// Minimum number of values of each chunk sorted by a thread.
+    const size_t PARALLEL_SORT_MIN = 1 << 16;
+
+    /// Number of bits of each radix sort digit.
+    const unsigned RADIX_BITS = 11;
+
+    /// Number of radix sort passes (digits) of a 64 bits key.
+    const unsigned RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+
+
+    /// Sorts a range of values (which must not be NaN) by their bits.
+    /**
+     Each value is mapped to an unsigned key with the same ordering (the sign bit is flipped
+     for the positive values, and every bit for the negative ones), and the keys are sorted by
+     a least significant digit radix sort. It takes a fixed number of linear passes, so it is
+     about twice as fast as a comparison sort for the large output sets. The passes where every
+     key has the same digit (the exponent digits of outputs of similar magnitudes) are skipped.
+    */
+    void radixSort(REAL *begin, REAL *end)
+    {
+      const size_t n = end - begin;
+      const size_t NUM_DIGITS = 1 << RADIX_BITS;
+      const uint64_t SIGN = static_cast<uint64_t>(1) << 63;
+      vector<uint64_t> keys(n);
+      vector<uint64_t> aux(n);
+      vector<size_t> hist(RADIX_PASSES * NUM_DIGITS, 0);
+
+      for (size_t i=0; i<n; i++)
+      {
+        uint64_t k;
+        memcpy(&k, begin + i, sizeof(k));
+        k = (k & SIGN) ? ~k : (k | SIGN);
+        keys[i] = k;
+        for (unsigned p=0; p<RADIX_PASSES; p++) hist[p*NUM_DIGITS + ((k >> (p*RADIX_BITS)) & (NUM_DIGITS-1))]++;
+      }
+
+      for (unsigned p=0; p<RADIX_PASSES; p++)
+      {
+        size_t *h = &hist[p*NUM_DIGITS];
+        if (find(h, h + NUM_DIGITS, n) != (h + NUM_DIGITS)) continue;
+
+        size_t pos = 0;
+        for (size_t d=0; d<NUM_DIGITS; d++)
+        {
+          const size_t count = h[d];
+          h[d] = pos;
+          pos += count;
+        }
+        for (size_t i=0; i<n; i++) aux[h[(keys[i] >> (p*RADIX_BITS)) & (NUM_DIGITS-1)]++] = keys[i];
+        keys.swap(aux);
+      }
+
+      for (size_t i=0; i<n; i++)
+      {
+        const uint64_t k = (keys[i] & SIGN) ? (keys[i] & ~SIGN) : ~keys[i];
+        memcpy(begin + i, &k, sizeof(k));
+      }
+    }
+
+
+    /// Sorts a vector (which must not hold NaN) in parallel.
+    /**
+     The vector is split into a chunk per thread (a power of two of them), each one is radix
+     sorted by a thread, and then they are merged pairwise, with a parallel pass for each
+     level of the merge tree.
+    */
+    void parallelSort(vector<REAL> &v)
+    {
+#ifdef NO_OMP
+      const int numThreads = 1;
+#else
+      const int numThreads = omp_get_max_threads();
+#endif
+      int numChunks = 1;
+      while ( ((2*numChunks) <= numThreads) && ((v.size() / (2*numChunks)) >= PARALLEL_SORT_MIN) ) numChunks *= 2;
+
+      vector<size_t> bounds(numChunks+1);
+      for (int c=0; c<=numChunks; c++) bounds[c] = (v.size() * c) / numChunks;
+      REAL *data = v.data();
+      int c;
+
+      #pragma omp parallel for schedule(static) private(c)
+      for (c=0; c<numChunks; c++) radixSort(data + bounds[c], data + bounds[c+1]);
+
+      for (int width=1; width<numChunks; width*=2)
+      {
+        #pragma omp parallel for schedule(static) private(c)
+        for (c=0; c<numChunks; c+=2*width)
+        {
+          inplace_merge(data + bounds[c], data + bounds[c+width], data + bounds[c+2*width]);
+        }
+      }
+    }
+
+
+    /// Returns the sorted outputs, without the ones that can not be compared (NaN).
+    template <class T>
+    vector<REAL> sortedOutputs(const T *out, const size_t n)
+    {
+      vector<REAL> ret(n);
+      size_t numValid = 0;
+      for (size_t i=0; i<n; i++)
+      {
+        ret[numValid] = out[i];
+        if (out[i] == out[i]) numValid++;
+      }
+      ret.resize(numValid);
+      parallelSort(ret);
+      return ret;
+    }
+
+
+    /// Appends an operating point to a ROC.
+    /**
+     The efficiencies are calculated from the event counts as in PatternRecognition::sp,
+     so the SP products are exactly the same ones.
+    */
+    inline void addPoint(RocCurve &roc, const REAL cut, const size_t sigAbove, const size_t nSignal,
+                          const size_t noiseAbove, const size_t noiseBelow, const size_t nNoise,
+                          const REAL signalWeight, const REAL noiseWeight)
+    {
+      const REAL sigEffic = (static_cast<REAL>(sigAbove) / nSignal) * signalWeight;
+      const REAL noiseEffic = (static_cast<REAL>(noiseBelow) / nNoise) * noiseWeight;
+      roc.cut.push_back(cut);
+      roc.det.push_back(static_cast<REAL>(sigAbove) / nSignal);
+      roc.fa.push_back(static_cast<REAL>(noiseAbove) / nNoise);
+      roc.sp.push_back(sqrt(((sigEffic + noiseEffic) / 2) * sqrt(sigEffic * noiseEffic)));
+      if (roc.sp.back() > roc.sp[roc.best]) roc.best = roc.sp.size() - 1;
+    }
+
+
+    /// Sweeps the sorted outputs by increasing threshold, returning the exact AUC.
+    /**
+     If roc is not NULL, the operating point at every distinct output (and at the infinite
+     threshold) is appended to it. The areas are summed as integer counts, so they are exact.
+    */
+    REAL sweep(const vector<REAL> &signal, const size_t nSignal, const vector<REAL> &noise, const size_t nNoise,
+                RocCurve *roc, const REAL signalWeight, const REAL noiseWeight)
+    {
+      const size_t ns = signal.size();
+      const size_t nn = noise.size();
+      unsigned long long area = 0;
+      size_t i = 0;
+      size_t j = 0;
+      if (roc)
+      {
+        roc->cut.reserve(ns + nn + 1);
+        roc->det.reserve(ns + nn + 1);
+        roc->fa.reserve(ns + nn + 1);
+        roc->sp.reserve(ns + nn + 1);
+      }
+
+      while ( (i < ns) || (j < nn) )
+      {
+        const REAL cut = ( (j == nn) || ((i < ns) && (signal[i] < noise[j])) ) ? signal[i] : noise[j];
+        const unsigned long long sigAbove = ns - i;
+        const unsigned long long noiseAbove = nn - j;
+        if (roc) addPoint(*roc, cut, sigAbove, nSignal, noiseAbove, j, nNoise, signalWeight, noiseWeight);
+
+        while ( (i < ns) && (signal[i] == cut) ) i++;
+        while ( (j < nn) && (noise[j] == cut) ) j++;
+
+        //Trapezoid up to the next operating point.
+        area += (noiseAbove - (nn - j)) * (sigAbove + (ns - i));
+      }
+
+      if (roc) addPoint(*roc, numeric_limits<REAL>::infinity(), 0, nSignal, 0, nn, nNoise, signalWeight, noiseWeight);
+
+      return static_cast<REAL>(area) / (2. * static_cast<REAL>(nSignal) * static_cast<REAL>(nNoise));
+    }
+  }
+
+
+  template <class T>
+  RocCurve calculateRoc(const T *signal, const size_t nSignal, const T *noise, const size_t nNoise,
+                          const REAL signalWeight, const REAL noiseWeight)
+  {
+    DEBUG1("Calculating the exact ROC of " << nSignal << " signal and " << nNoise << " noise events.");
+    if ( (!nSignal) || (!nNoise) ) throw "The ROC needs both signal and noise events!";
+
+    const vector<REAL> sortedSignal = sortedOutputs(signal, nSignal);
+    const vector<REAL> sortedNoise = sortedOutputs(noise, nNoise);
+
+    RocCurve roc;
+    roc.best = 0;
+    roc.auc = sweep(sortedSignal, nSignal, sortedNoise, nNoise, &roc, signalWeight, noiseWeight);
+    return roc;
+  }
+
+
+  template <class T>
+  RocCurve calculateRoc(const T *signal, const size_t nSignal, const T *noise, const size_t nNoise,
+                          const vector<REAL> &cuts, const REAL signalWeight, const REAL noiseWeight)
+  {
+    DEBUG1("Calculating the ROC of " << nSignal << " signal and " << nNoise << " noise events at " << cuts.size() << " thresholds.");
+    if ( (!nSignal) || (!nNoise) ) throw "The ROC needs both signal and noise events!";
+
+    const vector<REAL> sortedSignal = sortedOutputs(signal, nSignal);
+    const vector<REAL> sortedNoise = sortedOutputs(noise, nNoise);
+
+    RocCurve roc;
+    roc.best = 0;
+    roc.auc = sweep(sortedSignal, nSignal, sortedNoise, nNoise, NULL, signalWeight, noiseWeight);
+    for (size_t k=0; k<cuts.size(); k++)
+    {
+      //No output is at, above or below a NaN threshold.
+      const bool valid = (cuts[k] == cuts[k]);
+      const size_t sigBelow = lower_bound(sortedSignal.begin(), sortedSignal.end(), cuts[k]) - sortedSignal.begin();
+      const size_t noiseBelow = lower_bound(sortedNoise.begin(), sortedNoise.end(), cuts[k]) - sortedNoise.begin();
+      addPoint(roc, cuts[k], (valid) ? sortedSignal.size() - sigBelow : 0, nSignal,
+                (valid) ? sortedNoise.size() - noiseBelow : 0, (valid) ? noiseBelow : 0, nNoise, signalWeight, noiseWeight);
+    }
+    return roc;
+  }
+
+
+  template RocCurve calculateRoc(const float *signal, const size_t nSignal, const float *noise, const size_t nNoise,
+                                  const REAL signalWeight, const REAL noiseWeight);
+  template RocCurve calculateRoc(const double *signal, const size_t nSignal, const double *noise, const size_t nNoise,
+                                  const REAL signalWeight, const REAL noiseWeight);
+  template RocCurve calculateRoc(const float *signal, const size_t nSignal, const float *noise, const size_t nNoise,
+                                  const vector<REAL> &cuts, const REAL signalWeight, const REAL noiseWeight);
+  template RocCurve calculateRoc(const double *signal, const size_t nSignal, const double *noise, const size_t nNoise,
+                                  const vector<REAL> &cuts, const REAL signalWeight, const REAL noiseWeight);
+}
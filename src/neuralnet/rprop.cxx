@@ -1,6 +1,6 @@
 /**  
 @file  rprop.cpp
-@brief The Resilient BackPropagation (RProp) class definition.
+@brief The Resilient BackPropagation (BasicRProp) class template definition.
 */
 
 #include <vector>
@@ -8,6 +8,7 @@
 #include <typeinfo>
 
 #include "fastnet/neuralnet/rprop.h"
+#include "fastnet/neuralnet/kernels.h"
 #include "fastnet/sys/Reporter.h"
 
 
@@ -15,17 +16,19 @@ using namespace std;
 
 namespace FastNet
 {
-  RProp::RProp(const RProp &net) : Backpropagation(net)
+  template <class T>
+  BasicRProp<T>::BasicRProp(const BasicRProp &net) : BasicBackpropagation<T>(net)
   {
     try {allocateSpace(net.nNodes);}
     catch (bad_alloc xa) {throw;}
     (*this) = net;
   }
 
-  void RProp::operator=(const RProp &net)
+  template <class T>
+  void BasicRProp<T>::operator=(const BasicRProp &net)
   {
     DEBUG1("Attributing all values using assignment operator for RProp class");
-    Backpropagation::operator=(net);
+    BasicBackpropagation<T>::operator=(net);
 
     deltaMax = net.deltaMax;
     deltaMin = net.deltaMin;
@@ -33,22 +36,15 @@ namespace FastNet
     decEta = net.decEta;
     initEta = net.initEta;
 
-    for (unsigned i=0; i<(nNodes.size() - 1); i++)
-    {
-      memcpy(prev_db[i], net.prev_db[i], nNodes[i+1]*sizeof(REAL));
-      memcpy(delta_b[i], net.delta_b[i], nNodes[i+1]*sizeof(REAL));
-      for (unsigned j=0; j<nNodes[i+1]; j++) 
-      {
-        memcpy(prev_dw[i][j], net.prev_dw[i][j], nNodes[i]*sizeof(REAL));
-        memcpy(delta_w[i][j], net.delta_w[i][j], nNodes[i]*sizeof(REAL));
-      }
-    }
+    //prev_dw, prev_db, delta_w and delta_b are copied all at once.
+    rpArena.copy(net.rpArena);
   }
 
 
-  RProp::RProp(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias, 
-                      const REAL deltaMin, const REAL deltaMax, const REAL initEta,
-                      const REAL incEta, const REAL decEta) : Backpropagation(nNodes, trfFunc, usingBias)
+  template <class T>
+  BasicRProp<T>::BasicRProp(const std::vector<unsigned> &nNodes, const std::vector<string> &trfFunc, const std::vector<bool> &usingBias, 
+                      const ACC_REAL deltaMin, const ACC_REAL deltaMax, const ACC_REAL initEta,
+                      const ACC_REAL incEta, const ACC_REAL decEta) : BasicBackpropagation<T>(nNodes, trfFunc, usingBias)
   {
     DEBUG1("Initializing the RProp class from scratch.");
     this->deltaMax = deltaMax;
@@ -60,47 +56,24 @@ namespace FastNet
     try {allocateSpace(nNodes);}
     catch (bad_alloc xa) {throw;}
 
-    //Initializing the dynamically allocated values.
-    for (unsigned i=0; i<(nNodes.size() - 1); i++)
-    {
-      for (unsigned j=0; j<nNodes[i+1]; j++) 
-      {
-        prev_db[i][j] = 0.;
-        delta_b[i][j] = this->initEta;
-        
-        for (unsigned k=0; k<nNodes[i]; k++)
-        {
-          prev_dw[i][j][k] = 0.;
-          delta_w[i][j][k] = this->initEta;
-        }
-      }
-    }
+    //Initializing the dynamically allocated values. prev_dw and prev_db
+    //are already zero, since the arena is zero initialized.
+    ACC_REAL *eta = rpArena.getParams(ETA_SET);
+    for (size_t i=0; i<rpArena.paramSize(); i++) eta[i] = this->initEta;
   }
 
 
-  void RProp::allocateSpace(const vector<unsigned> &nNodes)
+  template <class T>
+  void BasicRProp<T>::allocateSpace(const vector<unsigned> &nNodes)
   {
     DEBUG2("Allocating all the space that the RProp class will need.");
-    const unsigned size = nNodes.size() - 1;
-    
     try
     {
-      prev_db = new REAL* [size];
-      delta_b = new REAL* [size];
-      prev_dw = new REAL** [size];
-      delta_w = new REAL** [size];
-      for (unsigned i=0; i<size; i++)
-      {
-        prev_db[i] = new REAL [nNodes[i+1]];
-        delta_b[i] = new REAL [nNodes[i+1]];
-        prev_dw[i] = new REAL* [nNodes[i+1]];
-        delta_w[i] = new REAL* [nNodes[i+1]];
-        for (unsigned j=0; j<nNodes[i+1]; j++) 
-        {
-          prev_dw[i][j] = new REAL [nNodes[i]];
-          delta_w[i][j] = new REAL [nNodes[i]];
-        }
-      }
+      rpArena.allocate(nNodes, 2, 0);
+      prev_dw = rpArena.getWeights(PREV_SET);
+      prev_db = rpArena.getBias(PREV_SET);
+      delta_w = rpArena.getWeights(ETA_SET);
+      delta_b = rpArena.getBias(ETA_SET);
     }
     catch (bad_alloc xa)
     {
@@ -109,22 +82,20 @@ namespace FastNet
   }
 
 
-  RProp::~RProp()
+  template <class T>
+  BasicRProp<T>::~BasicRProp()
   {
     DEBUG2("Releasing all memory allocated by RProp.");
-    // Deallocating the delta bias matrix.
-    releaseMatrix(prev_db);
-    releaseMatrix(delta_b);
-
-    // Deallocating the delta weights matrix.
-    releaseMatrix(prev_dw);
-    releaseMatrix(delta_w);
+    //prev_dw, prev_db, delta_w and delta_b are released by the arena.
   }
 
 
 
-  void RProp::updateWeights(const unsigned numEvents)
+  template <class T>
+  void BasicRProp<T>::updateWeights(const unsigned numEvents)
   {
+    const Kernels<T> &kernels = getKernels<T>();
+
     for (unsigned i=0; i<(nNodes.size()-1); i++)
     {
       for (unsigned j=0; j<nNodes[(i+1)]; j++)
@@ -140,22 +111,22 @@ namespace FastNet
         }
         else
         {
-          for (unsigned k=0; k<nNodes[i]; k++)
-          {
-            updateW(delta_w[i][j][k], dw[i][j][k], prev_dw[i][j][k], weights[i][j][k]);
-          }
+          clearPruned(i, j, dw[i][j]);
+          kernels.rprop(weights[i][j], dw[i][j], prev_dw[i][j], delta_w[i][j], nNodes[i], incEta, decEta, deltaMin, deltaMax);
         
           if (usingBias[i]) updateW(delta_b[i][j], db[i][j], prev_db[i][j], bias[i][j]);
           else bias[i][j] = 0;
         }
       }
     }
+    transposeWeights();
   }
 
 
-  inline void RProp::updateW(REAL &delta, REAL &d, REAL &prev_d, REAL &w)
+  template <class T>
+  inline void BasicRProp<T>::updateW(ACC_REAL &delta, ACC_REAL &d, ACC_REAL &prev_d, T &w)
   {
-    const REAL val = prev_d * d;
+    const ACC_REAL val = prev_d * d;
           
     if (val > 0.)
     {
@@ -166,15 +137,16 @@ namespace FastNet
       delta = max((delta*decEta), deltaMin);
     }
 
-    w += (sign(d) * delta);
+    w += static_cast<T>(sign(d) * delta);
     prev_d = d;
     d = 0;
   }
   
   
-  void RProp::showInfo() const
+  template <class T>
+  void BasicRProp<T>::showInfo() const
   {
-    Backpropagation::showInfo();
+    BasicBackpropagation<T>::showInfo();
     REPORT("TRAINING ALGORITHM INFORMATION");
     REPORT("Training algorithm: Resilient Backpropagation");
     REPORT("Maximum allowed learning rate value (deltaMax) = " << deltaMax);
@@ -183,4 +155,8 @@ namespace FastNet
     REPORT("Learning rate decreasing factor (decEta) = " << decEta);
     REPORT("Initial learning rate value (initEta) = " << initEta);
   }
+
+
+  template class BasicRProp<float>;
+  template class BasicRProp<double>;
 }
@@ -0,0 +1,267 @@
+#include <random>
+#include <algorithm>
+
+#include "fastnet/training/CrossValid.h"
+
+RandomBlocksDealer::RandomBlocksDealer(const std::vector<unsigned> &numEvents, const unsigned nTrn, const unsigned nVal,
+                                        const unsigned nTst, const unsigned nDeals, const unsigned seed)
+{
+  DEBUG1("Creating " << nDeals << " sorted blocks deals (" << nTrn << " trn, " << nVal << " val, " << nTst << " tst blocks).");
+  if ( (!nTrn) || (!nVal) ) throw "There must be training and validation blocks!";
+
+  this->numEvents = numEvents;
+  this->nTrn = nTrn;
+  this->nVal = nVal;
+  this->nTst = nTst;
+  this->nDeals = nDeals;
+
+  //The block orders are drawn at once, so any deal may be generated by any thread.
+  const unsigned numBlocks = nTrn + nVal + nTst;
+  std::mt19937 engine(seed);
+  order.resize(nDeals * numEvents.size() * numBlocks);
+  for (unsigned i=0; i<order.size(); i+=numBlocks)
+  {
+    for (unsigned b=0; b<numBlocks; b++) order[i+b] = b;
+    std::shuffle(order.begin() + i, order.begin() + i + numBlocks, engine);
+  }
+};
+
+
+void RandomBlocksDealer::addBlocks(const unsigned d, const unsigned pat, const unsigned first, const unsigned last,
+                                    std::vector<unsigned> &set) const
+{
+  const unsigned numBlocks = nTrn + nVal + nTst;
+  const unsigned *blocks = &order[(d*numEvents.size() + pat) * numBlocks];
+  for (unsigned k=first; k<last; k++)
+  {
+    for (unsigned e=blocks[k]; e<numEvents[pat]; e+=numBlocks) set.push_back(e);
+  }
+};
+
+
+void RandomBlocksDealer::getDeal(const unsigned d, Deal &deal) const
+{
+  const unsigned numPatterns = numEvents.size();
+  deal.trn.assign(numPatterns, std::vector<unsigned>());
+  deal.val.assign(numPatterns, std::vector<unsigned>());
+  deal.tst.assign(numPatterns, std::vector<unsigned>());
+
+  for (unsigned p=0; p<numPatterns; p++)
+  {
+    addBlocks(d, p, 0, nTrn, deal.trn[p]);
+    addBlocks(d, p, nTrn, nTrn + nVal, deal.val[p]);
+    if (nTst) addBlocks(d, p, nTrn + nVal, nTrn + nVal + nTst, deal.tst[p]);
+    else deal.tst[p] = deal.val[p];
+  }
+};
+
+
+LeaveOneOutDealer::LeaveOneOutDealer(const std::vector<unsigned> &numEvents, const unsigned first, const unsigned nDeals)
+{
+  DEBUG1("Creating " << nDeals << " leave one out deals, from the event " << first << ".");
+  unsigned total = 0;
+  for (unsigned p=0; p<numEvents.size(); p++) total += numEvents[p];
+  if ( (first > total) || (nDeals > (total - first)) ) throw "There are not enough events for the leave one out deals!";
+
+  this->numEvents = numEvents;
+  this->first = first;
+  this->nDeals = nDeals;
+};
+
+
+void LeaveOneOutDealer::getDeal(const unsigned d, Deal &deal) const
+{
+  const unsigned numPatterns = numEvents.size();
+  deal.trn.assign(numPatterns, std::vector<unsigned>());
+  deal.tst.assign(numPatterns, std::vector<unsigned>());
+
+  //Finding the pattern of the event left out.
+  unsigned pat = 0;
+  unsigned ev = first + d;
+  while (ev >= numEvents[pat]) ev -= numEvents[pat++];
+
+  for (unsigned p=0; p<numPatterns; p++)
+  {
+    deal.trn[p].reserve(numEvents[p]);
+    for (unsigned e=0; e<numEvents[p]; e++)
+    {
+      if ( (p != pat) || (e != ev) ) deal.trn[p].push_back(e);
+    }
+  }
+  deal.tst[pat].push_back(ev);
+  deal.val = deal.trn;
+};
+
+
+template <class T>
+BasicCrossValidation<T>::BasicCrossValidation(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *data,
+                                              const bool usingSP, const unsigned bSize, const REAL signalWeight,
+                                              const REAL noiseWeight, const REAL spResolution)
+{
+  DEBUG1("Starting a Cross Validation Object");
+  if (data->size() != 2) throw "The cross validation needs two patterns!";
+
+  protoNet = net;
+  dataList = data;
+  useSP = usingSP;
+  batchSize = bSize;
+  this->signalWeight = signalWeight;
+  this->noiseWeight = noiseWeight;
+  this->spResolution = spResolution;
+};
+
+
+template <class T>
+BasicCrossValidation<T>::~BasicCrossValidation()
+{
+  release();
+};
+
+
+template <class T>
+void BasicCrossValidation<T>::release()
+{
+  for (auto &r : results) delete r.net;
+  results.clear();
+};
+
+
+template <class T>
+void BasicCrossValidation<T>::trainDeal(const Deal &deal, const unsigned nTrains, const unsigned seed, const unsigned nEpochs,
+                                        const unsigned failLimit, const std::vector<REAL> &cuts, BasicDealResult<T> &res)
+{
+  const unsigned numPatterns = dataList->size();
+  std::vector<BasicDataManager<T>*> trn, val, tst;
+  std::mt19937 seeder(seed);
+
+  try
+  {
+    for (unsigned p=0; p<numPatterns; p++)
+    {
+      trn.push_back(new BasicDataManager<T>(*(*dataList)[p], deal.trn[p], static_cast<unsigned>(seeder())));
+      val.push_back(new BasicDataManager<T>(*(*dataList)[p], deal.val[p], 0));
+      tst.push_back(new BasicDataManager<T>(*(*dataList)[p], deal.tst[p], 0));
+    }
+
+    BasicMultiStartTraining<T> trainer(protoNet, &trn, &val, useSP, batchSize, signalWeight, noiseWeight, spResolution);
+    res.bestTrain = trainer.train(nTrains, static_cast<unsigned>(seeder()), nEpochs, failLimit);
+    const std::vector< BasicTrainRun<T> > &runs = trainer.getRuns();
+
+    //Choosing the training of the highest testing SP, if there are testing events of both patterns.
+    const bool hasTst = (tst[0]->numEvents()) && (tst[1]->numEvents());
+    std::vector< std::vector<REAL> > outputs(numPatterns);
+    for (unsigned i=0; i<runs.size(); i++)
+    {
+      if ( (!hasTst) && (i != res.bestTrain) ) continue;
+      for (unsigned p=0; p<numPatterns; p++)
+      {
+        outputs[p].resize(tst[p]->numEvents());
+        for (unsigned e=0; e<outputs[p].size(); e++) outputs[p][e] = runs[i].net->propagateInput((*tst[p])[e])[0];
+      }
+      if (!hasTst)
+      {
+        res.tstOutputs = outputs;
+        continue;
+      }
+
+      const FastNet::RocCurve roc = (cuts.empty()) ?
+        FastNet::calculateRoc(&outputs[0][0], outputs[0].size(), &outputs[1][0], outputs[1].size(), signalWeight, noiseWeight) :
+        FastNet::calculateRoc(&outputs[0][0], outputs[0].size(), &outputs[1][0], outputs[1].size(), cuts, signalWeight, noiseWeight);
+      if ( (!i) || (roc.sp[roc.best] > res.sp) )
+      {
+        res.sp = roc.sp[roc.best];
+        res.roc = roc;
+        res.bestTrain = i;
+        res.tstOutputs = outputs;
+      }
+    }
+
+    res.net = dynamic_cast<FastNet::BasicBackpropagation<T>*>(runs[res.bestTrain].net->clone());
+    res.trnEvolution = runs[res.bestTrain].trnEvolution;
+  }
+  catch (...)
+  {
+    for (unsigned p=0; p<trn.size(); p++) delete trn[p];
+    for (unsigned p=0; p<val.size(); p++) delete val[p];
+    for (unsigned p=0; p<tst.size(); p++) delete tst[p];
+    throw;
+  }
+
+  for (unsigned p=0; p<numPatterns; p++)
+  {
+    delete trn[p];
+    delete val[p];
+    delete tst[p];
+  }
+};
+
+
+template <class T>
+void BasicCrossValidation<T>::run(const Dealer &dealer, const unsigned nTrains, const unsigned seed, const unsigned nEpochs,
+                                  const unsigned failLimit, const std::vector<REAL> &cuts)
+{
+  const unsigned nDeals = dealer.numDeals();
+  DEBUG1("Running a cross validation of " << nDeals << " deals, with " << nTrains << " trainings each.");
+  release();
+
+  BasicDealResult<T> empty;
+  empty.net = NULL;
+  empty.bestTrain = 0;
+  empty.sp = 0.;
+  results.assign(nDeals, empty);
+
+  //The seeds are drawn in the deal order, before the threads start.
+  std::vector<unsigned> seeds(nDeals);
+  std::mt19937 seeder(seed);
+  for (unsigned d=0; d<nDeals; d++) seeds[d] = static_cast<unsigned>(seeder());
+
+  const char *errorMsg = NULL;
+  bool noMemory = false;
+  int d;
+
+  #pragma omp parallel for schedule(dynamic,1) shared(errorMsg,noMemory) private(d)
+  for (d=0; d<static_cast<int>(nDeals); d++)
+  {
+    try
+    {
+      //Inside the parallel region, each deal trains with a single thread.
+      Deal deal;
+      dealer.getDeal(d, deal);
+      trainDeal(deal, nTrains, seeds[d], nEpochs, failLimit, cuts, results[d]);
+    }
+    catch (bad_alloc xa)
+    {
+      #pragma omp critical
+      noMemory = true;
+    }
+    catch (const char *msg)
+    {
+      #pragma omp critical
+      errorMsg = msg;
+    }
+  }
+
+  if (noMemory) throw bad_alloc();
+  if (errorMsg) throw errorMsg;
+};
+
+
+template <class T>
+FastNet::RocCurve BasicCrossValidation<T>::getPooledRoc(const std::vector<REAL> &cuts) const
+{
+  std::vector<REAL> signal, noise;
+  for (unsigned d=0; d<results.size(); d++)
+  {
+    if (results[d].tstOutputs.empty()) continue;
+    signal.insert(signal.end(), results[d].tstOutputs[0].begin(), results[d].tstOutputs[0].end());
+    noise.insert(noise.end(), results[d].tstOutputs[1].begin(), results[d].tstOutputs[1].end());
+  }
+  if ( (signal.empty()) || (noise.empty()) ) throw "The ROC needs both signal and noise events!";
+
+  return (cuts.empty()) ? FastNet::calculateRoc(&signal[0], signal.size(), &noise[0], noise.size(), signalWeight, noiseWeight) :
+                          FastNet::calculateRoc(&signal[0], signal.size(), &noise[0], noise.size(), cuts, signalWeight, noiseWeight);
+};
+
+
+template class BasicCrossValidation<float>;
+template class BasicCrossValidation<double>;
@@ -0,0 +1,131 @@
+#include <random>
+
+#include "fastnet/training/MultiStart.h"
+
+template <class T>
+BasicMultiStartTraining<T>::BasicMultiStartTraining(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *inTrn,
+                                                    std::vector<BasicDataManager<T>*> *inVal, const bool usingSP, const unsigned bSize,
+                                                    const REAL signalWeight, const REAL noiseWeight, const REAL spResolution)
+{
+  DEBUG1("Starting a Multi Start Training Object");
+
+  protoNet = net;
+  inTrnList = inTrn;
+  inValList = inVal;
+  useSP = usingSP;
+  batchSize = bSize;
+  this->signalWeight = signalWeight;
+  this->noiseWeight = noiseWeight;
+  this->spResolution = spResolution;
+  bestRun = 0;
+};
+
+
+template <class T>
+BasicMultiStartTraining<T>::~BasicMultiStartTraining()
+{
+  release();
+};
+
+
+template <class T>
+void BasicMultiStartTraining<T>::release()
+{
+  for (auto &r : runs) delete r.net;
+  runs.clear();
+  bestRun = 0;
+};
+
+
+template <class T>
+unsigned BasicMultiStartTraining<T>::train(const unsigned numRuns, const unsigned seed, const unsigned nEpochs, const unsigned failLimit)
+{
+  DEBUG1("Training " << numRuns << " runs from the base seed " << seed << ".");
+  release();
+  if (!numRuns) throw "The number of runs must be positive!";
+
+  const unsigned numPatterns = inTrnList->size();
+  std::vector< std::vector<BasicDataManager<T>*> > trnViews(numRuns);
+  const char *errorMsg = NULL;
+  bool noMemory = false;
+
+  //The networks and the sampling of each run are set before the training threads start,
+  //drawing every seed in the run order.
+  try
+  {
+    std::mt19937 seeder(seed);
+    for (unsigned r=0; r<numRuns; r++)
+    {
+      BasicTrainRun<T> run;
+      run.net = NULL;
+      run.seed = static_cast<unsigned>(seeder());
+      run.mseVal = run.spVal = 0.;
+      runs.push_back(run);
+      runs[r].net = dynamic_cast<FastNet::BasicBackpropagation<T>*>(protoNet->clone());
+      initNetwork(runs[r].net, runs[r].seed);
+      for (unsigned p=0; p<numPatterns; p++)
+      {
+        trnViews[r].push_back(new BasicDataManager<T>(*(*inTrnList)[p], static_cast<unsigned>(seeder())));
+      }
+    }
+  }
+  catch (bad_alloc xa)
+  {
+    for (auto &v : trnViews) for (auto &x : v) delete x;
+    throw;
+  }
+
+  BasicTrainRun<T> *run = &runs[0];
+  std::vector< std::vector<BasicDataManager<T>*> > *views = &trnViews;
+  int r;
+
+  #pragma omp parallel for schedule(dynamic,1) shared(run,views,errorMsg,noMemory) private(r)
+  for (r=0; r<static_cast<int>(numRuns); r++)
+  {
+    try
+    {
+      //Inside the parallel region, each run trains with a single thread.
+      BasicPatternRecognition<T> train(run[r].net, &(*views)[r], inValList, useSP, batchSize,
+                                        signalWeight, noiseWeight, spResolution);
+      train.trainEpochs(nEpochs, failLimit, useSP, 0);
+      run[r].trnEvolution = train.getTrainInfo();
+
+      //The validation of the best network is the one of the last improvement.
+      const TrainData &evo = run[r].trnEvolution;
+      for (unsigned e=0; e<evo.size(); e++)
+      {
+        if ( ((useSP) ? evo.is_best_sp[e] : evo.is_best_mse[e]) != BETTER ) continue;
+        run[r].mseVal = evo.mse_val[e];
+        run[r].spVal = (useSP) ? evo.sp_val[e] : 0.;
+      }
+
+      //The network is left with its best weights.
+      run[r].net->readWeights(run[r].net->getSavedWeights(), run[r].net->getSavedBias());
+    }
+    catch (bad_alloc xa)
+    {
+      #pragma omp critical
+      noMemory = true;
+    }
+    catch (const char *msg)
+    {
+      #pragma omp critical
+      errorMsg = msg;
+    }
+  }
+
+  for (auto &v : trnViews) for (auto &x : v) delete x;
+  if (noMemory) throw bad_alloc();
+  if (errorMsg) throw errorMsg;
+
+  for (unsigned i=1; i<numRuns; i++)
+  {
+    if ( (useSP) ? (runs[i].spVal > runs[bestRun].spVal) : (runs[i].mseVal < runs[bestRun].mseVal) ) bestRun = i;
+  }
+  DEBUG1("The best run is " << bestRun << " (validation MSE = " << runs[bestRun].mseVal << ", SP = " << runs[bestRun].spVal << ").");
+  return bestRun;
+};
+
+
+template class BasicMultiStartTraining<float>;
+template class BasicMultiStartTraining<double>;
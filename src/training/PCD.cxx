@@ -0,0 +1,316 @@
+#include <random>
+#include <cmath>
+
+#include "fastnet/neuralnet/roc.h"
+#include "fastnet/training/PCD.h"
+
+/// A copy of the weights and biases of a network, in the arrays taken by readWeights.
+template <class T>
+struct NetworkWeights
+{
+  std::vector< std::vector< std::vector<T> > > w;
+  std::vector< std::vector<T> > b;
+
+  NetworkWeights(const FastNet::BasicBackpropagation<T> &net)
+  {
+    const unsigned numLayers = net.getNumLayers() - 1;
+    w.resize(numLayers);
+    b.resize(numLayers);
+    for (unsigned i=0; i<numLayers; i++)
+    {
+      w[i].assign(net[i+1], std::vector<T>(net[i]));
+      b[i].resize(net[i+1]);
+      for (unsigned j=0; j<net[i+1]; j++)
+      {
+        for (unsigned k=0; k<net[i]; k++) w[i][j][k] = net.getWeight(i, j, k);
+        b[i][j] = net.getBias(i, j);
+      }
+    }
+  };
+
+  /// Writes the weights and biases into a network (see BasicBackpropagation::readWeights).
+  void writeTo(FastNet::BasicBackpropagation<T> *net) const
+  {
+    std::vector< std::vector<const T*> > rows(w.size());
+    std::vector<const T**> layers(w.size());
+    std::vector<const T*> biases(w.size());
+    for (unsigned i=0; i<w.size(); i++)
+    {
+      for (unsigned j=0; j<w[i].size(); j++) rows[i].push_back(&w[i][j][0]);
+      layers[i] = &rows[i][0];
+      biases[i] = &b[i][0];
+    }
+    net->readWeights(&layers[0], &biases[0]);
+  };
+};
+
+
+template <class T>
+void BasicPCDExtraction<T>::RoundTraining::initNetwork(FastNet::BasicBackpropagation<T> *net, const unsigned seed)
+{
+  //The new node, and its outgoing weights, come from a network initialized by the Nguyen-Widrow
+  //method, and everything else from the network of the previous round (if there is one).
+  FastNet::BasicBackpropagation<T> *fresh = dynamic_cast<FastNet::BasicBackpropagation<T>*>(net->clone());
+  fresh->setPruned(0, false);
+  fresh->setPruned(1, false);
+  fresh->initWeights(seed);
+  const NetworkWeights<T> init(*fresh);
+  delete fresh;
+  NetworkWeights<T> cur = (node) ? NetworkWeights<T>(*net) : init;
+
+  std::vector<T> &row = cur.w[0][node];
+  row = init.w[0][node];
+  cur.b[0][node] = init.b[0][node];
+  for (unsigned j=0; j<cur.w[1].size(); j++) cur.w[1][j][node] = init.w[1][j][node];
+
+  //The nodes after the new one are inactive: null weights, bias and outgoing weights.
+  for (unsigned k=node+1; k<cur.w[0].size(); k++)
+  {
+    std::fill(cur.w[0][k].begin(), cur.w[0][k].end(), 0);
+    cur.b[0][k] = 0;
+    for (unsigned j=0; j<cur.w[1].size(); j++) cur.w[1][j][k] = 0;
+  }
+
+  //Pointing the new node away from the PCDs already extracted (as ortWeights in npcd.m).
+  if (orthogonalize)
+  {
+    const std::vector<T> start = row;
+    for (unsigned i=0; i<node; i++)
+    {
+      const std::vector<T> &pcd = cur.w[0][i];
+      REAL dot = 0.;
+      REAL norm = 0.;
+      for (unsigned k=0; k<pcd.size(); k++)
+      {
+        dot += pcd[k] * start[k];
+        norm += pcd[k] * pcd[k];
+      }
+      if (norm <= 0.) continue;
+      for (unsigned k=0; k<row.size(); k++) row[k] -= static_cast<T>((dot / norm) * pcd[k]);
+    }
+  }
+
+  cur.writeTo(net);
+
+  //The connections of the inactive nodes are pruned, so the mostly null layers of the
+  //first rounds are propagated by the sparse kernels.
+  net->setPruned(0, true);
+  net->setPruned(1, true);
+};
+
+
+template <class T>
+BasicPCDExtraction<T>::BasicPCDExtraction(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *inTrn,
+                                          std::vector<BasicDataManager<T>*> *inVal, std::vector<BasicDataManager<T>*> *inTst,
+                                          const bool usingSP, const unsigned bSize, const REAL signalWeight,
+                                          const REAL noiseWeight, const REAL spResolution)
+{
+  DEBUG1("Starting a PCD Extraction Object");
+  if (net->getNumLayers() < 3) throw "The PCD extraction needs a hidden layer!";
+  if ( (inVal->size() != inTrn->size()) || (inTst->size() != inTrn->size()) ) throw "Every set must have the same number of patterns!";
+
+  //As npcd.m, the Caloba style is taken when there is more than one hidden layer.
+  calobaStyle = (net->getNumLayers() > 3);
+  const std::string &trf = net->getTrfFunc(0);
+  if (calobaStyle)
+  {
+    if ( (trf != LIN_ID) || (net->isUsingBias(0)) ) throw "The first hidden layer must be linear and without bias at the Caloba style!";
+  }
+  else if ( (trf != TGH_ID) && (trf != LIN_ID) && (trf != POSLIN_ID) ) throw "The first hidden layer transfer function must be null at 0!";
+
+  protoNet = net;
+  inTrnList = inTrn;
+  inValList = inVal;
+  inTstList = inTst;
+  useSP = usingSP;
+  batchSize = bSize;
+  this->signalWeight = signalWeight;
+  this->noiseWeight = noiseWeight;
+  this->spResolution = spResolution;
+};
+
+
+template <class T>
+BasicPCDExtraction<T>::~BasicPCDExtraction()
+{
+  release();
+};
+
+
+template <class T>
+void BasicPCDExtraction<T>::release()
+{
+  for (auto &r : rounds) delete r.net;
+  rounds.clear();
+};
+
+
+template <class T>
+REAL BasicPCDExtraction<T>::testSP(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *tst) const
+{
+  //With more than two patterns, the SP is the one of the confusion matrix (see BasicPatternRecognition::multiClassSP).
+  if (tst->size() != 2)
+  {
+    BasicPatternRecognition<T> eval(net, tst, tst, true, batchSize, signalWeight, noiseWeight, spResolution);
+    REAL mse, sp;
+    eval.valNetwork(mse, sp);
+    return sp;
+  }
+
+  std::vector<REAL> outputs[2];
+  for (unsigned p=0; p<2; p++)
+  {
+    outputs[p].resize((*tst)[p]->numEvents());
+    for (unsigned e=0; e<outputs[p].size(); e++) outputs[p][e] = net->propagateInput((*(*tst)[p])[e])[0];
+  }
+  const FastNet::RocCurve roc = FastNet::calculateRoc(&outputs[0][0], outputs[0].size(), &outputs[1][0], outputs[1].size(),
+                                                      signalWeight, noiseWeight);
+  return roc.sp[roc.best];
+};
+
+
+template <class T>
+unsigned BasicPCDExtraction<T>::extract(const unsigned numIterations, const REAL minDiff, const unsigned nPCD, const unsigned seed,
+                                        const unsigned nEpochs, const unsigned failLimit)
+{
+  const unsigned maxNumPCD = (*protoNet)[1];
+  if (nPCD > maxNumPCD) throw "There are not enough nodes in the first hidden layer for the PCDs!";
+  const unsigned numPCD = (nPCD) ? nPCD : maxNumPCD;
+  DEBUG1("Extracting up to " << numPCD << " PCDs (" << ((calobaStyle) ? "Caloba" : "Seixas") << " style), with "
+          << numIterations << " trainings each.");
+  release();
+
+  const unsigned numPatterns = inTrnList->size();
+  for (unsigned p=0; p<numPatterns; p++)
+  {
+    if (!(*inTstList)[p]->numEvents()) throw "Every pattern must have testing events!";
+  }
+
+  //At the Caloba style, the PCDs are removed from copies of the events.
+  std::vector<BasicResidualDataManager<T>*> residual;
+  std::vector<BasicDataManager<T>*> trn, val, tst;
+  FastNet::BasicBackpropagation<T> *net = NULL;
+
+  try
+  {
+    if (calobaStyle)
+    {
+      for (unsigned p=0; p<numPatterns; p++)
+      {
+        residual.push_back(new BasicResidualDataManager<T>(*(*inTrnList)[p], 0));
+        trn.push_back(residual.back());
+        residual.push_back(new BasicResidualDataManager<T>(*(*inValList)[p], 0));
+        val.push_back(residual.back());
+        residual.push_back(new BasicResidualDataManager<T>(*(*inTstList)[p], 0));
+        tst.push_back(residual.back());
+      }
+    }
+    else
+    {
+      trn = *inTrnList;
+      val = *inValList;
+      tst = *inTstList;
+    }
+
+    //Only the node of the round is trained (see RoundTraining::initNetwork).
+    net = dynamic_cast<FastNet::BasicBackpropagation<T>*>(protoNet->clone());
+    net->setFrozen(0, true);
+
+    std::mt19937 seeder(seed);
+    REAL prevMaxSP = 0.;
+    unsigned mfCount = 0;
+    for (unsigned k=0; k<numPCD; k++)
+    {
+      DEBUG1("Extracting the PCD " << k << ".");
+      net->setFrozen(0, k, false);
+      RoundTraining round(net, &trn, &val, useSP, batchSize, signalWeight, noiseWeight, spResolution, k, (calobaStyle && k));
+      round.train(numIterations, static_cast<unsigned>(seeder()), nEpochs, failLimit);
+      const std::vector< BasicTrainRun<T> > &runs = round.getRuns();
+
+      //The PCD of the round comes from the training of the highest testing SP.
+      std::vector<REAL> sp(runs.size());
+      const char *errorMsg = NULL;
+      bool noMemory = false;
+      int i;
+
+      #pragma omp parallel for schedule(dynamic,1) shared(sp,errorMsg,noMemory) private(i)
+      for (i=0; i<static_cast<int>(runs.size()); i++)
+      {
+        try
+        {
+          sp[i] = testSP(runs[i].net, &tst);
+        }
+        catch (bad_alloc xa)
+        {
+          #pragma omp critical
+          noMemory = true;
+        }
+        catch (const char *msg)
+        {
+          #pragma omp critical
+          errorMsg = msg;
+        }
+      }
+      if (noMemory) throw bad_alloc();
+      if (errorMsg) throw errorMsg;
+
+      unsigned best = 0;
+      for (unsigned r=1; r<runs.size(); r++) if (sp[r] > sp[best]) best = r;
+
+      BasicPCDRound<T> res;
+      res.net = NULL;
+      res.trnEvolution = runs[best].trnEvolution;
+      res.sp = sp[best];
+      res.pcd.resize((*protoNet)[0]);
+      REAL norm = 0.;
+      for (unsigned n=0; n<res.pcd.size(); n++)
+      {
+        res.pcd[n] = runs[best].net->getWeight(0, k, n);
+        norm += res.pcd[n] * res.pcd[n];
+      }
+      if ( (calobaStyle) && (norm > 0.) )
+      {
+        norm = sqrt(norm);
+        for (auto &x : res.pcd) x /= norm;
+      }
+      rounds.push_back(res);
+      rounds.back().net = dynamic_cast<FastNet::BasicBackpropagation<T>*>(runs[best].net->clone());
+      DEBUG1("PCD " << k << " extracted by the training " << best << " (testing SP = " << res.sp << ").");
+
+      //If the SP gain is below the minimum, the stopping countdown goes on (as npcd.m).
+      const REAL maxSP = 100 * res.sp;
+      const REAL spDiff = (maxSP > 0.) ? 100 * (maxSP - prevMaxSP) / maxSP : 0.;
+      mfCount = (spDiff < minDiff) ? (mfCount + 1) : 0;
+      if ( (!nPCD) && (mfCount == MAX_FAIL) ) break;
+      prevMaxSP = maxSP;
+
+      //The next round starts from the best network, with the PCD frozen (normalized, at the Caloba style).
+      delete net;
+      net = NULL;
+      net = dynamic_cast<FastNet::BasicBackpropagation<T>*>(rounds.back().net->clone());
+      net->setFrozen(0, k, true);
+      if (calobaStyle)
+      {
+        NetworkWeights<T> next(*net);
+        for (unsigned n=0; n<res.pcd.size(); n++) next.w[0][k][n] = static_cast<T>(res.pcd[n]);
+        next.writeTo(net);
+        for (auto &x : residual) x->removeDirection(res.pcd);
+      }
+    }
+  }
+  catch (...)
+  {
+    if (net != NULL) delete net;
+    for (auto &x : residual) delete x;
+    throw;
+  }
+
+  delete net;
+  for (auto &x : residual) delete x;
+  DEBUG1(rounds.size() << " PCDs extracted.");
+  return rounds.size();
+};
+
+
+template class BasicPCDExtraction<float>;
+template class BasicPCDExtraction<double>;
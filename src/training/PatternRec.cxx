@@ -1,10 +1,11 @@
 #include "fastnet/training/PatternRec.h"
 
-PatternRecognition::PatternRecognition(FastNet::Backpropagation *net, std::vector<DataManager*> *inTrn, 
-                                        std::vector<DataManager*> *inVal,  
-                                        const bool usingSP, const unsigned bSize,
-                                        const REAL signalWeight, const REAL noiseWeight) 
-                                        : Training(net, bSize)
+template <class T>
+BasicPatternRecognition<T>::BasicPatternRecognition(FastNet::BasicBackpropagation<T> *net, std::vector<BasicDataManager<T>*> *inTrn, 
+                                                    std::vector<BasicDataManager<T>*> *inVal,  
+                                                    const bool usingSP, const unsigned bSize,
+                                                    const REAL signalWeight, const REAL noiseWeight, const REAL spResolution) 
+                                                    : BasicTraining<T>(net, bSize)
 {
   DEBUG1("Starting a Pattern Recognition Training Object");
   
@@ -14,8 +15,11 @@ PatternRecognition::PatternRecognition(FastNet::Backpropagation *net, std::vecto
   // Initialize weights for SP calculation
   this->signalWeight = signalWeight;
   this->noiseWeight = noiseWeight;
+  this->spResolution = spResolution;
 
   useSP = usingSP;
+  cacheSize = 0;
+  cacheReady = false;
   if (useSP)
   {
     bestGoalSP = 0.;
@@ -23,41 +27,45 @@ PatternRecognition::PatternRecognition(FastNet::Backpropagation *net, std::vecto
   }
   else DEBUG2("I'll NOT use SP validating criterium.");
   
-  //Allocating space for the network outputs if SP criteria is selected.
-  if (useSP)
-  {
-    for (const auto &patData : (*inTrnList) )
-    {
-      epochValOutputs.push_back(new REAL[patData->numEvents()]);
-    }
-  }
-  
   //Creating the targets for each class (maximum sparsed oututs).
   const auto numPatterns = inTrn->size();
   DEBUG2("Number of patterns: " << numPatterns);
   const auto outputSize = (numPatterns == 2) ? 1 : numPatterns;
   for (auto i=0; i<numPatterns; i++)
   {
-    REAL *target = new REAL [outputSize];
+    T *target = new T [outputSize];
     for (auto j=0; j<outputSize; j++) target[j] = -1;
     target[i] = 1;
     //Saving the target in the list.
     targList.push_back(target);    
   }
+
+  //The SP cuts and the output histograms, if SP criteria is selected for a two patterns discriminator.
+  //With more patterns, the SP comes from the confusion matrix.
+  epochValConf.assign(numPatterns*numPatterns, 0);
+  if ( (useSP) && (numPatterns == 2) )
+  {
+    if (spResolution <= 0.) throw "The SP resolution must be positive!";
+    const REAL signalTarget = std::max(targList[0][0], targList[1][0]);
+    const REAL noiseTarget = std::min(targList[0][0], targList[1][0]);
+    for (REAL pos = noiseTarget; pos < signalTarget; pos += spResolution) spCuts.push_back(pos);
+    epochValHist.assign(numPatterns, std::vector<unsigned>(spCuts.size() + 1, 0));
+  }
   
   DEBUG2("Input events dimension: " << (*inTrn)[0]->eventSize());
   DEBUG2("Output events dimension: " << outputSize);
 };
 
 
-PatternRecognition::~PatternRecognition()
+template <class T>
+BasicPatternRecognition<T>::~BasicPatternRecognition()
 {
-  for (auto &v : epochValOutputs) delete [] v;
   for (auto &v : targList) delete [] v;
 };
 
 
-REAL PatternRecognition::sp(const std::vector<DataManager*> *inList, const std::vector<REAL*> &epochOutputs)
+template <class T>
+REAL BasicPatternRecognition<T>::sp(const std::vector<BasicDataManager<T>*> *inList, const std::vector< std::vector<unsigned> > &epochHist)
 {
   unsigned TARG_SIGNAL, TARG_NOISE;
   
@@ -74,47 +82,25 @@ REAL PatternRecognition::sp(const std::vector<DataManager*> *inList, const std::
     TARG_SIGNAL = 1;
   }
 
-  const REAL *signal = epochOutputs[TARG_SIGNAL];
-  const REAL *noise = epochOutputs[TARG_NOISE];
-  const REAL signalTarget = targList[TARG_SIGNAL][0];
-  const REAL noiseTarget = targList[TARG_NOISE][0];
-  const int numSignalEvents = static_cast<int>((*inList)[TARG_SIGNAL]->numEvents());
-  const int numNoiseEvents = static_cast<int>((*inList)[TARG_NOISE]->numEvents());
-  const REAL RESOLUTION = 0.01;
+  const std::vector<unsigned> &signal = epochHist[TARG_SIGNAL];
+  const std::vector<unsigned> &noise = epochHist[TARG_NOISE];
+  const REAL numSignalEvents = static_cast<REAL>((*inList)[TARG_SIGNAL]->numEvents());
+  const REAL numNoiseEvents = static_cast<REAL>((*inList)[TARG_NOISE]->numEvents());
   REAL maxSP = -1.;
-  int i;
-  int chunk = chunkSize;
 
+  //The signal events above each cut, and the noise events below it, as cumulative sums of the histograms.
+  unsigned se = 0;
+  unsigned ne = 0;
+  for (unsigned k=1; k<signal.size(); k++) se += signal[k];
 
-  for (REAL pos = noiseTarget; pos < signalTarget; pos += RESOLUTION)
+  for (unsigned k=0; k<spCuts.size(); k++)
   {
-    REAL sigEffic = 0.;
-    REAL noiseEffic = 0.;
-    unsigned se, ne;
-    
-    #pragma omp parallel shared(signal, noise, sigEffic, noiseEffic) private(i,se,ne)
-    {
-      se = ne = 0;
-      
-      #pragma omp for schedule(dynamic,chunk) nowait
-      for (i=0; i<numSignalEvents; i++) if (signal[i] >= pos) se++;
-      
-      #pragma omp critical
-      sigEffic += static_cast<REAL>(se);
-
-      #pragma omp for schedule(dynamic,chunk) nowait
-      for (i=0; i<numNoiseEvents; i++) if (noise[i] < pos) ne++;
-      
-      #pragma omp critical
-      noiseEffic += static_cast<REAL>(ne);
-    }
-    
-    sigEffic /= static_cast<REAL>(numSignalEvents);
-    noiseEffic /= static_cast<REAL>(numNoiseEvents);
+    ne += noise[k];
+    if (k) se -= signal[k];
 
     // Use weights for signal and noise efficiencies
-    sigEffic *= signalWeight;
-    noiseEffic *= noiseWeight;
+    const REAL sigEffic = (static_cast<REAL>(se) / numSignalEvents) * signalWeight;
+    const REAL noiseEffic = (static_cast<REAL>(ne) / numNoiseEvents) * noiseWeight;
 
     //Using normalized SP calculation.
     const REAL sp = ((sigEffic + noiseEffic) / 2) * sqrt(sigEffic * noiseEffic);
@@ -125,87 +111,192 @@ REAL PatternRecognition::sp(const std::vector<DataManager*> *inList, const std::
 };
 
 
-void PatternRecognition::getNetworkErrors(const std::vector<DataManager*> *inList,
-                                           std::vector<REAL*> &epochOutputs, REAL &mseRet, REAL &spRet)
+template <class T>
+REAL BasicPatternRecognition<T>::multiClassSP(const std::vector<unsigned> &epochConf)
+{
+  const unsigned numPatterns = targList.size();
+  REAL sum = 0.;
+  REAL prod = 1.;
+
+  for (unsigned i=0; i<numPatterns; i++)
+  {
+    unsigned numEvents = 0;
+    for (unsigned j=0; j<numPatterns; j++) numEvents += epochConf[i*numPatterns + j];
+    const REAL effic = (numEvents) ? static_cast<REAL>(epochConf[i*numPatterns + i]) / numEvents : 0.;
+    sum += effic;
+    prod *= effic;
+  }
+
+  return sqrt(pow(prod, 1. / numPatterns) * (sum / numPatterns));
+};
+
+
+template <class T>
+void BasicPatternRecognition<T>::buildCaches()
 {
-  REAL gbError = 0.;
-  FastNet::Backpropagation **nv = netVec;
+  cacheReady = true;
+  cacheSize = mainNet->getFrozenCacheSize();
+  if (!cacheSize) return;
+
+  DEBUG2("Caching " << cacheSize << " frozen values per event (from the layer " << mainNet->getCachedLayer() << ").");
+  buildCache(inTrnList, trnCache);
+  buildCache(inValList, valCache);
+};
+
+
+template <class T>
+void BasicPatternRecognition<T>::buildCache(const std::vector<BasicDataManager<T>*> *inList, std::vector< std::vector<T> > &cache)
+{
+  const FastNet::BasicBackpropagation<T> *net = mainNet;
+  typename BasicTraining<T>::Workspace * const *ws = &wsVec[0];
+  const unsigned block = FastNet::BasicNeuralNetwork<T>::BATCH_BLOCK;
+  cache.resize(inList->size());
+
+  for (unsigned pat=0; pat<inList->size(); pat++)
+  {
+    const BasicDataManager<T> *input = (*inList)[pat];
+    const int nEvents = input->numEvents();
+    const int numBlocks = static_cast<int>((nEvents + block - 1) / block);
+    cache[pat].resize(static_cast<size_t>(nEvents) * cacheSize);
+    T *c = (nEvents) ? &cache[pat][0] : NULL;
+    int b;
+
+    #pragma omp parallel for schedule(dynamic) shared(input,net,ws,c) private(b)
+    for (b=0; b<numBlocks; b++)
+    {
+      const unsigned blockSize = std::min(block, static_cast<unsigned>(nEvents - b*block));
+      const T *inputs[block];
+      for (unsigned e=0; e<blockSize; e++) inputs[e] = (*input)[b*block + e];
+      net->cacheFrozen(inputs, blockSize, c + static_cast<size_t>(b)*block*cacheSize, *ws[omp_get_thread_num()]);
+    }
+  }
+};
+
+
+template <class T>
+void BasicPatternRecognition<T>::getNetworkErrors(const std::vector<BasicDataManager<T>*> *inList,
+                                                  const std::vector< std::vector<T> > *cache,
+                                                  std::vector< std::vector<unsigned> > &epochHist,
+                                                  std::vector<unsigned> &epochConf, REAL &mseRet, REAL &spRet)
+{
+  ACC_REAL gbError = 0.;
+  const FastNet::BasicBackpropagation<T> *net = mainNet;
+  typename BasicTraining<T>::Workspace * const *ws = &wsVec[0];
+  const unsigned numPatterns = inList->size();
+  const bool useHist = (useSP) && (numPatterns == 2);
   int totEvents = 0;
+  std::fill(epochConf.begin(), epochConf.end(), 0);
   
-  for (auto pat=0; pat<inList->size(); pat++)
+  for (unsigned pat=0; pat<numPatterns; pat++)
   {
  
-    const REAL *target = targList[pat];
-    const DataManager *input = (*inList)[pat];
-    const REAL *output;
+    const T *target = targList[pat];
+    const BasicDataManager<T> *input = (*inList)[pat];
+    const T *patCache = ( (cache) && (!(*cache)[pat].empty()) ) ? &(*cache)[pat][0] : NULL;
+    const unsigned cSize = cacheSize;
+    const T *output;
     const int numEvents = input->numEvents();
-    REAL error = 0.;
+    ACC_REAL error = 0.;
     int i, thId;
     int chunk = chunkSize;
     totEvents += numEvents;
 
-    REAL *outList = (useSP) ? epochOutputs[pat] : NULL;
+    //Each thread fills its own histogram of the outputs and its row of the confusion matrix,
+    //added to the pattern ones at the end.
+    std::vector<unsigned> *hist = (useHist) ? &epochHist[pat] : NULL;
+    const unsigned numBins = (useHist) ? hist->size() : 0;
+    if (useHist) std::fill(hist->begin(), hist->end(), 0);
+    unsigned *confRow = &epochConf[pat*numPatterns];
     
     DEBUG2("Applying performance calculation for pattern " << pat << " (" << numEvents << " events).");
     
-    #pragma omp parallel shared(input,target,chunk,nv,gbError,pat) private(i,thId,output,error)
+    #pragma omp parallel shared(input,target,chunk,net,ws,gbError,pat,hist,confRow,patCache) private(i,thId,output,error)
     {
       thId = omp_get_thread_num();
       error = 0.;
+      std::vector<unsigned> thHist(numBins, 0);
+      std::vector<unsigned> thConf(numPatterns, 0);
 
       #pragma omp for schedule(dynamic,chunk) nowait
       for (i=0; i<numEvents; i++)
       {
-        error += nv[thId]->applySupervisedInput((*input)[i], target, output);
-        if (useSP) outList[i] = output[0];
+        if (patCache) error += net->applySupervisedInput((*input)[i], patCache + static_cast<size_t>(i)*cSize, target, output, *ws[thId]);
+        else error += net->applySupervisedInput((*input)[i], target, output, *ws[thId]);
+        thConf[classify(output)]++;
+        if (useHist)
+        {
+          const REAL out = output[0];
+          if (out == out) thHist[spBin(out)]++;
+        }
       }
 
       #pragma omp critical
-      gbError += error;
+      {
+        gbError += error;
+        for (unsigned k=0; k<numBins; k++) (*hist)[k] += thHist[k];
+        for (unsigned k=0; k<numPatterns; k++) confRow[k] += thConf[k];
+      }
     }
   }
 
   mseRet = gbError / static_cast<REAL>(totEvents);
-  if (useSP)  spRet = sp(inList, epochOutputs);
+  if (useSP) spRet = (useHist) ? sp(inList, epochHist) : multiClassSP(epochConf);
 };
 
 
-REAL PatternRecognition::trainNetwork()
+template <class T>
+REAL BasicPatternRecognition<T>::trainNetwork()
 {
   DEBUG2("Starting training process for an epoch.");
-  REAL gbError = 0;
-  FastNet::Backpropagation **nv = netVec;
+  if (!cacheReady) buildCaches();
+  ACC_REAL gbError = 0;
+  const FastNet::BasicBackpropagation<T> *net = mainNet;
+  typename BasicTraining<T>::Workspace * const *ws = &wsVec[0];
   int totEvents = 0; // Holds the amount of events presented to the network.
 
   for(unsigned pat=0; pat<inTrnList->size(); pat++)
   {
     //wFactor will allow each pattern to have the same relevance, despite the number of events it contains.
-    const REAL *target = targList[pat];
-    DataManager *input = (*inTrnList)[pat];
-    const REAL *output;
-    REAL error = 0.;
-    int i, thId;
-    int chunk = chunkSize;
-    unsigned pos = 0;
+    const T *target = targList[pat];
+    BasicDataManager<T> *input = (*inTrnList)[pat];
+    const T *patCache = (cacheSize) ? &trnCache[pat][0] : NULL;
+    const unsigned cSize = cacheSize;
+    ACC_REAL error = 0.;
+    int b, thId;
 
     const int nEvents = (batchSize) ? batchSize : input->numEvents();
+    const unsigned block = FastNet::BasicNeuralNetwork<T>::BATCH_BLOCK;
+    const int numBlocks = static_cast<int>((nEvents + block - 1) / block);
     totEvents += nEvents;
     DEBUG2("Applying training set for pattern " << pat << " by randomly selecting " << nEvents << " events (out of " << input->numEvents() << ").");
     
-    #pragma omp parallel shared(input,target,chunk,nv,gbError,pat) private(i,thId,output,error,pos)
+    //The events of the epoch are drawn beforehand, so each block reads its own indices.
+    const unsigned *evIdx = input->drawEpoch(nEvents);
+
+    //Each thread trains the network with whole blocks of events at once, in its own workspace.
+    #pragma omp parallel shared(input,target,net,ws,evIdx,gbError,pat,patCache) private(b,thId,error)
     {
       thId = omp_get_thread_num();
       error = 0.;
+      const T *inputs[block];
+      const T *cached[block];
+      const T *targets[block];
+      for (unsigned e=0; e<block; e++) targets[e] = target;
 
-      #pragma omp for schedule(dynamic,chunk) nowait
-      for (i=0; i<nEvents; i++)
+      //The next permutation is shuffled by one of the threads, while the others train.
+      #pragma omp single nowait
+      input->prepareNext();
+
+      #pragma omp for schedule(dynamic) nowait
+      for (b=0; b<numBlocks; b++)
       {
-        #pragma omp critical
-        pos = input->getNextEventIndex();
+        const unsigned blockSize = std::min(block, static_cast<unsigned>(nEvents - b*block));
+        const unsigned *pos = evIdx + b*block;
+        for (unsigned e=0; e<blockSize; e++) inputs[e] = (*input)[pos[e]];
+        if (patCache) for (unsigned e=0; e<blockSize; e++) cached[e] = patCache + static_cast<size_t>(pos[e])*cSize;
 
-        error += nv[thId]->applySupervisedInput((*input)[pos], target, output);
-        //Calculating the weight and bias update values.
-        nv[thId]->calculateNewWeights(output, target);
+        //Calculating the errors and the weight and bias update values (the frozen leading nodes from the caches).
+        error += net->applySupervisedBatch(inputs, (patCache) ? cached : NULL, targets, blockSize, *ws[thId]);
       }
 
       #pragma omp critical
@@ -219,17 +310,19 @@ REAL PatternRecognition::trainNetwork()
 };
   
 
-void PatternRecognition::showInfo(const unsigned nEpochs) const
+template <class T>
+void BasicPatternRecognition<T>::showInfo(const unsigned nEpochs) const
 {
   REPORT("TRAINING DATA INFORMATION (Pattern Recognition Optimized Network)");
   REPORT("Number of Epochs          : " << nEpochs);
   REPORT("Using SP Stopping Criteria      : " << ((useSP) ? "true" : "false"));
 };
 
-void PatternRecognition::isBestNetwork(const REAL currMSEError, const REAL currSPError, ValResult &isBestMSE, ValResult &isBestSP)
+template <class T>
+void BasicPatternRecognition<T>::isBestNetwork(const REAL currMSEError, const REAL currSPError, ValResult &isBestMSE, ValResult &isBestSP)
 {
   //Knowing whether we have a better network, according to the MSE validation criterium.
-  Training::isBestNetwork(currMSEError, currSPError, isBestMSE, isBestSP);
+  BasicTraining<T>::isBestNetwork(currMSEError, currSPError, isBestMSE, isBestSP);
 
   //Knowing whether we have a better network, according to the SP validation criterium.  
   if (useSP)
@@ -244,9 +337,13 @@ void PatternRecognition::isBestNetwork(const REAL currMSEError, const REAL currS
   }
 };
 
-void PatternRecognition::showTrainingStatus(const unsigned epoch, const REAL trnError, const REAL valError)
+template <class T>
+void BasicPatternRecognition<T>::showTrainingStatus(const unsigned epoch, const REAL trnError, const REAL valError)
 {
   if (useSP) {REPORT("Epoch " << setw(5) << epoch << ": mse (train) = " << trnError << " SP (val) = " << valError)}
-  else Training::showTrainingStatus(epoch, trnError, valError);
+  else BasicTraining<T>::showTrainingStatus(epoch, trnError, valError);
 };
 
+
+template class BasicPatternRecognition<float>;
+template class BasicPatternRecognition<double>;
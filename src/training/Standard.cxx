@@ -1,6 +1,8 @@
 #include "fastnet/training/Standard.h"
 
-StandardTraining::StandardTraining(FastNet::Backpropagation *net, DataManager *inTrn, DataManager *outTrn, DataManager *inVal, DataManager *outVal, const unsigned bSize) : Training(net, bSize)
+template <class T>
+BasicStandardTraining<T>::BasicStandardTraining(FastNet::BasicBackpropagation<T> *net, BasicDataManager<T> *inTrn, BasicDataManager<T> *outTrn, 
+                                                BasicDataManager<T> *inVal, BasicDataManager<T> *outVal, const unsigned bSize) : BasicTraining<T>(net, bSize)
 {
   DEBUG2("Creating StandardTraining object.");
   
@@ -10,22 +12,24 @@ StandardTraining::StandardTraining(FastNet::Backpropagation *net, DataManager *i
   outValData = outVal;
 };
 
-void StandardTraining::valNetwork(REAL &mseVal, REAL &spVal)
+template <class T>
+void BasicStandardTraining<T>::valNetwork(REAL &mseVal, REAL &spVal)
 {
-  REAL gbError = 0.;
-  REAL error = 0.;
-  const REAL *output;
+  ACC_REAL gbError = 0.;
+  ACC_REAL error = 0.;
+  const T *output;
 
-  const DataManager *input = inValData;
-  const DataManager *target = outValData;
+  const BasicDataManager<T> *input = inValData;
+  const BasicDataManager<T> *target = outValData;
   const int numEvents = static_cast<int>(inValData->numEvents());
   DEBUG2("Running this validating epoch with " << numEvents << " events.");
   
   int chunk = chunkSize;
   int i, thId;
-  FastNet::Backpropagation **nv = netVec;
+  const FastNet::BasicBackpropagation<T> *net = mainNet;
+  typename BasicTraining<T>::Workspace * const *ws = &wsVec[0];
 
-  #pragma omp parallel shared(input,target,chunk,nv,gbError) private(i,thId,output,error)
+  #pragma omp parallel shared(input,target,chunk,net,ws,gbError) private(i,thId,output,error)
   {
     thId = omp_get_thread_num();
     error = 0.;
@@ -33,7 +37,7 @@ void StandardTraining::valNetwork(REAL &mseVal, REAL &spVal)
     #pragma omp for schedule(dynamic,chunk) nowait
     for (i=0; i<numEvents; i++)
     {
-      error += nv[thId]->applySupervisedInput((*input)[i], (*target)[i], output);
+      error += net->applySupervisedInput((*input)[i], (*target)[i], output, *ws[thId]);
     }
 
     #pragma omp critical
@@ -44,35 +48,50 @@ void StandardTraining::valNetwork(REAL &mseVal, REAL &spVal)
 };
 
 
-REAL StandardTraining::trainNetwork()
+template <class T>
+REAL BasicStandardTraining<T>::trainNetwork()
 {
-  unsigned pos;
-  REAL gbError = 0.;
-  REAL error = 0.;
-  const REAL *output;
+  ACC_REAL gbError = 0.;
+  ACC_REAL error = 0.;
 
-  DataManager *input = inTrnData;
-  const DataManager *target = outTrnData;
+  BasicDataManager<T> *input = inTrnData;
+  const BasicDataManager<T> *target = outTrnData;
 
-  int chunk = chunkSize;
-  int i, thId;
-  FastNet::Backpropagation **nv = netVec;
+  int b, thId;
+  const FastNet::BasicBackpropagation<T> *net = mainNet;
+  typename BasicTraining<T>::Workspace * const *ws = &wsVec[0];
   const int nEvents = (batchSize) ? batchSize : input->numEvents();
+  const unsigned block = FastNet::BasicNeuralNetwork<T>::BATCH_BLOCK;
+  const int numBlocks = static_cast<int>((nEvents + block - 1) / block);
   DEBUG2("Running this training epoch with " << nEvents << " events as batch size.");
 
-  #pragma omp parallel shared(input,target,chunk,nv,gbError) private(i,thId,output,error,pos)
+  //The events of the epoch are drawn beforehand, so each block reads its own indices.
+  const unsigned *evIdx = input->drawEpoch(nEvents);
+
+  //Each thread trains the network with whole blocks of events at once, in its own workspace.
+  #pragma omp parallel shared(input,target,net,ws,evIdx,gbError) private(b,thId,error)
   {
     thId = omp_get_thread_num(); 
     error = 0.;
+    const T *inputs[block];
+    const T *targets[block];
 
-    #pragma omp for schedule(dynamic,chunk) nowait
-    for (i=0; i<nEvents; i++)
+    //The next permutation is shuffled by one of the threads, while the others train.
+    #pragma omp single nowait
+    input->prepareNext();
+
+    #pragma omp for schedule(dynamic) nowait
+    for (b=0; b<numBlocks; b++)
     {
-        #pragma omp critical
-        pos = input->getNextEventIndex();
-        
-        error += nv[thId]->applySupervisedInput((*input)[pos], (*target)[pos], output);
-        nv[thId]->calculateNewWeights(output, (*target)[pos]);
+      const unsigned blockSize = std::min(block, static_cast<unsigned>(nEvents - b*block));
+      const unsigned *pos = evIdx + b*block;
+      for (unsigned e=0; e<blockSize; e++)
+      {
+        inputs[e] = (*input)[pos[e]];
+        targets[e] = (*target)[pos[e]];
+      }
+
+      error += net->applySupervisedBatch(inputs, targets, blockSize, *ws[thId]);
     }
 
     #pragma omp critical
@@ -85,8 +104,13 @@ REAL StandardTraining::trainNetwork()
 }
 
   
-void StandardTraining::showInfo(const unsigned nEpochs) const
+template <class T>
+void BasicStandardTraining<T>::showInfo(const unsigned nEpochs) const
 {
   REPORT("TRAINING DATA INFORMATION (Standard Network)");
   REPORT("Number of Epochs          : " << nEpochs);
 };
+
+
+template class BasicStandardTraining<float>;
+template class BasicStandardTraining<double>;
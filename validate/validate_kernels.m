@@ -0,0 +1,105 @@
+clear all;
+close all;
+
+%Compares the kernel tables (scalar, SSE2, AVX2 and AVX-512) against each other, over
+%the propagation (float, int8 and int16), the training (trainMany) and the PCD
+%extraction (npcd). The table is chosen once per process, on first use (it can be
+%forced by the FASTNET_KERNELS environment variable), and it is kept by the shared
+%libraries even after a "clear mex". So this script runs once per table in a new
+%Matlab process, with FASTNET_KERNELS set, and the parent compares the results. A
+%table the CPU does not support makes its process fail, and it is reported as such.
+%The integer kernels accumulate exactly, so their outputs should match to the bit.
+%The float kernels may round differently (summation order and FMA), which
+%changes the propagation in the last bits. Over a training, these differences
+%grow with every epoch, so the trained networks are compared by their SP.
+
+resultFile = getenv('FASTNET_VALIDATE_KERNELS');
+tables = {'scalar', 'sse2', 'avx2', 'avx512'};
+inFile = fullfile(tempdir, 'validate_kernels_in.mat');
+
+if ~isempty(resultFile),
+  %Worker: runs everything with the kernel table given by FASTNET_KERNELS.
+  load(inFile);
+  path(searchPath);
+  calib = [inTrn{:}];
+  out = nsim(net, inTst);
+  out8 = nsim(net, inTst, 'int8', calib);
+  out16 = nsim(net, inTst, 'int16', calib);
+  [oNet, I] = trainMany(net, inTrn, inVal, inTst, numTrains, seed);
+  trnSP = zeros(1,numTrains);
+  for i=1:numTrains,
+    trnOut = nsim(oNet{i}.net, inTst);
+    trnSP(i) = max(genROC(trnOut{1}, trnOut{2}));
+  end
+  pcd = npcd(net, inTrn, inVal, inTst, 2, 0.01, nPCD, seed);
+  save(resultFile, 'out', 'out8', 'out16', 'trnSP', 'pcd');
+  return;
+end
+
+%Creating the data for validation.
+Nev = 9000;
+c1 = randn(8, Nev);
+c2 = randn(8, Nev) + 0.8;
+
+%Creating the training, validating and testing data sets.
+inTrn = {c1(:,1:3:end) c2(:,1:3:end)};
+inVal = {c1(:,2:3:end) c2(:,2:3:end)};
+inTst = {c1(:,3:3:end) c2(:,3:3:end)};
+
+%The 16 hidden nodes fill every vector width (2 to 8 doubles, 4 to 16 floats).
+net = newff2(inTrn, [1 -1], 16, {'tansig','tansig'});
+net.trainParam.epochs = 100;
+net.trainParam.max_fail = 100;
+net.trainParam.show = 1000000;
+net.trainParam.batchSize = 1000;
+net.trainParam.useSP = false;
+numTrains = 4;
+nPCD = 2;
+seed = 12345;
+searchPath = path;
+save(inFile, 'net', 'inTrn', 'inVal', 'inTst', 'numTrains', 'nPCD', 'seed', 'searchPath');
+
+%Running each table in its own Matlab process.
+matlabExe = fullfile(matlabroot, 'bin', 'matlab');
+res = cell(1, length(tables));
+for t=1:length(tables),
+  resultFile = fullfile(tempdir, sprintf('validate_kernels_%s.mat', tables{t}));
+  if exist(resultFile, 'file'), delete(resultFile); end
+  cmd = sprintf(['FASTNET_KERNELS=%s FASTNET_VALIDATE_KERNELS=''%s'' ''%s'' -nodisplay -nosplash -r ' ...
+                 '"try, run(''%s''); catch e, disp(e.message); exit(1); end; exit(0);"'], ...
+                tables{t}, resultFile, matlabExe, [mfilename('fullpath') '.m']);
+  [status, msg] = system(cmd);
+  if (status == 0) && exist(resultFile, 'file'),
+    res{t} = load(resultFile);
+    delete(resultFile);
+  else
+    fprintf('The %s table failed (not supported by this CPU?):\n%s\n', tables{t}, msg);
+  end
+end
+delete(inFile);
+
+%The maximum absolute deviation between every pair of tables.
+fields = {'out', 'out8', 'out16', 'trnSP', 'pcd'};
+names = {'float', 'int8', 'int16', 'train SP', 'PCD'};
+for f=1:length(fields),
+  fprintf('\nMax deviation (%s)\n%-8s', names{f}, '');
+  fprintf('%12s', tables{:});
+  fprintf('\n');
+  for a=1:length(tables),
+    fprintf('%-8s', tables{a});
+    for b=1:length(tables),
+      if isempty(res{a}) || isempty(res{b}),
+        fprintf('%12s', '-');
+      else
+        va = res{a}.(fields{f});
+        vb = res{b}.(fields{f});
+        if iscell(va),
+          va = [va{:}];
+          vb = [vb{:}];
+        end
+        fprintf('%12.3g', max(abs(va(:) - vb(:))));
+      end
+    end
+    fprintf('\n');
+  end
+end
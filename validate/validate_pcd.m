@@ -0,0 +1,123 @@
+clear all;
+close all;
+
+%Compares the native PCD extraction (npcd, through pcd_c) with the previous
+%Matlab loop, which rebuilt a network for every PCD (freezing the PCDs already
+%extracted) and trained it numIterations times through ntrain. Both styles are
+%checked: Seixas (one hidden layer) and Caloba (two hidden layers, linear first
+%layer without bias, orthogonal PCDs). The initial weights differ between the two
+%versions, so the PCDs are compared by their testing SP and by the angle between
+%the subspaces they span, and the extraction times are reported.
+
+%Creating the data for validation: the classes only differ along 2 of the 6 directions.
+nDim = 6;
+Nev = 9000;
+mix = orth(randn(nDim));
+c1 = mix * randn(nDim, Nev);
+c2 = mix * [2 + randn(1,Nev); 0.5*randn(1,Nev) - 1.5; randn(nDim-2,Nev)];
+
+%Creating the training, validating and testing data sets.
+inTrn = {c1(:,1:3:end) c2(:,1:3:end)};
+inVal = {c1(:,2:3:end) c2(:,2:3:end)};
+inTst = {c1(:,3:3:end) c2(:,3:3:end)};
+
+nPCD = 3;
+numIterations = 5;
+styles = {'Seixas', 'Caloba'};
+hidNodes = {nPCD, [nPCD 4]};
+trfFuncs = {{'tansig', 'tansig'}, {'purelin', 'tansig', 'tansig'}};
+
+for s=1:length(styles),
+  %The template network (the first hidden layer holds a node per PCD).
+  net = newff2(inTrn, [-1 1], hidNodes{s}, trfFuncs{s});
+  net.trainParam.epochs = 500;
+  net.trainParam.max_fail = 20;
+  net.trainParam.show = 1000000;
+  net.trainParam.batchSize = 1000;
+  net.trainParam.useSP = false;
+  caloba = strcmp(styles{s}, 'Caloba');
+  if caloba,
+    net.layers{1}.userdata.usingBias = false;
+  end
+
+  %Native extraction.
+  tic
+  [nativePCD, nativeNet, nativeEvo, nativeSP] = npcd(net, inTrn, inVal, inTst, numIterations, 0.01, nPCD);
+  nativeTime = toc;
+
+  %The previous Matlab loop.
+  tic
+  matPCD = [];
+  matBias = [];
+  matSP = zeros(1,nPCD);
+  trn = inTrn;
+  val = inVal;
+  tst = inTst;
+  for i=1:nPCD,
+    %A network with a node per PCD extracted so far, plus the new one, with the PCDs frozen.
+    trnNet = newff2(inTrn, [-1 1], [i hidNodes{s}(2:end)], trfFuncs{s});
+    trnNet.trainParam = net.trainParam;
+    for l=1:length(trnNet.layers),
+      trnNet.layers{l}.userdata.usingBias = net.layers{l}.userdata.usingBias;
+    end
+    if i > 1,
+      trnNet.IW{1}(1:(i-1),:) = matPCD;
+      trnNet.b{1}(1:(i-1)) = matBias;
+      trnNet.layers{1}.userdata.frozenNodes = (1:(i-1));
+    end
+
+    %At the Caloba style, the last PCD is removed from the events.
+    if caloba && (i > 1),
+      lastPCD = matPCD(end,:);
+      for c=1:length(trn),
+        trn{c} = trn{c} - ( lastPCD' * (lastPCD * trn{c}) );
+        val{c} = val{c} - ( lastPCD' * (lastPCD * val{c}) );
+        tst{c} = tst{c} - ( lastPCD' * (lastPCD * tst{c}) );
+      end
+    end
+
+    %Keeping the best of numIterations trainings (by the testing SP).
+    bestSP = -1;
+    for it=1:numIterations,
+      trnNet = scrambleWeights(trnNet);
+      if caloba,
+        %Pointing the new node away from the PCDs already extracted.
+        sw = trnNet.IW{1}(end,:);
+        for k=1:(i-1),
+          pw = trnNet.IW{1}(k,:);
+          trnNet.IW{1}(end,:) = trnNet.IW{1}(end,:) - ( (pw*sw') / (pw*pw') )*pw;
+        end
+      end
+      outNet = ntrain(trnNet, trn, val);
+      out = nsim(outNet, tst);
+      sp = max(genROC(out{1}, out{2}));
+      if sp > bestSP,
+        bestSP = sp;
+        bestNet = outNet;
+      end
+    end
+
+    newPCD = bestNet.IW{1}(end,:);
+    if caloba,
+      newPCD = newPCD ./ norm(newPCD);
+    end
+    matPCD = [matPCD; newPCD];
+    matBias = bestNet.b{1};
+    matSP(i) = bestSP;
+  end
+  matTime = toc;
+
+  %The largest principal angle between the subspaces spanned by the first k PCDs of each version.
+  fprintf('\n%s style: native %.2f s, Matlab %.2f s (%.1fx)\n', styles{s}, nativeTime, matTime, matTime / nativeTime);
+  fprintf('%-6s %12s %12s %14s\n', 'PCD', 'SP native', 'SP Matlab', 'Angle (deg)');
+  for k=1:nPCD,
+    angle = 180 / pi * subspace(nativePCD(1:k,:)', matPCD(1:k,:)');
+    fprintf('%-6d %12.5f %12.5f %14.2f\n', k, nativeSP(k), matSP(k), angle);
+  end
+
+  %At the Caloba style, the PCDs must be orthonormal.
+  if caloba,
+    fprintf('Max |PCD * PCD'' - I|: native %.2g, Matlab %.2g\n', max(max(abs(nativePCD*nativePCD' - eye(nPCD)))), ...
+            max(max(abs(matPCD*matPCD' - eye(nPCD)))));
+  end
+end
@@ -0,0 +1,59 @@
+clear all;
+close all;
+
+%Accuracy versus speed report for the quantized (fixed point) networks.
+%A network is trained over the two gaussians problem of validate_sp.m, and
+%then propagated in floating point and quantized to int8 and int16 (calibrated
+%over the training set). The output deviation from the floating point network,
+%the SP loss on the testing set and the simulation times are reported.
+
+%Creating the data for validation.
+nClasses = 2;
+Nev = 12000;
+c1 = [randn(1,Nev); randn(1,Nev)];
+c2 = [2.5 + randn(1,Nev); 2.5 + randn(1,Nev)];
+
+%Creating the training, validating and testing data sets.
+inTrn = {c1(:,1:3:end) c2(:,1:3:end)};
+inVal = {c1(:,2:3:end) c2(:,2:3:end)};
+inTst = {c1(:,3:3:end) c2(:,3:3:end)};
+
+%Creating and training the neural network.
+inNet = newff2(inTrn, [1 -1], 2, {'tansig', 'tansig'});
+inNet.trainParam.epochs = 3000;
+inNet.trainParam.max_fail = 20;
+inNet.trainParam.show = 1000000;
+inNet.trainParam.batchSize = 1000;
+inNet.trainParam.useSP = true;
+net = ntrain(inNet, inTrn, inVal);
+
+%Large input set for measuring the simulation speed.
+inSpeed = randn(2, 1000000);
+calib = [inTrn{:}];
+
+modes = {'float', 'int8', 'int16'};
+nModes = length(modes);
+sp = zeros(1,nModes);
+maxDev = zeros(1,nModes);
+meanDev = zeros(1,nModes);
+simTime = zeros(1,nModes);
+
+floatOut = nsim(net, inTst);
+for i=1:nModes,
+  out = nsim(net, inTst, modes{i}, calib);
+  spVec = genROC(out{1}, out{2});
+  sp(i) = max(spVec);
+  dev = abs([out{:}] - [floatOut{:}]);
+  maxDev(i) = max(dev);
+  meanDev(i) = mean(dev);
+
+  tic
+  nsim(net, inSpeed, modes{i}, calib);
+  simTime(i) = toc;
+end
+
+fprintf('\n%-10s %10s %10s %12s %12s %12s\n', 'Mode', 'SP', 'SP loss', 'Max dev', 'Mean dev', 'Sim (s)');
+for i=1:nModes,
+  fprintf('%-10s %10.5f %10.5f %12.3g %12.3g %12.3f\n', modes{i}, sp(i), sp(1) - sp(i), ...
+          maxDev(i), meanDev(i), simTime(i));
+end
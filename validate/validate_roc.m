@@ -0,0 +1,111 @@
+clear all;
+close all;
+
+%Checks the exact ROC engine (nroc, through roc_c) against brute force, over 200
+%random output sets. The outputs are rounded to a few decimals, so there are many
+%ties, and some sets also hold NaN, +/-0 and +/-Inf outputs. For every set, the
+%exact ROC (every distinct output as a threshold, followed by Inf) and the ROC at
+%given thresholds (some of them NaN) are compared with the efficiencies counted
+%directly at each threshold, as getEff does. The AUC is compared with the fraction
+%of the (signal, noise) pairs where the signal output is above the noise one,
+%counting ties as half. A NaN output is never taken as signal, but it still counts
+%in the efficiency denominators. The last point of the exact ROC takes no event as
+%signal, not even an infinite one. Every 50th set is large enough for the parallel
+%sort. For those sets, the AUC is counted per distinct output instead of per pair.
+%Since all the efficiencies come from integer counts, every deviation should be 0.
+
+numSets = 200;
+maxDev = zeros(2,3);
+cutMiss = zeros(1,2);
+aucDev = 0;
+bestMiss = zeros(1,2);
+
+for k=1:numSets,
+  %Creating the outputs.
+  large = (mod(k, 50) == 0);
+  if large,
+    ns = 150000 + randi(150000);
+    nn = 150000 + randi(150000);
+    dec = 2;
+  else
+    ns = randi(2000);
+    nn = randi(2000);
+    dec = randi(3);
+  end
+  s = round((randn(1,ns) + 1) * 10^dec) / 10^dec;
+  n = round(randn(1,nn) * 10^dec) / 10^dec;
+  if mod(k, 5) == 0,
+    s(randi(ns, 1, ceil(ns/100))) = NaN;
+    n(randi(nn, 1, ceil(nn/100))) = NaN;
+  end
+  if mod(k, 7) == 0,
+    s(randi(ns, 1, 3)) = [-0 Inf -Inf];
+    n(randi(nn, 1, 3)) = [0 Inf -Inf];
+  end
+  if mod(k, 2) == 0,
+    sw = 0.5 + rand();
+    nw = 0.5 + rand();
+  else
+    sw = 1;
+    nw = 1;
+  end
+
+  %The exact ROC, and the one at some of its thresholds plus random and NaN ones.
+  [sp, cut, det, fa, auc, best] = nroc(s, n, [], sw, nw);
+  vals = unique([s(~isnan(s)) n(~isnan(n))]);
+  cuts = [vals(randi(length(vals), 1, 20)) randn(1,20) NaN Inf -Inf];
+  [fSP, fCut, fDet, fFa, fAuc, fBest] = nroc(s, n, cuts, sw, nw);
+  exact = {[vals Inf], cut, det, fa, sp, best};
+  fixed = {cuts, fCut, fDet, fFa, fSP, fBest};
+
+  %Counting the efficiencies directly at every threshold (the last exact point takes no event).
+  for m=1:2,
+    if m == 1, r = exact; else r = fixed; end
+    c = r{1};
+    bfDet = zeros(1,length(c));
+    bfFa = zeros(1,length(c));
+    bfBelow = zeros(1,length(c));
+    for i=1:length(c),
+      bfDet(i) = sum(s >= c(i)) / ns;
+      bfFa(i) = sum(n >= c(i)) / nn;
+      bfBelow(i) = sum(n < c(i)) / nn;
+    end
+    if m == 1,
+      bfDet(end) = 0;
+      bfFa(end) = 0;
+      bfBelow(end) = sum(~isnan(n)) / nn;
+    end
+    se = bfDet * sw;
+    ne = bfBelow * nw;
+    bfSP = sqrt(((se + ne) / 2) .* sqrt(se .* ne));
+    [aux, bfBest] = max(bfSP);
+
+    %Comparing (a NaN threshold must be kept as NaN, and -0 equals +0).
+    if (length(r{2}) ~= length(c)) || any((r{2} ~= c) & ~(isnan(r{2}) & isnan(c))),
+      cutMiss(m) = cutMiss(m) + 1;
+      continue;
+    end
+    maxDev(m,1) = max(maxDev(m,1), max(abs(bfDet - r{3})));
+    maxDev(m,2) = max(maxDev(m,2), max(abs(bfFa - r{4})));
+    maxDev(m,3) = max(maxDev(m,3), max(abs(bfSP - r{5})));
+    bestMiss(m) = bestMiss(m) + (bfBest ~= r{6});
+  end
+
+  %The AUC, by pairs (or by distinct output, at the large sets).
+  if large,
+    bfAuc = 0;
+    for v=vals,
+      bfAuc = bfAuc + sum(n == v) * (sum(s > v) + 0.5 * sum(s == v));
+    end
+  else
+    bfAuc = sum(sum(bsxfun(@gt, s', n))) + 0.5 * sum(sum(bsxfun(@eq, s', n)));
+  end
+  bfAuc = bfAuc / (ns * nn);
+  aucDev = max([aucDev abs(bfAuc - auc) abs(bfAuc - fAuc)]);
+end
+
+fprintf('%d random sets (max deviation from brute force)\n', numSets);
+fprintf('%-12s %10s %12s %12s %12s %12s\n', 'ROC', 'Cut misses', 'Det', 'FA', 'SP', 'Best misses');
+fprintf('%-12s %10d %12.3g %12.3g %12.3g %12d\n', 'exact', cutMiss(1), maxDev(1,1), maxDev(1,2), maxDev(1,3), bestMiss(1));
+fprintf('%-12s %10d %12.3g %12.3g %12.3g %12d\n', 'thresholds', cutMiss(2), maxDev(2,1), maxDev(2,2), maxDev(2,3), bestMiss(2));
+fprintf('AUC: %.3g\n', aucDev);
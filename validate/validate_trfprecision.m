@@ -0,0 +1,70 @@
+clear all;
+close all;
+
+%Accuracy versus speed report for the transfer functions precision modes.
+%The same network (same initial weights) is trained with each mode
+%over the two gaussians problem of validate_sp.m, and the SP and MSE on the
+%testing set, as well as the training and simulation times are reported.
+%The maximum tansig error of the rational mode is 2.6e-8 with double and
+%4e-7 with single precision, and 1.5e-6 for the table mode with both (see
+%activations.h). The output deviation reported below may be larger, since
+%the errors of the hidden layer propagate to the output layer.
+
+%Creating the data for validation.
+nClasses = 2;
+Nev = 12000;
+c1 = [randn(1,Nev); randn(1,Nev)];
+c2 = [2.5 + randn(1,Nev); 2.5 + randn(1,Nev)];
+
+%Creating the training, validating and testing data sets.
+inTrn = {c1(:,1:3:end) c2(:,1:3:end)};
+inVal = {c1(:,2:3:end) c2(:,2:3:end)};
+inTst = {c1(:,3:3:end) c2(:,3:3:end)};
+
+%Creating the neural network.
+inNet = newff2(inTrn, [1 -1], 2, {'tansig', 'tansig'});
+inNet.trainParam.epochs = 3000;
+inNet.trainParam.max_fail = 20;
+inNet.trainParam.show = 1000000;
+inNet.trainParam.batchSize = 1000;
+inNet.trainParam.useSP = true;
+
+%Large input set for measuring the simulation speed.
+inSpeed = randn(2, 1000000);
+
+modes = {'exact', 'rational', 'table'};
+nModes = length(modes);
+sp = zeros(1,nModes);
+mse = zeros(1,nModes);
+trnTime = zeros(1,nModes);
+simTime = zeros(1,nModes);
+maxDiff = zeros(1,nModes);
+
+for i=1:nModes,
+  inNet.userdata.trfPrecision = modes{i};
+
+  tic
+  [net{i}, evo{i}] = ntrain(inNet, inTrn, inVal);
+  trnTime(i) = toc;
+
+  out = nsim(net{i}, inTst);
+  [spVec, cut, det, fa] = genROC(out{1}, out{2});
+  sp(i) = max(spVec);
+  mse(i) = mean([(out{1} - 1).^2 (out{2} + 1).^2]);
+
+  tic
+  nsim(net{i}, inSpeed);
+  simTime(i) = toc;
+
+  %Output deviation from the exact mode, for the same weights.
+  exactNet = net{i};
+  exactNet.userdata.trfPrecision = 'exact';
+  exactOut = nsim(exactNet, inTst);
+  maxDiff(i) = max(abs([out{:}] - [exactOut{:}]));
+end
+
+fprintf('\n%-10s %10s %10s %12s %12s %12s %12s\n', 'Mode', 'SP', 'MSE', 'Epochs', 'Train (s)', 'Sim (s)', 'Max diff');
+for i=1:nModes,
+  fprintf('%-10s %10.5f %10.6f %12d %12.3f %12.3f %12.3g\n', modes{i}, sp(i), mse(i), ...
+          double(evo{i}.epoch(end)), trnTime(i), simTime(i), maxDiff(i));
+end